@@ -0,0 +1,28 @@
+
+# generate the isa specific variant of an arch layer implementation
+# the class, layer creator, header name and include guard get the isa suffix
+# so that all variants can live in one library
+macro(ncnn_generate_arch_opt_source class arch arch_opt SRC_DIR DST_DIR)
+    string(TOLOWER ${class} name)
+    string(TOUPPER ${name} NAME)
+    string(TOUPPER ${arch} ARCH)
+    string(TOUPPER ${arch_opt} ARCH_OPT)
+
+    foreach(ext cpp h)
+        set(ARCH_SRC ${SRC_DIR}/${name}_${arch}.${ext})
+        set(ARCH_OPT_DST ${DST_DIR}/${name}_${arch}_${arch_opt}.${ext})
+
+        file(READ ${ARCH_SRC} arch_opt_source)
+        string(REPLACE "${class}_${arch}" "${class}_${arch}_${arch_opt}" arch_opt_source "${arch_opt_source}")
+        string(REPLACE "\"${name}_${arch}.h\"" "\"${name}_${arch}_${arch_opt}.h\"" arch_opt_source "${arch_opt_source}")
+        string(REPLACE "LAYER_${NAME}_${ARCH}_H" "LAYER_${NAME}_${ARCH}_${ARCH_OPT}_H" arch_opt_source "${arch_opt_source}")
+
+        # only touch the generated file when the content changes
+        file(WRITE ${ARCH_OPT_DST}.tmp "${arch_opt_source}")
+        configure_file(${ARCH_OPT_DST}.tmp ${ARCH_OPT_DST} COPYONLY)
+        file(REMOVE ${ARCH_OPT_DST}.tmp)
+
+        # regenerate when the arch source changes
+        set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${ARCH_SRC})
+    endforeach()
+endmacro()
@@ -0,0 +1,121 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "autotune.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "cpu.h"
+
+namespace ncnn {
+
+AutoTuner::AutoTuner()
+{
+    repeat = 3;
+}
+
+#if NCNN_STDIO
+int AutoTuner::load(const char* path)
+{
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", path);
+        return -1;
+    }
+
+    MutexLockGuard guard(lock);
+
+    char line[1024];
+    while (fgets(line, 1024, fp))
+    {
+        if (line[0] == '#')
+            continue;
+
+        // the impl is the last token
+        char* p = strrchr(line, ' ');
+        if (!p || p == line)
+            continue;
+
+        int impl = 0;
+        if (sscanf(p + 1, "%d", &impl) != 1)
+            continue;
+
+        records[std::string(line, p - line)] = impl;
+    }
+
+    fclose(fp);
+
+    return 0;
+}
+
+int AutoTuner::save(const char* path) const
+{
+    FILE* fp = fopen(path, "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", path);
+        return -1;
+    }
+
+    MutexLockGuard guard(lock);
+
+    fprintf(fp, "# ncnn autotune, cpu|layer|w,h,c,elempack|threads impl\n");
+
+    std::map<std::string, int>::const_iterator it = records.begin();
+    for (; it != records.end(); it++)
+    {
+        fprintf(fp, "%s %d\n", it->first.c_str(), it->second);
+    }
+
+    fclose(fp);
+
+    return 0;
+}
+#endif // NCNN_STDIO
+
+void AutoTuner::clear()
+{
+    MutexLockGuard guard(lock);
+
+    records.clear();
+}
+
+int AutoTuner::find(const std::string& key) const
+{
+    MutexLockGuard guard(lock);
+
+    std::map<std::string, int>::const_iterator it = records.find(key);
+    if (it == records.end())
+        return -1;
+
+    return it->second;
+}
+
+void AutoTuner::insert(const std::string& key, int impl)
+{
+    MutexLockGuard guard(lock);
+
+    records[key] = impl;
+}
+
+std::string AutoTuner::make_key(const char* signature, const Mat& bottom_blob, int num_threads)
+{
+    char shape[128];
+    sprintf(shape, "|%d,%d,%d,%d|t%d", bottom_blob.w, bottom_blob.h, bottom_blob.c, bottom_blob.elempack, num_threads);
+
+    return std::string(get_cpu_model_name()) + "|" + signature + shape;
+}
+
+} // namespace ncnn
@@ -0,0 +1,66 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef NCNN_AUTOTUNE_H
+#define NCNN_AUTOTUNE_H
+
+#include <map>
+#include <string>
+#include "platform.h"
+#include "mat.h"
+
+namespace ncnn {
+
+// runtime kernel selection for layers with more than one implementation
+//
+// on the first forward a layer looks up its key, and on a miss times every
+// candidate on the real input and thread count and inserts the fastest
+// keys carry the cpu model, so one table file can be shared among hosts
+// the table is thread-safe, one tuner may serve several nets and extractors
+class AutoTuner
+{
+public:
+    AutoTuner();
+
+#if NCNN_STDIO
+    // text table with one "key impl" record per line
+    // load merges into the records already present
+    // return 0 if success
+    int load(const char* path);
+    int save(const char* path) const;
+#endif // NCNN_STDIO
+
+    void clear();
+
+    // the impl stored for key, -1 if not tuned yet
+    int find(const std::string& key) const;
+    void insert(const std::string& key, int impl);
+
+    // key of a layer configuration for this cpu, input shape and thread count
+    // signature must not contain blanks
+    static std::string make_key(const char* signature, const Mat& bottom_blob, int num_threads);
+
+public:
+    // timed runs per candidate, the fastest run counts
+    // 3 by default
+    int repeat;
+
+protected:
+    mutable Mutex lock;
+    std::map<std::string, int> records;
+};
+
+} // namespace ncnn
+
+#endif // NCNN_AUTOTUNE_H
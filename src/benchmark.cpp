@@ -53,17 +53,26 @@ double get_current_time()
 
 #if NCNN_BENCHMARK
 
-void benchmark(const Layer* layer, double start, double end)
+void benchmark(const Layer* layer, double start, double end, int num_threads)
 {
     fprintf(stderr, "%-24s %-30s %8.2lfms", layer->type.c_str(), layer->name.c_str(), end - start);
     fprintf(stderr, "    |");
+    if (num_threads)
+    {
+        fprintf(stderr, "    threads: %2d", num_threads);
+    }
     fprintf(stderr, "\n");
 }
 
-void benchmark(const Layer* layer, const Mat& bottom_blob, Mat& top_blob, double start, double end)
+void benchmark(const Layer* layer, const Mat& bottom_blob, Mat& top_blob, double start, double end, int num_threads)
 {
     fprintf(stderr, "%-24s %-30s %8.2lfms", layer->type.c_str(), layer->name.c_str(), end - start);
-    fprintf(stderr, "    |    feature_map: %4d x %-4d    inch: %4d    outch: %4d", bottom_blob.w, bottom_blob.h, bottom_blob.c, top_blob.c);
+    fprintf(stderr, "    |");
+    if (num_threads)
+    {
+        fprintf(stderr, "    threads: %2d", num_threads);
+    }
+    fprintf(stderr, "    feature_map: %4d x %-4d    inch: %4d    outch: %4d", bottom_blob.w, bottom_blob.h, bottom_blob.c, top_blob.c);
     if (layer->type == "Convolution")
     {
         fprintf(stderr, "     kernel: %1d x %1d     stride: %1d x %1d",
@@ -26,8 +26,9 @@ double get_current_time();
 
 #if NCNN_BENCHMARK
 
-void benchmark(const Layer* layer, double start, double end);
-void benchmark(const Layer* layer, const Mat& bottom_blob, Mat& top_blob, double start, double end);
+// num_threads is printed when it is not zero
+void benchmark(const Layer* layer, double start, double end, int num_threads = 0);
+void benchmark(const Layer* layer, const Mat& bottom_blob, Mat& top_blob, double start, double end, int num_threads = 0);
 
 #endif // NCNN_BENCHMARK
 
@@ -16,18 +16,28 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <string>
 #include <vector>
 
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
-#ifdef __ANDROID__
+#if defined __ANDROID__ || defined __linux__
 #include <sys/syscall.h>
 #include <unistd.h>
 #include <stdint.h>
 #endif
 
+#if defined __i386__ || defined __x86_64__ || defined _M_IX86 || defined _M_X64
+#define NCNN_CPU_X86 1
+#if defined _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
 #if __APPLE__
 #include "TargetConditionals.h"
 #if TARGET_OS_IPHONE
@@ -40,6 +50,71 @@
 
 namespace ncnn {
 
+CpuSet::CpuSet()
+{
+    disable_all();
+}
+
+void CpuSet::enable(int cpu)
+{
+    if (cpu < 0 || cpu >= MAX_CPU_COUNT)
+        return;
+
+    const int nbits = 8 * sizeof(unsigned long);
+    bits[cpu / nbits] |= 1UL << (cpu % nbits);
+}
+
+void CpuSet::disable(int cpu)
+{
+    if (cpu < 0 || cpu >= MAX_CPU_COUNT)
+        return;
+
+    const int nbits = 8 * sizeof(unsigned long);
+    bits[cpu / nbits] &= ~(1UL << (cpu % nbits));
+}
+
+void CpuSet::disable_all()
+{
+    memset(bits, 0, sizeof(bits));
+}
+
+bool CpuSet::is_enabled(int cpu) const
+{
+    if (cpu < 0 || cpu >= MAX_CPU_COUNT)
+        return false;
+
+    const int nbits = 8 * sizeof(unsigned long);
+    return (bits[cpu / nbits] >> (cpu % nbits)) & 1UL;
+}
+
+int CpuSet::num_enabled() const
+{
+    int count = 0;
+    for (int i=0; i<MAX_CPU_COUNT; i++)
+    {
+        if (is_enabled(i))
+            count++;
+    }
+
+    return count;
+}
+
+int CpuSet::nth_enabled(int n) const
+{
+    for (int i=0; i<MAX_CPU_COUNT; i++)
+    {
+        if (!is_enabled(i))
+            continue;
+
+        if (n == 0)
+            return i;
+
+        n--;
+    }
+
+    return -1;
+}
+
 #ifdef __ANDROID__
 
 // extract the ELF HW capabilities bitmap from /proc/self/auxv
@@ -191,6 +266,149 @@ int cpu_support_arm_asimdhp()
 #endif
 }
 
+#if NCNN_CPU_X86
+static void x86_cpuid(int level, int count, unsigned int regs[4])
+{
+#if defined _MSC_VER
+    __cpuidex((int*)regs, level, count);
+#else
+    __cpuid_count(level, count, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned int x86_get_xcr0()
+{
+#if defined _MSC_VER
+    return (unsigned int)_xgetbv(0);
+#else
+    // xgetbv, spelled out for assemblers without xsave support
+    unsigned int eax = 0;
+    unsigned int edx = 0;
+    __asm__ volatile(".byte 0x0f, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c"(0));
+    return eax;
+#endif
+}
+
+static int get_cpu_support_x86_avx()
+{
+    unsigned int regs[4];
+    x86_cpuid(0, 0, regs);
+    if (regs[0] < 1)
+        return 0;
+
+    x86_cpuid(1, 0, regs);
+
+    // avx + osxsave
+    if (!(regs[2] & (1u << 28)) || !(regs[2] & (1u << 27)))
+        return 0;
+
+    // xmm and ymm state enabled by os
+    return (x86_get_xcr0() & 6) == 6;
+}
+
+static int get_cpu_support_x86_fma()
+{
+    if (!get_cpu_support_x86_avx())
+        return 0;
+
+    unsigned int regs[4];
+    x86_cpuid(1, 0, regs);
+    return (regs[2] >> 12) & 1;
+}
+
+static int get_cpu_support_x86_avx2()
+{
+    if (!get_cpu_support_x86_avx())
+        return 0;
+
+    unsigned int regs[4];
+    x86_cpuid(0, 0, regs);
+    if (regs[0] < 7)
+        return 0;
+
+    x86_cpuid(7, 0, regs);
+    return (regs[1] >> 5) & 1;
+}
+
+static int get_cpu_support_x86_avx512()
+{
+    if (!get_cpu_support_x86_avx2())
+        return 0;
+
+    unsigned int regs[4];
+    x86_cpuid(7, 0, regs);
+
+    // f cd bw dq vl
+    const unsigned int avx512_mask = (1u << 16) | (1u << 28) | (1u << 30) | (1u << 17) | (1u << 31);
+    if ((regs[1] & avx512_mask) != avx512_mask)
+        return 0;
+
+    // opmask, upper zmm and hi16 zmm state enabled by os
+    return (x86_get_xcr0() & 0xe6) == 0xe6;
+}
+
+static int get_cpu_support_x86_avx512_vnni()
+{
+    if (!get_cpu_support_x86_avx512())
+        return 0;
+
+    unsigned int regs[4];
+    x86_cpuid(7, 0, regs);
+    return (regs[2] >> 11) & 1;
+}
+
+static int g_cpu_support_x86_avx = get_cpu_support_x86_avx();
+static int g_cpu_support_x86_fma = get_cpu_support_x86_fma();
+static int g_cpu_support_x86_avx2 = get_cpu_support_x86_avx2();
+static int g_cpu_support_x86_avx512 = get_cpu_support_x86_avx512();
+static int g_cpu_support_x86_avx512_vnni = get_cpu_support_x86_avx512_vnni();
+#endif // NCNN_CPU_X86
+
+int cpu_support_x86_avx()
+{
+#if NCNN_CPU_X86
+    return g_cpu_support_x86_avx;
+#else
+    return 0;
+#endif
+}
+
+int cpu_support_x86_fma()
+{
+#if NCNN_CPU_X86
+    return g_cpu_support_x86_fma;
+#else
+    return 0;
+#endif
+}
+
+int cpu_support_x86_avx2()
+{
+#if NCNN_CPU_X86
+    return g_cpu_support_x86_avx2;
+#else
+    return 0;
+#endif
+}
+
+int cpu_support_x86_avx512()
+{
+#if NCNN_CPU_X86
+    return g_cpu_support_x86_avx512;
+#else
+    return 0;
+#endif
+}
+
+int cpu_support_x86_avx512_vnni()
+{
+#if NCNN_CPU_X86
+    return g_cpu_support_x86_avx512_vnni;
+#else
+    return 0;
+#endif
+}
+
 static int get_cpucount()
 {
 #ifdef __ANDROID__
@@ -244,7 +462,94 @@ int get_cpu_count()
     return g_cpucount;
 }
 
-#ifdef __ANDROID__
+static std::string get_cpumodelname()
+{
+    char name[256];
+    const int size = 256;
+
+    name[0] = '\0';
+
+#if NCNN_CPU_X86
+    unsigned int regs[4];
+    x86_cpuid(0x80000000, 0, regs);
+    if (regs[0] >= 0x80000004 && size > 48)
+    {
+        // brand string from the extended leaves
+        for (int i=0; i<3; i++)
+        {
+            x86_cpuid(0x80000002 + i, 0, regs);
+            memcpy(name + i * 16, regs, 16);
+        }
+        name[48] = '\0';
+    }
+#elif defined __ANDROID__ || defined __linux__
+    FILE* fp = fopen("/proc/cpuinfo", "rb");
+    if (fp)
+    {
+        char line[1024];
+        while (!feof(fp))
+        {
+            char* s = fgets(line, 1024, fp);
+            if (!s)
+                break;
+
+            // arm kernels report Hardware, others model name
+            if (memcmp(line, "model name", 10) == 0 || memcmp(line, "Hardware", 8) == 0)
+            {
+                const char* p = strchr(line, ':');
+                if (p)
+                {
+                    p++;
+                    while (*p == ' ' || *p == '\t')
+                        p++;
+
+                    strncpy(name, p, size - 1);
+                    name[size - 1] = '\0';
+                    break;
+                }
+            }
+        }
+
+        fclose(fp);
+    }
+#endif
+
+    // trim and fold blanks so the name is a single token
+    int len = 0;
+    for (int i=0; name[i]; i++)
+    {
+        char c = name[i];
+        if (c == '\n' || c == '\r')
+            break;
+
+        if (c == ' ' || c == '\t')
+        {
+            if (len == 0 || name[len - 1] == '_')
+                continue;
+
+            c = '_';
+        }
+
+        name[len++] = c;
+    }
+    while (len > 0 && name[len - 1] == '_')
+        len--;
+    name[len] = '\0';
+
+    if (len == 0)
+        return "unknown";
+
+    return name;
+}
+
+static std::string g_cpumodelname = get_cpumodelname();
+
+const char* get_cpu_model_name()
+{
+    return g_cpumodelname.c_str();
+}
+
+#if defined __ANDROID__ || defined __linux__
 static int get_max_freq_khz(int cpuid)
 {
     // first try, for all possible cpu
@@ -316,25 +621,12 @@ static int get_max_freq_khz(int cpuid)
     return max_freq_khz;
 }
 
-static int set_sched_affinity(const std::vector<int>& cpuids)
+static int set_sched_affinity(const CpuSet& mask)
 {
-    // cpu_set_t definition
-    // ref http://stackoverflow.com/questions/16319725/android-set-thread-affinity
-#define CPU_SETSIZE 1024
-#define __NCPUBITS  (8 * sizeof (unsigned long))
-typedef struct
-{
-   unsigned long __bits[CPU_SETSIZE / __NCPUBITS];
-} cpu_set_t;
-
-#define CPU_SET(cpu, cpusetp) \
-  ((cpusetp)->__bits[(cpu)/__NCPUBITS] |= (1UL << ((cpu) % __NCPUBITS)))
-
-#define CPU_ZERO(cpusetp) \
-  memset((cpusetp), 0, sizeof(cpu_set_t))
-
     // set affinity for thread
-#ifdef __GLIBC__
+    // the raw bitmask layout is the same as the kernel cpu_set_t
+    // ref http://stackoverflow.com/questions/16319725/android-set-thread-affinity
+#if defined __GLIBC__ || !defined __ANDROID__
     pid_t pid = syscall(SYS_gettid);
 #else
 #ifdef PI3
@@ -343,14 +635,8 @@ typedef struct
     pid_t pid = gettid();
 #endif
 #endif
-    cpu_set_t mask;
-    CPU_ZERO(&mask);
-    for (int i=0; i<(int)cpuids.size(); i++)
-    {
-        CPU_SET(cpuids[i], &mask);
-    }
 
-    int syscallret = syscall(__NR_sched_setaffinity, pid, sizeof(mask), &mask);
+    int syscallret = syscall(__NR_sched_setaffinity, pid, sizeof(mask.bits), mask.bits);
     if (syscallret)
     {
         fprintf(stderr, "syscall error %d\n", syscallret);
@@ -360,6 +646,57 @@ typedef struct
     return 0;
 }
 
+// parse cpu list format like 0-3,8,10-11 from sysfs
+static int parse_cpu_list(const char* s, CpuSet& mask)
+{
+    while (*s)
+    {
+        int first = 0;
+        int last = 0;
+        int nconsumed = 0;
+        if (sscanf(s, "%d-%d%n", &first, &last, &nconsumed) != 2)
+        {
+            if (sscanf(s, "%d%n", &first, &nconsumed) != 1)
+                return -1;
+
+            last = first;
+        }
+
+        for (int i=first; i<=last; i++)
+        {
+            mask.enable(i);
+        }
+
+        s += nconsumed;
+        if (*s != ',')
+            break;
+
+        s++;
+    }
+
+    return 0;
+}
+
+static int get_thread_siblings(int cpuid, CpuSet& siblings)
+{
+    char path[256];
+    sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpuid);
+
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+        return -1;
+
+    char line[1024];
+    char* s = fgets(line, 1024, fp);
+
+    fclose(fp);
+
+    if (!s)
+        return -1;
+
+    return parse_cpu_list(line, siblings);
+}
+
 static int sort_cpuid_by_max_frequency(std::vector<int>& cpuids, int* little_cluster_offset)
 {
     const int cpu_count = cpuids.size();
@@ -374,11 +711,10 @@ static int sort_cpuid_by_max_frequency(std::vector<int>& cpuids, int* little_clu
 
     for (int i=0; i<cpu_count; i++)
     {
-        int max_freq_khz = get_max_freq_khz(i);
+        int max_freq_khz = get_max_freq_khz(cpuids[i]);
 
-        // printf("%d max freq = %d khz\n", i, max_freq_khz);
+        // printf("%d max freq = %d khz\n", cpuids[i], max_freq_khz);
 
-        cpuids[i] = i;
         cpu_max_freq_khz[i] = max_freq_khz;
     }
 
@@ -418,7 +754,130 @@ static int sort_cpuid_by_max_frequency(std::vector<int>& cpuids, int* little_clu
 
     return 0;
 }
-#endif // __ANDROID__
+#endif // __ANDROID__ || __linux__
+
+static CpuSet get_process_affinity_mask()
+{
+    CpuSet mask;
+
+#if defined __ANDROID__ || defined __linux__
+    // the kernel already intersects this with the cgroup cpuset
+    int syscallret = syscall(__NR_sched_getaffinity, getpid(), sizeof(mask.bits), mask.bits);
+    if (syscallret > 0 && mask.num_enabled() > 0)
+        return mask;
+
+    mask.disable_all();
+#endif
+
+    for (int i=0; i<g_cpucount; i++)
+    {
+        mask.enable(i);
+    }
+
+    return mask;
+}
+
+static CpuSet g_process_affinity_mask = get_process_affinity_mask();
+
+const CpuSet& get_cpu_process_affinity_mask()
+{
+    return g_process_affinity_mask;
+}
+
+CpuSet get_cpu_physical_core_mask(const CpuSet& mask)
+{
+    CpuSet physical_mask;
+
+    for (int i=0; i<CpuSet::MAX_CPU_COUNT; i++)
+    {
+        if (!mask.is_enabled(i))
+            continue;
+
+#if defined __ANDROID__ || defined __linux__
+        CpuSet siblings;
+        if (get_thread_siblings(i, siblings) == 0)
+        {
+            // skip if a lower numbered sibling of the same core is kept
+            bool has_lower_sibling = false;
+            for (int j=0; j<i; j++)
+            {
+                if (siblings.is_enabled(j) && mask.is_enabled(j))
+                {
+                    has_lower_sibling = true;
+                    break;
+                }
+            }
+
+            if (has_lower_sibling)
+                continue;
+        }
+#endif
+
+        physical_mask.enable(i);
+    }
+
+    return physical_mask;
+}
+
+int set_cpu_thread_affinity(const CpuSet& mask, int num_threads)
+{
+#if defined __ANDROID__ || defined __linux__
+    const int num_cpus = mask.num_enabled();
+    if (num_cpus == 0)
+    {
+        fprintf(stderr, "empty cpu affinity mask\n");
+        return -1;
+    }
+
+    if (num_threads < 1)
+        num_threads = 1;
+
+    // pin one thread per cpu if there are enough cpus
+    std::vector<CpuSet> thread_masks(num_threads);
+    for (int i=0; i<num_threads; i++)
+    {
+        if (num_threads <= num_cpus)
+        {
+            thread_masks[i].enable(mask.nth_enabled(i));
+        }
+        else
+        {
+            thread_masks[i] = mask;
+        }
+    }
+
+#ifdef _OPENMP
+    // openmp keeps the same worker threads for teams of the same size
+    // so the placement persists across the parallel regions of all layers
+    std::vector<int> ssarets(num_threads, 0);
+    #pragma omp parallel num_threads(num_threads)
+    {
+        int i = omp_get_thread_num();
+        ssarets[i] = set_sched_affinity(thread_masks[i]);
+    }
+    for (int i=0; i<num_threads; i++)
+    {
+        if (ssarets[i] != 0)
+        {
+            return -1;
+        }
+    }
+#else
+    int ssaret = set_sched_affinity(thread_masks[0]);
+    if (ssaret != 0)
+    {
+        return -1;
+    }
+#endif
+
+    return 0;
+#else
+    // TODO
+    (void) mask;
+    (void) num_threads;
+    return -1;
+#endif
+}
 
 static int g_powersave = 0;
 
@@ -429,17 +888,18 @@ int get_cpu_powersave()
 
 int set_cpu_powersave(int powersave)
 {
-#ifdef __ANDROID__
+#if defined __ANDROID__ || defined __linux__
     static std::vector<int> sorted_cpuids;
     static int little_cluster_offset = 0;
 
     if (sorted_cpuids.empty())
     {
-        // 0 ~ g_cpucount
-        sorted_cpuids.resize(g_cpucount);
-        for (int i=0; i<g_cpucount; i++)
+        // cpus allowed for this process
+        const int num_cpus = g_process_affinity_mask.num_enabled();
+        sorted_cpuids.resize(num_cpus);
+        for (int i=0; i<num_cpus; i++)
         {
-            sorted_cpuids[i] = i;
+            sorted_cpuids[i] = g_process_affinity_mask.nth_enabled(i);
         }
 
         // descent sort by max frequency
@@ -472,6 +932,12 @@ int set_cpu_powersave(int powersave)
         return -1;
     }
 
+    CpuSet mask;
+    for (int i=0; i<(int)cpuids.size(); i++)
+    {
+        mask.enable(cpuids[i]);
+    }
+
 #ifdef _OPENMP
     // set affinity for each thread
     int num_threads = cpuids.size();
@@ -480,7 +946,7 @@ int set_cpu_powersave(int powersave)
     #pragma omp parallel for
     for (int i=0; i<num_threads; i++)
     {
-        ssarets[i] = set_sched_affinity(cpuids);
+        ssarets[i] = set_sched_affinity(mask);
     }
     for (int i=0; i<num_threads; i++)
     {
@@ -490,7 +956,7 @@ int set_cpu_powersave(int powersave)
         }
     }
 #else
-    int ssaret = set_sched_affinity(cpuids);
+    int ssaret = set_sched_affinity(mask);
     if (ssaret != 0)
     {
         return -1;
@@ -17,6 +17,25 @@
 
 namespace ncnn {
 
+// a set of logical cpu ids
+// bit layout matches the kernel cpu_set_t on linux and android
+class CpuSet
+{
+public:
+    CpuSet();
+    void enable(int cpu);
+    void disable(int cpu);
+    void disable_all();
+    bool is_enabled(int cpu) const;
+    int num_enabled() const;
+    // the n-th enabled cpu id in ascending order, -1 if out of range
+    int nth_enabled(int n) const;
+
+public:
+    enum { MAX_CPU_COUNT = 1024 };
+    unsigned long bits[MAX_CPU_COUNT / (8 * sizeof(unsigned long))];
+};
+
 // test optional cpu features
 // neon = armv7 neon or aarch64 asimd
 int cpu_support_arm_neon();
@@ -24,13 +43,26 @@ int cpu_support_arm_neon();
 int cpu_support_arm_vfpv4();
 // asimdhp = aarch64 asimd half precision
 int cpu_support_arm_asimdhp();
+// avx = x86 avx with os ymm state support
+int cpu_support_x86_avx();
+// fma = x86 fma3
+int cpu_support_x86_fma();
+// avx2 = x86 avx2
+int cpu_support_x86_avx2();
+// avx512 = x86 avx512 f + cd + bw + dq + vl with os zmm state support
+int cpu_support_x86_avx512();
+// avx512vnni = x86 avx512 vnni on top of avx512
+int cpu_support_x86_avx512_vnni();
 
 // cpu info
 int get_cpu_count();
+// cpu model as a single token without blanks, "unknown" if not available
+// x86 reads the cpuid brand string, linux and android read /proc/cpuinfo
+const char* get_cpu_model_name();
 
 // bind all threads on little clusters if powersave enabled
 // affacts HMP arch cpu like ARM big.LITTLE
-// only implemented on android at the moment
+// only implemented on linux and android at the moment
 // switching powersave is expensive and not thread-safe
 // 0 = all cores enabled(default)
 // 1 = only little clusters enabled
@@ -39,6 +71,22 @@ int get_cpu_count();
 int get_cpu_powersave();
 int set_cpu_powersave(int powersave);
 
+// cpus this process is allowed to run on
+// honors taskset and cgroup cpuset restrictions
+// queried once at startup, only implemented on linux and android at the moment
+const CpuSet& get_cpu_process_affinity_mask();
+
+// keep only the lowest numbered logical cpu of each physical core in mask
+// SMT siblings are read from sysfs cpu topology, cpus without topology info are kept
+CpuSet get_cpu_physical_core_mask(const CpuSet& mask);
+
+// bind the calling thread and its openmp worker threads to cpus in mask
+// thread i is pinned to the i-th enabled cpu if num_threads <= mask.num_enabled()
+// otherwise every thread may float among all cpus in mask
+// only implemented on linux and android at the moment
+// return 0 if success
+int set_cpu_thread_affinity(const CpuSet& mask, int num_threads);
+
 // misc function wrapper for openmp routines
 int get_omp_num_threads();
 void set_omp_num_threads(int num_threads);
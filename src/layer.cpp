@@ -161,6 +161,20 @@ static const layer_registry_entry layer_registry[] =
 
 static const int layer_registry_entry_count = sizeof(layer_registry) / sizeof(layer_registry_entry);
 
+#if NCNN_RUNTIME_CPU_AVX2
+static const layer_registry_entry layer_registry_avx2[] =
+{
+#include "layer_registry_avx2.h"
+};
+#endif // NCNN_RUNTIME_CPU_AVX2
+
+#if NCNN_RUNTIME_CPU_AVX512
+static const layer_registry_entry layer_registry_avx512[] =
+{
+#include "layer_registry_avx512.h"
+};
+#endif // NCNN_RUNTIME_CPU_AVX512
+
 #if NCNN_STRING
 int layer_to_index(const char* type)
 {
@@ -188,7 +202,18 @@ Layer* create_layer(int index)
     if (index < 0 || index >= layer_registry_entry_count)
         return 0;
 
-    layer_creator_func layer_creator = layer_registry[index].creator;
+    // pick the best isa variant supported by this cpu
+    layer_creator_func layer_creator = 0;
+#if NCNN_RUNTIME_CPU_AVX512
+    if (!layer_creator && cpu_support_x86_avx512())
+        layer_creator = layer_registry_avx512[index].creator;
+#endif // NCNN_RUNTIME_CPU_AVX512
+#if NCNN_RUNTIME_CPU_AVX2
+    if (!layer_creator && cpu_support_x86_avx2() && cpu_support_x86_fma())
+        layer_creator = layer_registry_avx2[index].creator;
+#endif // NCNN_RUNTIME_CPU_AVX2
+    if (!layer_creator)
+        layer_creator = layer_registry[index].creator;
     if (!layer_creator)
         return 0;
 
@@ -312,16 +312,24 @@ int Crop_arm::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt)
             {
                 const Mat bottom_blob_sliced = bottom_blob.channel_range(_coffset / out_elempack, _outc / out_elempack);
 
+                if (_outw == w && _outh == h && _outc / out_elempack == channels)
+                {
+                    top_blob = bottom_blob;
+                    return 0;
+                }
+
                 if (_outw == w && _outh == h)
                 {
+                    if (opt.use_blob_view)
+                    {
+                        top_blob = bottom_blob_sliced;
+                        return 0;
+                    }
+
                     top_blob = bottom_blob_sliced.clone();
                     if (top_blob.empty())
                         return -100;
-                }
 
-                if (_outw == w && _outh == h && _outc / out_elempack == channels)
-                {
-                    top_blob = bottom_blob;
                     return 0;
                 }
 
@@ -524,16 +532,24 @@ int Crop_arm::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& to
             {
                 const Mat bottom_blob_sliced = bottom_blob.channel_range(_coffset / out_elempack, _outc / out_elempack);
 
+                if (_outw == w && _outh == h && _outc / out_elempack == channels)
+                {
+                    top_blob = bottom_blob;
+                    return 0;
+                }
+
                 if (_outw == w && _outh == h)
                 {
+                    if (opt.use_blob_view)
+                    {
+                        top_blob = bottom_blob_sliced;
+                        return 0;
+                    }
+
                     top_blob = bottom_blob_sliced.clone();
                     if (top_blob.empty())
                         return -100;
-                }
 
-                if (_outw == w && _outh == h && _outc / out_elempack == channels)
-                {
-                    top_blob = bottom_blob;
                     return 0;
                 }
 
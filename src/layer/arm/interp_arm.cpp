@@ -19,35 +19,7 @@ namespace ncnn {
 
 DEFINE_LAYER_CREATOR(Interp_arm)
 
-static void linear_coeffs(int w, int outw, int* xofs, float* alpha)
-{
-    double scale = (double)w / outw;
-
-    for (int dx = 0; dx < outw; dx++)
-    {
-        float fx = (float)((dx + 0.5) * scale - 0.5);
-        int sx = floor(fx);
-        fx -= sx;
-
-        if (sx < 0)
-        {
-            sx = 0;
-            fx = 0.f;
-        }
-        if (sx >= w - 1)
-        {
-            sx = w - 2;
-            fx = 1.f;
-        }
-
-        xofs[dx] = sx;
-
-        alpha[dx*2    ] = 1.f - fx;
-        alpha[dx*2 + 1] = fx;
-    }
-}
-
-static void resize_bilinear_image(const Mat& src, Mat& dst, float* alpha, int* xofs, float* beta, int* yofs)
+static void resize_bilinear_image(const Mat& src, Mat& dst, const float* alpha, const int* xofs, const float* beta, const int* yofs)
 {
     int w = dst.w;
     int h = dst.h;
@@ -251,16 +223,14 @@ int Interp_arm::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt
     if (top_blob.empty())
         return -100;
 
-    int* buf = new int[outw + outh + outw*2 + outh*2];
-
-    int* xofs = buf;//new int[outw];
-    int* yofs = buf + outw;//new int[outh];
-
-    float* alpha = (float*)(buf + outw + outh);//new float[outw * 2];
-    float* beta = (float*)(buf + outw + outh + outw*2);//new float[outh * 2];
+    Mat tab = get_resize_coeffs(w, h, outw, outh);
+    if (tab.empty())
+        return -100;
 
-    linear_coeffs(w, outw, xofs, alpha);
-    linear_coeffs(h, outh, yofs, beta);
+    const int* xofs = tab;
+    const int* yofs = xofs + outw;
+    const float* alpha = (const float*)(yofs + outh);
+    const float* beta = alpha + outw*2;
 
     #pragma omp parallel for num_threads(opt.num_threads)
     for (int q = 0; q < channels; q++)
@@ -271,8 +241,6 @@ int Interp_arm::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt
         resize_bilinear_image(src, dst, alpha, xofs, beta, yofs);
     }
 
-    delete[] buf;
-
     return 0;
 }
 
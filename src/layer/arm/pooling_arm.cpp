@@ -43,6 +43,9 @@ int Pooling_arm::forward(const Mat& bottom_blob, Mat& top_blob, const Option& op
     // max value in NxN window
     // avg value in NxN window
 
+    if (bottom_blob.elemsize == 1u)
+        return Pooling::forward_int8(bottom_blob, top_blob, opt);
+
     int w = bottom_blob.w;
     int h = bottom_blob.h;
     int channels = bottom_blob.c;
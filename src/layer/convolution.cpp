@@ -49,15 +49,41 @@ int Convolution::load_param(const ParamDict& pd)
     activation_type = pd.get(9, 0);
     activation_params = pd.get(10, Mat());
     impl_type = pd.get(17, 0);
+    residual_term = pd.get(19, 0);
+    residual_activation_type = pd.get(20, 0);
+    residual_activation_params = pd.get(21, Mat());
+    weight_quant_type = pd.get(22, 0);
+    weight_quant_group_size = pd.get(23, 32);
+
+    if (residual_term)
+    {
+        one_blob_only = false;
+
+        // the gpu convolution has no residual input
+        support_vulkan = false;
+    }
 
     return 0;
 }
 
 int Convolution::load_model(const ModelBin& mb)
 {
-    weight_data = mb.load(weight_data_size, 0);
-    if (weight_data.empty())
-        return -100;
+    if (weight_quant_type)
+    {
+        // weight-only quantized, see quantize_weight()
+        const int cols = weight_data_size / num_output;
+        const int quantized_size = weight_quant_type == 1 ? weight_data_size : num_output * ((cols + 1) / 2);
+
+        weight_data_quantized = mb.load(quantized_size, 0);
+        if (weight_data_quantized.empty() || weight_data_quantized.elemsize != (size_t)1u)
+            return -100;
+    }
+    else
+    {
+        weight_data = mb.load(weight_data_size, 0);
+        if (weight_data.empty())
+            return -100;
+    }
 
     if (bias_term)
     {
@@ -66,6 +92,26 @@ int Convolution::load_model(const ModelBin& mb)
             return -100;
     }
 
+    if (weight_quant_type)
+    {
+        const int cols = weight_data_size / num_output;
+        const int groups = (cols + weight_quant_group_size - 1) / weight_quant_group_size;
+        const int scales_size = weight_quant_type == 1 ? num_output : num_output * groups;
+
+        weight_data_quantize_scales = mb.load(scales_size, 1);
+        if (weight_data_quantize_scales.empty())
+            return -100;
+
+        // the plain fp32 weights for every implementation without a quantized kernel
+        dequantize_weight(weight_data_quantized, weight_data_quantize_scales, weight_data, num_output, cols, weight_quant_type, weight_quant_group_size);
+        if (weight_data.empty())
+            return -100;
+
+        // no convolution kernel reads the quantized form
+        weight_data_quantized.release();
+        weight_data_quantize_scales.release();
+    }
+
     if (int8_scale_term)
     {
         weight_data_int8_scales = mb.load(num_output, 1);
@@ -197,6 +243,11 @@ int Convolution::destroy_pipeline(const Option& opt)
     return 0;
 }
 
+int Convolution::fuse_depthwise(const Layer* /*depthwise*/, const Option& /*opt*/)
+{
+    return -1;
+}
+
 int Convolution::create_requantize_op(void)
 {
     if (!use_int8_requantize)
@@ -594,4 +645,68 @@ int Convolution::forward(const Mat& bottom_blob, Mat& top_blob, const Option& op
     return 0;
 }
 
+int Convolution::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    const Mat& bottom_blob = bottom_blobs[0];
+    Mat& top_blob = top_blobs[0];
+
+    int ret = forward(bottom_blob, top_blob, opt);
+    if (ret != 0)
+        return ret;
+
+    return add_residual(bottom_blobs[1], top_blob, opt);
+}
+
+int Convolution::add_residual(const Mat& residual_blob, Mat& top_blob, const Option& opt) const
+{
+    if (residual_blob.dims != top_blob.dims || residual_blob.w != top_blob.w || residual_blob.h != top_blob.h || residual_blob.c != top_blob.c
+        || residual_blob.elemsize != top_blob.elemsize || residual_blob.elempack != top_blob.elempack)
+        return -100;
+
+    if (top_blob.elemsize != (size_t)4u * top_blob.elempack)
+        return -100;
+
+    int channels = top_blob.c;
+    int size = top_blob.w * top_blob.h * top_blob.elempack;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<channels; q++)
+    {
+        const float* ptr = residual_blob.channel(q);
+        float* outptr = top_blob.channel(q);
+
+        for (int i=0; i<size; i++)
+        {
+            float sum = outptr[i] + ptr[i];
+
+            if (residual_activation_type == 1)
+            {
+                sum = std::max(sum, 0.f);
+            }
+            else if (residual_activation_type == 2)
+            {
+                float slope = residual_activation_params[0];
+                sum = sum > 0.f ? sum : sum * slope;
+            }
+            else if (residual_activation_type == 3)
+            {
+                float min = residual_activation_params[0];
+                float max = residual_activation_params[1];
+                if (sum < min)
+                    sum = min;
+                if (sum > max)
+                    sum = max;
+            }
+            else if (residual_activation_type == 4)
+            {
+                sum = 1.f / (1.f + exp(-sum));
+            }
+
+            outptr[i] = sum;
+        }
+    }
+
+    return 0;
+}
+
 } // namespace ncnn
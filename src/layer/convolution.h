@@ -33,8 +33,18 @@ public:
 
     virtual int create_requantize_op(void);
 
+    // take over the depthwise convolution producing the bottom blob of this 1x1 convolution
+    // so that both run tile by tile, return non-zero when the implementation can not fuse it
+    virtual int fuse_depthwise(const Layer* depthwise, const Option& opt);
+
     virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
 
+    // residual convolution, bottom_blobs[1] is summed into the output
+    virtual int forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
+
+    // top_blob = residual_activation(top_blob + residual_blob)
+    virtual int add_residual(const Mat& residual_blob, Mat& top_blob, const Option& opt) const;
+
 public:
     // param
     int num_output;
@@ -67,6 +77,12 @@ public:
     float bottom_blob_int8_scale;
     float top_blob_int8_scale;
 
+    // weight-only quantization, 0=none 1=int8 per output 2=int4 per group of inputs
+    int weight_quant_type;
+    int weight_quant_group_size;
+    Mat weight_data_quantized;
+    Mat weight_data_quantize_scales;
+
     bool use_int8_inference;
     bool use_int8_requantize;
 
@@ -80,6 +96,12 @@ public:
 
     // implementation type, 0 means do not use auto pack model 
     int impl_type;
+
+    // 1 = sum a second input blob of the output shape into the output
+    // the residual activation follows the sum, activation_type still applies before it
+    int residual_term;
+    int residual_activation_type;
+    Mat residual_activation_params;
 };
 
 } // namespace ncnn
@@ -281,6 +281,12 @@ int Crop::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) cons
             return 0;
         }
 
+        if (opt.use_blob_view)
+        {
+            top_blob = bottom_blob.range(_woffset, _outw);
+            return 0;
+        }
+
         top_blob.create(_outw, elemsize, opt.blob_allocator);
         if (top_blob.empty())
             return -100;
@@ -301,6 +307,12 @@ int Crop::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) cons
             return 0;
         }
 
+        if (_outw == w && opt.use_blob_view)
+        {
+            top_blob = bottom_blob.row_range(_hoffset, _outh);
+            return 0;
+        }
+
         top_blob.create(_outw, _outh, elemsize, opt.blob_allocator);
         if (top_blob.empty())
             return -100;
@@ -325,6 +337,12 @@ int Crop::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) cons
 
         if (_outw == w && _outh == h)
         {
+            if (opt.use_blob_view)
+            {
+                top_blob = bottom_blob_sliced;
+                return 0;
+            }
+
             top_blob = bottom_blob_sliced.clone();
             if (top_blob.empty())
                 return -100;
@@ -434,6 +452,12 @@ int Crop::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_bl
             return 0;
         }
 
+        if (opt.use_blob_view)
+        {
+            top_blob = bottom_blob.range(_woffset, _outw);
+            return 0;
+        }
+
         top_blob.create(_outw, elemsize, opt.blob_allocator);
         if (top_blob.empty())
             return -100;
@@ -454,6 +478,12 @@ int Crop::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_bl
             return 0;
         }
 
+        if (_outw == w && opt.use_blob_view)
+        {
+            top_blob = bottom_blob.row_range(_hoffset, _outh);
+            return 0;
+        }
+
         top_blob.create(_outw, _outh, elemsize, opt.blob_allocator);
         if (top_blob.empty())
             return -100;
@@ -478,6 +508,12 @@ int Crop::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_bl
 
         if (_outw == w && _outh == h)
         {
+            if (opt.use_blob_view)
+            {
+                top_blob = bottom_blob_sliced;
+                return 0;
+            }
+
             top_blob = bottom_blob_sliced.clone();
             if (top_blob.empty())
                 return -100;
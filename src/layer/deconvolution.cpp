@@ -202,6 +202,11 @@ int Deconvolution::forward(const Mat& bottom_blob, Mat& top_blob, const Option&
         }
     }
 
+    return cut_padding(top_blob_bordered, top_blob, opt);
+}
+
+int Deconvolution::cut_padding(const Mat& top_blob_bordered, Mat& top_blob, const Option& opt) const
+{
     if (pad_left > 0 || pad_right > 0 || pad_top > 0 || pad_bottom > 0)
     {
         Mat top_blob_bordered_adj = top_blob_bordered;
@@ -217,9 +222,6 @@ int Deconvolution::forward(const Mat& bottom_blob, Mat& top_blob, const Option&
         copy_cut_border(top_blob_bordered_adj, top_blob, pad_top, pad_bottom, pad_left, pad_right, opt);
         if (top_blob.empty())
             return -100;
-
-        outw = top_blob.w;
-        outh = top_blob.h;
     }
     else if (output_w > 0 && output_h > 0)
     {
@@ -248,9 +250,6 @@ int Deconvolution::forward(const Mat& bottom_blob, Mat& top_blob, const Option&
         }
         if (top_blob.empty())
             return -100;
-
-        outw = top_blob.w;
-        outh = top_blob.h;
     }
     else
     {
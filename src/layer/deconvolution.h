@@ -30,6 +30,10 @@ public:
 
     virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
 
+protected:
+    // apply pads, output pads and output size to the full deconvolution result
+    int cut_padding(const Mat& top_blob_bordered, Mat& top_blob, const Option& opt) const;
+
 public:
     // param
     int num_output;
@@ -15,6 +15,7 @@
 #include "detectionoutput.h"
 #include <algorithm>
 #include <math.h>
+#include "nms.h"
 
 namespace ncnn {
 
@@ -50,101 +51,6 @@ struct BBoxRect
     int label;
 };
 
-static inline float intersection_area(const BBoxRect& a, const BBoxRect& b)
-{
-    if (a.xmin > b.xmax || a.xmax < b.xmin || a.ymin > b.ymax || a.ymax < b.ymin)
-    {
-        // no intersection
-        return 0.f;
-    }
-
-    float inter_width = std::min(a.xmax, b.xmax) - std::max(a.xmin, b.xmin);
-    float inter_height = std::min(a.ymax, b.ymax) - std::max(a.ymin, b.ymin);
-
-    return inter_width * inter_height;
-}
-
-template <typename T>
-static void qsort_descent_inplace(std::vector<T>& datas, std::vector<float>& scores, int left, int right)
-{
-    int i = left;
-    int j = right;
-    float p = scores[(left + right) / 2];
-
-    while (i <= j)
-    {
-        while (scores[i] > p)
-            i++;
-
-        while (scores[j] < p)
-            j--;
-
-        if (i <= j)
-        {
-            // swap
-            std::swap(datas[i], datas[j]);
-            std::swap(scores[i], scores[j]);
-
-            i++;
-            j--;
-        }
-    }
-
-    if (left < j)
-        qsort_descent_inplace(datas, scores, left, j);
-
-    if (i < right)
-        qsort_descent_inplace(datas, scores, i, right);
-}
-
-template <typename T>
-static void qsort_descent_inplace(std::vector<T>& datas, std::vector<float>& scores)
-{
-    if (datas.empty() || scores.empty())
-        return;
-
-    qsort_descent_inplace(datas, scores, 0, scores.size() - 1);
-}
-
-static void nms_sorted_bboxes(const std::vector<BBoxRect>& bboxes, std::vector<int>& picked, float nms_threshold)
-{
-    picked.clear();
-
-    const int n = bboxes.size();
-
-    std::vector<float> areas(n);
-    for (int i = 0; i < n; i++)
-    {
-        const BBoxRect& r = bboxes[i];
-
-        float width = r.xmax - r.xmin;
-        float height = r.ymax - r.ymin;
-
-        areas[i] = width * height;
-    }
-
-    for (int i = 0; i < n; i++)
-    {
-        const BBoxRect& a = bboxes[i];
-
-        int keep = 1;
-        for (int j = 0; j < (int)picked.size(); j++)
-        {
-            const BBoxRect& b = bboxes[picked[j]];
-
-            // intersection over union
-            float inter_area = intersection_area(a, b);
-            float union_area = areas[i] + areas[picked[j]] - inter_area;
-//             float IoU = inter_area / union_area
-            if (inter_area / union_area > nms_threshold)
-                keep = 0;
-        }
-
-        if (keep)
-            picked.push_back(i);
-    }
-}
-
 int DetectionOutput::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
 {
     const Mat& location = bottom_blobs[0];
@@ -224,19 +130,16 @@ int DetectionOutput::forward(const std::vector<Mat>& bottom_blobs, std::vector<M
             }
         }
 
-        // sort inplace
-        qsort_descent_inplace(class_bbox_rects, class_bbox_scores);
+        if (class_bbox_rects.empty())
+            continue;
 
-        // keep nms_top_k
-        if (nms_top_k < (int)class_bbox_rects.size())
-        {
-            class_bbox_rects.resize(nms_top_k);
-            class_bbox_scores.resize(nms_top_k);
-        }
+        // keep nms_top_k in score order
+        std::vector<int> order;
+        topk_descent_indices(&class_bbox_scores[0], class_bbox_scores.size(), nms_top_k, order);
 
         // apply nms
         std::vector<int> picked;
-        nms_sorted_bboxes(class_bbox_rects, picked, nms_threshold);
+        nms_sorted_bboxes((const float*)&class_bbox_rects[0], sizeof(BBoxRect) / sizeof(float), &order[0], order.size(), picked, nms_threshold);
 
         // select
         for (int j = 0; j < (int)picked.size(); j++)
@@ -260,18 +163,13 @@ int DetectionOutput::forward(const std::vector<Mat>& bottom_blobs, std::vector<M
         bbox_scores.insert(bbox_scores.end(), class_bbox_scores.begin(), class_bbox_scores.end());
     }
 
-    // global sort inplace
-    qsort_descent_inplace(bbox_rects, bbox_scores);
-
-    // keep_top_k
-    if (keep_top_k < (int)bbox_rects.size())
-    {
-        bbox_rects.resize(keep_top_k);
-        bbox_scores.resize(keep_top_k);
-    }
+    // global sort and keep_top_k
+    std::vector<int> order;
+    if (!bbox_scores.empty())
+        topk_descent_indices(&bbox_scores[0], bbox_scores.size(), keep_top_k, order);
 
     // fill result
-    int num_detected = bbox_rects.size();
+    int num_detected = order.size();
     if (num_detected == 0)
         return 0;
 
@@ -282,8 +180,8 @@ int DetectionOutput::forward(const std::vector<Mat>& bottom_blobs, std::vector<M
 
     for (int i = 0; i < num_detected; i++)
     {
-        const BBoxRect& r = bbox_rects[i];
-        float score = bbox_scores[i];
+        const BBoxRect& r = bbox_rects[order[i]];
+        float score = bbox_scores[order[i]];
         float* outptr = top_blob.row(i);
 
         outptr[0] = r.label;
@@ -13,6 +13,7 @@
 // specific language governing permissions and limitations under the License.
 
 #include "eltwise.h"
+#include <math.h>
 #include <algorithm>
 
 namespace ncnn {
@@ -23,6 +24,9 @@ Eltwise::Eltwise()
 {
     one_blob_only = false;
     support_inplace = false;// TODO inplace reduction
+
+    use_int8_inference = false;
+    top_blob_int8_scale = 0.f;
 }
 
 int Eltwise::load_param(const ParamDict& pd)
@@ -35,6 +39,9 @@ int Eltwise::load_param(const ParamDict& pd)
 
 int Eltwise::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
 {
+    if (use_int8_inference)
+        return forward_int8(bottom_blobs, top_blobs, opt);
+
     const Mat& bottom_blob = bottom_blobs[0];
     int w = bottom_blob.w;
     int h = bottom_blob.h;
@@ -189,4 +196,141 @@ int Eltwise::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top
     return 0;
 }
 
+static inline signed char float2int8(float v)
+{
+    int int32 = round(v);
+    if (int32 > 127) return 127;
+    if (int32 < -127) return -127;
+    return (signed char)int32;
+}
+
+int Eltwise::forward_int8(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    const int count = bottom_blobs.size();
+
+    // fp32 inputs may arrive packed from a non-int8 producer
+    std::vector<Mat> bottom_blobs_unpacked(count);
+    for (int b=0; b<count; b++)
+    {
+        bottom_blobs_unpacked[b] = bottom_blobs[b];
+        if (bottom_blobs[b].elempack != 1)
+        {
+            Option opt_pack = opt;
+            opt_pack.blob_allocator = opt.workspace_allocator;
+            convert_packing(bottom_blobs[b], bottom_blobs_unpacked[b], 1, opt_pack);
+            if (bottom_blobs_unpacked[b].empty())
+                return -100;
+        }
+    }
+
+    const Mat& bottom_blob = bottom_blobs_unpacked[0];
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int channels = bottom_blob.c;
+    int size = w * h;
+
+    const bool top_int8 = top_blob_int8_scale != 0.f;
+
+    Mat& top_blob = top_blobs[0];
+    top_blob.create(w, h, channels, top_int8 ? (size_t)1u : (size_t)4u, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    // coefficient of each input with its dequantize scale folded in
+    std::vector<float> input_scales(count);
+    for (int b=0; b<count; b++)
+    {
+        float coeff = op_type == Operation_SUM && coeffs.w != 0 ? coeffs[b] : 1.f;
+
+        if (bottom_blobs_unpacked[b].elemsize == 1u)
+            coeff /= bottom_blob_int8_scales[b];
+
+        input_scales[b] = coeff;
+    }
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<channels; q++)
+    {
+        // accumulate a block in fp32 then store it once
+        float sum[64];
+
+        for (int i=0; i<size; i+=64)
+        {
+            const int n = std::min(64, size - i);
+
+            for (int b=0; b<count; b++)
+            {
+                const Mat& m = bottom_blobs_unpacked[b];
+                const float scale = input_scales[b];
+
+                if (m.elemsize == 1u)
+                {
+                    const signed char* ptr = (const signed char*)m.channel(q) + i;
+
+                    if (b == 0)
+                    {
+                        for (int k=0; k<n; k++)
+                            sum[k] = ptr[k] * scale;
+                    }
+                    else if (op_type == Operation_SUM)
+                    {
+                        for (int k=0; k<n; k++)
+                            sum[k] += ptr[k] * scale;
+                    }
+                    else if (op_type == Operation_PROD)
+                    {
+                        for (int k=0; k<n; k++)
+                            sum[k] *= ptr[k] * scale;
+                    }
+                    else
+                    {
+                        for (int k=0; k<n; k++)
+                            sum[k] = std::max(sum[k], ptr[k] * scale);
+                    }
+                }
+                else
+                {
+                    const float* ptr = (const float*)m.channel(q) + i;
+
+                    if (b == 0)
+                    {
+                        for (int k=0; k<n; k++)
+                            sum[k] = ptr[k] * scale;
+                    }
+                    else if (op_type == Operation_SUM)
+                    {
+                        for (int k=0; k<n; k++)
+                            sum[k] += ptr[k] * scale;
+                    }
+                    else if (op_type == Operation_PROD)
+                    {
+                        for (int k=0; k<n; k++)
+                            sum[k] *= ptr[k] * scale;
+                    }
+                    else
+                    {
+                        for (int k=0; k<n; k++)
+                            sum[k] = std::max(sum[k], ptr[k] * scale);
+                    }
+                }
+            }
+
+            if (top_int8)
+            {
+                signed char* outptr = (signed char*)top_blob.channel(q) + i;
+                for (int k=0; k<n; k++)
+                    outptr[k] = float2int8(sum[k] * top_blob_int8_scale);
+            }
+            else
+            {
+                float* outptr = (float*)top_blob.channel(q) + i;
+                for (int k=0; k<n; k++)
+                    outptr[k] = sum[k];
+            }
+        }
+    }
+
+    return 0;
+}
+
 } // namespace ncnn
@@ -28,12 +28,20 @@ public:
 
     virtual int forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
 
+    // int8 or fp32 inputs, rescaled to int8 top_blob_int8_scale or dequantized to fp32 when it is 0
+    virtual int forward_int8(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
+
     enum { Operation_PROD = 0, Operation_SUM = 1, Operation_MAX = 2 };
 
 public:
     // param
     int op_type;
     Mat coeffs;
+
+    // set by the int8 fusion in Net::fuse_network
+    bool use_int8_inference;
+    std::vector<float> bottom_blob_int8_scales;
+    float top_blob_int8_scale;
 };
 
 } // namespace ncnn
@@ -29,25 +29,12 @@ int Flatten::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) c
     int w = bottom_blob.w;
     int h = bottom_blob.h;
     int channels = bottom_blob.c;
-    size_t elemsize = bottom_blob.elemsize;
-    int size = w * h;
 
-    top_blob.create(size * channels, elemsize, opt.blob_allocator);
+    // shares the data unless there are gaps between channels
+    top_blob = bottom_blob.reshape(w * h * channels, opt.blob_allocator);
     if (top_blob.empty())
         return -100;
 
-    #pragma omp parallel for num_threads(opt.num_threads)
-    for (int q=0; q<channels; q++)
-    {
-        const float* ptr = bottom_blob.channel(q);
-        float* outptr = (float*)top_blob + size * q;
-
-        for (int i=0; i<size; i++)
-        {
-            outptr[i] = ptr[i];
-        }
-    }
-
     return 0;
 }
 
@@ -36,15 +36,30 @@ int InnerProduct::load_param(const ParamDict& pd)
     int8_scale_term = pd.get(8, 0);
     activation_type = pd.get(9, 0);
     activation_params = pd.get(10, Mat());
+    weight_quant_type = pd.get(11, 0);
+    weight_quant_group_size = pd.get(12, 32);
 
     return 0;
 }
 
 int InnerProduct::load_model(const ModelBin& mb)
 {
-    weight_data = mb.load(weight_data_size, 0);
-    if (weight_data.empty())
-        return -100;
+    if (weight_quant_type)
+    {
+        // weight-only quantized, see quantize_weight()
+        const int cols = weight_data_size / num_output;
+        const int quantized_size = weight_quant_type == 1 ? weight_data_size : num_output * ((cols + 1) / 2);
+
+        weight_data_quantized = mb.load(quantized_size, 0);
+        if (weight_data_quantized.empty() || weight_data_quantized.elemsize != (size_t)1u)
+            return -100;
+    }
+    else
+    {
+        weight_data = mb.load(weight_data_size, 0);
+        if (weight_data.empty())
+            return -100;
+    }
 
     if (bias_term)
     {
@@ -53,6 +68,22 @@ int InnerProduct::load_model(const ModelBin& mb)
             return -100;
     }
 
+    if (weight_quant_type)
+    {
+        const int cols = weight_data_size / num_output;
+        const int groups = (cols + weight_quant_group_size - 1) / weight_quant_group_size;
+        const int scales_size = weight_quant_type == 1 ? num_output : num_output * groups;
+
+        weight_data_quantize_scales = mb.load(scales_size, 1);
+        if (weight_data_quantize_scales.empty())
+            return -100;
+
+        // the plain fp32 weights for every implementation without a quantized kernel
+        dequantize_weight(weight_data_quantized, weight_data_quantize_scales, weight_data, num_output, cols, weight_quant_type, weight_quant_group_size);
+        if (weight_data.empty())
+            return -100;
+    }
+
     if (int8_scale_term)
     {
         weight_data_int8_scales = mb.load(num_output, 1);
@@ -174,6 +205,34 @@ int InnerProduct::destroy_pipeline(const Option& opt)
 
 int InnerProduct::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 {
+    const int num_input = weight_data_size / num_output;
+
+    // batched rows of features
+    if (!use_int8_inference && bottom_blob.dims == 2 && bottom_blob.w == num_input && bottom_blob.h > 1)
+    {
+        int batch = bottom_blob.h;
+        size_t elemsize = bottom_blob.elemsize;
+
+        top_blob.create(num_output, batch, elemsize, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        for (int j=0; j<batch; j++)
+        {
+            const Mat bottom_row(num_input, (void*)bottom_blob.row(j), elemsize);
+            Mat top_row(num_output, top_blob.row(j), elemsize);
+
+            Option opt_row = opt;
+            opt_row.blob_allocator = top_row.allocator;
+
+            int ret = InnerProduct::forward(bottom_row, top_row, opt_row);
+            if (ret != 0)
+                return ret;
+        }
+
+        return 0;
+    }
+
     int w = bottom_blob.w;
     int h = bottom_blob.h;
     int channels = bottom_blob.c;
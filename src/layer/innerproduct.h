@@ -53,6 +53,12 @@ public:
     Mat weight_data_int8_scales;
     float bottom_blob_int8_scale;
 
+    // weight-only quantization, 0=none 1=int8 per output 2=int4 per group of inputs
+    int weight_quant_type;
+    int weight_quant_group_size;
+    Mat weight_data_quantized;
+    Mat weight_data_quantize_scales;
+
     bool use_int8_inference;
 
     ncnn::Layer* quantize;
@@ -23,6 +23,11 @@ Interp::Interp()
 {
     one_blob_only = true;
     support_inplace = false;
+
+    coeffs_w = 0;
+    coeffs_h = 0;
+    coeffs_outw = 0;
+    coeffs_outh = 0;
 }
 
 int Interp::load_param(const ParamDict& pd)
@@ -64,7 +69,7 @@ static void linear_coeffs(int w, int outw, int* xofs, float* alpha)
     }
 }
 
-static void resize_bilinear_image(const Mat& src, Mat& dst, float* alpha, int* xofs, float* beta, int* yofs)
+static void resize_bilinear_image(const Mat& src, Mat& dst, const float* alpha, const int* xofs, const float* beta, const int* yofs)
 {
     int w = dst.w;
     int h = dst.h;
@@ -214,7 +219,7 @@ static void cubic_coeffs(int w, int outw, int* xofs, float* alpha)
     }
 }
 
-static void resize_bicubic_image(const Mat& src, Mat& dst, float* alpha, int* xofs, float* beta, int* yofs)
+static void resize_bicubic_image(const Mat& src, Mat& dst, const float* alpha, const int* xofs, const float* beta, const int* yofs)
 {
     int w = dst.w;
     int h = dst.h;
@@ -389,6 +394,58 @@ static void resize_bicubic_image(const Mat& src, Mat& dst, float* alpha, int* xo
     }
 }
 
+static void nearest_ofs(int w, int outw, float scale, int* xofs)
+{
+    for (int dx = 0; dx < outw; dx++)
+    {
+        xofs[dx] = std::min((int)(dx / scale), w - 1);
+    }
+}
+
+Mat Interp::get_resize_coeffs(int w, int h, int outw, int outh) const
+{
+    MutexLockGuard guard(coeffs_lock);
+
+    if (!coeffs.empty() && coeffs_w == w && coeffs_h == h && coeffs_outw == outw && coeffs_outh == outh)
+        return coeffs;
+
+    int taps = resize_type == 2 ? 2 : resize_type == 3 ? 4 : 0;
+
+    Mat tab(outw + outh + outw*taps + outh*taps, (size_t)4u);
+    if (tab.empty())
+        return tab;
+
+    int* xofs = tab;
+    int* yofs = xofs + outw;
+    float* alpha = (float*)(yofs + outh);
+    float* beta = alpha + outw*taps;
+
+    if (resize_type == 1)
+    {
+        nearest_ofs(w, outw, width_scale, xofs);
+        nearest_ofs(h, outh, height_scale, yofs);
+    }
+    else if (resize_type == 2)
+    {
+        linear_coeffs(w, outw, xofs, alpha);
+        linear_coeffs(h, outh, yofs, beta);
+    }
+    else if (resize_type == 3)
+    {
+        cubic_coeffs(w, outw, xofs, alpha);
+        cubic_coeffs(h, outh, yofs, beta);
+    }
+
+    // the old table stays valid for whoever still holds it
+    coeffs = tab;
+    coeffs_w = w;
+    coeffs_h = h;
+    coeffs_outw = outw;
+    coeffs_outh = outh;
+
+    return tab;
+}
+
 int Interp::forward(const Mat &bottom_blob, Mat &top_blob, const Option& opt) const
 {
     int h = bottom_blob.h;
@@ -430,6 +487,23 @@ int Interp::forward(const Mat &bottom_blob, Mat &top_blob, const Option& opt) co
         return 0;
     }
 
+    if (resize_type < 1 || resize_type > 3)
+    {
+        fprintf(stderr, "unsupported resize type %d %d %d\n", resize_type, oh, ow);
+        return -233;
+    }
+
+    Mat tab = get_resize_coeffs(w, h, ow, oh);
+    if (tab.empty())
+        return -100;
+
+    const int taps = resize_type == 2 ? 2 : resize_type == 3 ? 4 : 0;
+
+    const int* xofs = tab;
+    const int* yofs = xofs + ow;
+    const float* alpha = (const float*)(yofs + oh);
+    const float* beta = alpha + ow*taps;
+
     if (resize_type == 1)// nearest
     {
         #pragma omp parallel for num_threads(opt.num_threads)
@@ -439,11 +513,10 @@ int Interp::forward(const Mat &bottom_blob, Mat &top_blob, const Option& opt) co
             float *output_ptr = top_blob.channel(q);
             for (int y = 0; y < oh; ++y)
             {
-                const int in_y = std::min((int) (y / height_scale), (h - 1));
+                const float* in_row = ptr + yofs[y] * w;
                 for (int x = 0; x < ow; ++x)
                 {
-                    const int in_x = std::min((int) (x / width_scale), (w - 1));
-                    output_ptr[ow * y + x] = ptr[in_y * w + in_x];
+                    output_ptr[ow * y + x] = in_row[xofs[x]];
                 }
             }
         }
@@ -452,17 +525,6 @@ int Interp::forward(const Mat &bottom_blob, Mat &top_blob, const Option& opt) co
     }
     else if (resize_type == 2)// bilinear
     {
-        int* buf = new int[ow + oh + ow*2 + oh*2];
-
-        int* xofs = buf;//new int[ow];
-        int* yofs = buf + ow;//new int[oh];
-
-        float* alpha = (float*)(buf + ow + oh);//new float[ow * 2];
-        float* beta = (float*)(buf + ow + oh + ow*2);//new float[oh * 2];
-
-        linear_coeffs(w, ow, xofs, alpha);
-        linear_coeffs(h, oh, yofs, beta);
-
         #pragma omp parallel for num_threads(opt.num_threads)
         for (int q = 0; q < c; ++q)
         {
@@ -472,23 +534,10 @@ int Interp::forward(const Mat &bottom_blob, Mat &top_blob, const Option& opt) co
             resize_bilinear_image(src, dst, alpha, xofs, beta, yofs);
         }
 
-        delete[] buf;
-
         return 0;
     }
-    else if (resize_type == 3)// bicubic
+    else // if (resize_type == 3)// bicubic
     {
-        int* buf = new int[ow + oh + ow*4 + oh*4];
-
-        int* xofs = buf;//new int[ow];
-        int* yofs = buf + ow;//new int[oh];
-
-        float* alpha = (float*)(buf + ow + oh);//new float[ow * 4];
-        float* beta = (float*)(buf + ow + oh + ow*4);//new float[oh * 4];
-
-        cubic_coeffs(w, ow, xofs, alpha);
-        cubic_coeffs(h, oh, yofs, beta);
-
         #pragma omp parallel for num_threads(opt.num_threads)
         for (int q = 0; q < c; ++q)
         {
@@ -498,15 +547,8 @@ int Interp::forward(const Mat &bottom_blob, Mat &top_blob, const Option& opt) co
             resize_bicubic_image(src, dst, alpha, xofs, beta, yofs);
         }
 
-        delete[] buf;
-
         return 0;
     }
-    else
-    {
-        fprintf(stderr, "unsupported resize type %d %d %d\n", resize_type, oh, ow);
-        return -233;
-    }
 }
 
 } // namespace ncnn
@@ -28,6 +28,11 @@ public:
 
     virtual int forward(const Mat &bottom_blob, Mat &top_blob, const Option& opt) const;
 
+protected:
+    // xofs yofs then alpha beta for w x h -> outw x outh, as ints followed by floats
+    // computed once per shape, callers keep the returned mat alive while reading it
+    Mat get_resize_coeffs(int w, int h, int outw, int outh) const;
+
 public:
     // param
     int resize_type;//1=nearest  2=bilinear  3=bicubic
@@ -35,6 +40,15 @@ public:
     float height_scale;
     int output_width;
     int output_height;
+
+private:
+    // the tables of the most recent shape, fixed shape models never recompute them
+    mutable Mutex coeffs_lock;
+    mutable Mat coeffs;
+    mutable int coeffs_w;
+    mutable int coeffs_h;
+    mutable int coeffs_outw;
+    mutable int coeffs_outh;
 };
 
 } // namespace ncnn
@@ -14,6 +14,7 @@
 
 #include "pooling.h"
 #include <float.h>
+#include <math.h>
 #include <algorithm>
 #include "layer_type.h"
 
@@ -50,6 +51,9 @@ int Pooling::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) c
     // max value in NxN window
     // avg value in NxN window
 
+    if (bottom_blob.elemsize == 1u)
+        return forward_int8(bottom_blob, top_blob, opt);
+
     int w = bottom_blob.w;
     int h = bottom_blob.h;
     int channels = bottom_blob.c;
@@ -316,4 +320,264 @@ int Pooling::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) c
     return 0;
 }
 
+static inline signed char float2int8(float v)
+{
+    int int32 = round(v);
+    if (int32 > 127) return 127;
+    if (int32 < -127) return -127;
+    return (signed char)int32;
+}
+
+int Pooling::forward_int8(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int channels = bottom_blob.c;
+
+    if (global_pooling)
+    {
+        top_blob.create(channels, (size_t)1u, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        int size = w * h;
+
+        signed char* outptr = top_blob;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            const signed char* ptr = bottom_blob.channel(q);
+
+            if (pooling_type == PoolMethod_MAX)
+            {
+                signed char max = ptr[0];
+                for (int i=0; i<size; i++)
+                {
+                    max = std::max(max, ptr[i]);
+                }
+
+                outptr[q] = max;
+            }
+            else
+            {
+                int sum = 0;
+                for (int i=0; i<size; i++)
+                {
+                    sum += ptr[i];
+                }
+
+                outptr[q] = float2int8((float)sum / size);
+            }
+        }
+
+        return 0;
+    }
+
+    // windows are clipped to the input instead of materializing the border
+    int pl = pad_left;
+    int pt = pad_top;
+    int wpadded = w + pad_left + pad_right;
+    int hpadded = h + pad_top + pad_bottom;
+
+    int wtailpad = 0;
+    int htailpad = 0;
+
+    if (pad_mode == 0) // full padding
+    {
+        int wtail = (w + pad_left + pad_right - kernel_w) % stride_w;
+        int htail = (h + pad_top + pad_bottom - kernel_h) % stride_h;
+
+        if (wtail != 0)
+            wtailpad = stride_w - wtail;
+        if (htail != 0)
+            htailpad = stride_h - htail;
+
+        wpadded += wtailpad;
+        hpadded += htailpad;
+    }
+    else if (pad_mode == 2 || pad_mode == 3) // SAME_UPPER or SAME_LOWER
+    {
+        int wpad = std::max(kernel_w + (w - 1) / stride_w * stride_w - w, 0);
+        int hpad = std::max(kernel_h + (h - 1) / stride_h * stride_h - h, 0);
+
+        pl = pad_mode == 2 ? wpad / 2 : wpad - wpad / 2;
+        pt = pad_mode == 2 ? hpad / 2 : hpad - hpad / 2;
+        wpadded = w + wpad;
+        hpadded = h + hpad;
+    }
+
+    int outw = (wpadded - kernel_w) / stride_w + 1;
+    int outh = (hpadded - kernel_h) / stride_h + 1;
+
+    top_blob.create(outw, outh, channels, (size_t)1u, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    // same border correction as the fp32 path, applied before rounding
+    const bool fix_pad = pooling_type == PoolMethod_AVE && avgpool_count_include_pad == 0;
+    const float scale_top = pad_top != 0 ? (float)kernel_h / (kernel_h - pad_top) : 1.f;
+    const float scale_bottom = pad_bottom + htailpad != 0 ? (float)kernel_h / (kernel_h - pad_bottom - htailpad) : 1.f;
+    const float scale_left = pad_left != 0 ? (float)kernel_w / (kernel_w - pad_left) : 1.f;
+    const float scale_right = pad_right + wtailpad != 0 ? (float)kernel_w / (kernel_w - pad_right - wtailpad) : 1.f;
+
+    const float inv_maxk = 1.f / (kernel_w * kernel_h);
+
+    // columns where a window starting there stays inside the input
+    const int wvalid = std::max(w - kernel_w + 1, 0);
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<channels; q++)
+    {
+        const Mat m = bottom_blob.channel(q);
+        signed char* outptr = top_blob.channel(q);
+
+        // reduce the window rows first, then slide along the reduced row
+        std::vector<signed char> row_max(w);
+        std::vector<short> row_sum(w);
+        std::vector<signed char> col_max(wvalid + 1);
+        std::vector<int> col_sum(wvalid + 1);
+
+        for (int i = 0; i < outh; i++)
+        {
+            const int y = i * stride_h - pt;
+            const int y0 = std::max(y, 0);
+            const int y1 = std::min(y + kernel_h, h);
+
+            if (y0 >= y1)
+            {
+                // window entirely in padding
+                for (int j = 0; j < outw; j++)
+                {
+                    outptr[j] = pooling_type == PoolMethod_MAX ? -127 : 0;
+                }
+
+                outptr += outw;
+                continue;
+            }
+
+            if (pooling_type == PoolMethod_MAX)
+            {
+                signed char* rptr = &row_max[0];
+
+                const signed char* sptr = m.row<const signed char>(y0);
+                for (int x = 0; x < w; x++)
+                {
+                    rptr[x] = sptr[x];
+                }
+                for (int yy = y0 + 1; yy < y1; yy++)
+                {
+                    sptr = m.row<const signed char>(yy);
+                    for (int x = 0; x < w; x++)
+                    {
+                        rptr[x] = std::max(rptr[x], sptr[x]);
+                    }
+                }
+
+                // window max at every column the kernel fully covers
+                signed char* hptr = &col_max[0];
+                for (int x = 0; x < wvalid; x++)
+                {
+                    hptr[x] = rptr[x];
+                }
+                for (int k = 1; k < kernel_w; k++)
+                {
+                    for (int x = 0; x < wvalid; x++)
+                    {
+                        hptr[x] = std::max(hptr[x], rptr[x + k]);
+                    }
+                }
+
+                for (int j = 0; j < outw; j++)
+                {
+                    const int x = j * stride_w - pl;
+                    if (x >= 0 && x < wvalid)
+                    {
+                        outptr[j] = hptr[x];
+                        continue;
+                    }
+
+                    const int x0 = std::max(x, 0);
+                    const int x1 = std::min(x + kernel_w, w);
+
+                    signed char max = x0 < x1 ? rptr[x0] : -127;
+                    for (int xx = x0 + 1; xx < x1; xx++)
+                    {
+                        max = std::max(max, rptr[xx]);
+                    }
+
+                    outptr[j] = max;
+                }
+            }
+            else
+            {
+                short* rptr = &row_sum[0];
+
+                for (int x = 0; x < w; x++)
+                {
+                    rptr[x] = 0;
+                }
+                for (int yy = y0; yy < y1; yy++)
+                {
+                    const signed char* sptr = m.row<const signed char>(yy);
+                    for (int x = 0; x < w; x++)
+                    {
+                        rptr[x] += sptr[x];
+                    }
+                }
+
+                // window sum at every column the kernel fully covers
+                int* hptr = &col_sum[0];
+                for (int x = 0; x < wvalid; x++)
+                {
+                    hptr[x] = rptr[x];
+                }
+                for (int k = 1; k < kernel_w; k++)
+                {
+                    for (int x = 0; x < wvalid; x++)
+                    {
+                        hptr[x] += rptr[x + k];
+                    }
+                }
+
+                for (int j = 0; j < outw; j++)
+                {
+                    const int x = j * stride_w - pl;
+
+                    int sum = 0;
+                    if (x >= 0 && x < wvalid)
+                    {
+                        sum = hptr[x];
+                    }
+                    else
+                    {
+                        const int x0 = std::max(x, 0);
+                        const int x1 = std::min(x + kernel_w, w);
+
+                        for (int xx = x0; xx < x1; xx++)
+                        {
+                            sum += rptr[xx];
+                        }
+                    }
+
+                    float scale = inv_maxk;
+                    if (fix_pad)
+                    {
+                        if (i == 0) scale *= scale_top;
+                        if (i == outh - 1) scale *= scale_bottom;
+                        if (j == 0) scale *= scale_left;
+                        if (j == outw - 1) scale *= scale_right;
+                    }
+
+                    outptr[j] = float2int8(sum * scale);
+                }
+            }
+
+            outptr += outw;
+        }
+    }
+
+    return 0;
+}
+
 } // namespace ncnn
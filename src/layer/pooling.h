@@ -28,6 +28,9 @@ public:
 
     virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
 
+    // int8 in, int8 out with the same scale
+    virtual int forward_int8(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+
     enum { PoolMethod_MAX = 0, PoolMethod_AVE = 1 };
 
 public:
@@ -16,6 +16,7 @@
 #include <math.h>
 #include <algorithm>
 #include <vector>
+#include "nms.h"
 
 namespace ncnn {
 
@@ -100,101 +101,6 @@ struct Rect
     float y2;
 };
 
-static inline float intersection_area(const Rect& a, const Rect& b)
-{
-    if (a.x1 > b.x2 || a.x2 < b.x1 || a.y1 > b.y2 || a.y2 < b.y1)
-    {
-        // no intersection
-        return 0.f;
-    }
-
-    float inter_width = std::min(a.x2, b.x2) - std::max(a.x1, b.x1);
-    float inter_height = std::min(a.y2, b.y2) - std::max(a.y1, b.y1);
-
-    return inter_width * inter_height;
-}
-
-template <typename T>
-static void qsort_descent_inplace(std::vector<T>& datas, std::vector<float>& scores, int left, int right)
-{
-    int i = left;
-    int j = right;
-    float p = scores[(left + right) / 2];
-
-    while (i <= j)
-    {
-        while (scores[i] > p)
-            i++;
-
-        while (scores[j] < p)
-            j--;
-
-        if (i <= j)
-        {
-            // swap
-            std::swap(datas[i], datas[j]);
-            std::swap(scores[i], scores[j]);
-
-            i++;
-            j--;
-        }
-    }
-
-    if (left < j)
-        qsort_descent_inplace(datas, scores, left, j);
-
-    if (i < right)
-        qsort_descent_inplace(datas, scores, i, right);
-}
-
-template <typename T>
-static void qsort_descent_inplace(std::vector<T>& datas, std::vector<float>& scores)
-{
-    if (datas.empty() || scores.empty())
-        return;
-
-    qsort_descent_inplace(datas, scores, 0, scores.size() - 1);
-}
-
-static void nms_sorted_bboxes(const std::vector<Rect>& bboxes, std::vector<int>& picked, float nms_threshold)
-{
-    picked.clear();
-
-    const int n = bboxes.size();
-
-    std::vector<float> areas(n);
-    for (int i = 0; i < n; i++)
-    {
-        const Rect& r = bboxes[i];
-
-        float width = r.x2 - r.x1;
-        float height = r.y2 - r.y1;
-
-        areas[i] = width * height;
-    }
-
-    for (int i = 0; i < n; i++)
-    {
-        const Rect& a = bboxes[i];
-
-        int keep = 1;
-        for (int j = 0; j < (int)picked.size(); j++)
-        {
-            const Rect& b = bboxes[picked[j]];
-
-            // intersection over union
-            float inter_area = intersection_area(a, b);
-            float union_area = areas[i] + areas[picked[j]] - inter_area;
-//             float IoU = inter_area / union_area
-            if (inter_area / union_area > nms_threshold)
-                keep = 0;
-        }
-
-        if (keep)
-            picked.push_back(i);
-    }
-}
-
 int Proposal::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
 {
     const Mat& score_blob = bottom_blobs[0];
@@ -318,18 +224,15 @@ int Proposal::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& to
     }
 
     // sort all (proposal, score) pairs by score from highest to lowest
-    qsort_descent_inplace(proposal_boxes, scores);
-
     // take top pre_nms_topN
-    if (pre_nms_topN > 0 && pre_nms_topN < (int)proposal_boxes.size())
-    {
-        proposal_boxes.resize(pre_nms_topN);
-        scores.resize(pre_nms_topN);
-    }
+    std::vector<int> order;
+    if (!scores.empty())
+        topk_descent_indices(&scores[0], scores.size(), pre_nms_topN, order);
 
-    // apply nms with nms_thresh
+    // apply nms with nms_thresh, stop after after_nms_topN
     std::vector<int> picked;
-    nms_sorted_bboxes(proposal_boxes, picked, nms_thresh);
+    if (!order.empty())
+        nms_sorted_bboxes((const float*)&proposal_boxes[0], sizeof(Rect) / sizeof(float), &order[0], order.size(), picked, nms_thresh, 0, after_nms_topN);
 
     // take after_nms_topN
     int picked_count = std::min((int)picked.size(), after_nms_topN);
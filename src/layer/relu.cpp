@@ -13,6 +13,7 @@
 // specific language governing permissions and limitations under the License.
 
 #include "relu.h"
+#include <math.h>
 #include <algorithm>
 
 namespace ncnn {
@@ -32,6 +33,14 @@ int ReLU::load_param(const ParamDict& pd)
     return 0;
 }
 
+static inline signed char float2int8(float v)
+{
+    int int32 = round(v);
+    if (int32 > 127) return 127;
+    if (int32 < -127) return -127;
+    return (signed char)int32;
+}
+
 int ReLU::forward_inplace_int8(Mat& bottom_top_blob, const Option& opt) const
 {
     int w = bottom_top_blob.w;
@@ -55,18 +64,17 @@ int ReLU::forward_inplace_int8(Mat& bottom_top_blob, const Option& opt) const
     }
     else
     {
-        // TODO
-        // #pragma omp parallel for num_threads(opt.num_threads)
-        // for (int q=0; q<channels; q++)
-        // {
-        //     float* ptr = bottom_top_blob.channel(q);
-
-        //     for (int i=0; i<size; i++)
-        //     {
-        //         if (ptr[i] < 0)
-        //             ptr[i] *= slope;
-        //     }
-        // }
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            signed char* ptr = bottom_top_blob.channel(q);
+
+            for (int i=0; i<size; i++)
+            {
+                if (ptr[i] < 0)
+                    ptr[i] = float2int8(ptr[i] * slope);
+            }
+        }
     }
 
     return 0;
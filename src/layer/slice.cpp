@@ -51,6 +51,13 @@ int Slice::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_b
             }
 
             Mat& top_blob = top_blobs[i];
+            if (opt.use_blob_view)
+            {
+                top_blob = bottom_blob.range(q, slice);
+                q += slice;
+                continue;
+            }
+
             top_blob.create(slice, elemsize, opt.blob_allocator);
             if (top_blob.empty())
                 return -100;
@@ -80,6 +87,13 @@ int Slice::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_b
             }
 
             Mat& top_blob = top_blobs[i];
+            if (opt.use_blob_view)
+            {
+                top_blob = bottom_blob.row_range(q, slice);
+                q += slice;
+                continue;
+            }
+
             top_blob.create(w, slice, elemsize, opt.blob_allocator);
             if (top_blob.empty())
                 return -100;
@@ -145,6 +159,13 @@ int Slice::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_b
             }
 
             Mat& top_blob = top_blobs[i];
+            if (opt.use_blob_view)
+            {
+                top_blob = bottom_blob.channel_range(q, slice);
+                q += slice;
+                continue;
+            }
+
             top_blob.create(w, h, slice, elemsize, opt.blob_allocator);
             if (top_blob.empty())
                 return -100;
@@ -29,6 +29,9 @@
   (this is the zlib license)
 */
 
+#ifndef AVX_MATHFUN_H
+#define AVX_MATHFUN_H
+
 #include <immintrin.h>
 
 /* yes I know, the top of this file is quite ugly */
@@ -64,8 +67,8 @@ _PS256_CONST_TYPE(min_norm_pos, int, 0x00800000);
 _PS256_CONST_TYPE(mant_mask, int, 0x7f800000);
 _PS256_CONST_TYPE(inv_mant_mask, int, ~0x7f800000);
 
-_PS256_CONST_TYPE(sign_mask, int, 0x80000000);
-_PS256_CONST_TYPE(inv_sign_mask, int, ~0x80000000);
+_PS256_CONST_TYPE(sign_mask, int, (int)0x80000000);
+_PS256_CONST_TYPE(inv_sign_mask, int, ~(int)0x80000000);
 
 _PI32_CONST256(0, 0);
 _PI32_CONST256(1, 1);
@@ -108,7 +111,7 @@ typedef union imm_xmm_union {
 
 
 #define AVX2_BITOP_USING_SSE2(fn) \
-static inline v8si _mm256_##fn(v8si x, int a) \
+static inline v8si avx2_mm256_##fn(v8si x, int a) \
 { \
   /* use SSE2 instruction to perform the bitop AVX2 */ \
   v4si x1, x2; \
@@ -125,7 +128,7 @@ AVX2_BITOP_USING_SSE2(slli_epi32)
 AVX2_BITOP_USING_SSE2(srli_epi32)
 
 #define AVX2_INTOP_USING_SSE2(fn) \
-static inline v8si _mm256_##fn(v8si x, v8si y) \
+static inline v8si avx2_mm256_##fn(v8si x, v8si y) \
 { \
   /* use SSE2 instructions to perform the AVX2 integer operation */ \
   v4si x1, x2; \
@@ -146,13 +149,23 @@ AVX2_INTOP_USING_SSE2(cmpeq_epi32)
 AVX2_INTOP_USING_SSE2(sub_epi32)
 AVX2_INTOP_USING_SSE2(add_epi32)
 
+/* immintrin.h declares the avx2 intrinsics even when the TU is built without avx2,
+   so the shims use their own names and are mapped onto the intrinsic names here */
+#define _mm256_slli_epi32 avx2_mm256_slli_epi32
+#define _mm256_srli_epi32 avx2_mm256_srli_epi32
+#define _mm256_and_si128 avx2_mm256_and_si128
+#define _mm256_andnot_si128 avx2_mm256_andnot_si128
+#define _mm256_cmpeq_epi32 avx2_mm256_cmpeq_epi32
+#define _mm256_sub_epi32 avx2_mm256_sub_epi32
+#define _mm256_add_epi32 avx2_mm256_add_epi32
+
 #endif /* __AVX2__ */
 
 
 /* natural logarithm computed for 8 simultaneous float 
    return NaN for x <= 0
 */
-v8sf log256_ps(v8sf x) {
+static inline v8sf log256_ps(v8sf x) {
   v8si imm0;
   v8sf one = *(v8sf*)_ps256_1;
 
@@ -238,7 +251,7 @@ _PS256_CONST(cephes_exp_p3, 4.1665795894E-2);
 _PS256_CONST(cephes_exp_p4, 1.6666665459E-1);
 _PS256_CONST(cephes_exp_p5, 5.0000001201E-1);
 
-v8sf exp256_ps(v8sf x) {
+static inline v8sf exp256_ps(v8sf x) {
   v8sf tmp = _mm256_setzero_ps(), fx;
   v8si imm0;
   v8sf one = *(v8sf*)_ps256_1;
@@ -318,7 +331,7 @@ _PS256_CONST(cephes_FOPI, 1.27323954473516); // 4 / M_PI
    surprising but correct result.
 
 */
-v8sf sin256_ps(v8sf x) { // any x
+static inline v8sf sin256_ps(v8sf x) { // any x
   v8sf xmm1, xmm2 = _mm256_setzero_ps(), xmm3, sign_bit, y;
   v8si imm0, imm2;
 
@@ -348,11 +361,11 @@ v8sf sin256_ps(v8sf x) { // any x
   /* j=(j+1) & (~1) (see the cephes sources) */
   // another two AVX2 instruction
   imm2 = _mm256_add_epi32(imm2, *(v8si*)_pi32_256_1);
-  imm2 = _mm256_and_si128(imm2, *(v8si*)_pi32_256_inv1);
+  imm2 = _mm256_and_si256(imm2, *(v8si*)_pi32_256_inv1);
   y = _mm256_cvtepi32_ps(imm2);
 
   /* get the swap sign flag */
-  imm0 = _mm256_and_si128(imm2, *(v8si*)_pi32_256_4);
+  imm0 = _mm256_and_si256(imm2, *(v8si*)_pi32_256_4);
   imm0 = _mm256_slli_epi32(imm0, 29);
   /* get the polynom selection mask 
      there is one polynom for 0 <= x <= Pi/4
@@ -360,7 +373,7 @@ v8sf sin256_ps(v8sf x) { // any x
 
      Both branches will be computed.
   */
-  imm2 = _mm256_and_si128(imm2, *(v8si*)_pi32_256_2);
+  imm2 = _mm256_and_si256(imm2, *(v8si*)_pi32_256_2);
   imm2 = _mm256_cmpeq_epi32(imm2,*(v8si*)_pi32_256_0);
 #else
   /* we use SSE2 routines to perform the integer ops */
@@ -445,7 +458,7 @@ v8sf sin256_ps(v8sf x) { // any x
 }
 
 /* almost the same as sin_ps */
-v8sf cos256_ps(v8sf x) { // any x
+static inline v8sf cos256_ps(v8sf x) { // any x
   v8sf xmm1, xmm2 = _mm256_setzero_ps(), xmm3, y;
   v8si imm0, imm2;
 
@@ -465,15 +478,15 @@ v8sf cos256_ps(v8sf x) { // any x
   imm2 = _mm256_cvttps_epi32(y);
   /* j=(j+1) & (~1) (see the cephes sources) */
   imm2 = _mm256_add_epi32(imm2, *(v8si*)_pi32_256_1);
-  imm2 = _mm256_and_si128(imm2, *(v8si*)_pi32_256_inv1);
+  imm2 = _mm256_and_si256(imm2, *(v8si*)_pi32_256_inv1);
   y = _mm256_cvtepi32_ps(imm2);
   imm2 = _mm256_sub_epi32(imm2, *(v8si*)_pi32_256_2);
   
   /* get the swap sign flag */
-  imm0 = _mm256_andnot_si128(imm2, *(v8si*)_pi32_256_4);
+  imm0 = _mm256_andnot_si256(imm2, *(v8si*)_pi32_256_4);
   imm0 = _mm256_slli_epi32(imm0, 29);
   /* get the polynom selection mask */
-  imm2 = _mm256_and_si128(imm2, *(v8si*)_pi32_256_2);
+  imm2 = _mm256_and_si256(imm2, *(v8si*)_pi32_256_2);
   imm2 = _mm256_cmpeq_epi32(imm2, *(v8si*)_pi32_256_0);
 #else
 
@@ -562,7 +575,7 @@ v8sf cos256_ps(v8sf x) { // any x
 
 /* since sin256_ps and cos256_ps are almost identical, sincos256_ps could replace both of them..
    it is almost as fast, and gives you a free cosine with your sine */
-void sincos256_ps(v8sf x, v8sf *s, v8sf *c) {
+static inline void sincos256_ps(v8sf x, v8sf *s, v8sf *c) {
 
   v8sf xmm1, xmm2, xmm3 = _mm256_setzero_ps(), sign_bit_sin, y;
   v8si imm0, imm2, imm4;
@@ -588,18 +601,18 @@ void sincos256_ps(v8sf x, v8sf *s, v8sf *c) {
 
   /* j=(j+1) & (~1) (see the cephes sources) */
   imm2 = _mm256_add_epi32(imm2, *(v8si*)_pi32_256_1);
-  imm2 = _mm256_and_si128(imm2, *(v8si*)_pi32_256_inv1);
+  imm2 = _mm256_and_si256(imm2, *(v8si*)_pi32_256_inv1);
 
   y = _mm256_cvtepi32_ps(imm2);
   imm4 = imm2;
 
   /* get the swap sign flag for the sine */
-  imm0 = _mm256_and_si128(imm2, *(v8si*)_pi32_256_4);
+  imm0 = _mm256_and_si256(imm2, *(v8si*)_pi32_256_4);
   imm0 = _mm256_slli_epi32(imm0, 29);
   //v8sf swap_sign_bit_sin = _mm256_castsi256_ps(imm0);
 
   /* get the polynom selection mask for the sine*/
-  imm2 = _mm256_and_si128(imm2, *(v8si*)_pi32_256_2);
+  imm2 = _mm256_and_si256(imm2, *(v8si*)_pi32_256_2);
   imm2 = _mm256_cmpeq_epi32(imm2, *(v8si*)_pi32_256_0);
   //v8sf poly_mask = _mm256_castsi256_ps(imm2);
 #else
@@ -651,7 +664,7 @@ void sincos256_ps(v8sf x, v8sf *s, v8sf *c) {
 
 #ifdef __AVX2__
   imm4 = _mm256_sub_epi32(imm4, *(v8si*)_pi32_256_2);
-  imm4 = _mm256_andnot_si128(imm4, *(v8si*)_pi32_256_4);
+  imm4 = _mm256_andnot_si256(imm4, *(v8si*)_pi32_256_4);
   imm4 = _mm256_slli_epi32(imm4, 29);
 #else
   imm4_1 = _mm_sub_epi32(imm4_1, *(v4si*)_pi32avx_2);
@@ -710,3 +723,52 @@ void sincos256_ps(v8sf x, v8sf *s, v8sf *c) {
   *c = _mm256_xor_ps(xmm2, sign_bit_cos);
 }
 
+static inline v8sf pow256_ps(v8sf a, v8sf b)
+{
+    // pow(x, m) = exp(m * log(x))
+    return exp256_ps(_mm256_mul_ps(b, log256_ps(a)));
+}
+
+// tanh avx vector version
+// refer the scalar version from Cephes Math Library
+
+_PS256_CONST(cephes_tanh_C1, 0.625f);
+
+_PS256_CONST(cephes_tanh_p0, -5.70498872745E-3);
+_PS256_CONST(cephes_tanh_p1, +2.06390887954E-2);
+_PS256_CONST(cephes_tanh_p2, -5.37397155531E-2);
+_PS256_CONST(cephes_tanh_p3, +1.33314422036E-1);
+_PS256_CONST(cephes_tanh_p4, -3.33332819422E-1);
+
+/* Single precision hyperbolic tangent computed for 8 simultaneous float */
+static inline v8sf tanh256_ps(v8sf x)
+{
+    v8sf x2 = _mm256_and_ps(x, *(v8sf*)_ps256_inv_sign_mask);
+
+    v8sf mask_l = _mm256_cmp_ps(x2, *(v8sf*)_ps256_cephes_tanh_C1, _CMP_GE_OS);
+
+    // abs(x) >= 0.625
+    // tanh(abs(x)) = (1 - exp(-2 abs(x))) / (1 + exp(-2 abs(x))), which never overflows
+    v8sf one = *(v8sf*)_ps256_1;
+    v8sf exp_x_x = exp256_ps(_mm256_sub_ps(_mm256_setzero_ps(), _mm256_add_ps(x2, x2)));
+    v8sf y0 = _mm256_div_ps(_mm256_sub_ps(one, exp_x_x), _mm256_add_ps(one, exp_x_x));
+    y0 = _mm256_or_ps(y0, _mm256_and_ps(x, *(v8sf*)_ps256_sign_mask));
+
+    // abs(x) < 0.625
+    v8sf z = _mm256_mul_ps(x, x);
+
+    v8sf y = *(v8sf*)_ps256_cephes_tanh_p0;
+    y = _mm256_add_ps(_mm256_mul_ps(y, z), *(v8sf*)_ps256_cephes_tanh_p1);
+    y = _mm256_add_ps(_mm256_mul_ps(y, z), *(v8sf*)_ps256_cephes_tanh_p2);
+    y = _mm256_add_ps(_mm256_mul_ps(y, z), *(v8sf*)_ps256_cephes_tanh_p3);
+    y = _mm256_add_ps(_mm256_mul_ps(y, z), *(v8sf*)_ps256_cephes_tanh_p4);
+
+    y = _mm256_mul_ps(y, z);
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), x);
+
+    y = _mm256_blendv_ps(y, y0, mask_l);
+
+    return y;
+}
+
+#endif // AVX_MATHFUN_H
@@ -0,0 +1,170 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "batchnorm_x86.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+#if __AVX__
+#include <immintrin.h>
+#endif // __AVX__
+
+namespace ncnn {
+
+DEFINE_LAYER_CREATOR(BatchNorm_x86)
+
+BatchNorm_x86::BatchNorm_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+// value = b * value + a, a and b hold one value per lane of the pack
+static void batchnorm_lanes(float* ptr, const float* a, const float* b, int size, int elempack)
+{
+#if __AVX__
+    if (elempack == 8)
+    {
+        __m256 _a = _mm256_loadu_ps(a);
+        __m256 _b = _mm256_loadu_ps(b);
+        for (int i=0; i<size; i++)
+        {
+            __m256 _p = _mm256_loadu_ps(ptr);
+            _mm256_storeu_ps(ptr, _mm256_fmadd_ps(_p, _b, _a));
+            ptr += 8;
+        }
+        return;
+    }
+#endif // __AVX__
+#if __SSE2__
+    if (elempack == 4)
+    {
+        __m128 _a = _mm_loadu_ps(a);
+        __m128 _b = _mm_loadu_ps(b);
+        for (int i=0; i<size; i++)
+        {
+            __m128 _p = _mm_loadu_ps(ptr);
+            _mm_storeu_ps(ptr, _mm_add_ps(_mm_mul_ps(_p, _b), _a));
+            ptr += 4;
+        }
+        return;
+    }
+#endif // __SSE2__
+
+    int i = 0;
+#if __AVX__
+    __m256 _a_avx = _mm256_set1_ps(a[0]);
+    __m256 _b_avx = _mm256_set1_ps(b[0]);
+    for (; i+7<size; i+=8)
+    {
+        __m256 _p = _mm256_loadu_ps(ptr);
+        _mm256_storeu_ps(ptr, _mm256_fmadd_ps(_p, _b_avx, _a_avx));
+        ptr += 8;
+    }
+#endif // __AVX__
+#if __SSE2__
+    __m128 _a = _mm_set1_ps(a[0]);
+    __m128 _b = _mm_set1_ps(b[0]);
+    for (; i+3<size; i+=4)
+    {
+        __m128 _p = _mm_loadu_ps(ptr);
+        _mm_storeu_ps(ptr, _mm_add_ps(_mm_mul_ps(_p, _b), _a));
+        ptr += 4;
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        *ptr = b[0] * *ptr + a[0];
+        ptr++;
+    }
+}
+
+int BatchNorm_x86::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
+{
+    int dims = bottom_top_blob.dims;
+    int elempack = bottom_top_blob.elempack;
+
+    if (dims == 1)
+    {
+        int w = bottom_top_blob.w * elempack;
+
+        float* ptr = bottom_top_blob;
+        const float* a = a_data;
+        const float* b = b_data;
+
+        int i = 0;
+#if __AVX__
+        for (; i+7<w; i+=8)
+        {
+            __m256 _p = _mm256_loadu_ps(ptr + i);
+            __m256 _a = _mm256_loadu_ps(a + i);
+            __m256 _b = _mm256_loadu_ps(b + i);
+            _mm256_storeu_ps(ptr + i, _mm256_fmadd_ps(_p, _b, _a));
+        }
+#endif // __AVX__
+#if __SSE2__
+        for (; i+3<w; i+=4)
+        {
+            __m128 _p = _mm_loadu_ps(ptr + i);
+            __m128 _a = _mm_loadu_ps(a + i);
+            __m128 _b = _mm_loadu_ps(b + i);
+            _mm_storeu_ps(ptr + i, _mm_add_ps(_mm_mul_ps(_p, _b), _a));
+        }
+#endif // __SSE2__
+        for (; i<w; i++)
+        {
+            ptr[i] = b[i] * ptr[i] + a[i];
+        }
+
+        return 0;
+    }
+
+    if (dims == 2)
+    {
+        int w = bottom_top_blob.w;
+        int h = bottom_top_blob.h;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int i=0; i<h; i++)
+        {
+            float* ptr = bottom_top_blob.row(i);
+
+            batchnorm_lanes(ptr, (const float*)a_data + i * elempack, (const float*)b_data + i * elempack, w, elempack);
+        }
+
+        return 0;
+    }
+
+    if (dims == 3)
+    {
+        int size = bottom_top_blob.w * bottom_top_blob.h;
+        int channels = bottom_top_blob.c;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            float* ptr = bottom_top_blob.channel(q);
+
+            batchnorm_lanes(ptr, (const float*)a_data + q * elempack, (const float*)b_data + q * elempack, size, elempack);
+        }
+
+        return 0;
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
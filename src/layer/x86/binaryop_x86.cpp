@@ -0,0 +1,892 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "binaryop_x86.h"
+
+#include <math.h>
+#include <algorithm>
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+#if __AVX__
+#include <immintrin.h>
+#endif // __AVX__
+
+namespace ncnn {
+
+DEFINE_LAYER_CREATOR(BinaryOp_x86)
+
+BinaryOp_x86::BinaryOp_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+int BinaryOp_x86::create_pipeline(const Option& /*opt*/)
+{
+    // pow goes through the reference on the plain layout
+    if (op_type == Operation_POW)
+        support_packing = false;
+
+    return 0;
+}
+
+// c = op(a, b) for size elements
+template<typename Op>
+static void binary_op_vector_vector(const float* ptr, const float* ptr1, float* outptr, int size)
+{
+    Op op;
+
+    int i = 0;
+#if __AVX__
+    for (; i+7<size; i+=8)
+    {
+        __m256 _p = _mm256_loadu_ps(ptr);
+        __m256 _p1 = _mm256_loadu_ps(ptr1);
+        _mm256_storeu_ps(outptr, op.func_pack8(_p, _p1));
+
+        ptr += 8;
+        ptr1 += 8;
+        outptr += 8;
+    }
+#endif // __AVX__
+#if __SSE2__
+    for (; i+3<size; i+=4)
+    {
+        __m128 _p = _mm_loadu_ps(ptr);
+        __m128 _p1 = _mm_loadu_ps(ptr1);
+        _mm_storeu_ps(outptr, op.func_pack4(_p, _p1));
+
+        ptr += 4;
+        ptr1 += 4;
+        outptr += 4;
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        *outptr = op.func(*ptr, *ptr1);
+
+        ptr++;
+        ptr1++;
+        outptr++;
+    }
+}
+
+// c = op(a, b0) for size elements
+template<typename Op>
+static void binary_op_vector_scalar(const float* ptr, float b0, float* outptr, int size)
+{
+    Op op;
+
+    int i = 0;
+#if __AVX__
+    __m256 _b0_avx = _mm256_set1_ps(b0);
+    for (; i+7<size; i+=8)
+    {
+        __m256 _p = _mm256_loadu_ps(ptr);
+        _mm256_storeu_ps(outptr, op.func_pack8(_p, _b0_avx));
+
+        ptr += 8;
+        outptr += 8;
+    }
+#endif // __AVX__
+#if __SSE2__
+    __m128 _b0 = _mm_set1_ps(b0);
+    for (; i+3<size; i+=4)
+    {
+        __m128 _p = _mm_loadu_ps(ptr);
+        _mm_storeu_ps(outptr, op.func_pack4(_p, _b0));
+
+        ptr += 4;
+        outptr += 4;
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        *outptr = op.func(*ptr, b0);
+
+        ptr++;
+        outptr++;
+    }
+}
+
+// c = op(a0, b) for size elements
+template<typename Op>
+static void binary_op_scalar_vector(float a0, const float* ptr1, float* outptr, int size)
+{
+    Op op;
+
+    int i = 0;
+#if __AVX__
+    __m256 _a0_avx = _mm256_set1_ps(a0);
+    for (; i+7<size; i+=8)
+    {
+        __m256 _p1 = _mm256_loadu_ps(ptr1);
+        _mm256_storeu_ps(outptr, op.func_pack8(_a0_avx, _p1));
+
+        ptr1 += 8;
+        outptr += 8;
+    }
+#endif // __AVX__
+#if __SSE2__
+    __m128 _a0 = _mm_set1_ps(a0);
+    for (; i+3<size; i+=4)
+    {
+        __m128 _p1 = _mm_loadu_ps(ptr1);
+        _mm_storeu_ps(outptr, op.func_pack4(_a0, _p1));
+
+        ptr1 += 4;
+        outptr += 4;
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        *outptr = op.func(a0, *ptr1);
+
+        ptr1++;
+        outptr++;
+    }
+}
+
+// broadcasting rule
+// https://github.com/Tencent/ncnn/wiki/binaryop-broadcasting
+
+// c = op(a, b) where b holds one elempack lane vector shared by all size elements
+template<typename Op>
+static void binary_op_vector_lanes(const float* ptr, const float* ptr1, float* outptr, int size, int elempack)
+{
+    Op op;
+
+#if __AVX__
+    if (elempack == 8)
+    {
+        __m256 _b_avx = _mm256_loadu_ps(ptr1);
+        for (int i=0; i<size; i++)
+        {
+            _mm256_storeu_ps(outptr, op.func_pack8(_mm256_loadu_ps(ptr), _b_avx));
+
+            ptr += 8;
+            outptr += 8;
+        }
+
+        return;
+    }
+#endif // __AVX__
+#if __SSE2__
+    if (elempack == 4)
+    {
+        __m128 _b = _mm_loadu_ps(ptr1);
+        for (int i=0; i<size; i++)
+        {
+            _mm_storeu_ps(outptr, op.func_pack4(_mm_loadu_ps(ptr), _b));
+
+            ptr += 4;
+            outptr += 4;
+        }
+
+        return;
+    }
+#endif // __SSE2__
+    for (int i=0; i<size; i++)
+    {
+        for (int k=0; k<elempack; k++)
+        {
+            outptr[k] = op.func(ptr[k], ptr1[k]);
+        }
+
+        ptr += elempack;
+        outptr += elempack;
+    }
+}
+
+// c = op(a, b) where a holds one elempack lane vector shared by all size elements
+template<typename Op>
+static void binary_op_lanes_vector(const float* ptr, const float* ptr1, float* outptr, int size, int elempack)
+{
+    Op op;
+
+#if __AVX__
+    if (elempack == 8)
+    {
+        __m256 _a_avx = _mm256_loadu_ps(ptr);
+        for (int i=0; i<size; i++)
+        {
+            _mm256_storeu_ps(outptr, op.func_pack8(_a_avx, _mm256_loadu_ps(ptr1)));
+
+            ptr1 += 8;
+            outptr += 8;
+        }
+
+        return;
+    }
+#endif // __AVX__
+#if __SSE2__
+    if (elempack == 4)
+    {
+        __m128 _a = _mm_loadu_ps(ptr);
+        for (int i=0; i<size; i++)
+        {
+            _mm_storeu_ps(outptr, op.func_pack4(_a, _mm_loadu_ps(ptr1)));
+
+            ptr1 += 4;
+            outptr += 4;
+        }
+
+        return;
+    }
+#endif // __SSE2__
+    for (int i=0; i<size; i++)
+    {
+        for (int k=0; k<elempack; k++)
+        {
+            outptr[k] = op.func(ptr[k], ptr1[k]);
+        }
+
+        ptr1 += elempack;
+        outptr += elempack;
+    }
+}
+
+template<typename Op>
+static int binary_op(const Mat& a, const Mat& b, Mat& c, const Option& opt)
+{
+    int w = a.w;
+    int h = a.h;
+    int channels = a.c;
+    int size = w * h;
+    size_t elemsize = a.elemsize;
+
+    int w1 = b.w;
+    int h1 = b.h;
+    int channels1 = b.c;
+    int size1 = w1 * h1;
+
+    if (a.dims == 3)
+    {
+        c.create(w, h, channels, elemsize, opt.blob_allocator);
+        if (c.empty())
+            return -100;
+
+        if (b.dims == 3)
+        {
+            if (w1 == 1 && h1 == 1 && channels1 == channels)
+            {
+                // special type 1
+                #pragma omp parallel for num_threads(opt.num_threads)
+                for (int q=0; q<channels; q++)
+                {
+                    binary_op_vector_scalar<Op>(a.channel(q), b.channel(q)[0], c.channel(q), size);
+                }
+
+                return 0;
+            }
+
+            if (w1 == w && h1 == h && channels1 == 1)
+            {
+                // special type 2
+                #pragma omp parallel for num_threads(opt.num_threads)
+                for (int q=0; q<channels; q++)
+                {
+                    binary_op_vector_vector<Op>(a.channel(q), b, c.channel(q), size);
+                }
+
+                return 0;
+            }
+
+            // type 19
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int q=0; q<channels; q++)
+            {
+                binary_op_vector_vector<Op>(a.channel(q), b.channel(q), c.channel(q), size);
+            }
+
+            return 0;
+        }
+
+        if (b.dims == 2)
+        {
+            // type 18
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int q=0; q<channels; q++)
+            {
+                const float* ptr = a.channel(q);
+                const float* ptr1 = b.row(q);
+                float* outptr = c.channel(q);
+
+                for (int y=0; y<h; y++)
+                {
+                    binary_op_vector_scalar<Op>(ptr, ptr1[y], outptr, w);
+
+                    ptr += w;
+                    outptr += w;
+                }
+            }
+
+            return 0;
+        }
+
+        if (b.dims == 1)
+        {
+            if (b.w == 1)
+            {
+                // type 16
+                const float b0 = b[0];
+                #pragma omp parallel for num_threads(opt.num_threads)
+                for (int q=0; q<channels; q++)
+                {
+                    binary_op_vector_scalar<Op>(a.channel(q), b0, c.channel(q), size);
+                }
+
+                return 0;
+            }
+
+            // type 17
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int q=0; q<channels; q++)
+            {
+                binary_op_vector_scalar<Op>(a.channel(q), b[q], c.channel(q), size);
+            }
+
+            return 0;
+        }
+    }
+    else if (a.dims == 2)
+    {
+        if (b.dims == 3)
+        {
+            // type 14
+            c.create(w1, h1, channels1, elemsize, opt.blob_allocator);
+            if (c.empty())
+                return -100;
+
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int q=0; q<channels1; q++)
+            {
+                const float* ptr = a.row(q);
+                const float* ptr1 = b.channel(q);
+                float* outptr = c.channel(q);
+
+                for (int y=0; y<h1; y++)
+                {
+                    binary_op_scalar_vector<Op>(ptr[y], ptr1, outptr, w1);
+
+                    ptr1 += w1;
+                    outptr += w1;
+                }
+            }
+
+            return 0;
+        }
+
+        c.create(w, h, elemsize, opt.blob_allocator);
+        if (c.empty())
+            return -100;
+
+        if (b.dims == 2)
+        {
+            // type 13
+            binary_op_vector_vector<Op>(a, b, c, size);
+
+            return 0;
+        }
+
+        if (b.dims == 1)
+        {
+            if (b.w == 1)
+            {
+                // type 11
+                binary_op_vector_scalar<Op>(a, b[0], c, size);
+
+                return 0;
+            }
+
+            // type 12
+            const float* ptr = a;
+            float* outptr = c;
+
+            for (int y=0; y<h; y++)
+            {
+                binary_op_vector_scalar<Op>(ptr, b[y], outptr, w);
+
+                ptr += w;
+                outptr += w;
+            }
+
+            return 0;
+        }
+    }
+    else if (a.dims == 1)
+    {
+        if (a.w == 1)
+        {
+            if (b.dims == 3)
+            {
+                // type 4
+                c.create(w1, h1, channels1, elemsize, opt.blob_allocator);
+                if (c.empty())
+                    return -100;
+
+                const float a0 = a[0];
+                #pragma omp parallel for num_threads(opt.num_threads)
+                for (int q=0; q<channels1; q++)
+                {
+                    binary_op_scalar_vector<Op>(a0, b.channel(q), c.channel(q), size1);
+                }
+
+                return 0;
+            }
+
+            if (b.dims == 2)
+            {
+                // type 3
+                c.create(w1, h1, elemsize, opt.blob_allocator);
+                if (c.empty())
+                    return -100;
+
+                binary_op_scalar_vector<Op>(a[0], b, c, size1);
+
+                return 0;
+            }
+
+            if (b.dims == 1)
+            {
+                // type 2
+                c.create(w1, elemsize, opt.blob_allocator);
+                if (c.empty())
+                    return -100;
+
+                binary_op_scalar_vector<Op>(a[0], b, c, w1);
+
+                return 0;
+            }
+        }
+
+        if (b.dims == 3)
+        {
+            // type 9
+            c.create(w1, h1, channels1, elemsize, opt.blob_allocator);
+            if (c.empty())
+                return -100;
+
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int q=0; q<channels1; q++)
+            {
+                binary_op_scalar_vector<Op>(a[q], b.channel(q), c.channel(q), size1);
+            }
+
+            return 0;
+        }
+
+        if (b.dims == 2)
+        {
+            // type 8
+            c.create(w1, h1, elemsize, opt.blob_allocator);
+            if (c.empty())
+                return -100;
+
+            const float* ptr1 = b;
+            float* outptr = c;
+
+            for (int y=0; y<h1; y++)
+            {
+                binary_op_scalar_vector<Op>(a[y], ptr1, outptr, w1);
+
+                ptr1 += w1;
+                outptr += w1;
+            }
+
+            return 0;
+        }
+
+        if (b.dims == 1)
+        {
+            c.create(w, elemsize, opt.blob_allocator);
+            if (c.empty())
+                return -100;
+
+            if (b.w == 1)
+            {
+                // type 6
+                binary_op_vector_scalar<Op>(a, b[0], c, w);
+
+                return 0;
+            }
+
+            // type 7
+            binary_op_vector_vector<Op>(a, b, c, w);
+        }
+    }
+
+    return 0;
+}
+
+// packed inputs, broadcasting only along whole lane vectors
+template<typename Op>
+static int binary_op_pack(const Mat& a, const Mat& b, Mat& c, const Option& opt)
+{
+    int elempack = a.elempack;
+    int elempack1 = b.elempack;
+
+    if (a.dims == b.dims && a.w == b.w && a.h == b.h && a.c == b.c && elempack == elempack1)
+    {
+        c.create_like(a, opt.blob_allocator);
+        if (c.empty())
+            return -100;
+
+        int channels = a.c;
+        int size = a.w * a.h * elempack;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            binary_op_vector_vector<Op>(a.channel(q), b.channel(q), c.channel(q), size);
+        }
+
+        return 0;
+    }
+
+    if (b.dims == 1 && b.w == 1 && elempack1 == 1)
+    {
+        c.create_like(a, opt.blob_allocator);
+        if (c.empty())
+            return -100;
+
+        int channels = a.c;
+        int size = a.w * a.h * elempack;
+
+        const float b0 = b[0];
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            binary_op_vector_scalar<Op>(a.channel(q), b0, c.channel(q), size);
+        }
+
+        return 0;
+    }
+
+    if (a.dims == 1 && a.w == 1 && elempack == 1)
+    {
+        c.create_like(b, opt.blob_allocator);
+        if (c.empty())
+            return -100;
+
+        int channels = b.c;
+        int size = b.w * b.h * elempack1;
+
+        const float a0 = a[0];
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            binary_op_scalar_vector<Op>(a0, b.channel(q), c.channel(q), size);
+        }
+
+        return 0;
+    }
+
+    if (elempack == elempack1)
+    {
+        // b per channel of a
+        if (a.dims == 3 && ((b.dims == 1 && b.w == a.c) || (b.dims == 3 && b.w == 1 && b.h == 1 && b.c == a.c)))
+        {
+            c.create_like(a, opt.blob_allocator);
+            if (c.empty())
+                return -100;
+
+            int channels = a.c;
+            int size = a.w * a.h;
+
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int q=0; q<channels; q++)
+            {
+                const float* ptr1 = b.dims == 1 ? (const float*)b + q * elempack : (const float*)b.channel(q);
+                binary_op_vector_lanes<Op>(a.channel(q), ptr1, c.channel(q), size, elempack);
+            }
+
+            return 0;
+        }
+
+        // b per row of a
+        if (a.dims == 2 && b.dims == 1 && b.w == a.h)
+        {
+            c.create_like(a, opt.blob_allocator);
+            if (c.empty())
+                return -100;
+
+            int w = a.w;
+            int h = a.h;
+
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int y=0; y<h; y++)
+            {
+                binary_op_vector_lanes<Op>(a.row(y), (const float*)b + y * elempack, c.row(y), w, elempack);
+            }
+
+            return 0;
+        }
+
+        // a per channel of b
+        if (b.dims == 3 && a.dims == 1 && a.w == b.c)
+        {
+            c.create_like(b, opt.blob_allocator);
+            if (c.empty())
+                return -100;
+
+            int channels = b.c;
+            int size = b.w * b.h;
+
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int q=0; q<channels; q++)
+            {
+                const float* ptr = a.dims == 1 ? (const float*)a + q * elempack : (const float*)a.channel(q);
+                binary_op_lanes_vector<Op>(ptr, b.channel(q), c.channel(q), size, elempack);
+            }
+
+            return 0;
+        }
+
+        // a per row of b
+        if (b.dims == 2 && a.dims == 1 && a.w == b.h)
+        {
+            c.create_like(b, opt.blob_allocator);
+            if (c.empty())
+                return -100;
+
+            int w = b.w;
+            int h = b.h;
+
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int y=0; y<h; y++)
+            {
+                binary_op_lanes_vector<Op>((const float*)a + y * elempack, b.row(y), c.row(y), w, elempack);
+            }
+
+            return 0;
+        }
+    }
+
+    // other broadcasts on the plain layout
+    Option opt_pack = opt;
+    opt_pack.blob_allocator = opt.workspace_allocator;
+
+    Mat a_unpacked;
+    Mat b_unpacked;
+    convert_packing(a, a_unpacked, 1, opt_pack);
+    convert_packing(b, b_unpacked, 1, opt_pack);
+
+    return binary_op<Op>(a_unpacked, b_unpacked, c, opt);
+}
+
+template<typename Op>
+static int binary_op_scalar_inplace(Mat& a, float b, const Option& opt)
+{
+    int w = a.w;
+    int h = a.h;
+    int channels = a.c;
+    int elempack = a.elempack;
+    int size = w * h * elempack;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<channels; q++)
+    {
+        float* ptr = a.channel(q);
+
+        binary_op_vector_scalar<Op>(ptr, b, ptr, size);
+    }
+
+    return 0;
+}
+
+struct binary_op_add
+{
+    float func(const float& x, const float& y) const { return x + y; }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const { return _mm_add_ps(x, y); }
+#endif // __SSE2__
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const { return _mm256_add_ps(x, y); }
+#endif // __AVX__
+};
+
+struct binary_op_sub
+{
+    float func(const float& x, const float& y) const { return x - y; }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const { return _mm_sub_ps(x, y); }
+#endif // __SSE2__
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const { return _mm256_sub_ps(x, y); }
+#endif // __AVX__
+};
+
+struct binary_op_mul
+{
+    float func(const float& x, const float& y) const { return x * y; }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const { return _mm_mul_ps(x, y); }
+#endif // __SSE2__
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const { return _mm256_mul_ps(x, y); }
+#endif // __AVX__
+};
+
+struct binary_op_div
+{
+    float func(const float& x, const float& y) const { return x / y; }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const { return _mm_div_ps(x, y); }
+#endif // __SSE2__
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const { return _mm256_div_ps(x, y); }
+#endif // __AVX__
+};
+
+struct binary_op_max
+{
+    float func(const float& x, const float& y) const { return std::max(x, y); }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const { return _mm_max_ps(x, y); }
+#endif // __SSE2__
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const { return _mm256_max_ps(x, y); }
+#endif // __AVX__
+};
+
+struct binary_op_min
+{
+    float func(const float& x, const float& y) const { return std::min(x, y); }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const { return _mm_min_ps(x, y); }
+#endif // __SSE2__
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const { return _mm256_min_ps(x, y); }
+#endif // __AVX__
+};
+
+struct binary_op_rsub
+{
+    float func(const float& x, const float& y) const { return y - x; }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const { return _mm_sub_ps(y, x); }
+#endif // __SSE2__
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const { return _mm256_sub_ps(y, x); }
+#endif // __AVX__
+};
+
+struct binary_op_rdiv
+{
+    float func(const float& x, const float& y) const { return y / x; }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const { return _mm_div_ps(y, x); }
+#endif // __SSE2__
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const { return _mm256_div_ps(y, x); }
+#endif // __AVX__
+};
+
+int BinaryOp_x86::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    const Mat& bottom_blob = bottom_blobs[0];
+    const Mat& bottom_blob1 = bottom_blobs[1];
+
+    Mat& top_blob = top_blobs[0];
+
+    if (bottom_blob.elempack != 1 || bottom_blob1.elempack != 1)
+    {
+        if (op_type == Operation_ADD)
+            return binary_op_pack<binary_op_add>(bottom_blob, bottom_blob1, top_blob, opt);
+
+        if (op_type == Operation_SUB)
+            return binary_op_pack<binary_op_sub>(bottom_blob, bottom_blob1, top_blob, opt);
+
+        if (op_type == Operation_MUL)
+            return binary_op_pack<binary_op_mul>(bottom_blob, bottom_blob1, top_blob, opt);
+
+        if (op_type == Operation_DIV)
+            return binary_op_pack<binary_op_div>(bottom_blob, bottom_blob1, top_blob, opt);
+
+        if (op_type == Operation_MAX)
+            return binary_op_pack<binary_op_max>(bottom_blob, bottom_blob1, top_blob, opt);
+
+        if (op_type == Operation_MIN)
+            return binary_op_pack<binary_op_min>(bottom_blob, bottom_blob1, top_blob, opt);
+
+        if (op_type == Operation_RSUB)
+            return binary_op_pack<binary_op_rsub>(bottom_blob, bottom_blob1, top_blob, opt);
+
+        if (op_type == Operation_RDIV)
+            return binary_op_pack<binary_op_rdiv>(bottom_blob, bottom_blob1, top_blob, opt);
+    }
+
+    if (op_type == Operation_ADD)
+        return binary_op<binary_op_add>(bottom_blob, bottom_blob1, top_blob, opt);
+
+    if (op_type == Operation_SUB)
+        return binary_op<binary_op_sub>(bottom_blob, bottom_blob1, top_blob, opt);
+
+    if (op_type == Operation_MUL)
+        return binary_op<binary_op_mul>(bottom_blob, bottom_blob1, top_blob, opt);
+
+    if (op_type == Operation_DIV)
+        return binary_op<binary_op_div>(bottom_blob, bottom_blob1, top_blob, opt);
+
+    if (op_type == Operation_MAX)
+        return binary_op<binary_op_max>(bottom_blob, bottom_blob1, top_blob, opt);
+
+    if (op_type == Operation_MIN)
+        return binary_op<binary_op_min>(bottom_blob, bottom_blob1, top_blob, opt);
+
+    if (op_type == Operation_RSUB)
+        return binary_op<binary_op_rsub>(bottom_blob, bottom_blob1, top_blob, opt);
+
+    if (op_type == Operation_RDIV)
+        return binary_op<binary_op_rdiv>(bottom_blob, bottom_blob1, top_blob, opt);
+
+    // pow
+    return BinaryOp::forward(bottom_blobs, top_blobs, opt);
+}
+
+int BinaryOp_x86::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
+{
+    if (op_type == Operation_ADD)
+        return binary_op_scalar_inplace<binary_op_add>(bottom_top_blob, b, opt);
+
+    if (op_type == Operation_SUB)
+        return binary_op_scalar_inplace<binary_op_sub>(bottom_top_blob, b, opt);
+
+    if (op_type == Operation_MUL)
+        return binary_op_scalar_inplace<binary_op_mul>(bottom_top_blob, b, opt);
+
+    if (op_type == Operation_DIV)
+        return binary_op_scalar_inplace<binary_op_div>(bottom_top_blob, b, opt);
+
+    if (op_type == Operation_MAX)
+        return binary_op_scalar_inplace<binary_op_max>(bottom_top_blob, b, opt);
+
+    if (op_type == Operation_MIN)
+        return binary_op_scalar_inplace<binary_op_min>(bottom_top_blob, b, opt);
+
+    if (op_type == Operation_RSUB)
+        return binary_op_scalar_inplace<binary_op_rsub>(bottom_top_blob, b, opt);
+
+    if (op_type == Operation_RDIV)
+        return binary_op_scalar_inplace<binary_op_rdiv>(bottom_top_blob, b, opt);
+
+    // pow
+    return BinaryOp::forward_inplace(bottom_top_blob, opt);
+}
+
+} // namespace ncnn
@@ -659,7 +659,14 @@ static void conv3x3s1_winograd23_sse(const Mat& bottom_blob, Mat& top_blob, cons
 
     // BEGIN transform output
     Mat top_blob_bordered;
-    top_blob_bordered.create(outw, outh, outch, 4u, opt.workspace_allocator);
+    if (outw == top_blob.w && outh == top_blob.h)
+    {
+        top_blob_bordered = top_blob;
+    }
+    else
+    {
+        top_blob_bordered.create(outw, outh, outch, 4u, opt.workspace_allocator);
+    }
     {
         // AT
         // const float itm[2][4] = {
@@ -736,7 +743,10 @@ static void conv3x3s1_winograd23_sse(const Mat& bottom_blob, Mat& top_blob, cons
     // END transform output 
 
     // cut result pad
-    copy_cut_border(top_blob_bordered, top_blob, 0, top_blob_bordered.h - top_blob.h, 0, top_blob_bordered.w - top_blob.w, opt);
+    if (top_blob_bordered.data != top_blob.data)
+    {
+        copy_cut_border(top_blob_bordered, top_blob, 0, top_blob_bordered.h - top_blob.h, 0, top_blob_bordered.w - top_blob.w, opt);
+    }
 }
 
 static void conv3x3s1_winograd43_transform_kernel_sse(const Mat& kernel, std::vector<Mat> &kernel_tm2, int inch, int outch)
@@ -1606,7 +1616,7 @@ static void conv3x3s1_winograd43_sse(const Mat& bottom_blob, Mat& top_blob, cons
 #else
                         _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_r0, _k0));
 #endif
-                        kptr += 16;
+                        kptr += 4;
                         r0 += 4;
                     }
                     _mm_storeu_ps(output0_tm, _sum0);
@@ -1617,7 +1627,7 @@ static void conv3x3s1_winograd43_sse(const Mat& bottom_blob, Mat& top_blob, cons
                     {
                         for (int n=0; n<4; n++)
                         {
-                            sum0[n] += (int)r0[n] * kptr[n];
+                            sum0[n] += r0[n] * kptr[n];
                         }
                         kptr += 4; 
                         r0 += 4;
@@ -1668,7 +1678,14 @@ static void conv3x3s1_winograd43_sse(const Mat& bottom_blob, Mat& top_blob, cons
 
     // BEGIN transform output
     Mat top_blob_bordered;
-    top_blob_bordered.create(outw, outh, outch, elemsize, opt.workspace_allocator);
+    if (outw == top_blob.w && outh == top_blob.h)
+    {
+        top_blob_bordered = top_blob;
+    }
+    else
+    {
+        top_blob_bordered.create(outw, outh, outch, elemsize, opt.workspace_allocator);
+    }
     {
         // AT
         // const float itm[4][6] = {
@@ -1773,9 +1790,561 @@ static void conv3x3s1_winograd43_sse(const Mat& bottom_blob, Mat& top_blob, cons
     // END transform output
 
     // cut result pad
-    copy_cut_border(top_blob_bordered, top_blob, 0, top_blob_bordered.h - top_blob.h, 0, top_blob_bordered.w - top_blob.w, opt);
+    if (top_blob_bordered.data != top_blob.data)
+    {
+        copy_cut_border(top_blob_bordered, top_blob, 0, top_blob_bordered.h - top_blob.h, 0, top_blob_bordered.w - top_blob.w, opt);
+    }
 }
 
+#if __AVX__
+static inline void transpose8_ps(__m256& _r0, __m256& _r1, __m256& _r2, __m256& _r3, __m256& _r4, __m256& _r5, __m256& _r6, __m256& _r7)
+{
+    __m256 _tmp0 = _mm256_unpacklo_ps(_r0, _r1);
+    __m256 _tmp1 = _mm256_unpackhi_ps(_r0, _r1);
+    __m256 _tmp2 = _mm256_unpacklo_ps(_r2, _r3);
+    __m256 _tmp3 = _mm256_unpackhi_ps(_r2, _r3);
+    __m256 _tmp4 = _mm256_unpacklo_ps(_r4, _r5);
+    __m256 _tmp5 = _mm256_unpackhi_ps(_r4, _r5);
+    __m256 _tmp6 = _mm256_unpacklo_ps(_r6, _r7);
+    __m256 _tmp7 = _mm256_unpackhi_ps(_r6, _r7);
+
+    __m256 _tmp8 = _mm256_shuffle_ps(_tmp0, _tmp2, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 _tmp9 = _mm256_shuffle_ps(_tmp0, _tmp2, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 _tmpa = _mm256_shuffle_ps(_tmp1, _tmp3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 _tmpb = _mm256_shuffle_ps(_tmp1, _tmp3, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 _tmpc = _mm256_shuffle_ps(_tmp4, _tmp6, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 _tmpd = _mm256_shuffle_ps(_tmp4, _tmp6, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 _tmpe = _mm256_shuffle_ps(_tmp5, _tmp7, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 _tmpf = _mm256_shuffle_ps(_tmp5, _tmp7, _MM_SHUFFLE(3, 2, 3, 2));
+
+    _r0 = _mm256_permute2f128_ps(_tmp8, _tmpc, _MM_SHUFFLE(0, 2, 0, 0));
+    _r1 = _mm256_permute2f128_ps(_tmp9, _tmpd, _MM_SHUFFLE(0, 2, 0, 0));
+    _r2 = _mm256_permute2f128_ps(_tmpa, _tmpe, _MM_SHUFFLE(0, 2, 0, 0));
+    _r3 = _mm256_permute2f128_ps(_tmpb, _tmpf, _MM_SHUFFLE(0, 2, 0, 0));
+    _r4 = _mm256_permute2f128_ps(_tmp8, _tmpc, _MM_SHUFFLE(0, 3, 0, 1));
+    _r5 = _mm256_permute2f128_ps(_tmp9, _tmpd, _MM_SHUFFLE(0, 3, 0, 1));
+    _r6 = _mm256_permute2f128_ps(_tmpa, _tmpe, _MM_SHUFFLE(0, 3, 0, 1));
+    _r7 = _mm256_permute2f128_ps(_tmpb, _tmpf, _MM_SHUFFLE(0, 3, 0, 1));
+}
+
+// BT d, one 8-lane vector per row
+static inline void winograd63_transform_input_avx(const __m256* _r, __m256* _t)
+{
+    const __m256 _v5_25 = _mm256_set1_ps(5.25f);
+    const __m256 _vm4_25 = _mm256_set1_ps(-4.25f);
+    const __m256 _vm1_25 = _mm256_set1_ps(-1.25f);
+    const __m256 _v0_25 = _mm256_set1_ps(0.25f);
+    const __m256 _vm2_5 = _mm256_set1_ps(-2.5f);
+    const __m256 _v0_5 = _mm256_set1_ps(0.5f);
+    const __m256 _v2 = _mm256_set1_ps(2.f);
+    const __m256 _v4 = _mm256_set1_ps(4.f);
+
+    // 0 = r00 - r06 + (r04 - r02) * 5.25
+    // 7 = r07 - r01 + (r03 - r05) * 5.25
+    _t[0] = _mm256_fmadd_ps(_mm256_sub_ps(_r[4], _r[2]), _v5_25, _mm256_sub_ps(_r[0], _r[6]));
+    _t[7] = _mm256_fmadd_ps(_mm256_sub_ps(_r[3], _r[5]), _v5_25, _mm256_sub_ps(_r[7], _r[1]));
+
+    // 1 = (r02 + r06 - r04 * 4.25) + (r01 - r03 * 4.25 + r05)
+    // 2 = (r02 + r06 - r04 * 4.25) - (r01 - r03 * 4.25 + r05)
+    __m256 _tmp12a = _mm256_fmadd_ps(_r[4], _vm4_25, _mm256_add_ps(_r[2], _r[6]));
+    __m256 _tmp12b = _mm256_fmadd_ps(_r[3], _vm4_25, _mm256_add_ps(_r[1], _r[5]));
+    _t[1] = _mm256_add_ps(_tmp12a, _tmp12b);
+    _t[2] = _mm256_sub_ps(_tmp12a, _tmp12b);
+
+    // 3 = (r06 + r02 * 0.25 - r04 * 1.25) + (r01 * 0.5 - r03 * 2.5 + r05 * 2)
+    // 4 = (r06 + r02 * 0.25 - r04 * 1.25) - (r01 * 0.5 - r03 * 2.5 + r05 * 2)
+    __m256 _tmp34a = _mm256_fmadd_ps(_r[4], _vm1_25, _mm256_fmadd_ps(_r[2], _v0_25, _r[6]));
+    __m256 _tmp34b = _mm256_fmadd_ps(_r[5], _v2, _mm256_fmadd_ps(_r[3], _vm2_5, _mm256_mul_ps(_r[1], _v0_5)));
+    _t[3] = _mm256_add_ps(_tmp34a, _tmp34b);
+    _t[4] = _mm256_sub_ps(_tmp34a, _tmp34b);
+
+    // 5 = (r06 + (r02 - r04 * 1.25) * 4) + (r01 * 2 - r03 * 2.5 + r05 * 0.5)
+    // 6 = (r06 + (r02 - r04 * 1.25) * 4) - (r01 * 2 - r03 * 2.5 + r05 * 0.5)
+    __m256 _tmp56a = _mm256_fmadd_ps(_mm256_fmadd_ps(_r[4], _vm1_25, _r[2]), _v4, _r[6]);
+    __m256 _tmp56b = _mm256_fmadd_ps(_r[5], _v0_5, _mm256_fmadd_ps(_r[3], _vm2_5, _mm256_mul_ps(_r[1], _v2)));
+    _t[5] = _mm256_add_ps(_tmp56a, _tmp56b);
+    _t[6] = _mm256_sub_ps(_tmp56a, _tmp56b);
+}
+
+// AT m, one 8-lane vector per row
+static inline void winograd63_transform_output_avx(const __m256* _r, __m256* _t)
+{
+    const __m256 _v2 = _mm256_set1_ps(2.f);
+    const __m256 _v4 = _mm256_set1_ps(4.f);
+    const __m256 _v8 = _mm256_set1_ps(8.f);
+    const __m256 _v16 = _mm256_set1_ps(16.f);
+    const __m256 _v32 = _mm256_set1_ps(32.f);
+
+    __m256 _tmp024a = _mm256_add_ps(_r[1], _r[2]);
+    __m256 _tmp135a = _mm256_sub_ps(_r[1], _r[2]);
+    __m256 _tmp024b = _mm256_add_ps(_r[3], _r[4]);
+    __m256 _tmp135b = _mm256_sub_ps(_r[3], _r[4]);
+    __m256 _tmp024c = _mm256_add_ps(_r[5], _r[6]);
+    __m256 _tmp135c = _mm256_sub_ps(_r[5], _r[6]);
+
+    // 0 = r0 + (r1 + r2) + (r3 + r4)     + (r5 + r6) * 32
+    // 2 =      (r1 + r2) + (r3 + r4) * 4 + (r5 + r6) * 8
+    // 4 =      (r1 + r2) + (r3 + r4) * 16+ (r5 + r6) * 2
+    _t[0] = _mm256_fmadd_ps(_tmp024c, _v32, _mm256_add_ps(_mm256_add_ps(_r[0], _tmp024a), _tmp024b));
+    _t[2] = _mm256_fmadd_ps(_tmp024c, _v8, _mm256_fmadd_ps(_tmp024b, _v4, _tmp024a));
+    _t[4] = _mm256_fmadd_ps(_tmp024c, _v2, _mm256_fmadd_ps(_tmp024b, _v16, _tmp024a));
+
+    // 1 =      (r1 - r2) + (r3 - r4) * 2 + (r5 - r6) * 16
+    // 3 =      (r1 - r2) + (r3 - r4) * 8 + (r5 - r6) * 4
+    // 5 = r7 + (r1 - r2) + (r3 - r4) * 32+ (r5 - r6)
+    _t[1] = _mm256_fmadd_ps(_tmp135c, _v16, _mm256_fmadd_ps(_tmp135b, _v2, _tmp135a));
+    _t[3] = _mm256_fmadd_ps(_tmp135c, _v4, _mm256_fmadd_ps(_tmp135b, _v8, _tmp135a));
+    _t[5] = _mm256_add_ps(_mm256_fmadd_ps(_tmp135b, _v32, _mm256_add_ps(_r[7], _tmp135a)), _tmp135c);
+}
+
+static void conv3x3s1_winograd63_transform_kernel_avx(const Mat& kernel, Mat& kernel_tm2, int inch, int outch)
+{
+    Mat kernel_tm(8*8, inch, outch);
+
+    // G
+    const float ktm[8][3] = {
+        {   1.0f,     0.0f,     0.0f},
+        {-2.0f/9,  -2.0f/9,  -2.0f/9},
+        {-2.0f/9,   2.0f/9,  -2.0f/9},
+        {1.0f/90,  1.0f/45,  2.0f/45},
+        {1.0f/90, -1.0f/45,  2.0f/45},
+        {1.0f/45,  1.0f/90, 1.0f/180},
+        {1.0f/45, -1.0f/90, 1.0f/180},
+        {   0.0f,     0.0f,     1.0f}
+    };
+
+    #pragma omp parallel for
+    for (int p = 0; p<outch; p++)
+    {
+        for (int q = 0; q<inch; q++)
+        {
+            const float* kernel0 = (const float*)kernel + p*inch * 9 + q * 9;
+            float* kernel_tm0 = kernel_tm.channel(p).row(q);
+
+            // transform kernel
+            const float* k0 = kernel0;
+            const float* k1 = kernel0 + 3;
+            const float* k2 = kernel0 + 6;
+
+            // h
+            float tmp[8][3];
+            for (int i=0; i<8; i++)
+            {
+                tmp[i][0] = k0[0] * ktm[i][0] + k0[1] * ktm[i][1] + k0[2] * ktm[i][2];
+                tmp[i][1] = k1[0] * ktm[i][0] + k1[1] * ktm[i][1] + k1[2] * ktm[i][2];
+                tmp[i][2] = k2[0] * ktm[i][0] + k2[1] * ktm[i][1] + k2[2] * ktm[i][2];
+            }
+
+            // U
+            for (int j=0; j<8; j++)
+            {
+                float* tmpp = &tmp[j][0];
+
+                for (int i=0; i<8; i++)
+                {
+                    kernel_tm0[j*8 + i] = tmpp[0] * ktm[i][0] + tmpp[1] * ktm[i][1] + tmpp[2] * ktm[i][2];
+                }
+            }
+        }
+    }
+
+    // interleave 8 output channels for each of the 64 tile elements
+    // kernel_tm2 = 8-outch-inch-64-outch/8
+    kernel_tm2.create(8 * inch, 64, outch/8 + outch%8);
+
+    int p = 0;
+    for (; p+7<outch; p+=8)
+    {
+        Mat g0 = kernel_tm2.channel(p/8);
+
+        for (int k=0; k<64; k++)
+        {
+            float* g00 = g0.row(k);
+
+            for (int q=0; q<inch; q++)
+            {
+                for (int i=0; i<8; i++)
+                {
+                    g00[0] = kernel_tm.channel(p + i).row(q)[k];
+                    g00++;
+                }
+            }
+        }
+    }
+    for (; p<outch; p++)
+    {
+        Mat g0 = kernel_tm2.channel(p/8 + p%8);
+
+        for (int k=0; k<64; k++)
+        {
+            float* g00 = g0.row(k);
+
+            for (int q=0; q<inch; q++)
+            {
+                g00[q] = kernel_tm.channel(p).row(q)[k];
+            }
+        }
+    }
+}
+
+static void conv3x3s1_winograd63_avx(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, const Mat& _bias, const Option& opt)
+{
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int inch = bottom_blob.c;
+
+    int outw = top_blob.w;
+    int outh = top_blob.h;
+    int outch = top_blob.c;
+
+    // pad to 6n+2, winograd F(6,3)
+    Mat bottom_blob_bordered = bottom_blob;
+
+    outw = (outw + 5) / 6 * 6;
+    outh = (outh + 5) / 6 * 6;
+
+    w = outw + 2;
+    h = outh + 2;
+    Option opt_b = opt;
+    opt_b.blob_allocator = opt.workspace_allocator;
+    copy_make_border(bottom_blob, bottom_blob_bordered, 0, h - bottom_blob.h, 0, w - bottom_blob.w, 0, 0.f, opt_b);
+
+    const float* bias = _bias;
+
+    const int nColBlocks = outh / 6;
+    const int nRowBlocks = outw / 6;
+    const int tiles = nColBlocks * nRowBlocks;
+
+    // BEGIN transform input
+    Mat bottom_blob_tm;
+    {
+        bottom_blob_tm.create(tiles, 64, inch, 4u, opt.workspace_allocator);
+
+        // BT
+        // const float itm[8][8] = {
+        //     {1.0f,  0.0f, -5.25f,  0.00f,  5.25f,  0.00f, -1.0f, 0.0f},
+        //     {0.0f,  1.0f,  1.00f, -4.25f, -4.25f,  1.00f,  1.0f, 0.0f},
+        //     {0.0f, -1.0f,  1.00f,  4.25f, -4.25f, -1.00f,  1.0f, 0.0f},
+        //     {0.0f,  0.5f,  0.25f, -2.50f, -1.25f,  2.00f,  1.0f, 0.0f},
+        //     {0.0f, -0.5f,  0.25f,  2.50f, -1.25f, -2.00f,  1.0f, 0.0f},
+        //     {0.0f,  2.0f,  4.00f, -2.50f, -5.00f,  0.50f,  1.0f, 0.0f},
+        //     {0.0f, -2.0f,  4.00f,  2.50f, -5.00f, -0.50f,  1.0f, 0.0f},
+        //     {0.0f, -1.0f,  0.00f,  5.25f,  0.00f, -5.25f,  0.0f, 1.0f}
+        // };
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<inch; q++)
+        {
+            const Mat img = bottom_blob_bordered.channel(q);
+            Mat img_tm = bottom_blob_tm.channel(q);
+
+            float tmp[8][8];
+
+            for (int i = 0; i < nColBlocks; i++)
+            {
+                for (int j = 0; j < nRowBlocks; j++)
+                {
+                    const float* r0 = img.row(i * 6) + j * 6;
+
+                    __m256 _r[8];
+                    __m256 _t[8];
+                    for (int m = 0; m < 8; m++)
+                    {
+                        _r[m] = _mm256_loadu_ps(r0 + w * m);
+                    }
+
+                    // rows
+                    winograd63_transform_input_avx(_r, _t);
+
+                    transpose8_ps(_t[0], _t[1], _t[2], _t[3], _t[4], _t[5], _t[6], _t[7]);
+
+                    // columns
+                    winograd63_transform_input_avx(_t, _r);
+
+                    for (int m = 0; m < 8; m++)
+                    {
+                        _mm256_storeu_ps(tmp[m], _r[m]);
+                    }
+
+                    // scatter the 64 tile elements into their planes
+                    const int tile = i * nRowBlocks + j;
+                    for (int m = 0; m < 8; m++)
+                    {
+                        for (int n = 0; n < 8; n++)
+                        {
+                            img_tm.row(m * 8 + n)[tile] = tmp[m][n];
+                        }
+                    }
+                }
+            }
+        }
+    }
+    bottom_blob_bordered = Mat();
+    // END transform input
+
+    // BEGIN dot
+    Mat top_blob_tm;
+    {
+        // reorder tiles in blocks of 8 so the dot loop streams one vector per input channel
+        // bottom_blob_tm2 = 8-tile-inch-tiles/8-64
+        Mat bottom_blob_tm2;
+        bottom_blob_tm2.create(8 * inch, tiles/8 + tiles%8, 64, 4u, opt.workspace_allocator);
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int r=0; r<64; r++)
+        {
+            Mat tm2 = bottom_blob_tm2.channel(r);
+
+            int i = 0;
+            for (; i+7<tiles; i+=8)
+            {
+                float* tm2p = tm2.row(i/8);
+
+                for (int q=0; q<inch; q++)
+                {
+                    const float* r0 = bottom_blob_tm.channel(q).row(r) + i;
+
+                    _mm256_storeu_ps(tm2p, _mm256_loadu_ps(r0));
+
+                    tm2p += 8;
+                }
+            }
+            for (; i<tiles; i++)
+            {
+                float* tm2p = tm2.row(i/8 + i%8);
+
+                for (int q=0; q<inch; q++)
+                {
+                    tm2p[q] = bottom_blob_tm.channel(q).row(r)[i];
+                }
+            }
+        }
+
+        bottom_blob_tm = Mat();
+
+        top_blob_tm.create(tiles, 64, outch, 4u, opt.workspace_allocator);
+
+        int nn_outch = outch >> 3;
+        int remain_outch_start = nn_outch << 3;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int pp=0; pp<nn_outch; pp++)
+        {
+            int p = pp * 8;
+
+            const Mat kernel0_tm = kernel_tm.channel(pp);
+
+            for (int r=0; r<64; r++)
+            {
+                const Mat bb2 = bottom_blob_tm2.channel(r);
+
+                float* output0_tm = top_blob_tm.channel(p).row(r);
+                float* output1_tm = top_blob_tm.channel(p+1).row(r);
+                float* output2_tm = top_blob_tm.channel(p+2).row(r);
+                float* output3_tm = top_blob_tm.channel(p+3).row(r);
+                float* output4_tm = top_blob_tm.channel(p+4).row(r);
+                float* output5_tm = top_blob_tm.channel(p+5).row(r);
+                float* output6_tm = top_blob_tm.channel(p+6).row(r);
+                float* output7_tm = top_blob_tm.channel(p+7).row(r);
+
+                int i = 0;
+                for (; i+7<tiles; i+=8)
+                {
+                    const float* r0 = bb2.row(i/8);
+                    const float* k0 = kernel0_tm.row(r);
+
+                    __m256 _sum0 = _mm256_setzero_ps();
+                    __m256 _sum1 = _mm256_setzero_ps();
+                    __m256 _sum2 = _mm256_setzero_ps();
+                    __m256 _sum3 = _mm256_setzero_ps();
+                    __m256 _sum4 = _mm256_setzero_ps();
+                    __m256 _sum5 = _mm256_setzero_ps();
+                    __m256 _sum6 = _mm256_setzero_ps();
+                    __m256 _sum7 = _mm256_setzero_ps();
+
+                    for (int q=0; q<inch; q++)
+                    {
+                        __m256 _r0 = _mm256_loadu_ps(r0);
+
+                        _sum0 = _mm256_fmadd_ps(_r0, _mm256_broadcast_ss(k0), _sum0);
+                        _sum1 = _mm256_fmadd_ps(_r0, _mm256_broadcast_ss(k0 + 1), _sum1);
+                        _sum2 = _mm256_fmadd_ps(_r0, _mm256_broadcast_ss(k0 + 2), _sum2);
+                        _sum3 = _mm256_fmadd_ps(_r0, _mm256_broadcast_ss(k0 + 3), _sum3);
+                        _sum4 = _mm256_fmadd_ps(_r0, _mm256_broadcast_ss(k0 + 4), _sum4);
+                        _sum5 = _mm256_fmadd_ps(_r0, _mm256_broadcast_ss(k0 + 5), _sum5);
+                        _sum6 = _mm256_fmadd_ps(_r0, _mm256_broadcast_ss(k0 + 6), _sum6);
+                        _sum7 = _mm256_fmadd_ps(_r0, _mm256_broadcast_ss(k0 + 7), _sum7);
+
+                        r0 += 8;
+                        k0 += 8;
+                    }
+
+                    _mm256_storeu_ps(output0_tm + i, _sum0);
+                    _mm256_storeu_ps(output1_tm + i, _sum1);
+                    _mm256_storeu_ps(output2_tm + i, _sum2);
+                    _mm256_storeu_ps(output3_tm + i, _sum3);
+                    _mm256_storeu_ps(output4_tm + i, _sum4);
+                    _mm256_storeu_ps(output5_tm + i, _sum5);
+                    _mm256_storeu_ps(output6_tm + i, _sum6);
+                    _mm256_storeu_ps(output7_tm + i, _sum7);
+                }
+                for (; i<tiles; i++)
+                {
+                    const float* r0 = bb2.row(i/8 + i%8);
+                    const float* k0 = kernel0_tm.row(r);
+
+                    __m256 _sum = _mm256_setzero_ps();
+
+                    for (int q=0; q<inch; q++)
+                    {
+                        _sum = _mm256_fmadd_ps(_mm256_broadcast_ss(r0), _mm256_loadu_ps(k0), _sum);
+
+                        r0 += 1;
+                        k0 += 8;
+                    }
+
+                    float sum[8];
+                    _mm256_storeu_ps(sum, _sum);
+
+                    output0_tm[i] = sum[0];
+                    output1_tm[i] = sum[1];
+                    output2_tm[i] = sum[2];
+                    output3_tm[i] = sum[3];
+                    output4_tm[i] = sum[4];
+                    output5_tm[i] = sum[5];
+                    output6_tm[i] = sum[6];
+                    output7_tm[i] = sum[7];
+                }
+            }
+        }
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int p=remain_outch_start; p<outch; p++)
+        {
+            const Mat kernel0_tm = kernel_tm.channel(p/8 + p%8);
+
+            for (int r=0; r<64; r++)
+            {
+                const Mat bb2 = bottom_blob_tm2.channel(r);
+
+                float* output0_tm = top_blob_tm.channel(p).row(r);
+
+                int i = 0;
+                for (; i+7<tiles; i+=8)
+                {
+                    const float* r0 = bb2.row(i/8);
+                    const float* k0 = kernel0_tm.row(r);
+
+                    __m256 _sum0 = _mm256_setzero_ps();
+
+                    for (int q=0; q<inch; q++)
+                    {
+                        _sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(r0), _mm256_broadcast_ss(k0), _sum0);
+
+                        r0 += 8;
+                        k0 += 1;
+                    }
+
+                    _mm256_storeu_ps(output0_tm + i, _sum0);
+                }
+                for (; i<tiles; i++)
+                {
+                    const float* r0 = bb2.row(i/8 + i%8);
+                    const float* k0 = kernel0_tm.row(r);
+
+                    float sum0 = 0.f;
+
+                    for (int q=0; q<inch; q++)
+                    {
+                        sum0 += r0[q] * k0[q];
+                    }
+
+                    output0_tm[i] = sum0;
+                }
+            }
+        }
+    }
+    // END dot
+
+    // BEGIN transform output
+    Mat top_blob_bordered;
+    if (outw == top_blob.w && outh == top_blob.h)
+    {
+        top_blob_bordered = top_blob;
+    }
+    else
+    {
+        top_blob_bordered.create(outw, outh, outch, 4u, opt.workspace_allocator);
+    }
+    {
+        // AT
+        // const float otm[6][8] = {
+        //     {1.0f,  1.0f,   1.0f,   1.0f,   1.0f,  32.0f, 32.0f, 0.0f},
+        //     {0.0f,  1.0f,  -1.0f,   2.0f,  -2.0f,  16.0f,-16.0f, 0.0f},
+        //     {0.0f,  1.0f,   1.0f,   4.0f,   4.0f,   8.0f,  8.0f, 0.0f},
+        //     {0.0f,  1.0f,  -1.0f,   8.0f,  -8.0f,   4.0f, -4.0f, 0.0f},
+        //     {0.0f,  1.0f,   1.0f,  16.0f,  16.0f,   2.0f,  2.0f, 0.0f},
+        //     {0.0f,  1.0f,  -1.0f,  32.0f, -32.0f,   1.0f, -1.0f, 1.0f}
+        // };
+        const __m256i _mask6 = _mm256_setr_epi32(-1, -1, -1, -1, -1, -1, 0, 0);
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int p=0; p<outch; p++)
+        {
+            const Mat out_tm = top_blob_tm.channel(p);
+            Mat out = top_blob_bordered.channel(p);
+
+            const __m256 _bias0 = _mm256_set1_ps(bias ? bias[p] : 0.f);
+
+            float tmp[8][8];
+
+            for (int i=0; i<nColBlocks; i++)
+            {
+                for (int j=0; j<nRowBlocks; j++)
+                {
+                    // gather the 64 tile elements
+                    const int tile = i * nRowBlocks + j;
+                    for (int m = 0; m < 8; m++)
+                    {
+                        for (int n = 0; n < 8; n++)
+                        {
+                            tmp[m][n] = out_tm.row(m * 8 + n)[tile];
+                        }
+                    }
+
+                    __m256 _r[8];
+                    __m256 _t[8];
+                    for (int m = 0; m < 8; m++)
+                    {
+                        _r[m] = _mm256_loadu_ps(tmp[m]);
+                    }
+
+                    winograd63_transform_output_avx(_r, _t);
+
+                    _t[6] = _mm256_setzero_ps();
+                    _t[7] = _mm256_setzero_ps();
+                    transpose8_ps(_t[0], _t[1], _t[2], _t[3], _t[4], _t[5], _t[6], _t[7]);
+
+                    winograd63_transform_output_avx(_t, _r);
+
+                    float* outptr = out.row(i * 6) + j * 6;
+                    for (int m = 0; m < 6; m++)
+                    {
+                        _mm256_maskstore_ps(outptr + outw * m, _mask6, _mm256_add_ps(_r[m], _bias0));
+                    }
+                }
+            }
+        }
+    }
+    // END transform output
+
+    // cut result pad
+    if (top_blob_bordered.data != top_blob.data)
+    {
+        copy_cut_border(top_blob_bordered, top_blob, 0, top_blob_bordered.h - top_blob.h, 0, top_blob_bordered.w - top_blob.w, opt);
+    }
+}
+#endif // __AVX__
+
 static void conv3x3s2_sse(const Mat &bottom_blob, Mat &top_blob, const Mat &_kernel, const Mat& _bias, const Option& opt)
 {
     int w = bottom_blob.w;
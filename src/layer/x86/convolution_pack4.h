@@ -0,0 +1,394 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+static inline float reduce_add_ps(__m128 x)
+{
+    x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+    x = _mm_add_ss(x, _mm_shuffle_ps(x, x, 1));
+    return _mm_cvtss_f32(x);
+}
+
+// packed input, packed output
+// weight_data_packed = 4-inch-4-outch-maxk-inch/4-outch/4
+static void convolution_pack4_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& weight_data_packed, const Mat& bias_data, int kernel_w, int kernel_h, int dilation_w, int dilation_h, int stride_w, int stride_h, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    int w = bottom_blob.w;
+    int channels = bottom_blob.c;
+
+    int outw = top_blob.w;
+    int outh = top_blob.h;
+    int outch = top_blob.c;
+
+    const int maxk = kernel_w * kernel_h;
+
+    // kernel offsets
+    std::vector<int> _space_ofs(maxk);
+    int* space_ofs = &_space_ofs[0];
+    {
+        int p1 = 0;
+        int p2 = 0;
+        int gap = w * dilation_h - kernel_w * dilation_w;
+        for (int i = 0; i < kernel_h; i++)
+        {
+            for (int j = 0; j < kernel_w; j++)
+            {
+                space_ofs[p1] = p2;
+                p1++;
+                p2 += dilation_w;
+            }
+            p2 += gap;
+        }
+    }
+
+    const float* bias_data_ptr = bias_data;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p=0; p<outch; p++)
+    {
+        float* outptr = top_blob.channel(p);
+
+        const __m128 _bias = bias_data_ptr ? _mm_loadu_ps(bias_data_ptr + p * 4) : _mm_setzero_ps();
+
+        for (int i = 0; i < outh; i++)
+        {
+            int j = 0;
+            for (; j+7<outw; j+=8)
+            {
+                __m128 _sum0 = _bias;
+                __m128 _sum1 = _bias;
+                __m128 _sum2 = _bias;
+                __m128 _sum3 = _bias;
+                __m128 _sum4 = _bias;
+                __m128 _sum5 = _bias;
+                __m128 _sum6 = _bias;
+                __m128 _sum7 = _bias;
+
+                const float* kptr = weight_data_packed.channel(p);
+
+                for (int q=0; q<channels; q++)
+                {
+                    const Mat m = bottom_blob.channel(q);
+                    const float* sptr = m.row(i*stride_h) + j*stride_w * 4;
+
+                    for (int k = 0; k < maxk; k++)
+                    {
+                        const float* r0 = sptr + space_ofs[k] * 4;
+
+                        for (int l = 0; l < 4; l++)
+                        {
+                            __m128 _w = _mm_loadu_ps(kptr + l * 4);
+                            _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_mm_load1_ps(r0 + l), _w));
+                            _sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_mm_load1_ps(r0 + stride_w * 4 + l), _w));
+                            _sum2 = _mm_add_ps(_sum2, _mm_mul_ps(_mm_load1_ps(r0 + stride_w * 8 + l), _w));
+                            _sum3 = _mm_add_ps(_sum3, _mm_mul_ps(_mm_load1_ps(r0 + stride_w * 12 + l), _w));
+                            _sum4 = _mm_add_ps(_sum4, _mm_mul_ps(_mm_load1_ps(r0 + stride_w * 16 + l), _w));
+                            _sum5 = _mm_add_ps(_sum5, _mm_mul_ps(_mm_load1_ps(r0 + stride_w * 20 + l), _w));
+                            _sum6 = _mm_add_ps(_sum6, _mm_mul_ps(_mm_load1_ps(r0 + stride_w * 24 + l), _w));
+                            _sum7 = _mm_add_ps(_sum7, _mm_mul_ps(_mm_load1_ps(r0 + stride_w * 28 + l), _w));
+                        }
+
+                        kptr += 16;
+                    }
+                }
+
+                _mm_storeu_ps(outptr, activation_sse(_sum0, activation_type, activation_params));
+                _mm_storeu_ps(outptr + 4, activation_sse(_sum1, activation_type, activation_params));
+                _mm_storeu_ps(outptr + 8, activation_sse(_sum2, activation_type, activation_params));
+                _mm_storeu_ps(outptr + 12, activation_sse(_sum3, activation_type, activation_params));
+                _mm_storeu_ps(outptr + 16, activation_sse(_sum4, activation_type, activation_params));
+                _mm_storeu_ps(outptr + 20, activation_sse(_sum5, activation_type, activation_params));
+                _mm_storeu_ps(outptr + 24, activation_sse(_sum6, activation_type, activation_params));
+                _mm_storeu_ps(outptr + 28, activation_sse(_sum7, activation_type, activation_params));
+
+                outptr += 32;
+            }
+            for (; j+3<outw; j+=4)
+            {
+                __m128 _sum0 = _bias;
+                __m128 _sum1 = _bias;
+                __m128 _sum2 = _bias;
+                __m128 _sum3 = _bias;
+
+                const float* kptr = weight_data_packed.channel(p);
+
+                for (int q=0; q<channels; q++)
+                {
+                    const Mat m = bottom_blob.channel(q);
+                    const float* sptr = m.row(i*stride_h) + j*stride_w * 4;
+
+                    for (int k = 0; k < maxk; k++)
+                    {
+                        const float* r0 = sptr + space_ofs[k] * 4;
+
+                        for (int l = 0; l < 4; l++)
+                        {
+                            __m128 _w = _mm_loadu_ps(kptr + l * 4);
+                            _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_mm_load1_ps(r0 + l), _w));
+                            _sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_mm_load1_ps(r0 + stride_w * 4 + l), _w));
+                            _sum2 = _mm_add_ps(_sum2, _mm_mul_ps(_mm_load1_ps(r0 + stride_w * 8 + l), _w));
+                            _sum3 = _mm_add_ps(_sum3, _mm_mul_ps(_mm_load1_ps(r0 + stride_w * 12 + l), _w));
+                        }
+
+                        kptr += 16;
+                    }
+                }
+
+                _mm_storeu_ps(outptr, activation_sse(_sum0, activation_type, activation_params));
+                _mm_storeu_ps(outptr + 4, activation_sse(_sum1, activation_type, activation_params));
+                _mm_storeu_ps(outptr + 8, activation_sse(_sum2, activation_type, activation_params));
+                _mm_storeu_ps(outptr + 12, activation_sse(_sum3, activation_type, activation_params));
+
+                outptr += 16;
+            }
+            for (; j<outw; j++)
+            {
+                __m128 _sum = _bias;
+
+                const float* kptr = weight_data_packed.channel(p);
+
+                for (int q=0; q<channels; q++)
+                {
+                    const Mat m = bottom_blob.channel(q);
+                    const float* sptr = m.row(i*stride_h) + j*stride_w * 4;
+
+                    for (int k = 0; k < maxk; k++)
+                    {
+                        const float* r0 = sptr + space_ofs[k] * 4;
+
+                        for (int l = 0; l < 4; l++)
+                        {
+                            _sum = _mm_add_ps(_sum, _mm_mul_ps(_mm_load1_ps(r0 + l), _mm_loadu_ps(kptr + l * 4)));
+                        }
+
+                        kptr += 16;
+                    }
+                }
+
+                _mm_storeu_ps(outptr, activation_sse(_sum, activation_type, activation_params));
+
+                outptr += 4;
+            }
+        }
+    }
+}
+
+// plain input, packed output
+// weight_data_packed = 4-outch-maxk-inch-outch/4
+static void convolution_pack1to4_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& weight_data_packed, const Mat& bias_data, int kernel_w, int kernel_h, int dilation_w, int dilation_h, int stride_w, int stride_h, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    int w = bottom_blob.w;
+    int channels = bottom_blob.c;
+
+    int outw = top_blob.w;
+    int outh = top_blob.h;
+    int outch = top_blob.c;
+
+    const int maxk = kernel_w * kernel_h;
+
+    // kernel offsets
+    std::vector<int> _space_ofs(maxk);
+    int* space_ofs = &_space_ofs[0];
+    {
+        int p1 = 0;
+        int p2 = 0;
+        int gap = w * dilation_h - kernel_w * dilation_w;
+        for (int i = 0; i < kernel_h; i++)
+        {
+            for (int j = 0; j < kernel_w; j++)
+            {
+                space_ofs[p1] = p2;
+                p1++;
+                p2 += dilation_w;
+            }
+            p2 += gap;
+        }
+    }
+
+    const float* bias_data_ptr = bias_data;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p=0; p<outch; p++)
+    {
+        float* outptr = top_blob.channel(p);
+
+        const __m128 _bias = bias_data_ptr ? _mm_loadu_ps(bias_data_ptr + p * 4) : _mm_setzero_ps();
+
+        for (int i = 0; i < outh; i++)
+        {
+            int j = 0;
+            for (; j+3<outw; j+=4)
+            {
+                __m128 _sum0 = _bias;
+                __m128 _sum1 = _bias;
+                __m128 _sum2 = _bias;
+                __m128 _sum3 = _bias;
+
+                const float* kptr = weight_data_packed.channel(p);
+
+                for (int q=0; q<channels; q++)
+                {
+                    const Mat m = bottom_blob.channel(q);
+                    const float* sptr = m.row(i*stride_h) + j*stride_w;
+
+                    for (int k = 0; k < maxk; k++)
+                    {
+                        const float* r0 = sptr + space_ofs[k];
+
+                        __m128 _w = _mm_loadu_ps(kptr);
+                        _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_mm_load1_ps(r0), _w));
+                        _sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_mm_load1_ps(r0 + stride_w), _w));
+                        _sum2 = _mm_add_ps(_sum2, _mm_mul_ps(_mm_load1_ps(r0 + stride_w * 2), _w));
+                        _sum3 = _mm_add_ps(_sum3, _mm_mul_ps(_mm_load1_ps(r0 + stride_w * 3), _w));
+
+                        kptr += 4;
+                    }
+                }
+
+                _mm_storeu_ps(outptr, activation_sse(_sum0, activation_type, activation_params));
+                _mm_storeu_ps(outptr + 4, activation_sse(_sum1, activation_type, activation_params));
+                _mm_storeu_ps(outptr + 8, activation_sse(_sum2, activation_type, activation_params));
+                _mm_storeu_ps(outptr + 12, activation_sse(_sum3, activation_type, activation_params));
+
+                outptr += 16;
+            }
+            for (; j<outw; j++)
+            {
+                __m128 _sum = _bias;
+
+                const float* kptr = weight_data_packed.channel(p);
+
+                for (int q=0; q<channels; q++)
+                {
+                    const Mat m = bottom_blob.channel(q);
+                    const float* sptr = m.row(i*stride_h) + j*stride_w;
+
+                    for (int k = 0; k < maxk; k++)
+                    {
+                        _sum = _mm_add_ps(_sum, _mm_mul_ps(_mm_load1_ps(sptr + space_ofs[k]), _mm_loadu_ps(kptr)));
+
+                        kptr += 4;
+                    }
+                }
+
+                _mm_storeu_ps(outptr, activation_sse(_sum, activation_type, activation_params));
+
+                outptr += 4;
+            }
+        }
+    }
+}
+
+// packed input, plain output
+// weight_data_packed = 4-inch-maxk-inch/4-outch
+static void convolution_pack4to1_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& weight_data_packed, const Mat& bias_data, int kernel_w, int kernel_h, int dilation_w, int dilation_h, int stride_w, int stride_h, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    int w = bottom_blob.w;
+    int channels = bottom_blob.c;
+
+    int outw = top_blob.w;
+    int outh = top_blob.h;
+    int outch = top_blob.c;
+
+    const int maxk = kernel_w * kernel_h;
+
+    // kernel offsets
+    std::vector<int> _space_ofs(maxk);
+    int* space_ofs = &_space_ofs[0];
+    {
+        int p1 = 0;
+        int p2 = 0;
+        int gap = w * dilation_h - kernel_w * dilation_w;
+        for (int i = 0; i < kernel_h; i++)
+        {
+            for (int j = 0; j < kernel_w; j++)
+            {
+                space_ofs[p1] = p2;
+                p1++;
+                p2 += dilation_w;
+            }
+            p2 += gap;
+        }
+    }
+
+    const float* bias_data_ptr = bias_data;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p=0; p<outch; p++)
+    {
+        float* outptr = top_blob.channel(p);
+
+        const float bias0 = bias_data_ptr ? bias_data_ptr[p] : 0.f;
+
+        for (int i = 0; i < outh; i++)
+        {
+            int j = 0;
+            for (; j+3<outw; j+=4)
+            {
+                __m128 _sum0 = _mm_setzero_ps();
+                __m128 _sum1 = _mm_setzero_ps();
+                __m128 _sum2 = _mm_setzero_ps();
+                __m128 _sum3 = _mm_setzero_ps();
+
+                const float* kptr = weight_data_packed.channel(p);
+
+                for (int q=0; q<channels; q++)
+                {
+                    const Mat m = bottom_blob.channel(q);
+                    const float* sptr = m.row(i*stride_h) + j*stride_w * 4;
+
+                    for (int k = 0; k < maxk; k++)
+                    {
+                        const float* r0 = sptr + space_ofs[k] * 4;
+
+                        __m128 _w = _mm_loadu_ps(kptr);
+                        _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_mm_loadu_ps(r0), _w));
+                        _sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_mm_loadu_ps(r0 + stride_w * 4), _w));
+                        _sum2 = _mm_add_ps(_sum2, _mm_mul_ps(_mm_loadu_ps(r0 + stride_w * 8), _w));
+                        _sum3 = _mm_add_ps(_sum3, _mm_mul_ps(_mm_loadu_ps(r0 + stride_w * 12), _w));
+
+                        kptr += 4;
+                    }
+                }
+
+                outptr[j] = activation_ss(bias0 + reduce_add_ps(_sum0), activation_type, activation_params);
+                outptr[j + 1] = activation_ss(bias0 + reduce_add_ps(_sum1), activation_type, activation_params);
+                outptr[j + 2] = activation_ss(bias0 + reduce_add_ps(_sum2), activation_type, activation_params);
+                outptr[j + 3] = activation_ss(bias0 + reduce_add_ps(_sum3), activation_type, activation_params);
+            }
+            for (; j<outw; j++)
+            {
+                __m128 _sum = _mm_setzero_ps();
+
+                const float* kptr = weight_data_packed.channel(p);
+
+                for (int q=0; q<channels; q++)
+                {
+                    const Mat m = bottom_blob.channel(q);
+                    const float* sptr = m.row(i*stride_h) + j*stride_w * 4;
+
+                    for (int k = 0; k < maxk; k++)
+                    {
+                        _sum = _mm_add_ps(_sum, _mm_mul_ps(_mm_loadu_ps(sptr + space_ofs[k] * 4), _mm_loadu_ps(kptr)));
+
+                        kptr += 4;
+                    }
+                }
+
+                outptr[j] = activation_ss(bias0 + reduce_add_ps(_sum), activation_type, activation_params);
+            }
+
+            outptr += outw;
+        }
+    }
+}
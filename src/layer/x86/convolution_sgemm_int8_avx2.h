@@ -0,0 +1,394 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// int8 im2col gemm, 8 outch x 8 pixels per tile, 4 consecutive k per int32 lane
+//
+// avx2 multiplies with maddubs, the unsigned operand is |w| and the signed one
+// is x with the sign of w applied, so every int16 pair sum stays below 2*128*127
+// and nothing saturates
+//
+// avx512 vnni accumulates u8 x s8 straight into int32 with dpbusd, the input is
+// shifted to unsigned by +128 and 128*sum(w) is subtracted afterwards
+
+#if NCNN_RUNTIME_CPU_AVX512VNNI && __AVX512F__
+#define NCNN_X86_INT8_VNNI 1
+#else
+#define NCNN_X86_INT8_VNNI 0
+#endif
+
+static void conv_im2col_sgemm_transform_kernel_int8_avx2(const Mat& _kernel, Mat& kernel_tm, int inch, int outch, int kernel_size)
+{
+    const signed char* kernel = _kernel;
+
+    const int K = inch * kernel_size;
+    const int nn_k = (K + 3) / 4;
+
+    // kernel memory packed 8 outch x 4 k, zero padded
+    kernel_tm.create(32*nn_k, (outch + 7) / 8, (size_t)1u);
+
+    for (int pp=0; pp<kernel_tm.h; pp++)
+    {
+        signed char* ktmp = kernel_tm.row<signed char>(pp);
+
+        for (int kk=0; kk<nn_k; kk++)
+        {
+            for (int i=0; i<8; i++)
+            {
+                const int p = pp * 8 + i;
+
+                for (int t=0; t<4; t++)
+                {
+                    const int k = kk * 4 + t;
+
+                    ktmp[t] = (p < outch && k < K) ? kernel[p * K + k] : 0;
+                }
+
+                ktmp += 4;
+            }
+        }
+    }
+}
+
+// bottom memory packed 8 pixels x 4 k, zero padded
+static void conv_im2col_sgemm_int8_pack_bottom_avx2(const Mat& bottom_blob, Mat& bottom_tm, int outw, int outh, int kernel_w, int kernel_h, int dilation_w, int dilation_h, int stride_w, int stride_h, bool shift_u8, const Option& opt)
+{
+    int w = bottom_blob.w;
+    int inch = bottom_blob.c;
+
+    const int maxk = kernel_w * kernel_h;
+    const int K = inch * maxk;
+    const int nn_k = (K + 3) / 4;
+    const int size = outw * outh;
+
+    bottom_tm.create(32*nn_k, (size + 7) / 8, (size_t)1u, opt.workspace_allocator);
+    if (bottom_tm.empty())
+        return;
+
+    // kernel offsets
+    std::vector<int> _space_ofs(maxk);
+    int* space_ofs = &_space_ofs[0];
+    {
+        int p1 = 0;
+        int p2 = 0;
+        int gap = w * dilation_h - kernel_w * dilation_w;
+        for (int i = 0; i < kernel_h; i++)
+        {
+            for (int j = 0; j < kernel_w; j++)
+            {
+                space_ofs[p1] = p2;
+                p1++;
+                p2 += dilation_w;
+            }
+            p2 += gap;
+        }
+    }
+
+    const unsigned char xor_mask = shift_u8 ? 0x80 : 0;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int jj=0; jj<bottom_tm.h; jj++)
+    {
+        unsigned char* tmpptr = bottom_tm.row<unsigned char>(jj);
+
+        int offset[8];
+        int n = std::min(8, size - jj * 8);
+        for (int c=0; c<n; c++)
+        {
+            int i = (jj * 8 + c) / outw;
+            int j = (jj * 8 + c) % outw;
+
+            offset[c] = i * stride_h * w + j * stride_w;
+        }
+
+        memset(tmpptr, xor_mask, 32*nn_k);
+
+        int k = 0;
+        for (int q=0; q<inch; q++)
+        {
+            const unsigned char* img = bottom_blob.channel(q);
+
+            for (int u=0; u<maxk; u++)
+            {
+                unsigned char* outptr = tmpptr + (k / 4) * 32 + k % 4;
+
+                for (int c=0; c<n; c++)
+                {
+                    outptr[c * 4] = img[offset[c] + space_ofs[u]] ^ xor_mask;
+                }
+
+                k++;
+            }
+        }
+    }
+}
+
+// sums[c] holds the 8 outch of pixel c
+static void conv_im2col_sgemm_int8_kernel_avx2(const signed char* va, const unsigned char* vb, int nn_k, __m256i* sums)
+{
+    __m256i _sum0 = _mm256_setzero_si256();
+    __m256i _sum1 = _mm256_setzero_si256();
+    __m256i _sum2 = _mm256_setzero_si256();
+    __m256i _sum3 = _mm256_setzero_si256();
+    __m256i _sum4 = _mm256_setzero_si256();
+    __m256i _sum5 = _mm256_setzero_si256();
+    __m256i _sum6 = _mm256_setzero_si256();
+    __m256i _sum7 = _mm256_setzero_si256();
+
+    const __m256i _one = _mm256_set1_epi16(1);
+
+    for (int kk=0; kk<nn_k; kk++)
+    {
+        __m256i _w = _mm256_loadu_si256((const __m256i*)va);
+        __m256i _wabs = _mm256_abs_epi8(_w);
+
+        const int* vb32 = (const int*)vb;
+
+        __m256i _x0 = _mm256_sign_epi8(_mm256_set1_epi32(vb32[0]), _w);
+        __m256i _x1 = _mm256_sign_epi8(_mm256_set1_epi32(vb32[1]), _w);
+        __m256i _x2 = _mm256_sign_epi8(_mm256_set1_epi32(vb32[2]), _w);
+        __m256i _x3 = _mm256_sign_epi8(_mm256_set1_epi32(vb32[3]), _w);
+        _sum0 = _mm256_add_epi32(_sum0, _mm256_madd_epi16(_mm256_maddubs_epi16(_wabs, _x0), _one));
+        _sum1 = _mm256_add_epi32(_sum1, _mm256_madd_epi16(_mm256_maddubs_epi16(_wabs, _x1), _one));
+        _sum2 = _mm256_add_epi32(_sum2, _mm256_madd_epi16(_mm256_maddubs_epi16(_wabs, _x2), _one));
+        _sum3 = _mm256_add_epi32(_sum3, _mm256_madd_epi16(_mm256_maddubs_epi16(_wabs, _x3), _one));
+
+        __m256i _x4 = _mm256_sign_epi8(_mm256_set1_epi32(vb32[4]), _w);
+        __m256i _x5 = _mm256_sign_epi8(_mm256_set1_epi32(vb32[5]), _w);
+        __m256i _x6 = _mm256_sign_epi8(_mm256_set1_epi32(vb32[6]), _w);
+        __m256i _x7 = _mm256_sign_epi8(_mm256_set1_epi32(vb32[7]), _w);
+        _sum4 = _mm256_add_epi32(_sum4, _mm256_madd_epi16(_mm256_maddubs_epi16(_wabs, _x4), _one));
+        _sum5 = _mm256_add_epi32(_sum5, _mm256_madd_epi16(_mm256_maddubs_epi16(_wabs, _x5), _one));
+        _sum6 = _mm256_add_epi32(_sum6, _mm256_madd_epi16(_mm256_maddubs_epi16(_wabs, _x6), _one));
+        _sum7 = _mm256_add_epi32(_sum7, _mm256_madd_epi16(_mm256_maddubs_epi16(_wabs, _x7), _one));
+
+        va += 32;
+        vb += 32;
+    }
+
+    sums[0] = _sum0;
+    sums[1] = _sum1;
+    sums[2] = _sum2;
+    sums[3] = _sum3;
+    sums[4] = _sum4;
+    sums[5] = _sum5;
+    sums[6] = _sum6;
+    sums[7] = _sum7;
+}
+
+#if NCNN_X86_INT8_VNNI
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("avx512vnni")))
+#endif
+static void conv_im2col_sgemm_int8_kernel_vnni(const signed char* va, const unsigned char* vb, int nn_k, __m256i* sums)
+{
+    __m256i _sum0 = _mm256_setzero_si256();
+    __m256i _sum1 = _mm256_setzero_si256();
+    __m256i _sum2 = _mm256_setzero_si256();
+    __m256i _sum3 = _mm256_setzero_si256();
+    __m256i _sum4 = _mm256_setzero_si256();
+    __m256i _sum5 = _mm256_setzero_si256();
+    __m256i _sum6 = _mm256_setzero_si256();
+    __m256i _sum7 = _mm256_setzero_si256();
+
+    // 128 * sum(w) brought in by the unsigned shift of the input
+    __m256i _comp = _mm256_setzero_si256();
+    const __m256i _v128 = _mm256_set1_epi8((char)0x80);
+
+    for (int kk=0; kk<nn_k; kk++)
+    {
+        __m256i _w = _mm256_loadu_si256((const __m256i*)va);
+
+        const int* vb32 = (const int*)vb;
+
+        _sum0 = _mm256_dpbusd_epi32(_sum0, _mm256_set1_epi32(vb32[0]), _w);
+        _sum1 = _mm256_dpbusd_epi32(_sum1, _mm256_set1_epi32(vb32[1]), _w);
+        _sum2 = _mm256_dpbusd_epi32(_sum2, _mm256_set1_epi32(vb32[2]), _w);
+        _sum3 = _mm256_dpbusd_epi32(_sum3, _mm256_set1_epi32(vb32[3]), _w);
+        _sum4 = _mm256_dpbusd_epi32(_sum4, _mm256_set1_epi32(vb32[4]), _w);
+        _sum5 = _mm256_dpbusd_epi32(_sum5, _mm256_set1_epi32(vb32[5]), _w);
+        _sum6 = _mm256_dpbusd_epi32(_sum6, _mm256_set1_epi32(vb32[6]), _w);
+        _sum7 = _mm256_dpbusd_epi32(_sum7, _mm256_set1_epi32(vb32[7]), _w);
+        _comp = _mm256_dpbusd_epi32(_comp, _v128, _w);
+
+        va += 32;
+        vb += 32;
+    }
+
+    sums[0] = _mm256_sub_epi32(_sum0, _comp);
+    sums[1] = _mm256_sub_epi32(_sum1, _comp);
+    sums[2] = _mm256_sub_epi32(_sum2, _comp);
+    sums[3] = _mm256_sub_epi32(_sum3, _comp);
+    sums[4] = _mm256_sub_epi32(_sum4, _comp);
+    sums[5] = _mm256_sub_epi32(_sum5, _comp);
+    sums[6] = _mm256_sub_epi32(_sum6, _comp);
+    sums[7] = _mm256_sub_epi32(_sum7, _comp);
+}
+#endif // NCNN_X86_INT8_VNNI
+
+// round half away from zero and clamp to [-127, 127], same as float2int8
+static inline __m256i float2int8_avx2(__m256 _v)
+{
+    const __m256 _sign_mask = _mm256_set1_ps(-0.f);
+    __m256 _half = _mm256_or_ps(_mm256_and_ps(_v, _sign_mask), _mm256_set1_ps(0.5f));
+    __m256i _v32 = _mm256_cvttps_epi32(_mm256_add_ps(_v, _half));
+    _v32 = _mm256_min_epi32(_v32, _mm256_set1_epi32(127));
+    _v32 = _mm256_max_epi32(_v32, _mm256_set1_epi32(-127));
+    return _v32;
+}
+
+// scales are the per outch dequantize scales, or (scale_in, scale_out) pairs when requant
+static void conv_im2col_sgemm_int8_avx2(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, \
+            const int kernel_w, const int kernel_h, const int dilation_w, const int dilation_h, const int stride_w, const int stride_h, \
+            const Mat& _bias, const std::vector<float>& scales, bool requant, const Option& opt)
+{
+    int outw = top_blob.w;
+    int outh = top_blob.h;
+    int outch = top_blob.c;
+
+    const int K = bottom_blob.c * kernel_w * kernel_h;
+    const int nn_k = (K + 3) / 4;
+    const int size = outw * outh;
+
+    const float* bias = _bias;
+
+    bool use_vnni = false;
+#if NCNN_X86_INT8_VNNI
+    use_vnni = cpu_support_x86_avx512_vnni();
+#endif
+
+    Mat bottom_tm;
+    conv_im2col_sgemm_int8_pack_bottom_avx2(bottom_blob, bottom_tm, outw, outh, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, use_vnni, opt);
+    if (bottom_tm.empty())
+        return;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int pp=0; pp<kernel_tm.h; pp++)
+    {
+        const int p = pp * 8;
+        const int np = std::min(8, outch - p);
+
+        float scale_in[8] = {0.f};
+        float bias_in[8] = {0.f};
+        float scale_out[8] = {0.f};
+        for (int i=0; i<np; i++)
+        {
+            scale_in[i] = requant ? scales[2 * (p + i)] : scales[p + i];
+            bias_in[i] = bias ? bias[p + i] : 0.f;
+            scale_out[i] = requant ? scales[2 * (p + i) + 1] : 0.f;
+        }
+
+        __m256 _scale_in = _mm256_loadu_ps(scale_in);
+        __m256 _bias_in = _mm256_loadu_ps(bias_in);
+        __m256 _scale_out = _mm256_loadu_ps(scale_out);
+
+        const signed char* va = kernel_tm.row<const signed char>(pp);
+
+        for (int jj=0; jj<bottom_tm.h; jj++)
+        {
+            const int j = jj * 8;
+            const int nj = std::min(8, size - j);
+
+            const unsigned char* vb = bottom_tm.row<const unsigned char>(jj);
+
+            __m256i _sums[8];
+#if NCNN_X86_INT8_VNNI
+            if (use_vnni)
+                conv_im2col_sgemm_int8_kernel_vnni(va, vb, nn_k, _sums);
+            else
+#endif
+                conv_im2col_sgemm_int8_kernel_avx2(va, vb, nn_k, _sums);
+
+            // dequantize, one vector per pixel
+            __m256 _r0 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_sums[0]), _scale_in, _bias_in);
+            __m256 _r1 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_sums[1]), _scale_in, _bias_in);
+            __m256 _r2 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_sums[2]), _scale_in, _bias_in);
+            __m256 _r3 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_sums[3]), _scale_in, _bias_in);
+            __m256 _r4 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_sums[4]), _scale_in, _bias_in);
+            __m256 _r5 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_sums[5]), _scale_in, _bias_in);
+            __m256 _r6 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_sums[6]), _scale_in, _bias_in);
+            __m256 _r7 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_sums[7]), _scale_in, _bias_in);
+
+            if (requant)
+            {
+                _r0 = _mm256_mul_ps(_r0, _scale_out);
+                _r1 = _mm256_mul_ps(_r1, _scale_out);
+                _r2 = _mm256_mul_ps(_r2, _scale_out);
+                _r3 = _mm256_mul_ps(_r3, _scale_out);
+                _r4 = _mm256_mul_ps(_r4, _scale_out);
+                _r5 = _mm256_mul_ps(_r5, _scale_out);
+                _r6 = _mm256_mul_ps(_r6, _scale_out);
+                _r7 = _mm256_mul_ps(_r7, _scale_out);
+            }
+
+            // one vector per outch
+            transpose8_ps(_r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);
+
+            __m256 _rows[8] = {_r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7};
+
+            for (int i=0; i<np; i++)
+            {
+                if (requant)
+                {
+                    signed char* outptr = (signed char*)top_blob.channel(p + i) + j;
+
+                    __m256i _v32 = float2int8_avx2(_rows[i]);
+                    __m128i _v16 = _mm_packs_epi32(_mm256_castsi256_si128(_v32), _mm256_extracti128_si256(_v32, 1));
+                    __m128i _v8 = _mm_packs_epi16(_v16, _v16);
+
+                    if (nj == 8)
+                    {
+                        _mm_storel_epi64((__m128i*)outptr, _v8);
+                    }
+                    else
+                    {
+                        signed char tmp[16];
+                        _mm_storeu_si128((__m128i*)tmp, _v8);
+                        for (int c=0; c<nj; c++)
+                            outptr[c] = tmp[c];
+                    }
+                }
+                else
+                {
+                    float* outptr = (float*)top_blob.channel(p + i) + j;
+
+                    if (nj == 8)
+                    {
+                        _mm256_storeu_ps(outptr, _rows[i]);
+                    }
+                    else
+                    {
+                        float tmp[8];
+                        _mm256_storeu_ps(tmp, _rows[i]);
+                        for (int c=0; c<nj; c++)
+                            outptr[c] = tmp[c];
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void conv_im2col_sgemm_int8_dequant_avx2(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, \
+            const int kernel_w, const int kernel_h, const int dilation_w, const int dilation_h, const int stride_w, const int stride_h, \
+            const Mat& _bias, const std::vector<float>& scales_dequant, const Option& opt)
+{
+    conv_im2col_sgemm_int8_avx2(bottom_blob, top_blob, kernel_tm, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, _bias, scales_dequant, false, opt);
+}
+
+static void conv_im2col_sgemm_int8_requant_avx2(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, \
+            const int kernel_w, const int kernel_h, const int dilation_w, const int dilation_h, const int stride_w, const int stride_h, \
+            const Mat& _bias, const std::vector<float>& scales_requant, const Option& opt)
+{
+    conv_im2col_sgemm_int8_avx2(bottom_blob, top_blob, kernel_tm, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, _bias, scales_requant, true, opt);
+}
@@ -14,6 +14,10 @@
 
 #include "convolution_x86.h"
 
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
 #include "platform.h"
 #if __SSE2__
 #include <emmintrin.h>
@@ -23,7 +27,13 @@
 #endif
 
 #include "layer_type.h"
+#include "convolutiondepthwise.h"
 #include "benchmark.h"
+#include "cpu.h"
+#include "autotune.h"
+#include "x86_activation.h"
+#include "x86_gemm.h"
+#include "x86_sparse.h"
 
 namespace ncnn {
 
@@ -37,12 +47,101 @@ namespace ncnn {
 #include "convolution_3x3_int8.h"
 #include "convolution_5x5_int8.h"
 #include "convolution_7x7_int8.h"
+#if __AVX2__
+#include "convolution_sgemm_int8_avx2.h"
+#endif
+
+#if __AVX__
+#include "convolution_pack8.h"
+#elif __SSE2__
+#include "convolution_pack4.h"
+#endif
 
 DEFINE_LAYER_CREATOR(Convolution_x86)
 
+// instruction set this variant is compiled for, part of the autotune keys
+// as the timings of the avx2 and avx512 builds do not carry over
+#if __AVX512F__
+static const char* const isa_tag = "avx512";
+#elif __AVX2__
+static const char* const isa_tag = "avx2";
+#elif __AVX__
+static const char* const isa_tag = "avx";
+#elif __SSE2__
+static const char* const isa_tag = "sse2";
+#else
+static const char* const isa_tag = "c";
+#endif
+
+// winograd output tile for a 3x3s1 convolution, the one with the fewest
+// element-wise multiplies over the padded output wins and ties go to the smaller tile
+static int winograd3x3_select_tile(int outw, int outh, bool has_winograd43, bool has_winograd63)
+{
+    int tile = 2;
+    int cost = ((outw + 1) / 2) * ((outh + 1) / 2) * 16;
+
+    if (has_winograd43)
+    {
+        int cost43 = ((outw + 3) / 4) * ((outh + 3) / 4) * 36;
+        if (cost43 < cost)
+        {
+            tile = 4;
+            cost = cost43;
+        }
+    }
+
+    if (has_winograd63)
+    {
+        int cost63 = ((outw + 5) / 6) * ((outh + 5) / 6) * 64;
+        if (cost63 < cost)
+        {
+            tile = 6;
+            cost = cost63;
+        }
+    }
+
+    return tile;
+}
+
 Convolution_x86::Convolution_x86()
 {
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+
     activation = 0;
+    depthwise_op = 0;
+    depthwise_padding = 0;
+}
+
+// weight_data_packed = out_elempack-elempack-maxk-inch/elempack-outch/out_elempack
+static void convolution_transform_kernel_packed(const Mat& weight_data, Mat& weight_data_packed, int num_input, int num_output, int maxk, int elempack, int out_elempack)
+{
+    weight_data_packed.create(maxk * elempack * out_elempack, num_input / elempack, num_output / out_elempack);
+
+    for (int q=0; q+(out_elempack-1)<num_output; q+=out_elempack)
+    {
+        Mat g0 = weight_data_packed.channel(q / out_elempack);
+
+        for (int p=0; p+(elempack-1)<num_input; p+=elempack)
+        {
+            float* g00 = g0.row(p / elempack);
+
+            for (int k=0; k<maxk; k++)
+            {
+                for (int i=0; i<elempack; i++)
+                {
+                    for (int j=0; j<out_elempack; j++)
+                    {
+                        const float* k00 = (const float*)weight_data + (q + j) * num_input * maxk + (p + i) * maxk;
+
+                        g00[0] = k00[k];
+                        g00++;
+                    }
+                }
+            }
+        }
+    }
 }
 
 int Convolution_x86::create_pipeline(const Option& opt)
@@ -92,6 +191,12 @@ int Convolution_x86::create_pipeline(const Option& opt)
         // winograd is slow on small channel count
         if(num_input >= 16 && num_output >= 16)
             use_winograd3x3 = true;
+
+#if __AVX2__
+        // the int8 gemm is exact and faster than the int8 winograd here
+        if (use_int8_inference)
+            use_winograd3x3 = false;
+#endif
     }           
 
     if (use_winograd3x3)
@@ -102,23 +207,85 @@ int Convolution_x86::create_pipeline(const Option& opt)
             // conv3x3s1_winograd23_transform_kernel_int8_sse(weight_data, weight_3x3_winograd23_data, num_input, num_output);
             conv3x3s1_winograd43_transform_kernel_int8_sse(weight_data, weight_3x3_winograd23_data, num_input, num_output);
         else
+        {
             conv3x3s1_winograd23_transform_kernel_sse(weight_data, weight_3x3_winograd23_data, num_input, num_output);
-//             conv3x3s1_winograd43_transform_kernel_sse(weight_data, weight_3x3_winograd43_data, num_input, num_output);
+#if __AVX__
+            conv3x3s1_winograd63_transform_kernel_avx(weight_data, weight_3x3_winograd63_data, num_input, num_output);
+#else
+            conv3x3s1_winograd43_transform_kernel_sse(weight_data, weight_3x3_winograd43_data, num_input, num_output);
+#endif
+        }
     }
 
-    if (use_int8_inference == false)
+    // pruned 1x1s1 weights run as sparse times dense
+    if (use_int8_inference == false && kernel_w == 1 && kernel_h == 1 && stride_w == 1 && stride_h == 1
+        && pad_left == 0 && pad_right == 0 && pad_top == 0 && pad_bottom == 0)
+    {
+        int nnz = sparse_x86_count_nonzero(weight_data, weight_data_size);
+        if (nnz < weight_data_size * X86_SPARSE_DENSITY)
+        {
+            int num_input = weight_data_size / num_output;
+
+            if (sparse_x86_pack(weight_data, num_output, num_input, weight_sparse_data, weight_sparse_index) != 0)
+                return -100;
+
+            support_packing = false;
+        }
+    }
+
+    if (use_int8_inference == false && weight_sparse_data.empty())
     {
         int kernel_size = kernel_w * kernel_h;
         int num_input = weight_data_size / kernel_size / num_output;
 
-        conv_im2col_sgemm_transform_kernel_sse(weight_data, weight_sgemm_data, num_input, num_output, kernel_size);
+        conv_im2col_sgemm_transform_kernel_sse(weight_data, weight_sgemm_data, num_input, num_output, kernel_size, opt);
     }       
 
+    if (use_int8_inference)
+    {
+        support_packing = false;
+
+#if __AVX2__
+        int kernel_size = kernel_w * kernel_h;
+        int num_input = weight_data_size / kernel_size / num_output;
+
+        conv_im2col_sgemm_transform_kernel_int8_avx2(weight_data, weight_sgemm_int8_data, num_input, num_output, kernel_size);
+#endif
+    }
+
+#if __SSE2__
+    if (opt.use_packing_layout && use_int8_inference == false && weight_sparse_data.empty())
+    {
+#if __AVX__
+        const int packn = 8;
+#else
+        const int packn = 4;
+#endif
+        const int maxk = kernel_w * kernel_h;
+        const int num_input = weight_data_size / maxk / num_output;
+
+        int elempack = num_input % packn == 0 ? packn : 1;
+        int out_elempack = num_output % packn == 0 ? packn : 1;
+
+        if (elempack != 1 || out_elempack != 1)
+        {
+            convolution_transform_kernel_packed(weight_data, weight_data_packed, num_input, num_output, maxk, elempack, out_elempack);
+        }
+    }
+#endif // __SSE2__
+
     return 0;
 }
 
 int Convolution_x86::destroy_pipeline(const Option& opt)
 {
+    weight_data_packed.release();
+    weight_sparse_data.release();
+    weight_sparse_index.release();
+    weight_3x3_winograd63_data.release();
+    weight_sgemm_int8_data.release();
+    weight_3x3_winograd43_data.clear();
+
     if (activation)
     {
         activation->destroy_pipeline(opt);
@@ -126,160 +293,300 @@ int Convolution_x86::destroy_pipeline(const Option& opt)
         activation = 0;
     }
 
+    if (depthwise_op)
+    {
+        depthwise_op->destroy_pipeline(opt);
+        delete depthwise_op;
+        depthwise_op = 0;
+    }
+
+    if (depthwise_padding)
+    {
+        depthwise_padding->destroy_pipeline(opt);
+        delete depthwise_padding;
+        depthwise_padding = 0;
+    }
+
     return 0;
 }
 
-int Convolution_x86::forwardDilation(const Mat& bottom_blob, Mat& top_blob, conv_func conv, const Option& opt) const
+int Convolution_x86::fuse_depthwise(const Layer* depthwise, const Option& opt)
 {
-    int w = bottom_blob.w;
-    int h = bottom_blob.h;
-    size_t elemsize = bottom_blob.elemsize;
+    const ConvolutionDepthWise* dw = (const ConvolutionDepthWise*)depthwise;
+
+    // fp32 1x1s1 sgemm on plain layout only
+    if (kernel_w != 1 || kernel_h != 1 || stride_w != 1 || stride_h != 1 || dilation_w != 1 || dilation_h != 1
+        || pad_left != 0 || pad_right != 0 || pad_top != 0 || pad_bottom != 0 || residual_term
+        || use_int8_inference || weight_sgemm_data.empty() || !weight_data_packed.empty())
+        return -1;
+
+    if (dw->use_int8_inference || dw->group != dw->num_output || dw->num_output != weight_data_size / num_output
+        || dw->pad_left < 0 || dw->pad_right < 0 || dw->pad_top < 0 || dw->pad_bottom < 0)
+        return -1;
+
+    depthwise_op = ncnn::create_layer(ncnn::LayerType::ConvolutionDepthWise);
+
+    // the input is padded once up front
+    ncnn::ParamDict pd;
+    pd.set(0, dw->num_output);
+    pd.set(1, dw->kernel_w);
+    pd.set(11, dw->kernel_h);
+    pd.set(2, dw->dilation_w);
+    pd.set(12, dw->dilation_h);
+    pd.set(3, dw->stride_w);
+    pd.set(13, dw->stride_h);
+    pd.set(4, 0);
+    pd.set(14, 0);
+    pd.set(5, dw->bias_term);
+    pd.set(6, dw->weight_data_size);
+    pd.set(7, dw->group);
+    pd.set(9, dw->activation_type);
+    pd.set(10, dw->activation_params);
+
+    depthwise_op->load_param(pd);
+
+    ncnn::Mat weights[2];
+    weights[0] = dw->weight_data;
+    weights[1] = dw->bias_data;
+
+    depthwise_op->load_model(ModelBinFromMatArray(weights));
+
+    depthwise_op->create_pipeline(opt);
+
+    if (dw->pad_left > 0 || dw->pad_right > 0 || dw->pad_top > 0 || dw->pad_bottom > 0)
+    {
+        depthwise_padding = ncnn::create_layer(ncnn::LayerType::Padding);
 
-    const int kernel_size = kernel_w;
-    const int stride = stride_w;
-    const int dilation = dilation_w;
-    const int kernel_extent = dilation * (kernel_size - 1) + 1;
+        ncnn::ParamDict pd;
+        pd.set(0, dw->pad_top);
+        pd.set(1, dw->pad_bottom);
+        pd.set(2, dw->pad_left);
+        pd.set(3, dw->pad_right);
+        pd.set(4, 0);// BORDER_CONSTANT
+        pd.set(5, dw->pad_value);
 
-    Mat bottom_blob_bordered = bottom_blob;
-    if (pad_left > 0 || pad_right > 0 || pad_top > 0 || pad_bottom > 0)
+        depthwise_padding->load_param(pd);
+
+        depthwise_padding->create_pipeline(opt);
+    }
+
+    return 0;
+}
+
+int Convolution_x86::forward_depthwise(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    const ConvolutionDepthWise* dw = (const ConvolutionDepthWise*)depthwise_op;
+
+    Mat bottom_blob_unpacked = bottom_blob;
+    if (bottom_blob.elempack != 1)
+    {
+        Option opt_p = opt;
+        opt_p.blob_allocator = opt.workspace_allocator;
+        convert_packing(bottom_blob, bottom_blob_unpacked, 1, opt_p);
+        if (bottom_blob_unpacked.empty())
+            return -100;
+    }
+
+    Mat bottom_blob_bordered = bottom_blob_unpacked;
+    if (depthwise_padding)
     {
         Option opt_b = opt;
         opt_b.blob_allocator = opt.workspace_allocator;
-        copy_make_border(bottom_blob, bottom_blob_bordered, pad_top, pad_bottom, pad_left, pad_right, BORDER_CONSTANT, pad_value, opt_b);
+        depthwise_padding->forward(bottom_blob_unpacked, bottom_blob_bordered, opt_b);
         if (bottom_blob_bordered.empty())
             return -100;
-
-        w = bottom_blob_bordered.w;
-        h = bottom_blob_bordered.h;
     }
-    else if (pad_left == -233 && pad_right == -233 && pad_top == -233 && pad_bottom == -233)
-    {
-        int wpad = kernel_extent + (w - 1) / stride * stride - w;
-        int hpad = kernel_extent + (h - 1) / stride * stride - h;
-        if (wpad > 0 || hpad > 0)
-        {
-            Option opt_b = opt;
-            opt_b.blob_allocator = opt.workspace_allocator;
-            copy_make_border(bottom_blob, bottom_blob_bordered, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, BORDER_CONSTANT, pad_value, opt_b);
-            if (bottom_blob_bordered.empty())
-                return -100;
-        }
 
-        w = bottom_blob_bordered.w;
-        h = bottom_blob_bordered.h;
-    }
-    else if (pad_left == -234 && pad_right == -234 && pad_top == -234 && pad_bottom == -234)
-    {
-        int wpad = kernel_extent + (w - 1) / stride * stride - w;
-        int hpad = kernel_extent + (h - 1) / stride * stride - h;
-        if (wpad > 0 || hpad > 0)
-        {
-            Option opt_b = opt;
-            opt_b.blob_allocator = opt.workspace_allocator;
-            copy_make_border(bottom_blob, bottom_blob_bordered, hpad - hpad / 2, hpad / 2, wpad - wpad / 2, wpad / 2, BORDER_CONSTANT, pad_value, opt_b);
-            if (bottom_blob_bordered.empty())
-                return -100;
-        }
+    int w = bottom_blob_bordered.w;
+    int h = bottom_blob_bordered.h;
+    int channels = bottom_blob_bordered.c;
+    size_t elemsize = bottom_blob_bordered.elemsize;
 
-        w = bottom_blob_bordered.w;
-        h = bottom_blob_bordered.h;
-    }
+    const int kernel_extent_w = dw->dilation_w * (dw->kernel_w - 1) + 1;
+    const int kernel_extent_h = dw->dilation_h * (dw->kernel_h - 1) + 1;
 
-    int outw = (w - kernel_extent) / stride + 1;
-    int outh = (h - kernel_extent) / stride + 1;
+    if (w < kernel_extent_w || h < kernel_extent_h)
+        return -100;
+
+    int outw = (w - kernel_extent_w) / dw->stride_w + 1;
+    int outh = (h - kernel_extent_h) / dw->stride_h + 1;
 
     top_blob.create(outw, outh, num_output, elemsize, opt.blob_allocator);
     if (top_blob.empty())
         return -100;
 
-    // Make (dilation * dilation) batches
-    Mat inner_bottom_blob;
-    Mat inner_top_blob;
-    for (int x = 0; x < dilation; x ++)
+    // the depthwise tile and its packed copy share about 256k of cache,
+    // with at least 64 columns for the gemm
+    int tile_rows = std::max(65536 / (outw * channels), (128 + outw - 1) / outw);
+    tile_rows = std::max(std::min(tile_rows, outh), 1);
+
+    Option opt_t = opt;
+    opt_t.blob_allocator = opt.workspace_allocator;
+
+    const float* bias = bias_data;
+
+    for (int y=0; y<outh; y+=tile_rows)
     {
-        for (int y = 0; y < dilation; y ++)
-        {
-            int inner_w = (w - y + dilation - 1) / dilation;
-            int inner_h = (h - x + dilation - 1) / dilation;
+        const int rows = std::min(tile_rows, outh - y);
+        const int inh = (rows - 1) * dw->stride_h + kernel_extent_h;
 
-            int inner_outw = (inner_w - kernel_size) / stride + 1;
-            int inner_outh = (inner_h - kernel_size) / stride + 1;
+        // input rows of this tile, a view over all channels
+        Mat bottom_tile(w, inh, channels, (float*)bottom_blob_bordered.row(y * dw->stride_h), elemsize);
+        bottom_tile.cstep = bottom_blob_bordered.cstep;
 
-            inner_bottom_blob.create(inner_w, inner_h, bottom_blob.c, elemsize, opt.workspace_allocator);
-            if (inner_bottom_blob.empty())
-                return -100;
+        Mat depthwise_tile;
+        int ret = depthwise_op->forward(bottom_tile, depthwise_tile, opt_t);
+        if (ret != 0)
+            return ret;
 
-            inner_top_blob.create(inner_outw, inner_outh, num_output, elemsize, opt.workspace_allocator);
-            if (inner_top_blob.empty())
-                return -100;
+        const int N = rows * outw;
 
-            #pragma omp parallel for num_threads(opt.num_threads)
-            for (int c = 0; c < bottom_blob.c; c ++)
-            {
-                float *outptr = inner_bottom_blob.channel(c);
+        int bw;
+        int bh;
+        gemm_x86_packed_b_shape(channels, N, bw, bh);
 
-                for (int i = 0; i < inner_h; i ++)
-                {
-                    const float* ptr = (const float *)bottom_blob_bordered.channel(c) + dilation * i * w + x * w + y;
-                    for (int j = 0; j < inner_w; j ++)
-                    {
-                        outptr[j] = ptr[j*dilation];
-                    }
-                    outptr += inner_w;
-                }
-            }
+        Mat depthwise_tile_tm(bw, bh, elemsize, opt.workspace_allocator);
+        if (depthwise_tile_tm.empty())
+            return -100;
 
-            Option opt_g = opt;
-            opt_g.blob_allocator = inner_top_blob.allocator;
-            if (kernel_size == 7)
-            {
-            // FIXME conv7x7s1_sse use sgemm
-            conv(inner_bottom_blob, inner_top_blob, weight_sgemm_data, bias_data, opt_g);
-            }
-            else
-            {
-            conv(inner_bottom_blob, inner_top_blob, weight_data, bias_data, opt_g);
-            }
+        gemm_x86_pack_b(depthwise_tile, depthwise_tile.cstep, channels, N, depthwise_tile_tm, opt);
 
-            #pragma omp parallel for num_threads(opt.num_threads)
-            for (int c = 0; c < num_output; c ++)
-            {
-                float *outptr = (float *)top_blob.channel(c) + x * outw + y;
-                for (int i = 0; i < inner_outh; i ++)
-                {
-                    const float* ptr = (const float *)inner_top_blob.channel(c) + i * inner_outw;
-                    for (int j = 0; j < inner_outw; j ++)
-                    {
-                        outptr[j*dilation] = ptr[j];
-                    }
-                    outptr += dilation * outw;
-                }
-            }
-        }
+        gemm_x86(num_output, N, channels, weight_sgemm_data, depthwise_tile_tm, top_blob.row(y), top_blob.cstep, 0, 0, bias, 0, activation_type, activation_params, opt);
     }
 
     return 0;
 }
 
 int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    if (depthwise_op)
+        return forward_depthwise(bottom_blob, top_blob, opt);
+
+    bool residual_fused = false;
+    return forward_residual(bottom_blob, Mat(), top_blob, residual_fused, opt);
+}
+
+int Convolution_x86::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    const Mat& bottom_blob = bottom_blobs[0];
+    const Mat& residual_blob = bottom_blobs[1];
+    Mat& top_blob = top_blobs[0];
+
+    bool residual_fused = false;
+    int ret = forward_residual(bottom_blob, residual_blob, top_blob, residual_fused, opt);
+    if (ret != 0)
+        return ret;
+
+    if (residual_fused)
+        return 0;
+
+    return add_residual(residual_blob, top_blob, opt);
+}
+
+int Convolution_x86::add_residual(const Mat& residual_blob, Mat& top_blob, const Option& opt) const
+{
+    Mat residual = residual_blob;
+    if (residual_blob.elempack != top_blob.elempack)
+    {
+        Option opt_p = opt;
+        opt_p.blob_allocator = opt.workspace_allocator;
+        convert_packing(residual_blob, residual, top_blob.elempack, opt_p);
+        if (residual.empty())
+            return -100;
+    }
+
+    if (residual.dims != top_blob.dims || residual.w != top_blob.w || residual.h != top_blob.h || residual.c != top_blob.c
+        || residual.elemsize != top_blob.elemsize || top_blob.elemsize != (size_t)4u * top_blob.elempack)
+        return -100;
+
+    int channels = top_blob.c;
+    int size = top_blob.w * top_blob.h * top_blob.elempack;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<channels; q++)
+    {
+        const float* ptr = residual.channel(q);
+        float* outptr = top_blob.channel(q);
+
+        int i = 0;
+#if __AVX__
+        for (; i+7<size; i+=8)
+        {
+            __m256 _sum = _mm256_add_ps(_mm256_loadu_ps(outptr + i), _mm256_loadu_ps(ptr + i));
+            _mm256_storeu_ps(outptr + i, activation_avx(_sum, residual_activation_type, residual_activation_params));
+        }
+#endif // __AVX__
+#if __SSE2__
+        for (; i+3<size; i+=4)
+        {
+            __m128 _sum = _mm_add_ps(_mm_loadu_ps(outptr + i), _mm_loadu_ps(ptr + i));
+            _mm_storeu_ps(outptr + i, activation_sse(_sum, residual_activation_type, residual_activation_params));
+        }
+#endif // __SSE2__
+        for (; i<size; i++)
+        {
+            outptr[i] = activation_ss(outptr[i] + ptr[i], residual_activation_type, residual_activation_params);
+        }
+    }
+
+    return 0;
+}
+
+int Convolution_x86::forward_residual(const Mat& bottom_blob, const Mat& residual_blob, Mat& top_blob, bool& residual_fused, const Option& opt) const
 {
     // convolv with NxN kernel
     // value = value + bias
 
+    if (opt.use_packing_layout && !weight_data_packed.empty())
+    {
+        return forward_packed(bottom_blob, top_blob, opt);
+    }
+
+    if (bottom_blob.elempack != 1)
+    {
+        Mat bottom_blob_unpacked;
+        Option opt_p = opt;
+        opt_p.blob_allocator = opt.workspace_allocator;
+        convert_packing(bottom_blob, bottom_blob_unpacked, 1, opt_p);
+        if (bottom_blob_unpacked.empty())
+            return -100;
+
+        return forward_residual(bottom_blob_unpacked, residual_blob, top_blob, residual_fused, opt);
+    }
+
     if (bottom_blob.dims != 3)
     {
         return Convolution::forward(bottom_blob, top_blob, opt);
     }
 
+    if (!weight_sparse_data.empty())
+    {
+        // pruned 1x1s1 without padding
+        int size = bottom_blob.w * bottom_blob.h;
+
+        top_blob.create(bottom_blob.w, bottom_blob.h, num_output, bottom_blob.elemsize, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        sparse_x86_spmm(num_output, size, weight_sparse_data, weight_sparse_index, bottom_blob, bottom_blob.cstep, top_blob, top_blob.cstep, bias_data, activation_type, activation_params, opt);
+
+        return 0;
+    }
+
     if (kernel_w != kernel_h || stride_w != stride_h)
     {
         return Convolution::forward(bottom_blob, top_blob, opt);
     }
 
     const int kernel_size = kernel_w;
-    const int stride = stride_w;  
+    const int stride = stride_w;
+    const int dilation = dilation_w;
+    const int kernel_extent = dilation * (kernel_size - 1) + 1;
+
+    // the int8 gemm takes any kernel size, stride and dilation
+    const bool use_int8_sgemm = use_int8_inference && !weight_sgemm_int8_data.empty();
 
-    if (kernel_size > 7 || stride > 7 || dilation_w != dilation_h)
+    if (dilation_w != dilation_h || (!use_int8_sgemm && (kernel_size > 7 || stride > 7)))
     {
         return Convolution::forward(bottom_blob, top_blob, opt);
     }
@@ -435,13 +742,22 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
 
     if (use_int8_inference)
     {
-        if (use_int8_requantize)
-            conv_int8_requant = conv_int8_requant_func_table[kernel_size-1][stride-1];
-        else
-            conv_int8_dequant = conv_int8_dequant_func_table[kernel_size-1][stride-1];  
-        if ((!conv_int8_requant) && (!conv_int8_dequant))
+        if (!use_int8_sgemm)
         {
-            return Convolution::forward(bottom_blob, top_blob, opt);
+            if (use_int8_requantize)
+                conv_int8_requant = conv_int8_requant_func_table[kernel_size-1][stride-1];
+            else
+                conv_int8_dequant = conv_int8_dequant_func_table[kernel_size-1][stride-1];
+            if ((!conv_int8_requant) && (!conv_int8_dequant))
+            {
+                return Convolution::forward(bottom_blob, top_blob, opt);
+            }
+
+            // the int8 kernels in the table are not dilated
+            if (dilation != 1)
+            {
+                return Convolution::forward(bottom_blob, top_blob, opt);
+            }
         }
     }
     else
@@ -452,13 +768,6 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
             return Convolution::forward(bottom_blob, top_blob, opt);
         }
 
-        if (dilation_w != 1)
-        {
-            if (stride != 1)
-                return Convolution::forward(bottom_blob, top_blob, opt);
-
-            return forwardDilation(bottom_blob, top_blob, conv, opt);
-        }
     }
 
     int w = bottom_blob.w;
@@ -499,8 +808,8 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
     }
     else if (pad_left == -233 && pad_right == -233 && pad_top == -233 && pad_bottom == -233)
     {
-        int wpad = kernel_size + (w - 1) / stride * stride - w;
-        int hpad = kernel_size + (h - 1) / stride * stride - h;
+        int wpad = kernel_extent + (w - 1) / stride * stride - w;
+        int hpad = kernel_extent + (h - 1) / stride * stride - h;
         if (wpad > 0 || hpad > 0)
         {
             Option opt_b = opt;
@@ -515,8 +824,8 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
     }
     else if (pad_left == -234 && pad_right == -234 && pad_top == -234 && pad_bottom == -234)
     {
-        int wpad = kernel_size + (w - 1) / stride * stride - w;
-        int hpad = kernel_size + (h - 1) / stride * stride - h;
+        int wpad = kernel_extent + (w - 1) / stride * stride - w;
+        int hpad = kernel_extent + (h - 1) / stride * stride - h;
         if (wpad > 0 || hpad > 0)
         {
             Option opt_b = opt;
@@ -530,8 +839,8 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
         h = bottom_blob_bordered.h;
     }
 
-    int outw = (w - kernel_size) / stride + 1;
-    int outh = (h - kernel_size) / stride + 1;
+    int outw = (w - kernel_extent) / stride + 1;
+    int outh = (h - kernel_extent) / stride + 1;
 
     // int8
     if (use_int8_inference)
@@ -565,6 +874,10 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
                     requantize_ops[p]->forward(top_blob_tm_g, top_blob_g, opt_g);
                 }
             }
+#if __AVX2__
+            else if (use_int8_sgemm)
+                conv_im2col_sgemm_int8_requant_avx2(bottom_blob_bordered, top_blob, weight_sgemm_int8_data, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, bias_data, requantize_scales, opt);
+#endif
             else
                 conv_int8_requant(bottom_blob_bordered, top_blob, weight_data, bias_data, requantize_scales, opt);
         }
@@ -591,6 +904,10 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
                     dequantize_ops[p]->forward_inplace(top_blob_g, opt_g);
                 }
             }
+#if __AVX2__
+            else if (use_int8_sgemm)
+                conv_im2col_sgemm_int8_dequant_avx2(bottom_blob_bordered, top_blob, weight_sgemm_int8_data, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, bias_data, dequantize_scales, opt);
+#endif
             else
                 conv_int8_dequant(bottom_blob_bordered, top_blob, weight_data, bias_data, dequantize_scales, opt);     
         }
@@ -608,14 +925,45 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
     if (top_blob.empty())
         return -100;    
 
-    if (use_winograd3x3 && outw >= 8 && outh >=8)
+    int impl = 0;
+    if (use_winograd3x3 && outw >= 8 && outh >= 8)
+        impl = winograd3x3_select_tile(outw, outh, !weight_3x3_winograd43_data.empty(), !weight_3x3_winograd63_data.empty());
+
+    if (opt.autotuner)
+        impl = autotune_impl(bottom_blob_bordered, top_blob, opt);
+
+    // the sgemm sums an unpacked residual in its epilogue, after the convolution activation would be too late
+    if (impl == 0 && !residual_blob.empty() && activation_type == 0 && residual_blob.elempack == 1 && residual_blob.elemsize == elemsize
+        && residual_blob.w == outw && residual_blob.h == outh && residual_blob.c == num_output)
     {
-        conv3x3s1_winograd23_sse(bottom_blob_bordered, top_blob, weight_3x3_winograd23_data, bias_data, opt);
-//         conv3x3s1_winograd43_sse(bottom_blob_bordered, top_blob, weight_3x3_winograd43_data, bias_data, opt);
+        conv_im2col_sgemm_sse(bottom_blob_bordered, top_blob, weight_sgemm_data, bias_data, residual_blob, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, residual_activation_type, residual_activation_params, opt);
+
+        residual_fused = true;
+        return 0;
     }
+
+    return forward_impl(impl, bottom_blob_bordered, top_blob, opt);
+}
+
+int Convolution_x86::forward_impl(int impl, const Mat& bottom_blob_bordered, Mat& top_blob, const Option& opt) const
+{
+    if (impl == 0)
+    {
+        // the sgemm applies bias and activation itself
+        conv_im2col_sgemm_sse(bottom_blob_bordered, top_blob, weight_sgemm_data, bias_data, Mat(), kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, activation_type, activation_params, opt);
+
+        return 0;
+    }
+
+#if __AVX__
+    if (impl == 6)
+        conv3x3s1_winograd63_avx(bottom_blob_bordered, top_blob, weight_3x3_winograd63_data, bias_data, opt);
+    else
+#endif
+    if (impl == 4)
+        conv3x3s1_winograd43_sse(bottom_blob_bordered, top_blob, weight_3x3_winograd43_data, bias_data, opt);
     else
-        //conv(bottom_blob_bordered, top_blob, weight_data, bias_data, opt);
-        conv_im2col_sgemm_sse(bottom_blob_bordered, top_blob, weight_sgemm_data, bias_data, kernel_w, kernel_h, stride_w, stride_h, opt);
+        conv3x3s1_winograd23_sse(bottom_blob_bordered, top_blob, weight_3x3_winograd23_data, bias_data, opt);
 
     if (activation)
     {
@@ -625,4 +973,170 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
     return 0;
 }
 
+int Convolution_x86::autotune_impl(const Mat& bottom_blob_bordered, Mat& top_blob, const Option& opt) const
+{
+    int candidates[4];
+    int candidate_count = 0;
+
+    candidates[candidate_count++] = 0;
+
+    if (use_winograd3x3 && top_blob.w >= 8 && top_blob.h >= 8)
+    {
+        candidates[candidate_count++] = 2;
+
+        if (!weight_3x3_winograd43_data.empty())
+            candidates[candidate_count++] = 4;
+
+        if (!weight_3x3_winograd63_data.empty())
+            candidates[candidate_count++] = 6;
+    }
+
+    if (candidate_count == 1)
+        return candidates[0];
+
+    char signature[256];
+    sprintf(signature, "%d_%s,%dx%d,s%dx%d,d%dx%d,%d,%d", typeindex, isa_tag, kernel_w, kernel_h, stride_w, stride_h, dilation_w, dilation_h, bottom_blob_bordered.c, num_output);
+
+    const std::string key = AutoTuner::make_key(signature, bottom_blob_bordered, opt.num_threads);
+
+    // a record from another build may name an impl this one lacks
+    int impl = opt.autotuner->find(key);
+    for (int i=0; i<candidate_count; i++)
+    {
+        if (candidates[i] == impl)
+            return impl;
+    }
+
+    double best_time = 0;
+    for (int i=0; i<candidate_count; i++)
+    {
+        // warm up the caches and the allocator first
+        forward_impl(candidates[i], bottom_blob_bordered, top_blob, opt);
+
+        double time = 0;
+        for (int j=0; j<opt.autotuner->repeat; j++)
+        {
+            double start = get_current_time();
+
+            forward_impl(candidates[i], bottom_blob_bordered, top_blob, opt);
+
+            double end = get_current_time();
+
+            if (j == 0 || end - start < time)
+                time = end - start;
+        }
+
+        if (i == 0 || time < best_time)
+        {
+            best_time = time;
+            impl = candidates[i];
+        }
+    }
+
+    opt.autotuner->insert(key, impl);
+
+    return impl;
+}
+
+int Convolution_x86::forward_packed(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+#if __SSE2__
+#if __AVX__
+    const int packn = 8;
+#else
+    const int packn = 4;
+#endif
+    const int maxk = kernel_w * kernel_h;
+    const int num_input = weight_data_size / maxk / num_output;
+
+    const int elempack = num_input % packn == 0 ? packn : 1;
+    const int out_elempack = num_output % packn == 0 ? packn : 1;
+
+    // feed the layout the packed weights expect
+    Mat bottom_blob_packed = bottom_blob;
+    if (bottom_blob.elempack != elempack)
+    {
+        Option opt_p = opt;
+        opt_p.blob_allocator = opt.workspace_allocator;
+        convert_packing(bottom_blob, bottom_blob_packed, elempack, opt_p);
+        if (bottom_blob_packed.empty())
+            return -100;
+    }
+
+    int w = bottom_blob_packed.w;
+    int h = bottom_blob_packed.h;
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+
+    Mat bottom_blob_bordered = bottom_blob_packed;
+    if (pad_left > 0 || pad_right > 0 || pad_top > 0 || pad_bottom > 0)
+    {
+        Option opt_b = opt;
+        opt_b.blob_allocator = opt.workspace_allocator;
+        copy_make_border(bottom_blob_packed, bottom_blob_bordered, pad_top, pad_bottom, pad_left, pad_right, BORDER_CONSTANT, pad_value, opt_b);
+        if (bottom_blob_bordered.empty())
+            return -100;
+    }
+    else if ((pad_left == -233 && pad_right == -233 && pad_top == -233 && pad_bottom == -233)
+             || (pad_left == -234 && pad_right == -234 && pad_top == -234 && pad_bottom == -234))
+    {
+        int wpad = kernel_extent_w + (w - 1) / stride_w * stride_w - w;
+        int hpad = kernel_extent_h + (h - 1) / stride_h * stride_h - h;
+        if (wpad > 0 || hpad > 0)
+        {
+            Option opt_b = opt;
+            opt_b.blob_allocator = opt.workspace_allocator;
+            if (pad_left == -233)
+                copy_make_border(bottom_blob_packed, bottom_blob_bordered, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, BORDER_CONSTANT, pad_value, opt_b);
+            else
+                copy_make_border(bottom_blob_packed, bottom_blob_bordered, hpad - hpad / 2, hpad / 2, wpad - wpad / 2, wpad / 2, BORDER_CONSTANT, pad_value, opt_b);
+            if (bottom_blob_bordered.empty())
+                return -100;
+        }
+    }
+
+    w = bottom_blob_bordered.w;
+    h = bottom_blob_bordered.h;
+
+    int outw = (w - kernel_extent_w) / stride_w + 1;
+    int outh = (h - kernel_extent_h) / stride_h + 1;
+
+    top_blob.create(outw, outh, num_output / out_elempack, (size_t)4u * out_elempack, out_elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    const Mat bias = bias_term ? bias_data : Mat();
+
+    Mat bottom_blob_packed_bordered = bottom_blob_bordered;
+    Mat top_blob_packed = top_blob;
+    if (kernel_w == 1 && kernel_h == 1 && stride_w == 1 && stride_h == 1)
+    {
+        // 1x1s1 walks the whole plane as one row
+        bottom_blob_packed_bordered = bottom_blob_bordered.reshape(w * h, 1, bottom_blob_bordered.c);
+        top_blob_packed = top_blob.reshape(outw * outh, 1, top_blob.c);
+    }
+
+#if __AVX__
+    if (elempack == 8 && out_elempack == 8)
+        convolution_pack8_avx(bottom_blob_packed_bordered, top_blob_packed, weight_data_packed, bias, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, activation_type, activation_params, opt);
+    else if (elempack == 1 && out_elempack == 8)
+        convolution_pack1to8_avx(bottom_blob_packed_bordered, top_blob_packed, weight_data_packed, bias, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, activation_type, activation_params, opt);
+    else
+        convolution_pack8to1_avx(bottom_blob_packed_bordered, top_blob_packed, weight_data_packed, bias, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, activation_type, activation_params, opt);
+#else
+    if (elempack == 4 && out_elempack == 4)
+        convolution_pack4_sse(bottom_blob_packed_bordered, top_blob_packed, weight_data_packed, bias, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, activation_type, activation_params, opt);
+    else if (elempack == 1 && out_elempack == 4)
+        convolution_pack1to4_sse(bottom_blob_packed_bordered, top_blob_packed, weight_data_packed, bias, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, activation_type, activation_params, opt);
+    else
+        convolution_pack4to1_sse(bottom_blob_packed_bordered, top_blob_packed, weight_data_packed, bias, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, activation_type, activation_params, opt);
+#endif
+
+    return 0;
+#else
+    return Convolution::forward(bottom_blob, top_blob, opt);
+#endif // __SSE2__
+}
+
 } // namespace ncnn
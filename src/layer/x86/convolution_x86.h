@@ -19,8 +19,6 @@
 
 namespace ncnn {
 
-typedef void (*conv_func)(const Mat&, Mat&, const Mat&, const Mat&, const Option&);
-
 class Convolution_x86 : virtual public Convolution
 {
 public:
@@ -30,7 +28,25 @@ public:
     virtual int destroy_pipeline(const Option& opt);
 
     virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
-    virtual int forwardDilation(const Mat& bottom_blob, Mat &top_blob, conv_func conv, const Option& opt) const;
+
+    virtual int forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
+
+    virtual int add_residual(const Mat& residual_blob, Mat& top_blob, const Option& opt) const;
+
+    virtual int fuse_depthwise(const Layer* depthwise, const Option& opt);
+
+protected:
+    // depthwise output rows are computed into a cache sized tile and fed to the 1x1 sgemm
+    int forward_depthwise(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+
+    // residual_fused tells whether the residual was already summed in the gemm epilogue
+    int forward_residual(const Mat& bottom_blob, const Mat& residual_blob, Mat& top_blob, bool& residual_fused, const Option& opt) const;
+    int forward_packed(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+
+    // fp32 implementations, 0 = sgemm, 2 4 6 = winograd with that output tile
+    int forward_impl(int impl, const Mat& bottom_blob_bordered, Mat& top_blob, const Option& opt) const;
+    // the fastest implementation for this input from opt.autotuner, timed on a miss
+    int autotune_impl(const Mat& bottom_blob_bordered, Mat& top_blob, const Option& opt) const;
 
 public:
     Layer* activation;
@@ -38,6 +54,21 @@ public:
     Mat weight_3x3_winograd23_data;
     Mat weight_sgemm_data;
     std::vector<Mat> weight_3x3_winograd43_data;
+    Mat weight_3x3_winograd63_data;
+
+    // int8 gemm, 8 outch x 4 k blocks
+    Mat weight_sgemm_int8_data;
+
+    // packed layout
+    Mat weight_data_packed;
+
+    // pruned 1x1 weights in the compressed sparse rows of x86_sparse.h
+    Mat weight_sparse_data;
+    Mat weight_sparse_index;
+
+    // fused depthwise convolution without padding, and its padding
+    Layer* depthwise_op;
+    Layer* depthwise_padding;
 };
 
 } // namespace ncnn
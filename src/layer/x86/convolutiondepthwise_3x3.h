@@ -12,7 +12,10 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
-static void convdw3x3s1_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _kernel, const Mat& _bias, const Option& opt)
+// KxK depth-wise convolution at stride S with any dilation, bias and activation fused
+// each output row is vectorized across its columns
+template<int K, int S>
+static void convdw_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _kernel, const Mat& _bias, int dilation, int activation_type, const Mat& activation_params, const Option& opt)
 {
     int w = bottom_blob.w;
 
@@ -24,178 +27,184 @@ static void convdw3x3s1_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _k
     const float* kernel = _kernel;
     const float* bias = _bias;
 
+    // last input column a tap reads, relative to the first tap
+    const int kernel_extent = dilation * (K - 1);
+
     #pragma omp parallel for num_threads(opt.num_threads)
     for (int g=0; g<group; g++)
     {
-        Mat out = top_blob.channel(g);
+        float* outptr = top_blob.channel(g);
 
         const float bias0 = bias ? bias[g] : 0.f;
 
-        const float* kernel0 = kernel + g*9;
-
-        float* outptr = out;
-        float* outptr2 = outptr + outw;
+        const float* k0 = kernel + g * K * K;
 
         const float* img0 = bottom_blob.channel(g);
 
-        const float* r0 = img0;
-        const float* r1 = img0 + w;
-        const float* r2 = img0 + w*2;
-        const float* r3 = img0 + w*3;
-
-        const float* k0 = kernel0;
-        const float* k1 = kernel0 + 3;
-        const float* k2 = kernel0 + 6;
-
-        int i = 0;
-
-        for (; i+1 < outh; i+=2)
+#if __AVX__
+        __m256 _k_avx[K * K];
+        for (int k=0; k<K * K; k++)
+        {
+            _k_avx[k] = _mm256_set1_ps(k0[k]);
+        }
+        __m256 _bias_avx = _mm256_set1_ps(bias0);
+#endif // __AVX__
+#if __SSE2__
+        __m128 _k[K * K];
+        for (int k=0; k<K * K; k++)
         {
+            _k[k] = _mm_set1_ps(k0[k]);
+        }
+        __m128 _bias = _mm_set1_ps(bias0);
+#endif // __SSE2__
 
-            int remain = outw;
+        for (int i = 0; i < outh; i++)
+        {
+            const float* r0 = img0 + i * S * w;
 
-            for (; remain>0; remain--)
+            int j = 0;
+#if __AVX__
+            if (S == 1)
             {
-                float sum = bias0;
-                sum += r0[0] * k0[0];
-                sum += r0[1] * k0[1];
-                sum += r0[2] * k0[2];
-                sum += r1[0] * k1[0];
-                sum += r1[1] * k1[1];
-                sum += r1[2] * k1[2];
-                sum += r2[0] * k2[0];
-                sum += r2[1] * k2[1];
-                sum += r2[2] * k2[2];
-
-                float sum2 = bias0;
-                sum2 += r1[0] * k0[0];
-                sum2 += r1[1] * k0[1];
-                sum2 += r1[2] * k0[2];
-                sum2 += r2[0] * k1[0];
-                sum2 += r2[1] * k1[1];
-                sum2 += r2[2] * k1[2];
-                sum2 += r3[0] * k2[0];
-                sum2 += r3[1] * k2[1];
-                sum2 += r3[2] * k2[2];
-
-                *outptr = sum;
-                *outptr2 = sum2;
-
-                r0++;
-                r1++;
-                r2++;
-                r3++;
-                outptr++;
-                outptr2++;
+                for (; j+7<outw; j+=8)
+                {
+                    __m256 _sum = _bias_avx;
+
+                    for (int y=0; y<K; y++)
+                    {
+                        const float* sptr = r0 + y * dilation * w + j;
+
+                        for (int x=0; x<K; x++)
+                        {
+                            _sum = _mm256_fmadd_ps(_mm256_loadu_ps(sptr + x * dilation), _k_avx[y * K + x], _sum);
+                        }
+                    }
+
+                    _mm256_storeu_ps(outptr + j, activation_avx(_sum, activation_type, activation_params));
+                }
             }
+#if __AVX2__
+            if (S == 2)
+            {
+                // even columns come out of the in-lane shuffle as 0 1 4 5 2 3 6 7, put them in order once after the sum
+                // the loads read one column past the last tap, keep them inside the row
+                for (; j+7<outw && j * 2 + 16 + kernel_extent <= w; j+=8)
+                {
+                    __m256 _sum = _bias_avx;
+
+                    for (int y=0; y<K; y++)
+                    {
+                        const float* sptr = r0 + y * dilation * w + j * 2;
+
+                        int x = 0;
+                        if (dilation == 1)
+                        {
+                            // odd columns of one load pair are the even columns of the next tap
+                            for (; x+1<K; x+=2)
+                            {
+                                __m256 _a = _mm256_loadu_ps(sptr + x);
+                                __m256 _b = _mm256_loadu_ps(sptr + x + 8);
+                                _sum = _mm256_fmadd_ps(_mm256_shuffle_ps(_a, _b, _MM_SHUFFLE(2, 0, 2, 0)), _k_avx[y * K + x], _sum);
+                                _sum = _mm256_fmadd_ps(_mm256_shuffle_ps(_a, _b, _MM_SHUFFLE(3, 1, 3, 1)), _k_avx[y * K + x + 1], _sum);
+                            }
+                        }
+                        for (; x<K; x++)
+                        {
+                            __m256 _a = _mm256_loadu_ps(sptr + x * dilation);
+                            __m256 _b = _mm256_loadu_ps(sptr + x * dilation + 8);
+                            _sum = _mm256_fmadd_ps(_mm256_shuffle_ps(_a, _b, _MM_SHUFFLE(2, 0, 2, 0)), _k_avx[y * K + x], _sum);
+                        }
+                    }
+
+                    // the bias is the same in every lane
+                    _sum = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_sum), _MM_SHUFFLE(3, 1, 2, 0)));
+
+                    _mm256_storeu_ps(outptr + j, activation_avx(_sum, activation_type, activation_params));
+                }
+            }
+#endif // __AVX2__
+#endif // __AVX__
+#if __SSE2__
+            if (S == 1)
+            {
+                for (; j+3<outw; j+=4)
+                {
+                    __m128 _sum = _bias;
+
+                    for (int y=0; y<K; y++)
+                    {
+                        const float* sptr = r0 + y * dilation * w + j;
+
+                        for (int x=0; x<K; x++)
+                        {
+                            _sum = _mm_add_ps(_sum, _mm_mul_ps(_mm_loadu_ps(sptr + x * dilation), _k[y * K + x]));
+                        }
+                    }
+
+                    _mm_storeu_ps(outptr + j, activation_sse(_sum, activation_type, activation_params));
+                }
+            }
+            if (S == 2)
+            {
+                for (; j+3<outw && j * 2 + 8 + kernel_extent <= w; j+=4)
+                {
+                    __m128 _sum = _bias;
+
+                    for (int y=0; y<K; y++)
+                    {
+                        const float* sptr = r0 + y * dilation * w + j * 2;
+
+                        int x = 0;
+                        if (dilation == 1)
+                        {
+                            for (; x+1<K; x+=2)
+                            {
+                                __m128 _a = _mm_loadu_ps(sptr + x);
+                                __m128 _b = _mm_loadu_ps(sptr + x + 4);
+                                _sum = _mm_add_ps(_sum, _mm_mul_ps(_mm_shuffle_ps(_a, _b, _MM_SHUFFLE(2, 0, 2, 0)), _k[y * K + x]));
+                                _sum = _mm_add_ps(_sum, _mm_mul_ps(_mm_shuffle_ps(_a, _b, _MM_SHUFFLE(3, 1, 3, 1)), _k[y * K + x + 1]));
+                            }
+                        }
+                        for (; x<K; x++)
+                        {
+                            __m128 _a = _mm_loadu_ps(sptr + x * dilation);
+                            __m128 _b = _mm_loadu_ps(sptr + x * dilation + 4);
+                            _sum = _mm_add_ps(_sum, _mm_mul_ps(_mm_shuffle_ps(_a, _b, _MM_SHUFFLE(2, 0, 2, 0)), _k[y * K + x]));
+                        }
+                    }
+
+                    _mm_storeu_ps(outptr + j, activation_sse(_sum, activation_type, activation_params));
+                }
+            }
+#endif // __SSE2__
+            for (; j<outw; j++)
+            {
+                float sum = bias0;
 
-            r0 += 2 + w;
-            r1 += 2 + w;
-            r2 += 2 + w;
-            r3 += 2 + w;
-
-            outptr += outw;
-            outptr2 += outw;
-        }
+                for (int y=0; y<K; y++)
+                {
+                    const float* sptr = r0 + y * dilation * w + j * S;
 
-        for (; i < outh; i++)
-        {
-            int remain = outw;
+                    for (int x=0; x<K; x++)
+                    {
+                        sum += sptr[x * dilation] * k0[y * K + x];
+                    }
+                }
 
-            for (; remain>0; remain--)
-            {
-                float sum = bias0;
-                sum += r0[0] * k0[0];
-                sum += r0[1] * k0[1];
-                sum += r0[2] * k0[2];
-                sum += r1[0] * k1[0];
-                sum += r1[1] * k1[1];
-                sum += r1[2] * k1[2];
-                sum += r2[0] * k2[0];
-                sum += r2[1] * k2[1];
-                sum += r2[2] * k2[2];
-
-                *outptr = sum;
-
-                r0++;
-                r1++;
-                r2++;
-                outptr++;
+                outptr[j] = activation_ss(sum, activation_type, activation_params);
             }
 
-            r0 += 2;
-            r1 += 2;
-            r2 += 2;
+            outptr += outw;
         }
     }
 }
 
-static void convdw3x3s2_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _kernel, const Mat& _bias, const Option& opt)
+static void convdw3x3s1_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _kernel, const Mat& _bias, int dilation, int activation_type, const Mat& activation_params, const Option& opt)
 {
-    int w = bottom_blob.w;
-
-    int outw = top_blob.w;
-    int outh = top_blob.h;
-
-    const int group = bottom_blob.c;
-
-    const int tailstep = w - 2*outw + w;
-
-    const float* kernel = _kernel;
-    const float* bias = _bias;
-
-    #pragma omp parallel for num_threads(opt.num_threads)
-    for (int g=0; g<group; g++)
-    {
-        Mat out = top_blob.channel(g);
-
-        const float bias0 = bias ? bias[g] : 0.f;
-
-        const float* kernel0 = kernel + g*9;
-
-        float* outptr = out;
-
-        const float* img0 = bottom_blob.channel(g);
-
-        const float* r0 = img0;
-        const float* r1 = img0 + w;
-        const float* r2 = img0 + w*2;
-
-        const float* k0 = kernel0;
-        const float* k1 = kernel0 + 3;
-        const float* k2 = kernel0 + 6;
-
-        int i = 0;
-
-        for (; i < outh; i++)
-        {
-            int remain = outw;
-
-            for (; remain>0; remain--)
-            {
-                float sum = bias0;
-                sum += r0[0] * k0[0];
-                sum += r0[1] * k0[1];
-                sum += r0[2] * k0[2];
-                sum += r1[0] * k1[0];
-                sum += r1[1] * k1[1];
-                sum += r1[2] * k1[2];
-                sum += r2[0] * k2[0];
-                sum += r2[1] * k2[1];
-                sum += r2[2] * k2[2];
-
-                *outptr = sum;
-
-                r0 += 2;
-                r1 += 2;
-                r2 += 2;
-                outptr++;
-            }
-
-            r0 += tailstep;
-            r1 += tailstep;
-            r2 += tailstep;
-        }
+    convdw_sse<3, 1>(bottom_blob, top_blob, _kernel, _bias, dilation, activation_type, activation_params, opt);
+}
 
-    }
+static void convdw3x3s2_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _kernel, const Mat& _bias, int dilation, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    convdw_sse<3, 2>(bottom_blob, top_blob, _kernel, _bias, dilation, activation_type, activation_params, opt);
 }
@@ -0,0 +1,23 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+static void convdw5x5s1_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _kernel, const Mat& _bias, int dilation, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    convdw_sse<5, 1>(bottom_blob, top_blob, _kernel, _bias, dilation, activation_type, activation_params, opt);
+}
+
+static void convdw5x5s2_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _kernel, const Mat& _bias, int dilation, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    convdw_sse<5, 2>(bottom_blob, top_blob, _kernel, _bias, dilation, activation_type, activation_params, opt);
+}
@@ -0,0 +1,101 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+static void convdw_pack8_avx(const Mat& bottom_blob, Mat& top_blob, const Mat& weight_data_packed, const Mat& bias_data, int kernel_w, int kernel_h, int dilation_w, int dilation_h, int stride_w, int stride_h, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    int w = bottom_blob.w;
+    int channels = bottom_blob.c;
+
+    int outw = top_blob.w;
+    int outh = top_blob.h;
+
+    const int maxk = kernel_w * kernel_h;
+
+    // kernel offsets
+    std::vector<int> _space_ofs(maxk);
+    int* space_ofs = &_space_ofs[0];
+    {
+        int p1 = 0;
+        int p2 = 0;
+        int gap = w * dilation_h - kernel_w * dilation_w;
+        for (int i = 0; i < kernel_h; i++)
+        {
+            for (int j = 0; j < kernel_w; j++)
+            {
+                space_ofs[p1] = p2;
+                p1++;
+                p2 += dilation_w;
+            }
+            p2 += gap;
+        }
+    }
+
+    const float* bias_data_ptr = bias_data;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int g=0; g<channels; g++)
+    {
+        float* outptr = top_blob.channel(g);
+        const float* kptr = weight_data_packed.row(g);
+        const Mat m = bottom_blob.channel(g);
+
+        const __m256 _bias = bias_data_ptr ? _mm256_loadu_ps(bias_data_ptr + g * 8) : _mm256_setzero_ps();
+
+        for (int i = 0; i < outh; i++)
+        {
+            int j = 0;
+            for (; j+3 < outw; j+=4)
+            {
+                // four outputs share every kernel load and keep independent accumulators
+                const float* sptr = m.row(i*stride_h) + j*stride_w * 8;
+
+                __m256 _sum0 = _bias;
+                __m256 _sum1 = _bias;
+                __m256 _sum2 = _bias;
+                __m256 _sum3 = _bias;
+
+                for (int k = 0; k < maxk; k++)
+                {
+                    const float* s0 = sptr + space_ofs[k] * 8;
+                    __m256 _w = _mm256_loadu_ps(kptr + k * 8);
+
+                    _sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(s0), _w, _sum0);
+                    _sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(s0 + stride_w * 8), _w, _sum1);
+                    _sum2 = _mm256_fmadd_ps(_mm256_loadu_ps(s0 + stride_w * 16), _w, _sum2);
+                    _sum3 = _mm256_fmadd_ps(_mm256_loadu_ps(s0 + stride_w * 24), _w, _sum3);
+                }
+
+                _mm256_storeu_ps(outptr + j * 8, activation_avx(_sum0, activation_type, activation_params));
+                _mm256_storeu_ps(outptr + (j + 1) * 8, activation_avx(_sum1, activation_type, activation_params));
+                _mm256_storeu_ps(outptr + (j + 2) * 8, activation_avx(_sum2, activation_type, activation_params));
+                _mm256_storeu_ps(outptr + (j + 3) * 8, activation_avx(_sum3, activation_type, activation_params));
+            }
+            for (; j < outw; j++)
+            {
+                const float* sptr = m.row(i*stride_h) + j*stride_w * 8;
+
+                __m256 _sum = _bias;
+
+                for (int k = 0; k < maxk; k++)
+                {
+                    _sum = _mm256_fmadd_ps(_mm256_loadu_ps(sptr + space_ofs[k] * 8), _mm256_loadu_ps(kptr + k * 8), _sum);
+                }
+
+                _mm256_storeu_ps(outptr + j * 8, activation_avx(_sum, activation_type, activation_params));
+            }
+
+            outptr += outw * 8;
+        }
+    }
+}
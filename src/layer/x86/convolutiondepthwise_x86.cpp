@@ -18,18 +18,37 @@
 #include <omp.h>
 #endif
 
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+#if __AVX__
+#include <immintrin.h>
+#endif
+
 #include "layer_type.h"
+#include "x86_activation.h"
 
 namespace ncnn {
 
 #include "convolutiondepthwise_3x3.h"
+#include "convolutiondepthwise_5x5.h"
 
 #include "convolutiondepthwise_3x3_int8.h"
 
+#if __AVX__
+#include "convolutiondepthwise_pack8.h"
+#elif __SSE2__
+#include "convolutiondepthwise_pack4.h"
+#endif
+
 DEFINE_LAYER_CREATOR(ConvolutionDepthWise_x86)
 
 ConvolutionDepthWise_x86::ConvolutionDepthWise_x86()
 {
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+
     activation = 0;
 }
 
@@ -76,6 +95,37 @@ int ConvolutionDepthWise_x86::create_pipeline(const Option& opt)
     const int maxk = kernel_w * kernel_h;
     int channels = (weight_data_size / group) / maxk / (num_output / group) * group;
 
+    // only fp32 depth-wise takes the packed layout
+    support_packing = false;
+
+#if __SSE2__
+#if __AVX__
+    const int packn = 8;
+#else
+    const int packn = 4;
+#endif
+    if (opt.use_packing_layout && use_int8_inference == false && channels == group && group == num_output && channels % packn == 0)
+    {
+        // maxk-packn-group/packn
+        weight_data_packed.create(maxk * packn, group / packn);
+
+        for (int g=0; g<group; g+=packn)
+        {
+            float* g00 = weight_data_packed.row(g / packn);
+
+            for (int k=0; k<maxk; k++)
+            {
+                for (int i=0; i<packn; i++)
+                {
+                    *g00++ = weight_data[(g + i) * maxk + k];
+                }
+            }
+        }
+
+        support_packing = true;
+    }
+#endif // __SSE2__
+
     for (int i=0; i<(int)group_ops.size(); i++)
         delete group_ops[i];
 
@@ -84,14 +134,24 @@ int ConvolutionDepthWise_x86::create_pipeline(const Option& opt)
     if (channels == group && group == num_output)
     {
         // depth-wise specific
-        if (kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1)
+        if (use_int8_inference)
+        {
+            if (kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1)
+            {
+                if ((stride_w == 1 && stride_h == 1) || (stride_w == 2 && stride_h == 2))
+                {
+                    return 0;
+                }
+            }
+        }
+        else if (kernel_w == kernel_h && dilation_w == dilation_h && stride_w == stride_h)
         {
-            if ((stride_w == 1 && stride_h == 1) || (stride_w == 2 && stride_h == 2))
+            if ((kernel_w == 3 || kernel_w == 5) && (stride_w == 1 || stride_w == 2))
             {
                 return 0;
             }
         }
-    }    
+    }
 
     const int channels_g = channels / group;
     const int num_output_g = num_output / group;
@@ -153,7 +213,10 @@ int ConvolutionDepthWise_x86::create_pipeline(const Option& opt)
             op->load_model(ModelBinFromMatArray(weights));
         }
 
-        op->create_pipeline(opt);
+        // group ops run on plain channel slices
+        Option opt_g = opt;
+        opt_g.use_packing_layout = false;
+        op->create_pipeline(opt_g);
 
         group_ops[g] = op;
     }      
@@ -163,6 +226,8 @@ int ConvolutionDepthWise_x86::create_pipeline(const Option& opt)
 
 int ConvolutionDepthWise_x86::destroy_pipeline(const Option& opt)
 {
+    weight_data_packed.release();
+
     if (activation)
     {
         activation->destroy_pipeline(opt);
@@ -185,6 +250,11 @@ int ConvolutionDepthWise_x86::forward(const Mat& bottom_blob, Mat& top_blob, con
     // convolv with NxN kernel
     // value = value + bias
 
+    if (bottom_blob.elempack != 1)
+    {
+        return forward_packed(bottom_blob, top_blob, opt);
+    }
+
     int w = bottom_blob.w;
     int h = bottom_blob.h;
     int channels = bottom_blob.c;
@@ -444,23 +514,28 @@ int ConvolutionDepthWise_x86::forward(const Mat& bottom_blob, Mat& top_blob, con
     // depth-wise
     if (channels == group && group == num_output)
     {
-        if (kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1)
+        if (kernel_w == kernel_h && dilation_w == dilation_h && stride_w == stride_h)
         {
-            if (stride_w == 1 && stride_h == 1)
+            if (kernel_w == 3 && stride_w == 1)
+            {
+                convdw3x3s1_sse(bottom_blob_bordered, top_blob, weight_data, bias_data, dilation_w, activation_type, activation_params, opt);
+                return 0;
+            }
+            if (kernel_w == 3 && stride_w == 2)
             {
-                convdw3x3s1_sse(bottom_blob_bordered, top_blob, weight_data, bias_data, opt);
+                convdw3x3s2_sse(bottom_blob_bordered, top_blob, weight_data, bias_data, dilation_w, activation_type, activation_params, opt);
+                return 0;
             }
-            else if (stride_w == 2 && stride_h == 2)
+            if (kernel_w == 5 && stride_w == 1)
             {
-                convdw3x3s2_sse(bottom_blob_bordered, top_blob, weight_data, bias_data, opt);
+                convdw5x5s1_sse(bottom_blob_bordered, top_blob, weight_data, bias_data, dilation_w, activation_type, activation_params, opt);
+                return 0;
             }
-
-            if (activation)
+            if (kernel_w == 5 && stride_w == 2)
             {
-                activation->forward_inplace(top_blob, opt);
+                convdw5x5s2_sse(bottom_blob_bordered, top_blob, weight_data, bias_data, dilation_w, activation_type, activation_params, opt);
+                return 0;
             }
-
-            return 0;
         }
 
         #pragma omp parallel for num_threads(opt.num_threads)
@@ -512,4 +587,81 @@ int ConvolutionDepthWise_x86::forward(const Mat& bottom_blob, Mat& top_blob, con
     return 0;
 }
 
+int ConvolutionDepthWise_x86::forward_packed(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+#if __SSE2__
+    const int elempack = bottom_blob.elempack;
+
+    if (weight_data_packed.empty() || bottom_blob.c * elempack != group || weight_data_packed.w != kernel_w * kernel_h * elempack)
+    {
+        // layout the packed weights do not cover
+        Mat bottom_blob_unpacked;
+        Option opt_p = opt;
+        opt_p.blob_allocator = opt.workspace_allocator;
+        convert_packing(bottom_blob, bottom_blob_unpacked, 1, opt_p);
+        if (bottom_blob_unpacked.empty())
+            return -100;
+
+        return forward(bottom_blob_unpacked, top_blob, opt);
+    }
+
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int channels = bottom_blob.c;
+    size_t elemsize = bottom_blob.elemsize;
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+
+    Mat bottom_blob_bordered = bottom_blob;
+    if (pad_left > 0 || pad_right > 0 || pad_top > 0 || pad_bottom > 0)
+    {
+        Option opt_b = opt;
+        opt_b.blob_allocator = opt.workspace_allocator;
+        copy_make_border(bottom_blob, bottom_blob_bordered, pad_top, pad_bottom, pad_left, pad_right, BORDER_CONSTANT, pad_value, opt_b);
+        if (bottom_blob_bordered.empty())
+            return -100;
+    }
+    else if ((pad_left == -233 && pad_right == -233 && pad_top == -233 && pad_bottom == -233)
+             || (pad_left == -234 && pad_right == -234 && pad_top == -234 && pad_bottom == -234))
+    {
+        int wpad = kernel_extent_w + (w - 1) / stride_w * stride_w - w;
+        int hpad = kernel_extent_h + (h - 1) / stride_h * stride_h - h;
+        if (wpad > 0 || hpad > 0)
+        {
+            Option opt_b = opt;
+            opt_b.blob_allocator = opt.workspace_allocator;
+            if (pad_left == -233)
+                copy_make_border(bottom_blob, bottom_blob_bordered, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, BORDER_CONSTANT, pad_value, opt_b);
+            else
+                copy_make_border(bottom_blob, bottom_blob_bordered, hpad - hpad / 2, hpad / 2, wpad - wpad / 2, wpad / 2, BORDER_CONSTANT, pad_value, opt_b);
+            if (bottom_blob_bordered.empty())
+                return -100;
+        }
+    }
+
+    w = bottom_blob_bordered.w;
+    h = bottom_blob_bordered.h;
+
+    int outw = (w - kernel_extent_w) / stride_w + 1;
+    int outh = (h - kernel_extent_h) / stride_h + 1;
+
+    top_blob.create(outw, outh, channels, elemsize, elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    const Mat bias = bias_term ? bias_data : Mat();
+
+#if __AVX__
+    convdw_pack8_avx(bottom_blob_bordered, top_blob, weight_data_packed, bias, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, activation_type, activation_params, opt);
+#else
+    convdw_pack4_sse(bottom_blob_bordered, top_blob, weight_data_packed, bias, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, activation_type, activation_params, opt);
+#endif
+
+    return 0;
+#else
+    return ConvolutionDepthWise::forward(bottom_blob, top_blob, opt);
+#endif // __SSE2__
+}
+
 } // namespace ncnn
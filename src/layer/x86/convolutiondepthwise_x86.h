@@ -29,9 +29,15 @@ public:
 
     virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
 
+protected:
+    int forward_packed(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+
 public:
     Layer* activation;
     std::vector<ncnn::Layer*> group_ops;
+
+    // packed layout
+    Mat weight_data_packed;
 };
 
 } // namespace ncnn
@@ -0,0 +1,433 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// stride 2 deconvolution computed per output pixel
+//
+// the output splits into 2x2 phases, output (2*iy+ry, 2*ix+rx) only receives
+// input (iy-ty, ix-tx) through weight (ry+2*ty, rx+2*tx), so every output row
+// is a short dense convolution over the input and each vector of input feeds
+// both horizontal phases, written back interleaved without any scatter
+//
+// bottom_blob is expected to be bordered by (K+1)/2-1 zeros on each side
+
+static void deconv_s2_transform_kernel_sse(const Mat& _kernel, Mat& kernel_tm, int inch, int outch, int maxk)
+{
+    const float* kernel = _kernel;
+
+    // kernel memory packed 4 x maxk
+    kernel_tm.create(4*maxk*inch, outch/4 + outch%4);
+
+    int nn_outch = outch >> 2;
+    int remain_outch_start = nn_outch << 2;
+
+    for (int pp=0; pp<nn_outch; pp++)
+    {
+        int p = pp * 4;
+
+        const float* k0 = kernel + (p+0)*inch*maxk;
+        const float* k1 = kernel + (p+1)*inch*maxk;
+        const float* k2 = kernel + (p+2)*inch*maxk;
+        const float* k3 = kernel + (p+3)*inch*maxk;
+
+        float* ktmp = kernel_tm.row(pp);
+
+        for (int q=0; q<inch*maxk; q++)
+        {
+            ktmp[0] = k0[q];
+            ktmp[1] = k1[q];
+            ktmp[2] = k2[q];
+            ktmp[3] = k3[q];
+            ktmp += 4;
+        }
+    }
+
+    for (int p=remain_outch_start; p<outch; p++)
+    {
+        const float* k0 = kernel + p*inch*maxk;
+
+        float* ktmp = kernel_tm.row(p/4 + p%4);
+
+        for (int q=0; q<inch*maxk; q++)
+        {
+            ktmp[q] = k0[q];
+        }
+    }
+}
+
+template<int K>
+static void deconv_s2_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, const Mat& _bias, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    const int P = (K + 1) / 2 - 1;
+    const int maxk = K * K;
+
+    int inch = bottom_blob.c;
+
+    int outw = top_blob.w;
+    int outh = top_blob.h;
+    int outch = top_blob.c;
+
+    // columns where both horizontal phases are inside the output
+    const int nj = outw / 2;
+
+    const float* bias = _bias;
+
+    int nn_outch = outch >> 2;
+    int remain_outch_start = nn_outch << 2;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int pp=0; pp<nn_outch; pp++)
+    {
+        int p = pp * 4;
+
+        float* outptr0 = top_blob.channel(p);
+        float* outptr1 = top_blob.channel(p+1);
+        float* outptr2 = top_blob.channel(p+2);
+        float* outptr3 = top_blob.channel(p+3);
+
+        const float bias0 = bias ? bias[p] : 0.f;
+        const float bias1 = bias ? bias[p+1] : 0.f;
+        const float bias2 = bias ? bias[p+2] : 0.f;
+        const float bias3 = bias ? bias[p+3] : 0.f;
+
+        const float* ktm = kernel_tm.row(pp);
+
+        for (int oy=0; oy<outh; oy++)
+        {
+            const int ry = oy & 1;
+            const int iy = oy >> 1;
+            const int nty = (K - ry + 1) / 2;
+
+            int j = 0;
+#if __AVX__
+            for (; j+7<nj; j+=8)
+            {
+                __m256 _s00 = _mm256_set1_ps(bias0);
+                __m256 _s01 = _mm256_set1_ps(bias0);
+                __m256 _s10 = _mm256_set1_ps(bias1);
+                __m256 _s11 = _mm256_set1_ps(bias1);
+                __m256 _s20 = _mm256_set1_ps(bias2);
+                __m256 _s21 = _mm256_set1_ps(bias2);
+                __m256 _s30 = _mm256_set1_ps(bias3);
+                __m256 _s31 = _mm256_set1_ps(bias3);
+
+                for (int q=0; q<inch; q++)
+                {
+                    const Mat img = bottom_blob.channel(q);
+                    const float* kq = ktm + q * maxk * 4;
+
+                    for (int ty=0; ty<nty; ty++)
+                    {
+                        const float* r = img.row(iy + P - ty) + j + P;
+                        const float* kk = kq + (ry + 2 * ty) * K * 4;
+
+                        for (int tx=0; tx<(K+1)/2; tx++)
+                        {
+                            __m256 _r = _mm256_loadu_ps(r - tx);
+
+                            const float* k0 = kk + (2 * tx) * 4;
+                            _s00 = _mm256_fmadd_ps(_r, _mm256_broadcast_ss(k0), _s00);
+                            _s10 = _mm256_fmadd_ps(_r, _mm256_broadcast_ss(k0 + 1), _s10);
+                            _s20 = _mm256_fmadd_ps(_r, _mm256_broadcast_ss(k0 + 2), _s20);
+                            _s30 = _mm256_fmadd_ps(_r, _mm256_broadcast_ss(k0 + 3), _s30);
+
+                            if (2 * tx + 1 < K)
+                            {
+                                const float* k1 = k0 + 4;
+                                _s01 = _mm256_fmadd_ps(_r, _mm256_broadcast_ss(k1), _s01);
+                                _s11 = _mm256_fmadd_ps(_r, _mm256_broadcast_ss(k1 + 1), _s11);
+                                _s21 = _mm256_fmadd_ps(_r, _mm256_broadcast_ss(k1 + 2), _s21);
+                                _s31 = _mm256_fmadd_ps(_r, _mm256_broadcast_ss(k1 + 3), _s31);
+                            }
+                        }
+                    }
+                }
+
+                _s00 = activation_avx(_s00, activation_type, activation_params);
+                _s01 = activation_avx(_s01, activation_type, activation_params);
+                _s10 = activation_avx(_s10, activation_type, activation_params);
+                _s11 = activation_avx(_s11, activation_type, activation_params);
+                _s20 = activation_avx(_s20, activation_type, activation_params);
+                _s21 = activation_avx(_s21, activation_type, activation_params);
+                _s30 = activation_avx(_s30, activation_type, activation_params);
+                _s31 = activation_avx(_s31, activation_type, activation_params);
+
+                // interleave the two phases
+                __m256 _lo0 = _mm256_unpacklo_ps(_s00, _s01);
+                __m256 _hi0 = _mm256_unpackhi_ps(_s00, _s01);
+                __m256 _lo1 = _mm256_unpacklo_ps(_s10, _s11);
+                __m256 _hi1 = _mm256_unpackhi_ps(_s10, _s11);
+                __m256 _lo2 = _mm256_unpacklo_ps(_s20, _s21);
+                __m256 _hi2 = _mm256_unpackhi_ps(_s20, _s21);
+                __m256 _lo3 = _mm256_unpacklo_ps(_s30, _s31);
+                __m256 _hi3 = _mm256_unpackhi_ps(_s30, _s31);
+
+                _mm256_storeu_ps(outptr0 + 2 * j, _mm256_permute2f128_ps(_lo0, _hi0, 0x20));
+                _mm256_storeu_ps(outptr0 + 2 * j + 8, _mm256_permute2f128_ps(_lo0, _hi0, 0x31));
+                _mm256_storeu_ps(outptr1 + 2 * j, _mm256_permute2f128_ps(_lo1, _hi1, 0x20));
+                _mm256_storeu_ps(outptr1 + 2 * j + 8, _mm256_permute2f128_ps(_lo1, _hi1, 0x31));
+                _mm256_storeu_ps(outptr2 + 2 * j, _mm256_permute2f128_ps(_lo2, _hi2, 0x20));
+                _mm256_storeu_ps(outptr2 + 2 * j + 8, _mm256_permute2f128_ps(_lo2, _hi2, 0x31));
+                _mm256_storeu_ps(outptr3 + 2 * j, _mm256_permute2f128_ps(_lo3, _hi3, 0x20));
+                _mm256_storeu_ps(outptr3 + 2 * j + 8, _mm256_permute2f128_ps(_lo3, _hi3, 0x31));
+            }
+#endif // __AVX__
+#if __SSE2__
+            for (; j+3<nj; j+=4)
+            {
+                __m128 _s00 = _mm_set1_ps(bias0);
+                __m128 _s01 = _mm_set1_ps(bias0);
+                __m128 _s10 = _mm_set1_ps(bias1);
+                __m128 _s11 = _mm_set1_ps(bias1);
+                __m128 _s20 = _mm_set1_ps(bias2);
+                __m128 _s21 = _mm_set1_ps(bias2);
+                __m128 _s30 = _mm_set1_ps(bias3);
+                __m128 _s31 = _mm_set1_ps(bias3);
+
+                for (int q=0; q<inch; q++)
+                {
+                    const Mat img = bottom_blob.channel(q);
+                    const float* kq = ktm + q * maxk * 4;
+
+                    for (int ty=0; ty<nty; ty++)
+                    {
+                        const float* r = img.row(iy + P - ty) + j + P;
+                        const float* kk = kq + (ry + 2 * ty) * K * 4;
+
+                        for (int tx=0; tx<(K+1)/2; tx++)
+                        {
+                            __m128 _r = _mm_loadu_ps(r - tx);
+
+                            const float* k0 = kk + (2 * tx) * 4;
+                            _s00 = _mm_add_ps(_s00, _mm_mul_ps(_r, _mm_load1_ps(k0)));
+                            _s10 = _mm_add_ps(_s10, _mm_mul_ps(_r, _mm_load1_ps(k0 + 1)));
+                            _s20 = _mm_add_ps(_s20, _mm_mul_ps(_r, _mm_load1_ps(k0 + 2)));
+                            _s30 = _mm_add_ps(_s30, _mm_mul_ps(_r, _mm_load1_ps(k0 + 3)));
+
+                            if (2 * tx + 1 < K)
+                            {
+                                const float* k1 = k0 + 4;
+                                _s01 = _mm_add_ps(_s01, _mm_mul_ps(_r, _mm_load1_ps(k1)));
+                                _s11 = _mm_add_ps(_s11, _mm_mul_ps(_r, _mm_load1_ps(k1 + 1)));
+                                _s21 = _mm_add_ps(_s21, _mm_mul_ps(_r, _mm_load1_ps(k1 + 2)));
+                                _s31 = _mm_add_ps(_s31, _mm_mul_ps(_r, _mm_load1_ps(k1 + 3)));
+                            }
+                        }
+                    }
+                }
+
+                _s00 = activation_sse(_s00, activation_type, activation_params);
+                _s01 = activation_sse(_s01, activation_type, activation_params);
+                _s10 = activation_sse(_s10, activation_type, activation_params);
+                _s11 = activation_sse(_s11, activation_type, activation_params);
+                _s20 = activation_sse(_s20, activation_type, activation_params);
+                _s21 = activation_sse(_s21, activation_type, activation_params);
+                _s30 = activation_sse(_s30, activation_type, activation_params);
+                _s31 = activation_sse(_s31, activation_type, activation_params);
+
+                // interleave the two phases
+                _mm_storeu_ps(outptr0 + 2 * j, _mm_unpacklo_ps(_s00, _s01));
+                _mm_storeu_ps(outptr0 + 2 * j + 4, _mm_unpackhi_ps(_s00, _s01));
+                _mm_storeu_ps(outptr1 + 2 * j, _mm_unpacklo_ps(_s10, _s11));
+                _mm_storeu_ps(outptr1 + 2 * j + 4, _mm_unpackhi_ps(_s10, _s11));
+                _mm_storeu_ps(outptr2 + 2 * j, _mm_unpacklo_ps(_s20, _s21));
+                _mm_storeu_ps(outptr2 + 2 * j + 4, _mm_unpackhi_ps(_s20, _s21));
+                _mm_storeu_ps(outptr3 + 2 * j, _mm_unpacklo_ps(_s30, _s31));
+                _mm_storeu_ps(outptr3 + 2 * j + 4, _mm_unpackhi_ps(_s30, _s31));
+            }
+#endif // __SSE2__
+            for (int ox=2*j; ox<outw; ox++)
+            {
+                const int rx = ox & 1;
+                const int ix = ox >> 1;
+                const int ntx = (K - rx + 1) / 2;
+
+                float sum0 = bias0;
+                float sum1 = bias1;
+                float sum2 = bias2;
+                float sum3 = bias3;
+
+                for (int q=0; q<inch; q++)
+                {
+                    const Mat img = bottom_blob.channel(q);
+                    const float* kq = ktm + q * maxk * 4;
+
+                    for (int ty=0; ty<nty; ty++)
+                    {
+                        const float* r = img.row(iy + P - ty) + ix + P;
+                        const float* kk = kq + (ry + 2 * ty) * K * 4;
+
+                        for (int tx=0; tx<ntx; tx++)
+                        {
+                            const float* k0 = kk + (rx + 2 * tx) * 4;
+                            sum0 += r[-tx] * k0[0];
+                            sum1 += r[-tx] * k0[1];
+                            sum2 += r[-tx] * k0[2];
+                            sum3 += r[-tx] * k0[3];
+                        }
+                    }
+                }
+
+                outptr0[ox] = activation_ss(sum0, activation_type, activation_params);
+                outptr1[ox] = activation_ss(sum1, activation_type, activation_params);
+                outptr2[ox] = activation_ss(sum2, activation_type, activation_params);
+                outptr3[ox] = activation_ss(sum3, activation_type, activation_params);
+            }
+
+            outptr0 += outw;
+            outptr1 += outw;
+            outptr2 += outw;
+            outptr3 += outw;
+        }
+    }
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p=remain_outch_start; p<outch; p++)
+    {
+        float* outptr = top_blob.channel(p);
+
+        const float bias0 = bias ? bias[p] : 0.f;
+
+        const float* ktm = kernel_tm.row(p/4 + p%4);
+
+        for (int oy=0; oy<outh; oy++)
+        {
+            const int ry = oy & 1;
+            const int iy = oy >> 1;
+            const int nty = (K - ry + 1) / 2;
+
+            int j = 0;
+#if __AVX__
+            for (; j+7<nj; j+=8)
+            {
+                __m256 _sum0 = _mm256_set1_ps(bias0);
+                __m256 _sum1 = _mm256_set1_ps(bias0);
+
+                for (int q=0; q<inch; q++)
+                {
+                    const Mat img = bottom_blob.channel(q);
+                    const float* kq = ktm + q * maxk;
+
+                    for (int ty=0; ty<nty; ty++)
+                    {
+                        const float* r = img.row(iy + P - ty) + j + P;
+                        const float* kk = kq + (ry + 2 * ty) * K;
+
+                        for (int tx=0; tx<(K+1)/2; tx++)
+                        {
+                            __m256 _r = _mm256_loadu_ps(r - tx);
+
+                            _sum0 = _mm256_fmadd_ps(_r, _mm256_broadcast_ss(kk + 2 * tx), _sum0);
+
+                            if (2 * tx + 1 < K)
+                            {
+                                _sum1 = _mm256_fmadd_ps(_r, _mm256_broadcast_ss(kk + 2 * tx + 1), _sum1);
+                            }
+                        }
+                    }
+                }
+
+                _sum0 = activation_avx(_sum0, activation_type, activation_params);
+                _sum1 = activation_avx(_sum1, activation_type, activation_params);
+
+                __m256 _lo = _mm256_unpacklo_ps(_sum0, _sum1);
+                __m256 _hi = _mm256_unpackhi_ps(_sum0, _sum1);
+
+                _mm256_storeu_ps(outptr + 2 * j, _mm256_permute2f128_ps(_lo, _hi, 0x20));
+                _mm256_storeu_ps(outptr + 2 * j + 8, _mm256_permute2f128_ps(_lo, _hi, 0x31));
+            }
+#endif // __AVX__
+#if __SSE2__
+            for (; j+3<nj; j+=4)
+            {
+                __m128 _sum0 = _mm_set1_ps(bias0);
+                __m128 _sum1 = _mm_set1_ps(bias0);
+
+                for (int q=0; q<inch; q++)
+                {
+                    const Mat img = bottom_blob.channel(q);
+                    const float* kq = ktm + q * maxk;
+
+                    for (int ty=0; ty<nty; ty++)
+                    {
+                        const float* r = img.row(iy + P - ty) + j + P;
+                        const float* kk = kq + (ry + 2 * ty) * K;
+
+                        for (int tx=0; tx<(K+1)/2; tx++)
+                        {
+                            __m128 _r = _mm_loadu_ps(r - tx);
+
+                            _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_r, _mm_load1_ps(kk + 2 * tx)));
+
+                            if (2 * tx + 1 < K)
+                            {
+                                _sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_r, _mm_load1_ps(kk + 2 * tx + 1)));
+                            }
+                        }
+                    }
+                }
+
+                _sum0 = activation_sse(_sum0, activation_type, activation_params);
+                _sum1 = activation_sse(_sum1, activation_type, activation_params);
+
+                _mm_storeu_ps(outptr + 2 * j, _mm_unpacklo_ps(_sum0, _sum1));
+                _mm_storeu_ps(outptr + 2 * j + 4, _mm_unpackhi_ps(_sum0, _sum1));
+            }
+#endif // __SSE2__
+            for (int ox=2*j; ox<outw; ox++)
+            {
+                const int rx = ox & 1;
+                const int ix = ox >> 1;
+                const int ntx = (K - rx + 1) / 2;
+
+                float sum = bias0;
+
+                for (int q=0; q<inch; q++)
+                {
+                    const Mat img = bottom_blob.channel(q);
+                    const float* kq = ktm + q * maxk;
+
+                    for (int ty=0; ty<nty; ty++)
+                    {
+                        const float* r = img.row(iy + P - ty) + ix + P;
+                        const float* kk = kq + (ry + 2 * ty) * K;
+
+                        for (int tx=0; tx<ntx; tx++)
+                        {
+                            sum += r[-tx] * kk[rx + 2 * tx];
+                        }
+                    }
+                }
+
+                outptr[ox] = activation_ss(sum, activation_type, activation_params);
+            }
+
+            outptr += outw;
+        }
+    }
+}
+
+static void deconv2x2s2_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, const Mat& _bias, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    deconv_s2_sse<2>(bottom_blob, top_blob, kernel_tm, _bias, activation_type, activation_params, opt);
+}
+
+static void deconv3x3s2_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, const Mat& _bias, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    deconv_s2_sse<3>(bottom_blob, top_blob, kernel_tm, _bias, activation_type, activation_params, opt);
+}
+
+static void deconv4x4s2_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, const Mat& _bias, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    deconv_s2_sse<4>(bottom_blob, top_blob, kernel_tm, _bias, activation_type, activation_params, opt);
+}
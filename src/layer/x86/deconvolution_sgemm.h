@@ -0,0 +1,165 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// deconvolution as one gemm producing the (outch*maxk) x (w*h) column matrix,
+// followed by col2im which accumulates the columns into the output planes
+
+static void deconv_sgemm_transform_kernel_sse(const Mat& _kernel, Mat& kernel_tm, int inch, int outch, int maxk, const Option& opt)
+{
+    const float* kernel = _kernel;
+
+    // rows are (outch, maxk) pairs over inch
+    const int M = outch * maxk;
+
+    Mat kernel_t(inch, M);
+    if (kernel_t.empty())
+        return;
+
+    for (int r=0; r<M; r++)
+    {
+        int p = r / maxk;
+        int k = r % maxk;
+
+        float* ktmp = kernel_t.row(r);
+
+        for (int q=0; q<inch; q++)
+        {
+            ktmp[q] = kernel[(p * inch + q) * maxk + k];
+        }
+    }
+
+    int w;
+    int h;
+    gemm_x86_packed_a_shape(M, inch, w, h);
+
+    kernel_tm.create(w, h);
+    if (kernel_tm.empty())
+        return;
+
+    gemm_x86_pack_a(kernel_t, inch, M, inch, kernel_tm, opt);
+}
+
+static void deconv_sgemm_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, const Mat& _bias, int kernel_w, int kernel_h, int dilation_w, int dilation_h, int stride_w, int stride_h, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int inch = bottom_blob.c;
+    size_t elemsize = bottom_blob.elemsize;
+
+    int outw = top_blob.w;
+    int outh = top_blob.h;
+    int outch = top_blob.c;
+
+    const int size = w * h;
+    const int maxk = kernel_w * kernel_h;
+    const int M = outch * maxk;
+
+    const float* bias = _bias;
+
+    int bw;
+    int bh;
+    gemm_x86_packed_b_shape(inch, size, bw, bh);
+
+    Mat bottom_tm(bw, bh, elemsize, opt.workspace_allocator);
+    if (bottom_tm.empty())
+        return;
+
+    gemm_x86_pack_b(bottom_blob, bottom_blob.cstep, inch, size, bottom_tm, opt);
+
+    // gemm
+    Mat top_col(size, M, elemsize, opt.workspace_allocator);
+    if (top_col.empty())
+        return;
+
+    gemm_x86(M, size, inch, kernel_tm, bottom_tm, top_col, size, 0, 0, 0, 0, 0, Mat(), opt);
+
+    bottom_tm.release();
+
+    // col2im
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p=0; p<outch; p++)
+    {
+        Mat out = top_blob.channel(p);
+
+        const float bias0 = bias ? bias[p] : 0.f;
+
+        out.fill(bias0);
+
+        for (int k=0; k<maxk; k++)
+        {
+            const int ky = k / kernel_w;
+            const int kx = k % kernel_w;
+
+            const float* colptr = top_col.row(p * maxk + k);
+
+            for (int i=0; i<h; i++)
+            {
+                float* outptr = out.row(i * stride_h + ky * dilation_h) + kx * dilation_w;
+
+                if (stride_w == 1)
+                {
+                    int j = 0;
+#if __AVX__
+                    for (; j+7<w; j+=8)
+                    {
+                        _mm256_storeu_ps(outptr + j, _mm256_add_ps(_mm256_loadu_ps(outptr + j), _mm256_loadu_ps(colptr + j)));
+                    }
+#endif // __AVX__
+#if __SSE2__
+                    for (; j+3<w; j+=4)
+                    {
+                        _mm_storeu_ps(outptr + j, _mm_add_ps(_mm_loadu_ps(outptr + j), _mm_loadu_ps(colptr + j)));
+                    }
+#endif // __SSE2__
+                    for (; j<w; j++)
+                    {
+                        outptr[j] += colptr[j];
+                    }
+                }
+                else
+                {
+                    for (int j=0; j<w; j++)
+                    {
+                        outptr[j * stride_w] += colptr[j];
+                    }
+                }
+
+                colptr += w;
+            }
+        }
+
+        if (activation_type)
+        {
+            float* outptr = out;
+
+            int i = 0;
+#if __AVX__
+            for (; i+7<outw*outh; i+=8)
+            {
+                _mm256_storeu_ps(outptr + i, activation_avx(_mm256_loadu_ps(outptr + i), activation_type, activation_params));
+            }
+#endif // __AVX__
+#if __SSE2__
+            for (; i+3<outw*outh; i+=4)
+            {
+                _mm_storeu_ps(outptr + i, activation_sse(_mm_loadu_ps(outptr + i), activation_type, activation_params));
+            }
+#endif // __SSE2__
+            for (; i<outw*outh; i++)
+            {
+                outptr[i] = activation_ss(outptr[i], activation_type, activation_params);
+            }
+        }
+    }
+}
@@ -0,0 +1,132 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "deconvolution_x86.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+#if __AVX__
+#include <immintrin.h>
+#endif
+
+#include "x86_activation.h"
+#include "x86_gemm.h"
+
+namespace ncnn {
+
+#include "deconvolution_s2.h"
+#include "deconvolution_sgemm.h"
+
+DEFINE_LAYER_CREATOR(Deconvolution_x86)
+
+Deconvolution_x86::Deconvolution_x86()
+{
+    s2_kernel_size = 0;
+}
+
+int Deconvolution_x86::create_pipeline(const Option& opt)
+{
+    const int maxk = kernel_w * kernel_h;
+    int num_input = weight_data_size / maxk / num_output;
+
+    s2_kernel_size = 0;
+
+    if (kernel_w == kernel_h && kernel_w >= 2 && kernel_w <= 4 && dilation_w == 1 && dilation_h == 1 && stride_w == 2 && stride_h == 2)
+    {
+        s2_kernel_size = kernel_w;
+
+        deconv_s2_transform_kernel_sse(weight_data, weight_s2_data, num_input, num_output, maxk);
+
+        return 0;
+    }
+
+    deconv_sgemm_transform_kernel_sse(weight_data, weight_sgemm_data, num_input, num_output, maxk, opt);
+
+    return 0;
+}
+
+int Deconvolution_x86::destroy_pipeline(const Option& /*opt*/)
+{
+    weight_s2_data.release();
+    weight_sgemm_data.release();
+
+    return 0;
+}
+
+int Deconvolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    // deconvolv with NxN kernel
+    // value = value + bias
+
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    size_t elemsize = bottom_blob.elemsize;
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+
+    int outw = (w - 1) * stride_w + kernel_extent_w;
+    int outh = (h - 1) * stride_h + kernel_extent_h;
+
+    Mat top_blob_bordered;
+    if (pad_left > 0 || pad_right > 0 || pad_top > 0 || pad_bottom > 0 || output_pad_right > 0 || output_pad_bottom > 0 || (output_w > 0 && output_h > 0))
+    {
+        top_blob_bordered.create(outw, outh, num_output, elemsize, opt.workspace_allocator);
+    }
+    else
+    {
+        top_blob_bordered = top_blob;
+        top_blob_bordered.create(outw, outh, num_output, elemsize, opt.blob_allocator);
+    }
+    if (top_blob_bordered.empty())
+        return -100;
+
+    if (s2_kernel_size)
+    {
+        // zero border so that every output phase reads a full input window
+        const int pad = (s2_kernel_size + 1) / 2 - 1;
+
+        Mat bottom_blob_bordered = bottom_blob;
+        if (pad > 0)
+        {
+            Option opt_b = opt;
+            opt_b.blob_allocator = opt.workspace_allocator;
+            copy_make_border(bottom_blob, bottom_blob_bordered, pad, pad, pad, pad, BORDER_CONSTANT, 0.f, opt_b);
+            if (bottom_blob_bordered.empty())
+                return -100;
+        }
+
+        if (s2_kernel_size == 2)
+        {
+            deconv2x2s2_sse(bottom_blob_bordered, top_blob_bordered, weight_s2_data, bias_data, activation_type, activation_params, opt);
+        }
+        else if (s2_kernel_size == 3)
+        {
+            deconv3x3s2_sse(bottom_blob_bordered, top_blob_bordered, weight_s2_data, bias_data, activation_type, activation_params, opt);
+        }
+        else // if (s2_kernel_size == 4)
+        {
+            deconv4x4s2_sse(bottom_blob_bordered, top_blob_bordered, weight_s2_data, bias_data, activation_type, activation_params, opt);
+        }
+    }
+    else
+    {
+        deconv_sgemm_sse(bottom_blob, top_blob_bordered, weight_sgemm_data, bias_data, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, activation_type, activation_params, opt);
+    }
+
+    return cut_padding(top_blob_bordered, top_blob, opt);
+}
+
+} // namespace ncnn
@@ -0,0 +1,308 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "deconvolutiondepthwise_x86.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+#if __AVX__
+#include <immintrin.h>
+#endif
+
+#include "layer_type.h"
+#include "x86_activation.h"
+
+namespace ncnn {
+
+#include "deconvolution_s2.h"
+
+DEFINE_LAYER_CREATOR(DeconvolutionDepthWise_x86)
+
+DeconvolutionDepthWise_x86::DeconvolutionDepthWise_x86()
+{
+}
+
+int DeconvolutionDepthWise_x86::create_pipeline(const Option& opt)
+{
+    // create Deconvolution op for each group
+    const int maxk = kernel_w * kernel_h;
+    int channels = (weight_data_size / group) / maxk / (num_output / group) * group;
+
+    for (int i=0; i<(int)group_ops.size(); i++)
+        delete group_ops[i];
+
+    group_ops.clear();
+
+    if (channels == group && group == num_output)
+    {
+        // depth-wise specific
+        return 0;
+    }
+
+    const int channels_g = channels / group;
+    const int num_output_g = num_output / group;
+
+    group_ops.resize(group);
+
+    for (int g=0; g<group; g++)
+    {
+        Mat weight_data_g = weight_data.range(maxk * channels_g * num_output_g * g, maxk * channels_g * num_output_g);
+        Mat bias_data_g;
+        if (bias_term)
+            bias_data_g = bias_data.range(num_output_g * g, num_output_g);
+
+        ncnn::Layer* op = ncnn::create_layer(ncnn::LayerType::Deconvolution);
+
+        // set param
+        ncnn::ParamDict pd;
+        pd.set(0, num_output_g);// num_output
+        pd.set(1, kernel_w);
+        pd.set(11, kernel_h);
+        pd.set(2, dilation_w);
+        pd.set(12, dilation_h);
+        pd.set(3, stride_w);
+        pd.set(13, stride_h);
+        pd.set(4, 0);// pad_w
+        pd.set(14, 0);// pad_h
+        pd.set(5, bias_term);
+        pd.set(6, maxk * channels_g * num_output_g);// weight_data_size
+        pd.set(9, activation_type);
+        pd.set(10, activation_params);
+
+        op->load_param(pd);
+
+        // set weights
+        ncnn::Mat weights[2];
+        weights[0] = weight_data_g;
+        weights[1] = bias_data_g;
+
+        op->load_model(ModelBinFromMatArray(weights));
+
+        op->create_pipeline(opt);
+
+        group_ops[g] = op;
+    }
+
+    return 0;
+}
+
+int DeconvolutionDepthWise_x86::destroy_pipeline(const Option& opt)
+{
+    for (int i=0; i<(int)group_ops.size(); i++)
+    {
+        group_ops[i]->destroy_pipeline(opt);
+        delete group_ops[i];
+    }
+    group_ops.clear();
+
+    return 0;
+}
+
+int DeconvolutionDepthWise_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    // deconvolv with NxN kernel
+    // value = value + bias
+
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int channels = bottom_blob.c;
+    size_t elemsize = bottom_blob.elemsize;
+
+    if (channels % group != 0 || num_output % group != 0)
+    {
+        // reject invalid group
+        return -100;
+    }
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+
+    int outw = (w - 1) * stride_w + kernel_extent_w;
+    int outh = (h - 1) * stride_h + kernel_extent_h;
+
+    Mat top_blob_bordered;
+    if (pad_left > 0 || pad_right > 0 || pad_top > 0 || pad_bottom > 0 || output_pad_right > 0 || output_pad_bottom > 0 || (output_w > 0 && output_h > 0))
+    {
+        top_blob_bordered.create(outw, outh, num_output, elemsize, opt.workspace_allocator);
+    }
+    else
+    {
+        top_blob_bordered = top_blob;
+        top_blob_bordered.create(outw, outh, num_output, elemsize, opt.blob_allocator);
+    }
+    if (top_blob_bordered.empty())
+        return -100;
+
+    const int maxk = kernel_w * kernel_h;
+
+    // depth-wise
+    if (channels == group && group == num_output)
+    {
+        if (kernel_w == kernel_h && kernel_w >= 2 && kernel_w <= 4 && dilation_w == 1 && dilation_h == 1 && stride_w == 2 && stride_h == 2)
+        {
+            // zero border so that every output phase reads a full input window
+            const int pad = (kernel_w + 1) / 2 - 1;
+
+            Mat bottom_blob_bordered = bottom_blob;
+            if (pad > 0)
+            {
+                Option opt_b = opt;
+                opt_b.blob_allocator = opt.workspace_allocator;
+                copy_make_border(bottom_blob, bottom_blob_bordered, pad, pad, pad, pad, BORDER_CONSTANT, 0.f, opt_b);
+                if (bottom_blob_bordered.empty())
+                    return -100;
+            }
+
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int g=0; g<group; g++)
+            {
+                const Mat bottom_blob_bordered_g = bottom_blob_bordered.channel_range(g, 1);
+                Mat top_blob_bordered_g = top_blob_bordered.channel_range(g, 1);
+
+                // plain depth-wise weight is the single channel deconvolution layout
+                const Mat weight_data_g = weight_data.range(maxk * g, maxk);
+                Mat bias_data_g;
+                if (bias_term)
+                    bias_data_g = bias_data.range(g, 1);
+
+                Option opt_g = opt;
+                opt_g.num_threads = 1;
+
+                if (kernel_w == 2)
+                {
+                    deconv2x2s2_sse(bottom_blob_bordered_g, top_blob_bordered_g, weight_data_g, bias_data_g, activation_type, activation_params, opt_g);
+                }
+                else if (kernel_w == 3)
+                {
+                    deconv3x3s2_sse(bottom_blob_bordered_g, top_blob_bordered_g, weight_data_g, bias_data_g, activation_type, activation_params, opt_g);
+                }
+                else // if (kernel_w == 4)
+                {
+                    deconv4x4s2_sse(bottom_blob_bordered_g, top_blob_bordered_g, weight_data_g, bias_data_g, activation_type, activation_params, opt_g);
+                }
+            }
+
+            return cut_padding(top_blob_bordered, top_blob, opt);
+        }
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int g=0; g<group; g++)
+        {
+            const float* inptr = bottom_blob.channel(g);
+            const float* kptr = (const float*)weight_data + maxk * g;
+            Mat out = top_blob_bordered.channel(g);
+
+            const float bias = bias_term ? bias_data[g] : 0.f;
+
+            out.fill(bias);
+
+            // scatter each input row into the output rows it touches
+            for (int i = 0; i < h; i++)
+            {
+                for (int ky = 0; ky < kernel_h; ky++)
+                {
+                    for (int kx = 0; kx < kernel_w; kx++)
+                    {
+                        float* outptr = out.row(i * stride_h + ky * dilation_h) + kx * dilation_w;
+                        const float k0 = kptr[ky * kernel_w + kx];
+
+                        if (stride_w == 1)
+                        {
+                            int j = 0;
+#if __AVX__
+                            __m256 _k0 = _mm256_set1_ps(k0);
+                            for (; j+7<w; j+=8)
+                            {
+                                __m256 _out = _mm256_loadu_ps(outptr + j);
+                                _out = _mm256_fmadd_ps(_mm256_loadu_ps(inptr + j), _k0, _out);
+                                _mm256_storeu_ps(outptr + j, _out);
+                            }
+#endif // __AVX__
+#if __SSE2__
+                            __m128 _k0s = _mm_set1_ps(k0);
+                            for (; j+3<w; j+=4)
+                            {
+                                __m128 _out = _mm_loadu_ps(outptr + j);
+                                _out = _mm_add_ps(_out, _mm_mul_ps(_mm_loadu_ps(inptr + j), _k0s));
+                                _mm_storeu_ps(outptr + j, _out);
+                            }
+#endif // __SSE2__
+                            for (; j<w; j++)
+                            {
+                                outptr[j] += inptr[j] * k0;
+                            }
+                        }
+                        else
+                        {
+                            for (int j = 0; j < w; j++)
+                            {
+                                outptr[j * stride_w] += inptr[j] * k0;
+                            }
+                        }
+                    }
+                }
+
+                inptr += w;
+            }
+
+            if (activation_type)
+            {
+                float* outptr = out;
+                int size = outw * outh;
+
+                int i = 0;
+#if __AVX__
+                for (; i+7<size; i+=8)
+                {
+                    _mm256_storeu_ps(outptr + i, activation_avx(_mm256_loadu_ps(outptr + i), activation_type, activation_params));
+                }
+#endif // __AVX__
+#if __SSE2__
+                for (; i+3<size; i+=4)
+                {
+                    _mm_storeu_ps(outptr + i, activation_sse(_mm_loadu_ps(outptr + i), activation_type, activation_params));
+                }
+#endif // __SSE2__
+                for (; i<size; i++)
+                {
+                    outptr[i] = activation_ss(outptr[i], activation_type, activation_params);
+                }
+            }
+        }
+
+        return cut_padding(top_blob_bordered, top_blob, opt);
+    }
+
+    const int channels_g = channels / group;
+    const int num_output_g = num_output / group;
+
+    for (int g=0; g<group; g++)
+    {
+        const Mat bottom_blob_g = bottom_blob.channel_range(channels_g * g, channels_g);
+        Mat top_blob_bordered_g = top_blob_bordered.channel_range(num_output_g * g, num_output_g);
+
+        const ncnn::Layer* op = group_ops[g];
+
+        Option opt_g = opt;
+        opt_g.blob_allocator = top_blob_bordered.allocator;
+
+        // forward
+        op->forward(bottom_blob_g, top_blob_bordered_g, opt_g);
+    }
+
+    return cut_padding(top_blob_bordered, top_blob, opt);
+}
+
+} // namespace ncnn
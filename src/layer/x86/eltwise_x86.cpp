@@ -0,0 +1,364 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "eltwise_x86.h"
+
+#include <math.h>
+#include <algorithm>
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+#if __AVX__
+#include <immintrin.h>
+#endif // __AVX__
+
+namespace ncnn {
+
+DEFINE_LAYER_CREATOR(Eltwise_x86)
+
+Eltwise_x86::Eltwise_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+struct eltwise_op_prod
+{
+    float func(const float& x, const float& y) const { return x * y; }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const { return _mm_mul_ps(x, y); }
+#endif // __SSE2__
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const { return _mm256_mul_ps(x, y); }
+#endif // __AVX__
+};
+
+struct eltwise_op_sum
+{
+    float func(const float& x, const float& y) const { return x + y; }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const { return _mm_add_ps(x, y); }
+#endif // __SSE2__
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const { return _mm256_add_ps(x, y); }
+#endif // __AVX__
+};
+
+struct eltwise_op_max
+{
+    float func(const float& x, const float& y) const { return std::max(x, y); }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const { return _mm_max_ps(x, y); }
+#endif // __SSE2__
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const { return _mm256_max_ps(x, y); }
+#endif // __AVX__
+};
+
+// outptr = op(ptr, ptr1)
+template<typename Op>
+static void eltwise_op(const float* ptr, const float* ptr1, float* outptr, int size)
+{
+    Op op;
+
+    int i = 0;
+#if __AVX__
+    for (; i+7<size; i+=8)
+    {
+        __m256 _p = _mm256_loadu_ps(ptr);
+        __m256 _p1 = _mm256_loadu_ps(ptr1);
+        _mm256_storeu_ps(outptr, op.func_pack8(_p, _p1));
+
+        ptr += 8;
+        ptr1 += 8;
+        outptr += 8;
+    }
+#endif // __AVX__
+#if __SSE2__
+    for (; i+3<size; i+=4)
+    {
+        __m128 _p = _mm_loadu_ps(ptr);
+        __m128 _p1 = _mm_loadu_ps(ptr1);
+        _mm_storeu_ps(outptr, op.func_pack4(_p, _p1));
+
+        ptr += 4;
+        ptr1 += 4;
+        outptr += 4;
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        *outptr = op.func(*ptr, *ptr1);
+
+        ptr++;
+        ptr1++;
+        outptr++;
+    }
+}
+
+// outptr = ptr * coeff0 + ptr1 * coeff1
+static void eltwise_sum_coeff(const float* ptr, float coeff0, const float* ptr1, float coeff1, float* outptr, int size)
+{
+    int i = 0;
+#if __AVX__
+    __m256 _coeff0_avx = _mm256_set1_ps(coeff0);
+    __m256 _coeff1_avx = _mm256_set1_ps(coeff1);
+    for (; i+7<size; i+=8)
+    {
+        __m256 _p = _mm256_loadu_ps(ptr);
+        __m256 _p1 = _mm256_loadu_ps(ptr1);
+        _p = _mm256_fmadd_ps(_p1, _coeff1_avx, _mm256_mul_ps(_p, _coeff0_avx));
+        _mm256_storeu_ps(outptr, _p);
+
+        ptr += 8;
+        ptr1 += 8;
+        outptr += 8;
+    }
+#endif // __AVX__
+#if __SSE2__
+    __m128 _coeff0 = _mm_set1_ps(coeff0);
+    __m128 _coeff1 = _mm_set1_ps(coeff1);
+    for (; i+3<size; i+=4)
+    {
+        __m128 _p = _mm_loadu_ps(ptr);
+        __m128 _p1 = _mm_loadu_ps(ptr1);
+        _p = _mm_add_ps(_mm_mul_ps(_p, _coeff0), _mm_mul_ps(_p1, _coeff1));
+        _mm_storeu_ps(outptr, _p);
+
+        ptr += 4;
+        ptr1 += 4;
+        outptr += 4;
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        *outptr = *ptr * coeff0 + *ptr1 * coeff1;
+
+        ptr++;
+        ptr1++;
+        outptr++;
+    }
+}
+
+// all the inputs of one channel are combined in turn while the output channel is still in cache
+template<typename Op>
+static void eltwise_op_channels(const std::vector<Mat>& bottom_blobs, Mat& top_blob, int size, const Option& opt)
+{
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<top_blob.c; q++)
+    {
+        float* outptr = top_blob.channel(q);
+
+        eltwise_op<Op>(bottom_blobs[0].channel(q), bottom_blobs[1].channel(q), outptr, size);
+
+        for (size_t b=2; b<bottom_blobs.size(); b++)
+        {
+            eltwise_op<Op>(outptr, bottom_blobs[b].channel(q), outptr, size);
+        }
+    }
+}
+
+#if __SSE2__
+// 16 int8 to 4x4 float, scaled
+static inline void int8_to_float_sse(const signed char* ptr, __m128 _scale, __m128* _v)
+{
+    __m128i _p = _mm_loadu_si128((const __m128i*)ptr);
+    __m128i _sign = _mm_cmpgt_epi8(_mm_setzero_si128(), _p);
+    __m128i _lo16 = _mm_unpacklo_epi8(_p, _sign);
+    __m128i _hi16 = _mm_unpackhi_epi8(_p, _sign);
+    __m128i _lo_sign = _mm_cmpgt_epi16(_mm_setzero_si128(), _lo16);
+    __m128i _hi_sign = _mm_cmpgt_epi16(_mm_setzero_si128(), _hi16);
+
+    _v[0] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(_lo16, _lo_sign)), _scale);
+    _v[1] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(_lo16, _lo_sign)), _scale);
+    _v[2] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(_hi16, _hi_sign)), _scale);
+    _v[3] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(_hi16, _hi_sign)), _scale);
+}
+
+// 4x4 float to 16 int8, rounded half away from zero and clamped to [-127, 127]
+static inline void float_to_int8_sse(const __m128* _v, __m128 _scale, signed char* outptr)
+{
+    const __m128 _half = _mm_set1_ps(0.5f);
+    const __m128 _sign_mask = _mm_set1_ps(-0.f);
+
+    __m128i _i[4];
+    for (int k=0; k<4; k++)
+    {
+        __m128 _t = _mm_mul_ps(_v[k], _scale);
+        _t = _mm_add_ps(_t, _mm_or_ps(_mm_and_ps(_t, _sign_mask), _half));
+        _i[k] = _mm_cvttps_epi32(_t);
+    }
+
+    __m128i _lo16 = _mm_max_epi16(_mm_packs_epi32(_i[0], _i[1]), _mm_set1_epi16(-127));
+    __m128i _hi16 = _mm_max_epi16(_mm_packs_epi32(_i[2], _i[3]), _mm_set1_epi16(-127));
+    _mm_storeu_si128((__m128i*)outptr, _mm_packs_epi16(_lo16, _hi16));
+}
+#endif // __SSE2__
+
+static inline signed char float2int8(float v)
+{
+    int int32 = round(v);
+    if (int32 > 127) return 127;
+    if (int32 < -127) return -127;
+    return (signed char)int32;
+}
+
+// int8 inputs with their dequantize scales, int8 output when top_scale is not 0
+template<typename Op>
+static void eltwise_int8_channels(const std::vector<Mat>& bottom_blobs, const std::vector<float>& input_scales, Mat& top_blob, float top_scale, const Option& opt)
+{
+    Op op;
+
+    const int count = bottom_blobs.size();
+    const int channels = top_blob.c;
+    const int size = top_blob.w * top_blob.h;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<channels; q++)
+    {
+        int i = 0;
+#if __SSE2__
+        for (; i+15<size; i+=16)
+        {
+            __m128 _sum[4];
+            int8_to_float_sse((const signed char*)bottom_blobs[0].channel(q) + i, _mm_set1_ps(input_scales[0]), _sum);
+
+            for (int b=1; b<count; b++)
+            {
+                __m128 _v[4];
+                int8_to_float_sse((const signed char*)bottom_blobs[b].channel(q) + i, _mm_set1_ps(input_scales[b]), _v);
+
+                for (int k=0; k<4; k++)
+                    _sum[k] = op.func_pack4(_sum[k], _v[k]);
+            }
+
+            if (top_scale != 0.f)
+            {
+                float_to_int8_sse(_sum, _mm_set1_ps(top_scale), (signed char*)top_blob.channel(q) + i);
+            }
+            else
+            {
+                float* outptr = (float*)top_blob.channel(q) + i;
+                for (int k=0; k<4; k++)
+                    _mm_storeu_ps(outptr + k * 4, _sum[k]);
+            }
+        }
+#endif // __SSE2__
+        for (; i<size; i++)
+        {
+            float sum = ((const signed char*)bottom_blobs[0].channel(q))[i] * input_scales[0];
+
+            for (int b=1; b<count; b++)
+            {
+                sum = op.func(sum, ((const signed char*)bottom_blobs[b].channel(q))[i] * input_scales[b]);
+            }
+
+            if (top_scale != 0.f)
+                ((signed char*)top_blob.channel(q))[i] = float2int8(sum * top_scale);
+            else
+                ((float*)top_blob.channel(q))[i] = sum;
+        }
+    }
+}
+
+int Eltwise_x86::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    if (use_int8_inference)
+        return forward_int8(bottom_blobs, top_blobs, opt);
+
+    const Mat& bottom_blob = bottom_blobs[0];
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int channels = bottom_blob.c;
+    size_t elemsize = bottom_blob.elemsize;
+    int elempack = bottom_blob.elempack;
+    int size = w * h * elempack;
+
+    Mat& top_blob = top_blobs[0];
+    top_blob.create(w, h, channels, elemsize, elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    if (op_type == Operation_PROD)
+    {
+        eltwise_op_channels<eltwise_op_prod>(bottom_blobs, top_blob, size, opt);
+    }
+    else if (op_type == Operation_SUM)
+    {
+        if (coeffs.w == 0)
+        {
+            eltwise_op_channels<eltwise_op_sum>(bottom_blobs, top_blob, size, opt);
+        }
+        else
+        {
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int q=0; q<channels; q++)
+            {
+                float* outptr = top_blob.channel(q);
+
+                eltwise_sum_coeff(bottom_blobs[0].channel(q), coeffs[0], bottom_blobs[1].channel(q), coeffs[1], outptr, size);
+
+                for (size_t b=2; b<bottom_blobs.size(); b++)
+                {
+                    eltwise_sum_coeff(outptr, 1.f, bottom_blobs[b].channel(q), coeffs[b], outptr, size);
+                }
+            }
+        }
+    }
+    else if (op_type == Operation_MAX)
+    {
+        eltwise_op_channels<eltwise_op_max>(bottom_blobs, top_blob, size, opt);
+    }
+
+    return 0;
+}
+
+int Eltwise_x86::forward_int8(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    // inputs mixed with fp32 take the generic path
+    for (size_t b=0; b<bottom_blobs.size(); b++)
+    {
+        if (bottom_blobs[b].elemsize != 1u)
+            return Eltwise::forward_int8(bottom_blobs, top_blobs, opt);
+    }
+
+    const Mat& bottom_blob = bottom_blobs[0];
+
+    const bool top_int8 = top_blob_int8_scale != 0.f;
+
+    Mat& top_blob = top_blobs[0];
+    top_blob.create(bottom_blob.w, bottom_blob.h, bottom_blob.c, top_int8 ? (size_t)1u : (size_t)4u, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    std::vector<float> input_scales(bottom_blobs.size());
+    for (size_t b=0; b<bottom_blobs.size(); b++)
+    {
+        float coeff = op_type == Operation_SUM && coeffs.w != 0 ? coeffs[b] : 1.f;
+        input_scales[b] = coeff / bottom_blob_int8_scales[b];
+    }
+
+    if (op_type == Operation_PROD)
+        eltwise_int8_channels<eltwise_op_prod>(bottom_blobs, input_scales, top_blob, top_blob_int8_scale, opt);
+    else if (op_type == Operation_SUM)
+        eltwise_int8_channels<eltwise_op_sum>(bottom_blobs, input_scales, top_blob, top_blob_int8_scale, opt);
+    else if (op_type == Operation_MAX)
+        eltwise_int8_channels<eltwise_op_max>(bottom_blobs, input_scales, top_blob, top_blob_int8_scale, opt);
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,99 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "hardsigmoid_x86.h"
+
+#include <math.h>
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+#if __AVX__
+#include <immintrin.h>
+#endif // __AVX__
+
+namespace ncnn {
+
+DEFINE_LAYER_CREATOR(HardSigmoid_x86)
+
+HardSigmoid_x86::HardSigmoid_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+int HardSigmoid_x86::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
+{
+    int w = bottom_top_blob.w;
+    int h = bottom_top_blob.h;
+    int channels = bottom_top_blob.c;
+    int elempack = bottom_top_blob.elempack;
+    int size = w * h * elempack;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<channels; q++)
+    {
+        float* ptr = bottom_top_blob.channel(q);
+
+        int i = 0;
+#if __AVX__
+        __m256 _zero_avx = _mm256_setzero_ps();
+        __m256 _one_avx = _mm256_set1_ps(1.f);
+        __m256 _alpha_avx = _mm256_set1_ps(alpha);
+        __m256 _beta_avx = _mm256_set1_ps(beta);
+        for (; i+7<size; i+=8)
+        {
+            __m256 _p = _mm256_loadu_ps(ptr);
+            _p = _mm256_fmadd_ps(_p, _alpha_avx, _beta_avx);
+            _p = _mm256_max_ps(_p, _zero_avx);
+            _p = _mm256_min_ps(_p, _one_avx);
+            _mm256_storeu_ps(ptr, _p);
+
+            ptr += 8;
+        }
+#endif // __AVX__
+#if __SSE2__
+        __m128 _zero = _mm_setzero_ps();
+        __m128 _one = _mm_set1_ps(1.f);
+        __m128 _alpha = _mm_set1_ps(alpha);
+        __m128 _beta = _mm_set1_ps(beta);
+        for (; i+3<size; i+=4)
+        {
+            __m128 _p = _mm_loadu_ps(ptr);
+            _p = _mm_add_ps(_mm_mul_ps(_p, _alpha), _beta);
+            _p = _mm_max_ps(_p, _zero);
+            _p = _mm_min_ps(_p, _one);
+            _mm_storeu_ps(ptr, _p);
+
+            ptr += 4;
+        }
+#endif // __SSE2__
+        for (; i<size; i++)
+        {
+            if (*ptr < lower)
+                *ptr = 0.f;
+            else if (*ptr > upper)
+                *ptr = 1.f;
+            else
+                *ptr = *ptr * alpha + beta;
+
+            ptr++;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,322 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// weight-only quantized innerproduct, the int8 or int4 codes are laid out in
+// the panels of X86_GEMM_NR outputs of the packed b operand and expanded to
+// fp32 in registers, so the gemv streams 4x or 8x fewer weight bytes
+//
+// int8 panel = k-NR codes, one scale per output
+// int4 panel = k-NR/2 bytes, byte j holds output j in the low nibble and output
+//              j + NR/2 in the high nibble, code + 8 as in quantize_weight(),
+//              with one scale per output and group of group_size inputs
+
+static void innerproduct_transform_kernel_quantized(const Mat& weight_data_quantized, const Mat& weight_data_quantize_scales, Mat& kernel_tm, Mat& scales_tm, int num_input, int num_output, int type, int group_size)
+{
+    const int nn_panel = (num_output + X86_GEMM_NR - 1) / X86_GEMM_NR;
+    const int groups = (num_input + group_size - 1) / group_size;
+
+    if (type == 1)
+    {
+        kernel_tm.create(num_input * X86_GEMM_NR, nn_panel, (size_t)1u);
+        scales_tm.create(X86_GEMM_NR, nn_panel);
+        if (kernel_tm.empty() || scales_tm.empty())
+            return;
+
+        memset(kernel_tm.data, 0, kernel_tm.total());
+        scales_tm.fill(0.f);
+
+        for (int p=0; p<num_output; p++)
+        {
+            const signed char* kptr = (const signed char*)weight_data_quantized.data + p * num_input;
+            signed char* ktmp = (signed char*)kernel_tm.row<signed char>(p / X86_GEMM_NR) + p % X86_GEMM_NR;
+
+            for (int k=0; k<num_input; k++)
+            {
+                ktmp[k * X86_GEMM_NR] = kptr[k];
+            }
+
+            scales_tm.row(p / X86_GEMM_NR)[p % X86_GEMM_NR] = weight_data_quantize_scales[p];
+        }
+    }
+    else if (type == 2)
+    {
+        const int row_bytes = (num_input + 1) / 2;
+
+        // padded outputs get code 8, which is zero
+        kernel_tm.create(num_input * X86_GEMM_NR / 2, nn_panel, (size_t)1u);
+        scales_tm.create(groups * X86_GEMM_NR, nn_panel);
+        if (kernel_tm.empty() || scales_tm.empty())
+            return;
+
+        memset(kernel_tm.data, 0x88, kernel_tm.total());
+        scales_tm.fill(0.f);
+
+        for (int p=0; p<num_output; p++)
+        {
+            const unsigned char* kptr = (const unsigned char*)weight_data_quantized.data + p * row_bytes;
+            unsigned char* ktmp = kernel_tm.row<unsigned char>(p / X86_GEMM_NR);
+
+            const int j = p % X86_GEMM_NR;
+            const int shift = j < X86_GEMM_NR / 2 ? 0 : 4;
+            const int b = j % (X86_GEMM_NR / 2);
+
+            for (int k=0; k<num_input; k++)
+            {
+                int q = k % 2 == 0 ? kptr[k / 2] & 15 : kptr[k / 2] >> 4;
+
+                unsigned char& v = ktmp[k * X86_GEMM_NR / 2 + b];
+                v = (unsigned char)((v & ~(15 << shift)) | (q << shift));
+            }
+
+            float* stmp = scales_tm.row(p / X86_GEMM_NR);
+            for (int g=0; g<groups; g++)
+            {
+                stmp[g * X86_GEMM_NR + j] = weight_data_quantize_scales[p * groups + g];
+            }
+        }
+    }
+}
+
+// the fp32 packed b operand of the sgemm engine from the quantized panels
+static void innerproduct_dequantize_kernel(const Mat& kernel_tm, const Mat& scales_tm, Mat& weight_packed, int num_input, int num_output, int type, int group_size, const Option& opt)
+{
+    const int nn_panel = (num_output + X86_GEMM_NR - 1) / X86_GEMM_NR;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int pp=0; pp<nn_panel; pp++)
+    {
+        const float* sptr = scales_tm.row(pp);
+        float* outptr = (float*)weight_packed + pp * num_input * X86_GEMM_NR;
+
+        if (type == 1)
+        {
+            const signed char* kptr = kernel_tm.row<const signed char>(pp);
+
+            for (int k=0; k<num_input; k++)
+            {
+                for (int j=0; j<X86_GEMM_NR; j++)
+                {
+                    outptr[j] = kptr[j] * sptr[j];
+                }
+
+                kptr += X86_GEMM_NR;
+                outptr += X86_GEMM_NR;
+            }
+        }
+        else
+        {
+            const unsigned char* kptr = kernel_tm.row<const unsigned char>(pp);
+
+            for (int k=0; k<num_input; k++)
+            {
+                const float* gsptr = sptr + k / group_size * X86_GEMM_NR;
+
+                for (int j=0; j<X86_GEMM_NR / 2; j++)
+                {
+                    outptr[j] = ((kptr[j] & 15) - 8) * gsptr[j];
+                    outptr[j + X86_GEMM_NR / 2] = ((kptr[j] >> 4) - 8) * gsptr[j + X86_GEMM_NR / 2];
+                }
+
+                kptr += X86_GEMM_NR / 2;
+                outptr += X86_GEMM_NR;
+            }
+        }
+    }
+}
+
+// sum[0..NR) = panel codes times x, scaled
+static void innerproduct_gemv_int8_panel(const signed char* kptr, const float* sptr, const float* x, int num_input, float* sum)
+{
+    int k = 0;
+#if __AVX2__
+    __m256 _sum0 = _mm256_setzero_ps();
+    __m256 _sum1 = _mm256_setzero_ps();
+    __m256 _sum2 = _mm256_setzero_ps();
+    __m256 _sum3 = _mm256_setzero_ps();
+
+    for (; k+1<num_input; k+=2)
+    {
+        __m128i _w0 = _mm_loadu_si128((const __m128i*)kptr);
+        __m128i _w1 = _mm_loadu_si128((const __m128i*)(kptr + 16));
+        __m256 _x0 = _mm256_broadcast_ss(x + k);
+        __m256 _x1 = _mm256_broadcast_ss(x + k + 1);
+
+        _sum0 = _mm256_fmadd_ps(_x0, _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_w0)), _sum0);
+        _sum1 = _mm256_fmadd_ps(_x0, _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_unpackhi_epi64(_w0, _w0))), _sum1);
+        _sum2 = _mm256_fmadd_ps(_x1, _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_w1)), _sum2);
+        _sum3 = _mm256_fmadd_ps(_x1, _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_unpackhi_epi64(_w1, _w1))), _sum3);
+
+        kptr += 32;
+    }
+    for (; k<num_input; k++)
+    {
+        __m128i _w0 = _mm_loadu_si128((const __m128i*)kptr);
+        __m256 _x0 = _mm256_broadcast_ss(x + k);
+
+        _sum0 = _mm256_fmadd_ps(_x0, _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_w0)), _sum0);
+        _sum1 = _mm256_fmadd_ps(_x0, _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_unpackhi_epi64(_w0, _w0))), _sum1);
+
+        kptr += 16;
+    }
+
+    _mm256_storeu_ps(sum, _mm256_mul_ps(_mm256_add_ps(_sum0, _sum2), _mm256_loadu_ps(sptr)));
+    _mm256_storeu_ps(sum + 8, _mm256_mul_ps(_mm256_add_ps(_sum1, _sum3), _mm256_loadu_ps(sptr + 8)));
+#elif __SSE2__ && !__AVX__
+    __m128 _sum0 = _mm_setzero_ps();
+    __m128 _sum1 = _mm_setzero_ps();
+
+    for (; k<num_input; k++)
+    {
+        __m128i _w = _mm_loadl_epi64((const __m128i*)kptr);
+        _w = _mm_srai_epi16(_mm_unpacklo_epi8(_w, _w), 8);
+        __m128 _w0 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(_w, _w), 16));
+        __m128 _w1 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(_w, _w), 16));
+        __m128 _x0 = _mm_load1_ps(x + k);
+
+        _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_x0, _w0));
+        _sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_x0, _w1));
+
+        kptr += 8;
+    }
+
+    _mm_storeu_ps(sum, _mm_mul_ps(_sum0, _mm_loadu_ps(sptr)));
+    _mm_storeu_ps(sum + 4, _mm_mul_ps(_sum1, _mm_loadu_ps(sptr + 4)));
+#else
+    for (int j=0; j<X86_GEMM_NR; j++)
+    {
+        sum[j] = 0.f;
+    }
+
+    for (; k<num_input; k++)
+    {
+        for (int j=0; j<X86_GEMM_NR; j++)
+        {
+            sum[j] += x[k] * kptr[j];
+        }
+
+        kptr += X86_GEMM_NR;
+    }
+
+    for (int j=0; j<X86_GEMM_NR; j++)
+    {
+        sum[j] *= sptr[j];
+    }
+#endif
+}
+
+static void innerproduct_gemv_int4_panel(const unsigned char* kptr, const float* sptr, const float* x, int num_input, int group_size, float* sum)
+{
+    // codes are stored + 8, the sum of x over a group takes the offset back out
+#if __AVX2__
+    __m256 _sum0 = _mm256_setzero_ps();
+    __m256 _sum1 = _mm256_setzero_ps();
+
+    const __m128i _mask = _mm_set1_epi8(15);
+
+    for (int k0=0; k0<num_input; k0+=group_size)
+    {
+        const int k1 = std::min(k0 + group_size, num_input);
+
+        __m256 _acc0 = _mm256_setzero_ps();
+        __m256 _acc1 = _mm256_setzero_ps();
+        float sumx = 0.f;
+
+        for (int k=k0; k<k1; k++)
+        {
+            __m128i _w = _mm_loadl_epi64((const __m128i*)kptr);
+            __m128i _wl = _mm_and_si128(_w, _mask);
+            __m128i _wh = _mm_and_si128(_mm_srli_epi16(_w, 4), _mask);
+            __m256 _x0 = _mm256_broadcast_ss(x + k);
+
+            _acc0 = _mm256_fmadd_ps(_x0, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_wl)), _acc0);
+            _acc1 = _mm256_fmadd_ps(_x0, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_wh)), _acc1);
+            sumx += x[k];
+
+            kptr += 8;
+        }
+
+        __m256 _sumx8 = _mm256_set1_ps(sumx * 8.f);
+        _sum0 = _mm256_fmadd_ps(_mm256_sub_ps(_acc0, _sumx8), _mm256_loadu_ps(sptr), _sum0);
+        _sum1 = _mm256_fmadd_ps(_mm256_sub_ps(_acc1, _sumx8), _mm256_loadu_ps(sptr + 8), _sum1);
+
+        sptr += 16;
+    }
+
+    _mm256_storeu_ps(sum, _sum0);
+    _mm256_storeu_ps(sum + 8, _sum1);
+#elif __SSE2__ && !__AVX__
+    __m128 _sum0 = _mm_setzero_ps();
+    __m128 _sum1 = _mm_setzero_ps();
+
+    const __m128i _mask = _mm_set1_epi8(15);
+    const __m128i _zero = _mm_setzero_si128();
+
+    for (int k0=0; k0<num_input; k0+=group_size)
+    {
+        const int k1 = std::min(k0 + group_size, num_input);
+
+        __m128 _acc0 = _mm_setzero_ps();
+        __m128 _acc1 = _mm_setzero_ps();
+        float sumx = 0.f;
+
+        for (int k=k0; k<k1; k++)
+        {
+            int v;
+            memcpy(&v, kptr, 4);
+            __m128i _w = _mm_cvtsi32_si128(v);
+            __m128i _wl = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_and_si128(_w, _mask), _zero), _zero);
+            __m128i _wh = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(_w, 4), _mask), _zero), _zero);
+            __m128 _x0 = _mm_load1_ps(x + k);
+
+            _acc0 = _mm_add_ps(_acc0, _mm_mul_ps(_x0, _mm_cvtepi32_ps(_wl)));
+            _acc1 = _mm_add_ps(_acc1, _mm_mul_ps(_x0, _mm_cvtepi32_ps(_wh)));
+            sumx += x[k];
+
+            kptr += 4;
+        }
+
+        __m128 _sumx8 = _mm_set1_ps(sumx * 8.f);
+        _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_mm_sub_ps(_acc0, _sumx8), _mm_loadu_ps(sptr)));
+        _sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_mm_sub_ps(_acc1, _sumx8), _mm_loadu_ps(sptr + 4)));
+
+        sptr += 8;
+    }
+
+    _mm_storeu_ps(sum, _sum0);
+    _mm_storeu_ps(sum + 4, _sum1);
+#else
+    for (int j=0; j<X86_GEMM_NR; j++)
+    {
+        sum[j] = 0.f;
+    }
+
+    for (int k0=0; k0<num_input; k0+=group_size)
+    {
+        const int k1 = std::min(k0 + group_size, num_input);
+
+        for (int k=k0; k<k1; k++)
+        {
+            for (int j=0; j<X86_GEMM_NR / 2; j++)
+            {
+                sum[j] += x[k] * ((kptr[j] & 15) - 8) * sptr[j];
+                sum[j + X86_GEMM_NR / 2] += x[k] * ((kptr[j] >> 4) - 8) * sptr[j + X86_GEMM_NR / 2];
+            }
+
+            kptr += X86_GEMM_NR / 2;
+        }
+
+        sptr += X86_GEMM_NR;
+    }
+#endif
+}
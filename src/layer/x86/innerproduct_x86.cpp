@@ -0,0 +1,385 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "innerproduct_x86.h"
+
+#include <string.h>
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+#if __AVX__
+#include <immintrin.h>
+#endif
+
+#include "layer_type.h"
+#include "x86_activation.h"
+#include "x86_gemm.h"
+#include "x86_sparse.h"
+
+namespace ncnn {
+
+#include "innerproduct_quantized.h"
+
+DEFINE_LAYER_CREATOR(InnerProduct_x86)
+
+InnerProduct_x86::InnerProduct_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+int InnerProduct_x86::create_pipeline(const Option& opt)
+{
+    if (use_int8_inference)
+    {
+        support_packing = false;
+        return 0;
+    }
+
+    const int num_input = weight_data_size / num_output;
+
+    if (weight_quant_type)
+    {
+        innerproduct_transform_kernel_quantized(weight_data_quantized, weight_data_quantize_scales, weight_data_quantized_packed, weight_quantize_scales_packed, num_input, num_output, weight_quant_type, weight_quant_group_size);
+        if (weight_data_quantized_packed.empty() || weight_quantize_scales_packed.empty())
+            return -100;
+
+        // forward only reads the packed panels, drop the fp32 and raw quantized copies
+        if (opt.lightmode && !opt.use_vulkan_compute)
+        {
+            weight_data.release();
+            weight_data_quantized.release();
+            weight_data_quantize_scales.release();
+        }
+
+        return 0;
+    }
+
+    // pruned weights run as sparse times dense
+    int nnz = sparse_x86_count_nonzero(weight_data, weight_data_size);
+    if (nnz < weight_data_size * X86_SPARSE_DENSITY)
+    {
+        return sparse_x86_pack(weight_data, num_output, num_input, weight_sparse_data, weight_sparse_index);
+    }
+
+    // src = inch-outch
+    // dst = the packed b operand of the sgemm engine, which the gemv reads too
+    int w;
+    int h;
+    gemm_x86_packed_b_shape(num_input, num_output, w, h);
+
+    weight_data_packed.create(w, h);
+    if (weight_data_packed.empty())
+        return -100;
+
+    gemm_x86_pack_b_transposed(weight_data, num_input, num_input, num_output, weight_data_packed, opt);
+
+    return 0;
+}
+
+int InnerProduct_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    if (use_int8_inference)
+    {
+        return InnerProduct::forward(bottom_blob, top_blob, opt);
+    }
+
+    if (bottom_blob.elempack != 1)
+    {
+        // the features are read in plain channel order
+        Option opt_pack = opt;
+        opt_pack.blob_allocator = opt.workspace_allocator;
+
+        Mat bottom_blob_unpacked;
+        convert_packing(bottom_blob, bottom_blob_unpacked, 1, opt_pack);
+        if (bottom_blob_unpacked.empty())
+            return -100;
+
+        return forward(bottom_blob_unpacked, top_blob, opt);
+    }
+
+    const int num_input = weight_data_size / num_output;
+
+    if (weight_quant_type)
+    {
+        return forward_quantized(bottom_blob, top_blob, opt);
+    }
+
+    if (!weight_sparse_data.empty())
+    {
+        return forward_sparse(bottom_blob, top_blob, opt);
+    }
+
+    // batched rows of features
+    if (bottom_blob.dims == 2 && bottom_blob.w == num_input && bottom_blob.h > 1)
+    {
+        return forward_gemm(bottom_blob, weight_data_packed, top_blob, opt);
+    }
+
+    int size = bottom_blob.w * bottom_blob.h;
+    int channels = bottom_blob.c;
+    size_t elemsize = bottom_blob.elemsize;
+
+    // a packed 1-d output has the very same memory layout, it only saves the next layer a conversion
+    int out_elempack = 1;
+#if __AVX__
+    if (opt.use_packing_layout && num_output % 8 == 0)
+        out_elempack = 8;
+#elif __SSE2__
+    if (opt.use_packing_layout && num_output % 4 == 0)
+        out_elempack = 4;
+#endif
+
+    top_blob.create(num_output / out_elempack, elemsize * out_elempack, out_elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    const int nn_panel = (num_output + X86_GEMM_NR - 1) / X86_GEMM_NR;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int pp=0; pp<nn_panel; pp++)
+    {
+        const int p = pp * X86_GEMM_NR;
+        const int nr = std::min(X86_GEMM_NR, num_output - p);
+
+        const float* kptr = (const float*)weight_data_packed + p * num_input;
+
+        float sum[X86_GEMM_NR];
+        for (int j=0; j<X86_GEMM_NR; j++)
+        {
+            sum[j] = bias_term && j < nr ? bias_data[p + j] : 0.f;
+        }
+
+#if __AVX__
+        __m256 _sum0 = _mm256_loadu_ps(sum);
+        __m256 _sum1 = _mm256_loadu_ps(sum + 8);
+        __m256 _sum2 = _mm256_setzero_ps();
+        __m256 _sum3 = _mm256_setzero_ps();
+
+        for (int q=0; q<channels; q++)
+        {
+            const float* m = bottom_blob.channel(q);
+
+            int i = 0;
+            for (; i+1<size; i+=2)
+            {
+                __m256 _m0 = _mm256_broadcast_ss(m);
+                __m256 _m1 = _mm256_broadcast_ss(m + 1);
+                _sum0 = _mm256_fmadd_ps(_m0, _mm256_loadu_ps(kptr), _sum0);
+                _sum1 = _mm256_fmadd_ps(_m0, _mm256_loadu_ps(kptr + 8), _sum1);
+                _sum2 = _mm256_fmadd_ps(_m1, _mm256_loadu_ps(kptr + 16), _sum2);
+                _sum3 = _mm256_fmadd_ps(_m1, _mm256_loadu_ps(kptr + 24), _sum3);
+
+                m += 2;
+                kptr += 32;
+            }
+            for (; i<size; i++)
+            {
+                __m256 _m0 = _mm256_broadcast_ss(m);
+                _sum0 = _mm256_fmadd_ps(_m0, _mm256_loadu_ps(kptr), _sum0);
+                _sum1 = _mm256_fmadd_ps(_m0, _mm256_loadu_ps(kptr + 8), _sum1);
+
+                m += 1;
+                kptr += 16;
+            }
+        }
+
+        _mm256_storeu_ps(sum, _mm256_add_ps(_sum0, _sum2));
+        _mm256_storeu_ps(sum + 8, _mm256_add_ps(_sum1, _sum3));
+#elif __SSE2__
+        __m128 _sum0 = _mm_loadu_ps(sum);
+        __m128 _sum1 = _mm_loadu_ps(sum + 4);
+        __m128 _sum2 = _mm_setzero_ps();
+        __m128 _sum3 = _mm_setzero_ps();
+
+        for (int q=0; q<channels; q++)
+        {
+            const float* m = bottom_blob.channel(q);
+
+            int i = 0;
+            for (; i+1<size; i+=2)
+            {
+                __m128 _m0 = _mm_load1_ps(m);
+                __m128 _m1 = _mm_load1_ps(m + 1);
+                _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_m0, _mm_loadu_ps(kptr)));
+                _sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_m0, _mm_loadu_ps(kptr + 4)));
+                _sum2 = _mm_add_ps(_sum2, _mm_mul_ps(_m1, _mm_loadu_ps(kptr + 8)));
+                _sum3 = _mm_add_ps(_sum3, _mm_mul_ps(_m1, _mm_loadu_ps(kptr + 12)));
+
+                m += 2;
+                kptr += 16;
+            }
+            for (; i<size; i++)
+            {
+                __m128 _m0 = _mm_load1_ps(m);
+                _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_m0, _mm_loadu_ps(kptr)));
+                _sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_m0, _mm_loadu_ps(kptr + 4)));
+
+                m += 1;
+                kptr += 8;
+            }
+        }
+
+        _mm_storeu_ps(sum, _mm_add_ps(_sum0, _sum2));
+        _mm_storeu_ps(sum + 4, _mm_add_ps(_sum1, _sum3));
+#else
+        for (int q=0; q<channels; q++)
+        {
+            const float* m = bottom_blob.channel(q);
+
+            for (int i=0; i<size; i++)
+            {
+                for (int j=0; j<X86_GEMM_NR; j++)
+                {
+                    sum[j] += m[i] * kptr[j];
+                }
+
+                kptr += X86_GEMM_NR;
+            }
+        }
+#endif
+
+        for (int j=0; j<nr; j++)
+        {
+            top_blob[p + j] = activation_ss(sum[j], activation_type, activation_params);
+        }
+    }
+
+    return 0;
+}
+
+int InnerProduct_x86::forward_gemm(const Mat& bottom_blob, const Mat& weight_packed, Mat& top_blob, const Option& opt) const
+{
+    const int num_input = bottom_blob.w;
+    const int batch = bottom_blob.h;
+    size_t elemsize = bottom_blob.elemsize;
+
+    top_blob.create(num_output, batch, elemsize, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    // rows of features times the transposed weights
+    int w;
+    int h;
+    gemm_x86_packed_a_shape(batch, num_input, w, h);
+
+    Mat bottom_tm(w, h, elemsize, opt.workspace_allocator);
+    if (bottom_tm.empty())
+        return -100;
+
+    gemm_x86_pack_a(bottom_blob, num_input, batch, num_input, bottom_tm, opt);
+
+    const float* bias = bias_term ? (const float*)bias_data : 0;
+
+    gemm_x86(batch, num_output, num_input, bottom_tm, weight_packed, top_blob, num_output, 0, 0, 0, bias, activation_type, activation_params, opt);
+
+    return 0;
+}
+
+int InnerProduct_x86::forward_sparse(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    const int num_input = weight_data_size / num_output;
+    size_t elemsize = bottom_blob.elemsize;
+
+    const float* bias = bias_term ? (const float*)bias_data : 0;
+
+    // batched rows of features
+    if (bottom_blob.dims == 2 && bottom_blob.w == num_input && bottom_blob.h > 1)
+    {
+        const int batch = bottom_blob.h;
+
+        top_blob.create(num_output, batch, elemsize, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        for (int j=0; j<batch; j++)
+        {
+            sparse_x86_spmv(num_output, weight_sparse_data, weight_sparse_index, bottom_blob.row(j), top_blob.row(j), bias, activation_type, activation_params, opt);
+        }
+
+        return 0;
+    }
+
+    // the gather wants the features without channel gaps
+    Mat bottom_blob_flattened = bottom_blob.reshape(num_input, opt.workspace_allocator);
+    if (bottom_blob_flattened.empty())
+        return -100;
+
+    top_blob.create(num_output, elemsize, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    sparse_x86_spmv(num_output, weight_sparse_data, weight_sparse_index, bottom_blob_flattened, top_blob, bias, activation_type, activation_params, opt);
+
+    return 0;
+}
+
+int InnerProduct_x86::forward_quantized(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    const int num_input = weight_data_size / num_output;
+    size_t elemsize = bottom_blob.elemsize;
+
+    // batched rows of features, the panels are expanded once for the gemm
+    if (bottom_blob.dims == 2 && bottom_blob.w == num_input && bottom_blob.h > 1)
+    {
+        int w;
+        int h;
+        gemm_x86_packed_b_shape(num_input, num_output, w, h);
+
+        Mat weight_packed(w, h, (size_t)4u, opt.workspace_allocator);
+        if (weight_packed.empty())
+            return -100;
+
+        innerproduct_dequantize_kernel(weight_data_quantized_packed, weight_quantize_scales_packed, weight_packed, num_input, num_output, weight_quant_type, weight_quant_group_size, opt);
+
+        return forward_gemm(bottom_blob, weight_packed, top_blob, opt);
+    }
+
+    Mat bottom_blob_flattened = bottom_blob.reshape(num_input, opt.workspace_allocator);
+    if (bottom_blob_flattened.empty())
+        return -100;
+
+    top_blob.create(num_output, elemsize, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    const float* x = bottom_blob_flattened;
+
+    const int nn_panel = (num_output + X86_GEMM_NR - 1) / X86_GEMM_NR;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int pp=0; pp<nn_panel; pp++)
+    {
+        const int p = pp * X86_GEMM_NR;
+        const int nr = std::min(X86_GEMM_NR, num_output - p);
+
+        float sum[X86_GEMM_NR];
+        if (weight_quant_type == 1)
+            innerproduct_gemv_int8_panel(weight_data_quantized_packed.row<const signed char>(pp), weight_quantize_scales_packed.row(pp), x, num_input, sum);
+        else
+            innerproduct_gemv_int4_panel(weight_data_quantized_packed.row<const unsigned char>(pp), weight_quantize_scales_packed.row(pp), x, num_input, weight_quant_group_size, sum);
+
+        for (int j=0; j<nr; j++)
+        {
+            float v = bias_term ? sum[j] + bias_data[p + j] : sum[j];
+            top_blob[p + j] = activation_ss(v, activation_type, activation_params);
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,51 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef LAYER_INNERPRODUCT_X86_H
+#define LAYER_INNERPRODUCT_X86_H
+
+#include "innerproduct.h"
+
+namespace ncnn {
+
+class InnerProduct_x86 : virtual public InnerProduct
+{
+public:
+    InnerProduct_x86();
+
+    virtual int create_pipeline(const Option& opt);
+
+    virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+
+protected:
+    int forward_gemm(const Mat& bottom_blob, const Mat& weight_packed, Mat& top_blob, const Option& opt) const;
+    int forward_sparse(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+    int forward_quantized(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+
+public:
+    // transposed weights in the packed b layout of x86_gemm.h
+    Mat weight_data_packed;
+
+    // pruned weights in the compressed sparse rows of x86_sparse.h
+    Mat weight_sparse_data;
+    Mat weight_sparse_index;
+
+    // weight-only quantized panels of innerproduct_quantized.h
+    Mat weight_data_quantized_packed;
+    Mat weight_quantize_scales_packed;
+};
+
+} // namespace ncnn
+
+#endif // LAYER_INNERPRODUCT_X86_H
@@ -0,0 +1,312 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#include "interp_x86.h"
+
+#include <string.h>
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+#if __AVX__
+#include <immintrin.h>
+#endif // __AVX__
+
+namespace ncnn {
+
+DEFINE_LAYER_CREATOR(Interp_x86)
+
+static void resize_nearest_integer_image(const Mat& src, Mat& dst, int scale_x, int scale_y)
+{
+    int w = src.w;
+    int h = src.h;
+    int outw = dst.w;
+
+    for (int y = 0; y < h; y++)
+    {
+        const float* S = src.row(y);
+        float* D = dst.row(y * scale_y);
+
+        int x = 0;
+        if (scale_x == 2)
+        {
+#if __AVX__
+            for (; x+7<w; x+=8)
+            {
+                __m256 _p = _mm256_loadu_ps(S + x);
+                __m256 _lo = _mm256_unpacklo_ps(_p, _p);
+                __m256 _hi = _mm256_unpackhi_ps(_p, _p);
+                _mm256_storeu_ps(D + x*2, _mm256_permute2f128_ps(_lo, _hi, 0x20));
+                _mm256_storeu_ps(D + x*2 + 8, _mm256_permute2f128_ps(_lo, _hi, 0x31));
+            }
+#endif // __AVX__
+#if __SSE2__
+            for (; x+3<w; x+=4)
+            {
+                __m128 _p = _mm_loadu_ps(S + x);
+                _mm_storeu_ps(D + x*2, _mm_unpacklo_ps(_p, _p));
+                _mm_storeu_ps(D + x*2 + 4, _mm_unpackhi_ps(_p, _p));
+            }
+#endif // __SSE2__
+        }
+        else if (scale_x == 4)
+        {
+#if __SSE2__
+            for (; x+3<w; x+=4)
+            {
+                __m128 _p = _mm_loadu_ps(S + x);
+                _mm_storeu_ps(D + x*4, _mm_shuffle_ps(_p, _p, _MM_SHUFFLE(0, 0, 0, 0)));
+                _mm_storeu_ps(D + x*4 + 4, _mm_shuffle_ps(_p, _p, _MM_SHUFFLE(1, 1, 1, 1)));
+                _mm_storeu_ps(D + x*4 + 8, _mm_shuffle_ps(_p, _p, _MM_SHUFFLE(2, 2, 2, 2)));
+                _mm_storeu_ps(D + x*4 + 12, _mm_shuffle_ps(_p, _p, _MM_SHUFFLE(3, 3, 3, 3)));
+            }
+#endif // __SSE2__
+        }
+        for (; x<w; x++)
+        {
+            float v = S[x];
+            for (int k = 0; k < scale_x; k++)
+            {
+                D[x * scale_x + k] = v;
+            }
+        }
+
+        // the other output rows of this input row are plain copies
+        for (int k = 1; k < scale_y; k++)
+        {
+            memcpy(D + outw * k, D, outw * sizeof(float));
+        }
+    }
+}
+
+static void resize_nearest_image(const Mat& src, Mat& dst, const int* xofs, const int* yofs)
+{
+    int w = dst.w;
+    int h = dst.h;
+
+    for (int dy = 0; dy < h; dy++)
+    {
+        float* D = dst.row(dy);
+
+        if (dy > 0 && yofs[dy] == yofs[dy-1])
+        {
+            memcpy(D, dst.row(dy-1), w * sizeof(float));
+            continue;
+        }
+
+        const float* S = src.row(yofs[dy]);
+        for (int dx = 0; dx < w; dx++)
+        {
+            D[dx] = S[xofs[dx]];
+        }
+    }
+}
+
+static void hresize_linear(const float* S, float* rows, const float* alpha, const int* xofs, int w)
+{
+    int dx = 0;
+#if __SSE2__
+    for (; dx+3<w; dx+=4)
+    {
+        // two taps of four outputs, then split the products into even and odd lanes
+        __m128 _S01 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(S + xofs[dx])), (const __m64*)(S + xofs[dx+1]));
+        __m128 _S23 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(S + xofs[dx+2])), (const __m64*)(S + xofs[dx+3]));
+        __m128 _m01 = _mm_mul_ps(_S01, _mm_loadu_ps(alpha));
+        __m128 _m23 = _mm_mul_ps(_S23, _mm_loadu_ps(alpha + 4));
+        __m128 _even = _mm_shuffle_ps(_m01, _m23, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 _odd = _mm_shuffle_ps(_m01, _m23, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(rows + dx, _mm_add_ps(_even, _odd));
+
+        alpha += 8;
+    }
+#endif // __SSE2__
+    for (; dx<w; dx++)
+    {
+        const float* Sp = S + xofs[dx];
+        rows[dx] = Sp[0]*alpha[0] + Sp[1]*alpha[1];
+
+        alpha += 2;
+    }
+}
+
+static void resize_bilinear_image(const Mat& src, Mat& dst, const float* alpha, const int* xofs, const float* beta, const int* yofs)
+{
+    int w = dst.w;
+    int h = dst.h;
+
+    // loop body
+    Mat rowsbuf0(w);
+    Mat rowsbuf1(w);
+    float* rows0 = rowsbuf0;
+    float* rows1 = rowsbuf1;
+
+    int prev_sy1 = -2;
+
+    for (int dy = 0; dy < h; dy++ )
+    {
+        int sy = yofs[dy];
+
+        if (sy == prev_sy1)
+        {
+            // reuse all rows
+        }
+        else if (sy == prev_sy1 + 1)
+        {
+            // hresize one row
+            float* rows0_old = rows0;
+            rows0 = rows1;
+            rows1 = rows0_old;
+
+            hresize_linear(src.row(sy+1), rows1, alpha, xofs, w);
+        }
+        else
+        {
+            // hresize two rows
+            hresize_linear(src.row(sy), rows0, alpha, xofs, w);
+            hresize_linear(src.row(sy+1), rows1, alpha, xofs, w);
+        }
+
+        prev_sy1 = sy;
+
+        // vresize
+        float b0 = beta[0];
+        float b1 = beta[1];
+
+        const float* rows0p = rows0;
+        const float* rows1p = rows1;
+        float* Dp = dst.row(dy);
+
+        int dx = 0;
+#if __AVX__
+        __m256 _b0_avx = _mm256_set1_ps(b0);
+        __m256 _b1_avx = _mm256_set1_ps(b1);
+        for (; dx+7<w; dx+=8)
+        {
+            __m256 _rows0 = _mm256_loadu_ps(rows0p + dx);
+            __m256 _rows1 = _mm256_loadu_ps(rows1p + dx);
+            _mm256_storeu_ps(Dp + dx, _mm256_fmadd_ps(_rows1, _b1_avx, _mm256_mul_ps(_rows0, _b0_avx)));
+        }
+#endif // __AVX__
+#if __SSE2__
+        __m128 _b0 = _mm_set1_ps(b0);
+        __m128 _b1 = _mm_set1_ps(b1);
+        for (; dx+3<w; dx+=4)
+        {
+            __m128 _rows0 = _mm_loadu_ps(rows0p + dx);
+            __m128 _rows1 = _mm_loadu_ps(rows1p + dx);
+            _mm_storeu_ps(Dp + dx, _mm_add_ps(_mm_mul_ps(_rows0, _b0), _mm_mul_ps(_rows1, _b1)));
+        }
+#endif // __SSE2__
+        for (; dx<w; dx++)
+        {
+            Dp[dx] = rows0p[dx] * b0 + rows1p[dx] * b1;
+        }
+
+        beta += 2;
+    }
+}
+
+int Interp_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    int h = bottom_blob.h;
+    int w = bottom_blob.w;
+    int channels = bottom_blob.c;
+    int dims = bottom_blob.dims;
+    size_t elemsize = bottom_blob.elemsize;
+
+    if ((resize_type != 1 && resize_type != 2) || dims == 1)
+    {
+        return Interp::forward(bottom_blob, top_blob, opt);
+    }
+
+    int outh = output_height;
+    int outw = output_width;
+
+    if (outh == 0 || outw == 0)
+    {
+        outh = h * height_scale;
+        outw = w * width_scale;
+    }
+
+    if (outh == h && outw == w)
+    {
+        top_blob = bottom_blob;
+        return 0;
+    }
+
+    top_blob.create(outw, outh, channels, elemsize, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    if (resize_type == 1)
+    {
+        // integer upsample factors map every output pixel to x / scale, no table needed
+        int scale_x = outw / w;
+        int scale_y = outh / h;
+        if (outw == w * scale_x && outh == h * scale_y && width_scale == scale_x && height_scale == scale_y)
+        {
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int q = 0; q < channels; q++)
+            {
+                const Mat src = bottom_blob.channel(q);
+                Mat dst = top_blob.channel(q);
+
+                resize_nearest_integer_image(src, dst, scale_x, scale_y);
+            }
+
+            return 0;
+        }
+
+        Mat tab = get_resize_coeffs(w, h, outw, outh);
+        if (tab.empty())
+            return -100;
+
+        const int* xofs = tab;
+        const int* yofs = xofs + outw;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q = 0; q < channels; q++)
+        {
+            const Mat src = bottom_blob.channel(q);
+            Mat dst = top_blob.channel(q);
+
+            resize_nearest_image(src, dst, xofs, yofs);
+        }
+
+        return 0;
+    }
+
+    Mat tab = get_resize_coeffs(w, h, outw, outh);
+    if (tab.empty())
+        return -100;
+
+    const int* xofs = tab;
+    const int* yofs = xofs + outw;
+    const float* alpha = (const float*)(yofs + outh);
+    const float* beta = alpha + outw*2;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < channels; q++)
+    {
+        const Mat src = bottom_blob.channel(q);
+        Mat dst = top_blob.channel(q);
+
+        resize_bilinear_image(src, dst, alpha, xofs, beta, yofs);
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,261 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "lrn_x86.h"
+
+#include <math.h>
+#include <algorithm>
+
+#if __SSE2__
+#include <emmintrin.h>
+#include "sse_mathfun.h"
+#endif // __SSE2__
+#if __AVX__
+#include <immintrin.h>
+#include "avx_mathfun.h"
+#endif // __AVX__
+
+namespace ncnn {
+
+DEFINE_LAYER_CREATOR(LRN_x86)
+
+LRN_x86::LRN_x86()
+{
+}
+
+// outptr = a + b
+static void lrn_add(const float* a, const float* b, float* outptr, int size)
+{
+    int i = 0;
+#if __AVX__
+    for (; i+7<size; i+=8)
+    {
+        _mm256_storeu_ps(outptr + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+#endif // __AVX__
+#if __SSE2__
+    for (; i+3<size; i+=4)
+    {
+        _mm_storeu_ps(outptr + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        outptr[i] = a[i] + b[i];
+    }
+}
+
+// value = value * pow(bias + alpha_div_size * ss, -beta)
+static void lrn_norm(float* ptr, const float* ssptr, int size, float bias, float alpha_div_size, float beta)
+{
+    // beta 0.75 of alexnet and googlenet is x / (sqrt(x) * sqrt(sqrt(x)))
+    const bool beta_075 = beta == 0.75f;
+
+    int i = 0;
+#if __AVX__
+    __m256 _bias_avx = _mm256_set1_ps(bias);
+    __m256 _alpha_avx = _mm256_set1_ps(alpha_div_size);
+    __m256 _nbeta_avx = _mm256_set1_ps(-beta);
+    for (; i+7<size; i+=8)
+    {
+        __m256 _x = _mm256_fmadd_ps(_mm256_loadu_ps(ssptr + i), _alpha_avx, _bias_avx);
+        __m256 _p = _mm256_loadu_ps(ptr + i);
+        if (beta_075)
+        {
+            __m256 _sqrt = _mm256_sqrt_ps(_x);
+            _p = _mm256_div_ps(_p, _mm256_mul_ps(_sqrt, _mm256_sqrt_ps(_sqrt)));
+        }
+        else
+        {
+            _p = _mm256_mul_ps(_p, pow256_ps(_x, _nbeta_avx));
+        }
+        _mm256_storeu_ps(ptr + i, _p);
+    }
+#endif // __AVX__
+#if __SSE2__
+    __m128 _bias = _mm_set1_ps(bias);
+    __m128 _alpha = _mm_set1_ps(alpha_div_size);
+    __m128 _nbeta = _mm_set1_ps(-beta);
+    for (; i+3<size; i+=4)
+    {
+        __m128 _x = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(ssptr + i), _alpha), _bias);
+        __m128 _p = _mm_loadu_ps(ptr + i);
+        if (beta_075)
+        {
+            __m128 _sqrt = _mm_sqrt_ps(_x);
+            _p = _mm_div_ps(_p, _mm_mul_ps(_sqrt, _mm_sqrt_ps(_sqrt)));
+        }
+        else
+        {
+            _p = _mm_mul_ps(_p, pow_ps(_x, _nbeta));
+        }
+        _mm_storeu_ps(ptr + i, _p);
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        ptr[i] = ptr[i] * pow(bias + alpha_div_size * ssptr[i], -beta);
+    }
+}
+
+int LRN_x86::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
+{
+    int w = bottom_top_blob.w;
+    int h = bottom_top_blob.h;
+    int channels = bottom_top_blob.c;
+    size_t elemsize = bottom_top_blob.elemsize;
+    int size = w * h;
+
+    // squared values with local_size padding
+    Mat square_blob;
+    square_blob.create(w, h, channels, elemsize, opt.workspace_allocator);
+    if (square_blob.empty())
+        return -100;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<channels; q++)
+    {
+        const float* ptr = bottom_top_blob.channel(q);
+        float* outptr = square_blob.channel(q);
+
+        int i = 0;
+#if __AVX__
+        for (; i+7<size; i+=8)
+        {
+            __m256 _p = _mm256_loadu_ps(ptr + i);
+            _mm256_storeu_ps(outptr + i, _mm256_mul_ps(_p, _p));
+        }
+#endif // __AVX__
+#if __SSE2__
+        for (; i+3<size; i+=4)
+        {
+            __m128 _p = _mm_loadu_ps(ptr + i);
+            _mm_storeu_ps(outptr + i, _mm_mul_ps(_p, _p));
+        }
+#endif // __SSE2__
+        for (; i<size; i++)
+        {
+            outptr[i] = ptr[i] * ptr[i];
+        }
+    }
+
+    if (region_type == NormRegion_ACROSS_CHANNELS)
+    {
+        Mat square_sum;
+        square_sum.create(w, h, channels, elemsize, opt.workspace_allocator);
+        if (square_sum.empty())
+            return -100;
+
+        const float alpha_div_size = alpha / local_size;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            // square sum
+            float* ssptr = square_sum.channel(q);
+
+            int p0 = std::max(q - local_size / 2, 0);
+            int p1 = std::min(q + local_size / 2, channels - 1);
+            if (p0 == p1)
+            {
+                const float* sptr = square_blob.channel(p0);
+                for (int i=0; i<size; i++)
+                {
+                    ssptr[i] = sptr[i];
+                }
+            }
+            else
+            {
+                lrn_add(square_blob.channel(p0), square_blob.channel(p0 + 1), ssptr, size);
+                for (int p=p0 + 2; p<=p1; p++)
+                {
+                    lrn_add(ssptr, square_blob.channel(p), ssptr, size);
+                }
+            }
+
+            lrn_norm(bottom_top_blob.channel(q), ssptr, size, bias, alpha_div_size, beta);
+        }
+    }
+    else if (region_type == NormRegion_WITHIN_CHANNEL)
+    {
+        int outw = w;
+        int outh = h;
+
+        Mat square_blob_bordered = square_blob;
+        int pad = local_size / 2;
+        if (pad > 0)
+        {
+            Option opt_b = opt;
+            opt_b.blob_allocator = opt.workspace_allocator;
+            copy_make_border(square_blob, square_blob_bordered, pad, local_size - pad - 1, pad, local_size - pad - 1, BORDER_CONSTANT, 0.f, opt_b);
+            if (square_blob_bordered.empty())
+                return -100;
+
+            w = square_blob_bordered.w;
+            h = square_blob_bordered.h;
+        }
+
+        const int maxk = local_size * local_size;
+
+        const float alpha_div_size = alpha / maxk;
+
+        // per channel scratch, the vertical window sum of a bordered row and the box sum of an output row
+        Mat sum_rows;
+        sum_rows.create(w + outw, channels, 4u, opt.workspace_allocator);
+        if (sum_rows.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            float* ptr = bottom_top_blob.channel(q);
+            const Mat m = square_blob_bordered.channel(q);
+
+            float* vsum = sum_rows.row(q);
+            float* ssptr = vsum + w;
+
+            for (int i = 0; i < outh; i++)
+            {
+                // separable box sum, rows first
+                const float* r0 = m.row(i);
+                for (int j = 0; j < w; j++)
+                {
+                    vsum[j] = r0[j];
+                }
+                for (int k = 1; k < local_size; k++)
+                {
+                    lrn_add(vsum, m.row(i + k), vsum, w);
+                }
+
+                // then the columns of the window
+                for (int j = 0; j < outw; j++)
+                {
+                    ssptr[j] = vsum[j];
+                }
+                for (int k = 1; k < local_size; k++)
+                {
+                    lrn_add(ssptr, vsum + k, ssptr, outw);
+                }
+
+                lrn_norm(ptr, ssptr, outw, bias, alpha_div_size, beta);
+
+                ptr += outw;
+            }
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
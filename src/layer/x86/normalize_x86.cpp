@@ -0,0 +1,318 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "normalize_x86.h"
+
+#include <math.h>
+#include <algorithm>
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+#if __AVX__
+#include <immintrin.h>
+#endif // __AVX__
+
+namespace ncnn {
+
+DEFINE_LAYER_CREATOR(Normalize_x86)
+
+Normalize_x86::Normalize_x86()
+{
+}
+
+#if __AVX__
+static inline float reduce_add_ps256(__m256 x)
+{
+    __m128 x4 = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+    x4 = _mm_add_ps(x4, _mm_movehl_ps(x4, x4));
+    x4 = _mm_add_ss(x4, _mm_shuffle_ps(x4, x4, 1));
+    return _mm_cvtss_f32(x4);
+}
+#endif // __AVX__
+
+#if __SSE2__
+static inline float reduce_add_ps(__m128 x)
+{
+    x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+    x = _mm_add_ss(x, _mm_shuffle_ps(x, x, 1));
+    return _mm_cvtss_f32(x);
+}
+#endif // __SSE2__
+
+static float normalize_square_sum(const float* ptr, int size)
+{
+    float ssum = 0.f;
+
+    int i = 0;
+#if __AVX__
+    __m256 _ssum_avx = _mm256_setzero_ps();
+    for (; i+7<size; i+=8)
+    {
+        __m256 _p = _mm256_loadu_ps(ptr + i);
+        _ssum_avx = _mm256_fmadd_ps(_p, _p, _ssum_avx);
+    }
+    ssum += reduce_add_ps256(_ssum_avx);
+#endif // __AVX__
+#if __SSE2__
+    __m128 _ssum = _mm_setzero_ps();
+    for (; i+3<size; i+=4)
+    {
+        __m128 _p = _mm_loadu_ps(ptr + i);
+        _ssum = _mm_add_ps(_ssum, _mm_mul_ps(_p, _p));
+    }
+    ssum += reduce_add_ps(_ssum);
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        ssum += ptr[i] * ptr[i];
+    }
+
+    return ssum;
+}
+
+// ssptr += value * value
+static void normalize_square_acc(const float* ptr, float* ssptr, int size)
+{
+    int i = 0;
+#if __AVX__
+    for (; i+7<size; i+=8)
+    {
+        __m256 _p = _mm256_loadu_ps(ptr + i);
+        _mm256_storeu_ps(ssptr + i, _mm256_fmadd_ps(_p, _p, _mm256_loadu_ps(ssptr + i)));
+    }
+#endif // __AVX__
+#if __SSE2__
+    for (; i+3<size; i+=4)
+    {
+        __m128 _p = _mm_loadu_ps(ptr + i);
+        _mm_storeu_ps(ssptr + i, _mm_add_ps(_mm_loadu_ps(ssptr + i), _mm_mul_ps(_p, _p)));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        ssptr[i] += ptr[i] * ptr[i];
+    }
+}
+
+static float normalize_coeff(float ssum, float eps, int eps_mode)
+{
+    if (eps_mode == 0) // caffe/mxnet
+        return 1.f / sqrt(ssum + eps);
+
+    if (eps_mode == 1) // pytorch
+        return 1.f / std::max((float)sqrt(ssum), eps);
+
+    // eps_mode == 2 tensorflow
+    return 1.f / sqrt(std::max(ssum, eps));
+}
+
+// ssptr = normalize_coeff(ssptr) * scale
+static void normalize_coeff_vector(float* ssptr, int size, float eps, int eps_mode, float scale)
+{
+    int i = 0;
+#if __AVX__
+    __m256 _eps_avx = _mm256_set1_ps(eps);
+    __m256 _scale_avx = _mm256_set1_ps(scale);
+    for (; i+7<size; i+=8)
+    {
+        __m256 _ss = _mm256_loadu_ps(ssptr + i);
+        __m256 _d;
+        if (eps_mode == 0)
+            _d = _mm256_sqrt_ps(_mm256_add_ps(_ss, _eps_avx));
+        else if (eps_mode == 1)
+            _d = _mm256_max_ps(_mm256_sqrt_ps(_ss), _eps_avx);
+        else
+            _d = _mm256_sqrt_ps(_mm256_max_ps(_ss, _eps_avx));
+        _mm256_storeu_ps(ssptr + i, _mm256_div_ps(_scale_avx, _d));
+    }
+#endif // __AVX__
+#if __SSE2__
+    __m128 _eps = _mm_set1_ps(eps);
+    __m128 _scale = _mm_set1_ps(scale);
+    for (; i+3<size; i+=4)
+    {
+        __m128 _ss = _mm_loadu_ps(ssptr + i);
+        __m128 _d;
+        if (eps_mode == 0)
+            _d = _mm_sqrt_ps(_mm_add_ps(_ss, _eps));
+        else if (eps_mode == 1)
+            _d = _mm_max_ps(_mm_sqrt_ps(_ss), _eps);
+        else
+            _d = _mm_sqrt_ps(_mm_max_ps(_ss, _eps));
+        _mm_storeu_ps(ssptr + i, _mm_div_ps(_scale, _d));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        ssptr[i] = normalize_coeff(ssptr[i], eps, eps_mode) * scale;
+    }
+}
+
+static void normalize_mul(float* ptr, int size, float s)
+{
+    int i = 0;
+#if __AVX__
+    __m256 _s_avx = _mm256_set1_ps(s);
+    for (; i+7<size; i+=8)
+    {
+        _mm256_storeu_ps(ptr + i, _mm256_mul_ps(_mm256_loadu_ps(ptr + i), _s_avx));
+    }
+#endif // __AVX__
+#if __SSE2__
+    __m128 _s = _mm_set1_ps(s);
+    for (; i+3<size; i+=4)
+    {
+        _mm_storeu_ps(ptr + i, _mm_mul_ps(_mm_loadu_ps(ptr + i), _s));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        ptr[i] *= s;
+    }
+}
+
+// value = value * sptr * s
+static void normalize_mul_vector(float* ptr, const float* sptr, int size, float s)
+{
+    int i = 0;
+#if __AVX__
+    __m256 _s_avx = _mm256_set1_ps(s);
+    for (; i+7<size; i+=8)
+    {
+        __m256 _p = _mm256_mul_ps(_mm256_loadu_ps(ptr + i), _mm256_loadu_ps(sptr + i));
+        _mm256_storeu_ps(ptr + i, _mm256_mul_ps(_p, _s_avx));
+    }
+#endif // __AVX__
+#if __SSE2__
+    __m128 _s = _mm_set1_ps(s);
+    for (; i+3<size; i+=4)
+    {
+        __m128 _p = _mm_mul_ps(_mm_loadu_ps(ptr + i), _mm_loadu_ps(sptr + i));
+        _mm_storeu_ps(ptr + i, _mm_mul_ps(_p, _s));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        ptr[i] = ptr[i] * sptr[i] * s;
+    }
+}
+
+int Normalize_x86::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
+{
+    int w = bottom_top_blob.w;
+    int h = bottom_top_blob.h;
+    int channels = bottom_top_blob.c;
+    size_t elemsize = bottom_top_blob.elemsize;
+    int size = w * h;
+
+    if (across_spatial && across_channel)
+    {
+        // square
+        Mat square_sum_blob;
+        square_sum_blob.create(channels, elemsize, opt.workspace_allocator);
+        if (square_sum_blob.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            square_sum_blob[q] = normalize_square_sum(bottom_top_blob.channel(q), size);
+        }
+
+        float ssum = 0.f;
+        for (int q=0; q<channels; q++)
+        {
+            ssum += square_sum_blob[q];
+        }
+
+        float a = normalize_coeff(ssum, eps, eps_mode);
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            float scale = a * (channel_shared ? scale_data[0] : scale_data[q]);
+
+            normalize_mul(bottom_top_blob.channel(q), size, scale);
+        }
+
+        return 0;
+    }
+
+    if (across_spatial && !across_channel)
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            float* ptr = bottom_top_blob.channel(q);
+
+            float a = normalize_coeff(normalize_square_sum(ptr, size), eps, eps_mode);
+
+            float scale = a * (channel_shared ? scale_data[0] : scale_data[q]);
+
+            normalize_mul(ptr, size, scale);
+        }
+
+        return 0;
+    }
+
+    if (!across_spatial && across_channel)
+    {
+        // square sum, 1 / sqrt(ssum)
+        Mat square_sum_blob;
+        square_sum_blob.create(size, elemsize, opt.workspace_allocator);
+        if (square_sum_blob.empty())
+            return -100;
+
+        const float shared_scale = channel_shared ? scale_data[0] : 1.f;
+
+        // accumulate over channels in column blocks so every block stays in cache
+        const int block = 256;
+        int nn_block = (size + block - 1) / block;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int b=0; b<nn_block; b++)
+        {
+            int i = b * block;
+            int len = std::min(block, size - i);
+
+            float* ssptr = (float*)square_sum_blob + i;
+            for (int j=0; j<len; j++)
+            {
+                ssptr[j] = 0.f;
+            }
+
+            for (int q=0; q<channels; q++)
+            {
+                normalize_square_acc((const float*)bottom_top_blob.channel(q) + i, ssptr, len);
+            }
+
+            normalize_coeff_vector(ssptr, len, eps, eps_mode, shared_scale);
+        }
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            float scale = channel_shared ? 1.f : scale_data[q];
+
+            normalize_mul_vector(bottom_top_blob.channel(q), square_sum_blob, size, scale);
+        }
+
+        return 0;
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
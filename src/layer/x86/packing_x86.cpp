@@ -0,0 +1,369 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "packing_x86.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+#if __AVX__
+#include <immintrin.h>
+#endif // __AVX__
+
+namespace ncnn {
+
+DEFINE_LAYER_CREATOR(Packing_x86)
+
+Packing_x86::Packing_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+// interleave elempack planes of size elements
+static void pack_planes(const float** rows, float* outptr, int size, int out_elempack)
+{
+    int i = 0;
+#if __AVX__
+    if (out_elempack == 8)
+    {
+        const float* r0 = rows[0];
+        const float* r1 = rows[1];
+        const float* r2 = rows[2];
+        const float* r3 = rows[3];
+        const float* r4 = rows[4];
+        const float* r5 = rows[5];
+        const float* r6 = rows[6];
+        const float* r7 = rows[7];
+
+        for (; i+7<size; i+=8)
+        {
+            __m256 _r0 = _mm256_loadu_ps(r0 + i);
+            __m256 _r1 = _mm256_loadu_ps(r1 + i);
+            __m256 _r2 = _mm256_loadu_ps(r2 + i);
+            __m256 _r3 = _mm256_loadu_ps(r3 + i);
+            __m256 _r4 = _mm256_loadu_ps(r4 + i);
+            __m256 _r5 = _mm256_loadu_ps(r5 + i);
+            __m256 _r6 = _mm256_loadu_ps(r6 + i);
+            __m256 _r7 = _mm256_loadu_ps(r7 + i);
+
+            // 8x8 transpose
+            __m256 _t0 = _mm256_unpacklo_ps(_r0, _r1);
+            __m256 _t1 = _mm256_unpackhi_ps(_r0, _r1);
+            __m256 _t2 = _mm256_unpacklo_ps(_r2, _r3);
+            __m256 _t3 = _mm256_unpackhi_ps(_r2, _r3);
+            __m256 _t4 = _mm256_unpacklo_ps(_r4, _r5);
+            __m256 _t5 = _mm256_unpackhi_ps(_r4, _r5);
+            __m256 _t6 = _mm256_unpacklo_ps(_r6, _r7);
+            __m256 _t7 = _mm256_unpackhi_ps(_r6, _r7);
+
+            __m256 _s0 = _mm256_shuffle_ps(_t0, _t2, _MM_SHUFFLE(1, 0, 1, 0));
+            __m256 _s1 = _mm256_shuffle_ps(_t0, _t2, _MM_SHUFFLE(3, 2, 3, 2));
+            __m256 _s2 = _mm256_shuffle_ps(_t1, _t3, _MM_SHUFFLE(1, 0, 1, 0));
+            __m256 _s3 = _mm256_shuffle_ps(_t1, _t3, _MM_SHUFFLE(3, 2, 3, 2));
+            __m256 _s4 = _mm256_shuffle_ps(_t4, _t6, _MM_SHUFFLE(1, 0, 1, 0));
+            __m256 _s5 = _mm256_shuffle_ps(_t4, _t6, _MM_SHUFFLE(3, 2, 3, 2));
+            __m256 _s6 = _mm256_shuffle_ps(_t5, _t7, _MM_SHUFFLE(1, 0, 1, 0));
+            __m256 _s7 = _mm256_shuffle_ps(_t5, _t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+            _mm256_storeu_ps(outptr, _mm256_permute2f128_ps(_s0, _s4, 0x20));
+            _mm256_storeu_ps(outptr + 8, _mm256_permute2f128_ps(_s1, _s5, 0x20));
+            _mm256_storeu_ps(outptr + 16, _mm256_permute2f128_ps(_s2, _s6, 0x20));
+            _mm256_storeu_ps(outptr + 24, _mm256_permute2f128_ps(_s3, _s7, 0x20));
+            _mm256_storeu_ps(outptr + 32, _mm256_permute2f128_ps(_s0, _s4, 0x31));
+            _mm256_storeu_ps(outptr + 40, _mm256_permute2f128_ps(_s1, _s5, 0x31));
+            _mm256_storeu_ps(outptr + 48, _mm256_permute2f128_ps(_s2, _s6, 0x31));
+            _mm256_storeu_ps(outptr + 56, _mm256_permute2f128_ps(_s3, _s7, 0x31));
+
+            outptr += 64;
+        }
+    }
+#endif // __AVX__
+#if __SSE2__
+    if (out_elempack == 4)
+    {
+        const float* r0 = rows[0];
+        const float* r1 = rows[1];
+        const float* r2 = rows[2];
+        const float* r3 = rows[3];
+
+        for (; i+3<size; i+=4)
+        {
+            __m128 _r0 = _mm_loadu_ps(r0 + i);
+            __m128 _r1 = _mm_loadu_ps(r1 + i);
+            __m128 _r2 = _mm_loadu_ps(r2 + i);
+            __m128 _r3 = _mm_loadu_ps(r3 + i);
+
+            _MM_TRANSPOSE4_PS(_r0, _r1, _r2, _r3);
+
+            _mm_storeu_ps(outptr, _r0);
+            _mm_storeu_ps(outptr + 4, _r1);
+            _mm_storeu_ps(outptr + 8, _r2);
+            _mm_storeu_ps(outptr + 12, _r3);
+
+            outptr += 16;
+        }
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        for (int k=0; k<out_elempack; k++)
+        {
+            outptr[k] = rows[k][i];
+        }
+
+        outptr += out_elempack;
+    }
+}
+
+// split size elements of elempack lanes into elempack planes
+static void unpack_planes(const float* ptr, float** rows, int size, int elempack)
+{
+    int i = 0;
+#if __AVX__
+    if (elempack == 8)
+    {
+        float* r0 = rows[0];
+        float* r1 = rows[1];
+        float* r2 = rows[2];
+        float* r3 = rows[3];
+        float* r4 = rows[4];
+        float* r5 = rows[5];
+        float* r6 = rows[6];
+        float* r7 = rows[7];
+
+        for (; i+7<size; i+=8)
+        {
+            __m256 _r0 = _mm256_loadu_ps(ptr);
+            __m256 _r1 = _mm256_loadu_ps(ptr + 8);
+            __m256 _r2 = _mm256_loadu_ps(ptr + 16);
+            __m256 _r3 = _mm256_loadu_ps(ptr + 24);
+            __m256 _r4 = _mm256_loadu_ps(ptr + 32);
+            __m256 _r5 = _mm256_loadu_ps(ptr + 40);
+            __m256 _r6 = _mm256_loadu_ps(ptr + 48);
+            __m256 _r7 = _mm256_loadu_ps(ptr + 56);
+
+            // 8x8 transpose
+            __m256 _t0 = _mm256_unpacklo_ps(_r0, _r1);
+            __m256 _t1 = _mm256_unpackhi_ps(_r0, _r1);
+            __m256 _t2 = _mm256_unpacklo_ps(_r2, _r3);
+            __m256 _t3 = _mm256_unpackhi_ps(_r2, _r3);
+            __m256 _t4 = _mm256_unpacklo_ps(_r4, _r5);
+            __m256 _t5 = _mm256_unpackhi_ps(_r4, _r5);
+            __m256 _t6 = _mm256_unpacklo_ps(_r6, _r7);
+            __m256 _t7 = _mm256_unpackhi_ps(_r6, _r7);
+
+            __m256 _s0 = _mm256_shuffle_ps(_t0, _t2, _MM_SHUFFLE(1, 0, 1, 0));
+            __m256 _s1 = _mm256_shuffle_ps(_t0, _t2, _MM_SHUFFLE(3, 2, 3, 2));
+            __m256 _s2 = _mm256_shuffle_ps(_t1, _t3, _MM_SHUFFLE(1, 0, 1, 0));
+            __m256 _s3 = _mm256_shuffle_ps(_t1, _t3, _MM_SHUFFLE(3, 2, 3, 2));
+            __m256 _s4 = _mm256_shuffle_ps(_t4, _t6, _MM_SHUFFLE(1, 0, 1, 0));
+            __m256 _s5 = _mm256_shuffle_ps(_t4, _t6, _MM_SHUFFLE(3, 2, 3, 2));
+            __m256 _s6 = _mm256_shuffle_ps(_t5, _t7, _MM_SHUFFLE(1, 0, 1, 0));
+            __m256 _s7 = _mm256_shuffle_ps(_t5, _t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+            _mm256_storeu_ps(r0 + i, _mm256_permute2f128_ps(_s0, _s4, 0x20));
+            _mm256_storeu_ps(r1 + i, _mm256_permute2f128_ps(_s1, _s5, 0x20));
+            _mm256_storeu_ps(r2 + i, _mm256_permute2f128_ps(_s2, _s6, 0x20));
+            _mm256_storeu_ps(r3 + i, _mm256_permute2f128_ps(_s3, _s7, 0x20));
+            _mm256_storeu_ps(r4 + i, _mm256_permute2f128_ps(_s0, _s4, 0x31));
+            _mm256_storeu_ps(r5 + i, _mm256_permute2f128_ps(_s1, _s5, 0x31));
+            _mm256_storeu_ps(r6 + i, _mm256_permute2f128_ps(_s2, _s6, 0x31));
+            _mm256_storeu_ps(r7 + i, _mm256_permute2f128_ps(_s3, _s7, 0x31));
+
+            ptr += 64;
+        }
+    }
+#endif // __AVX__
+#if __SSE2__
+    if (elempack == 4)
+    {
+        float* r0 = rows[0];
+        float* r1 = rows[1];
+        float* r2 = rows[2];
+        float* r3 = rows[3];
+
+        for (; i+3<size; i+=4)
+        {
+            __m128 _r0 = _mm_loadu_ps(ptr);
+            __m128 _r1 = _mm_loadu_ps(ptr + 4);
+            __m128 _r2 = _mm_loadu_ps(ptr + 8);
+            __m128 _r3 = _mm_loadu_ps(ptr + 12);
+
+            _MM_TRANSPOSE4_PS(_r0, _r1, _r2, _r3);
+
+            _mm_storeu_ps(r0 + i, _r0);
+            _mm_storeu_ps(r1 + i, _r1);
+            _mm_storeu_ps(r2 + i, _r2);
+            _mm_storeu_ps(r3 + i, _r3);
+
+            ptr += 16;
+        }
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        for (int k=0; k<elempack; k++)
+        {
+            rows[k][i] = ptr[k];
+        }
+
+        ptr += elempack;
+    }
+}
+
+int Packing_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    if (use_padding)
+    {
+        return Packing::forward(bottom_blob, top_blob, opt);
+    }
+
+    int elempack = bottom_blob.elempack;
+
+    if (elempack == out_elempack)
+    {
+        top_blob = bottom_blob;
+        return 0;
+    }
+
+    bool pack1ton = elempack == 1 && (out_elempack == 4 || out_elempack == 8);
+    bool packnto1 = (elempack == 4 || elempack == 8) && out_elempack == 1;
+
+    if ((!pack1ton && !packnto1) || bottom_blob.elemsize / elempack != 4u)
+    {
+        return Packing::forward(bottom_blob, top_blob, opt);
+    }
+
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int channels = bottom_blob.c;
+    int dims = bottom_blob.dims;
+    size_t elemsize = bottom_blob.elemsize;
+
+    // identity if use_padding not allowed
+    if (dims == 1 && w * elempack % out_elempack != 0)
+    {
+        top_blob = bottom_blob;
+        return 0;
+    }
+    if (dims == 2 && h * elempack % out_elempack != 0)
+    {
+        top_blob = bottom_blob;
+        return 0;
+    }
+    if (dims == 3 && channels * elempack % out_elempack != 0)
+    {
+        top_blob = bottom_blob;
+        return 0;
+    }
+
+    if (dims == 1)
+    {
+        top_blob = bottom_blob;
+        top_blob.w = w * elempack / out_elempack;
+        top_blob.cstep = w * elempack / out_elempack;
+        top_blob.elemsize = elemsize / elempack * out_elempack;
+        top_blob.elempack = out_elempack;
+        return 0;
+    }
+
+    size_t out_elemsize = elemsize / elempack * out_elempack;
+
+    if (dims == 2)
+    {
+        int outh = h * elempack / out_elempack;
+
+        top_blob.create(w, outh, out_elemsize, out_elempack, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        if (pack1ton)
+        {
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int i=0; i<outh; i++)
+            {
+                const float* rows[8];
+                for (int k=0; k<out_elempack; k++)
+                {
+                    rows[k] = bottom_blob.row(i * out_elempack + k);
+                }
+
+                pack_planes(rows, top_blob.row(i), w, out_elempack);
+            }
+        }
+        if (packnto1)
+        {
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int i=0; i<h; i++)
+            {
+                float* rows[8];
+                for (int k=0; k<elempack; k++)
+                {
+                    rows[k] = top_blob.row(i * elempack + k);
+                }
+
+                unpack_planes(bottom_blob.row(i), rows, w, elempack);
+            }
+        }
+
+        return 0;
+    }
+
+    if (dims == 3)
+    {
+        int size = w * h;
+        int outc = channels * elempack / out_elempack;
+
+        top_blob.create(w, h, outc, out_elemsize, out_elempack, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        if (pack1ton)
+        {
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int q=0; q<outc; q++)
+            {
+                const float* rows[8];
+                for (int k=0; k<out_elempack; k++)
+                {
+                    rows[k] = bottom_blob.channel(q * out_elempack + k);
+                }
+
+                pack_planes(rows, top_blob.channel(q), size, out_elempack);
+            }
+        }
+        if (packnto1)
+        {
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int q=0; q<channels; q++)
+            {
+                float* rows[8];
+                for (int k=0; k<elempack; k++)
+                {
+                    rows[k] = top_blob.channel(q * elempack + k);
+                }
+
+                unpack_planes(bottom_blob.channel(q), rows, size, elempack);
+            }
+        }
+
+        return 0;
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
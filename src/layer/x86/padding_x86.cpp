@@ -0,0 +1,182 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "padding_x86.h"
+
+#include <string.h>
+#include <algorithm>
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+#if __AVX__
+#include <immintrin.h>
+#endif // __AVX__
+
+namespace ncnn {
+
+DEFINE_LAYER_CREATOR(Padding_x86)
+
+Padding_x86::Padding_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+// constant or replicate border of one packed channel
+static void padding_packn(const Mat& src, Mat& dst, int top, int left, int type, float v)
+{
+    const int elempack = src.elempack;
+    const int w = src.w;
+    const int h = src.h;
+    const int outw = dst.w;
+    const int outh = dst.h;
+
+#if __AVX__
+    __m256 _v_avx = _mm256_set1_ps(v);
+#endif // __AVX__
+#if __SSE2__
+    __m128 _v = _mm_set1_ps(v);
+#endif // __SSE2__
+
+    float* outptr = dst;
+
+    for (int y = 0; y < outh; y++)
+    {
+        int sy = y - top;
+        bool outside_y = sy < 0 || sy >= h;
+        if (type == 1)
+        {
+            sy = std::min(std::max(sy, 0), h - 1);
+            outside_y = false;
+        }
+
+        const float* ptr = outside_y ? 0 : src.row(sy);
+
+        for (int x = 0; x < outw; x++)
+        {
+            int sx = x - left;
+
+            if (!outside_y && sx >= 0 && sx < w)
+            {
+                // the whole source row at once
+                memcpy(outptr, ptr, w * elempack * sizeof(float));
+                outptr += w * elempack;
+                x += w - 1;
+                continue;
+            }
+
+            if (type == 1 && !outside_y)
+            {
+                const float* eptr = ptr + (sx < 0 ? 0 : w - 1) * elempack;
+                memcpy(outptr, eptr, elempack * sizeof(float));
+            }
+#if __AVX__
+            else if (elempack == 8)
+            {
+                _mm256_storeu_ps(outptr, _v_avx);
+            }
+#endif // __AVX__
+#if __SSE2__
+            else if (elempack == 4)
+            {
+                _mm_storeu_ps(outptr, _v);
+            }
+#endif // __SSE2__
+            else
+            {
+                for (int k = 0; k < elempack; k++)
+                {
+                    outptr[k] = v;
+                }
+            }
+
+            outptr += elempack;
+        }
+    }
+}
+
+int Padding_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    if (top == 0 && bottom == 0 && left == 0 && right == 0)
+    {
+        top_blob = bottom_blob;
+        return 0;
+    }
+
+    int elempack = bottom_blob.elempack;
+
+    if (elempack == 1)
+    {
+        return Padding::forward(bottom_blob, top_blob, opt);
+    }
+
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int channels = bottom_blob.c;
+    int dims = bottom_blob.dims;
+    size_t elemsize = bottom_blob.elemsize;
+
+    // only width and height of packed channels pad in place
+    if (dims != 3 || elemsize / elempack != 4u || type > 1)
+    {
+        Option opt_pack = opt;
+        opt_pack.blob_allocator = opt.workspace_allocator;
+
+        Mat bottom_blob_unpacked;
+        convert_packing(bottom_blob, bottom_blob_unpacked, 1, opt_pack);
+
+        return Padding::forward(bottom_blob_unpacked, top_blob, opt);
+    }
+
+    int outw = w + left + right;
+    int outh = h + top + bottom;
+
+    top_blob.create(outw, outh, channels, elemsize, elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<channels; q++)
+    {
+        const Mat m = bottom_blob.channel(q);
+        Mat borderm = top_blob.channel(q);
+
+        padding_packn(m, borderm, top, left, type, value);
+    }
+
+    return 0;
+}
+
+int Padding_x86::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    if (bottom_blobs[0].elempack == 1)
+    {
+        return Padding::forward(bottom_blobs, top_blobs, opt);
+    }
+
+    Option opt_pack = opt;
+    opt_pack.blob_allocator = opt.workspace_allocator;
+
+    std::vector<Mat> bottom_blobs_unpacked(bottom_blobs.size());
+    for (size_t i=0; i<bottom_blobs.size(); i++)
+    {
+        convert_packing(bottom_blobs[i], bottom_blobs_unpacked[i], 1, opt_pack);
+    }
+
+    return Padding::forward(bottom_blobs_unpacked, top_blobs, opt);
+}
+
+} // namespace ncnn
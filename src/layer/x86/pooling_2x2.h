@@ -0,0 +1,140 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#if __AVX2__
+// cols 0 2 4 .. 14 and 1 3 5 .. 15 of the 16 floats in a b
+static inline void deinterleave_ps256(__m256 a, __m256 b, __m256& even, __m256& odd)
+{
+    even = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+    odd = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+#endif // __AVX2__
+
+// n outputs of one row, every window lies inside the input
+static void pooling2x2s2_max_row_sse(const float* r0, const float* r1, float* outptr, int n)
+{
+    int j = 0;
+#if __AVX2__
+    for (; j+7<n; j+=8)
+    {
+        __m256 _r00 = _mm256_loadu_ps(r0);
+        __m256 _r01 = _mm256_loadu_ps(r0 + 8);
+        __m256 _r10 = _mm256_loadu_ps(r1);
+        __m256 _r11 = _mm256_loadu_ps(r1 + 8);
+
+        __m256 _max0 = _mm256_max_ps(_r00, _r10);
+        __m256 _max1 = _mm256_max_ps(_r01, _r11);
+
+        __m256 _even;
+        __m256 _odd;
+        deinterleave_ps256(_max0, _max1, _even, _odd);
+
+        _mm256_storeu_ps(outptr, _mm256_max_ps(_even, _odd));
+
+        r0 += 16;
+        r1 += 16;
+        outptr += 8;
+    }
+#endif // __AVX2__
+#if __SSE2__
+    for (; j+3<n; j+=4)
+    {
+        __m128 _r00 = _mm_loadu_ps(r0);
+        __m128 _r01 = _mm_loadu_ps(r0 + 4);
+        __m128 _r10 = _mm_loadu_ps(r1);
+        __m128 _r11 = _mm_loadu_ps(r1 + 4);
+
+        __m128 _max0 = _mm_max_ps(_r00, _r10);
+        __m128 _max1 = _mm_max_ps(_r01, _r11);
+
+        __m128 _even = _mm_shuffle_ps(_max0, _max1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 _odd = _mm_shuffle_ps(_max0, _max1, _MM_SHUFFLE(3, 1, 3, 1));
+
+        _mm_storeu_ps(outptr, _mm_max_ps(_even, _odd));
+
+        r0 += 8;
+        r1 += 8;
+        outptr += 4;
+    }
+#endif // __SSE2__
+    for (; j<n; j++)
+    {
+        float max0 = std::max(r0[0], r0[1]);
+        float max1 = std::max(r1[0], r1[1]);
+
+        *outptr = std::max(max0, max1);
+
+        r0 += 2;
+        r1 += 2;
+        outptr++;
+    }
+}
+
+static void pooling2x2s2_avg_row_sse(const float* r0, const float* r1, float* outptr, int n)
+{
+    int j = 0;
+#if __AVX2__
+    __m256 _inv_maxk_avx = _mm256_set1_ps(0.25f);
+    for (; j+7<n; j+=8)
+    {
+        __m256 _r00 = _mm256_loadu_ps(r0);
+        __m256 _r01 = _mm256_loadu_ps(r0 + 8);
+        __m256 _r10 = _mm256_loadu_ps(r1);
+        __m256 _r11 = _mm256_loadu_ps(r1 + 8);
+
+        __m256 _sum0 = _mm256_add_ps(_r00, _r10);
+        __m256 _sum1 = _mm256_add_ps(_r01, _r11);
+
+        __m256 _even;
+        __m256 _odd;
+        deinterleave_ps256(_sum0, _sum1, _even, _odd);
+
+        _mm256_storeu_ps(outptr, _mm256_mul_ps(_mm256_add_ps(_even, _odd), _inv_maxk_avx));
+
+        r0 += 16;
+        r1 += 16;
+        outptr += 8;
+    }
+#endif // __AVX2__
+#if __SSE2__
+    __m128 _inv_maxk = _mm_set1_ps(0.25f);
+    for (; j+3<n; j+=4)
+    {
+        __m128 _r00 = _mm_loadu_ps(r0);
+        __m128 _r01 = _mm_loadu_ps(r0 + 4);
+        __m128 _r10 = _mm_loadu_ps(r1);
+        __m128 _r11 = _mm_loadu_ps(r1 + 4);
+
+        __m128 _sum0 = _mm_add_ps(_r00, _r10);
+        __m128 _sum1 = _mm_add_ps(_r01, _r11);
+
+        __m128 _even = _mm_shuffle_ps(_sum0, _sum1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 _odd = _mm_shuffle_ps(_sum0, _sum1, _MM_SHUFFLE(3, 1, 3, 1));
+
+        _mm_storeu_ps(outptr, _mm_mul_ps(_mm_add_ps(_even, _odd), _inv_maxk));
+
+        r0 += 8;
+        r1 += 8;
+        outptr += 4;
+    }
+#endif // __SSE2__
+    for (; j<n; j++)
+    {
+        *outptr = (r0[0] + r0[1] + r1[0] + r1[1]) * 0.25f;
+
+        r0 += 2;
+        r1 += 2;
+        outptr++;
+    }
+}
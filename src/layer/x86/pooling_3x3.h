@@ -0,0 +1,146 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// n outputs of one row, every window lies inside the input
+static void pooling3x3s2_max_row_sse(const float* r0, const float* r1, const float* r2, float* outptr, int n)
+{
+    int j = 0;
+#if __AVX2__
+    const __m256i _rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+    for (; j+7<n; j+=8)
+    {
+        __m256 _max0 = _mm256_max_ps(_mm256_max_ps(_mm256_loadu_ps(r0), _mm256_loadu_ps(r1)), _mm256_loadu_ps(r2));
+        __m256 _max1 = _mm256_max_ps(_mm256_max_ps(_mm256_loadu_ps(r0 + 8), _mm256_loadu_ps(r1 + 8)), _mm256_loadu_ps(r2 + 8));
+        __m256 _max2 = _mm256_max_ps(_mm256_max_ps(_mm256_broadcast_ss(r0 + 16), _mm256_broadcast_ss(r1 + 16)), _mm256_broadcast_ss(r2 + 16));
+
+        __m256 _even;
+        __m256 _odd;
+        deinterleave_ps256(_max0, _max1, _even, _odd);
+
+        // cols 2 4 6 .. 16
+        __m256 _even_next = _mm256_blend_ps(_mm256_permutevar8x32_ps(_even, _rotate), _max2, 0x80);
+
+        _mm256_storeu_ps(outptr, _mm256_max_ps(_mm256_max_ps(_even, _odd), _even_next));
+
+        r0 += 16;
+        r1 += 16;
+        r2 += 16;
+        outptr += 8;
+    }
+#endif // __AVX2__
+#if __SSE2__
+    for (; j+3<n; j+=4)
+    {
+        __m128 _max0 = _mm_max_ps(_mm_max_ps(_mm_loadu_ps(r0), _mm_loadu_ps(r1)), _mm_loadu_ps(r2));
+        __m128 _max1 = _mm_max_ps(_mm_max_ps(_mm_loadu_ps(r0 + 4), _mm_loadu_ps(r1 + 4)), _mm_loadu_ps(r2 + 4));
+        __m128 _max2 = _mm_max_ss(_mm_max_ss(_mm_load_ss(r0 + 8), _mm_load_ss(r1 + 8)), _mm_load_ss(r2 + 8));
+
+        __m128 _even = _mm_shuffle_ps(_max0, _max1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 _odd = _mm_shuffle_ps(_max0, _max1, _MM_SHUFFLE(3, 1, 3, 1));
+
+        // cols 2 4 6 8
+        __m128 _even_next = _mm_move_ss(_even, _max2);
+        _even_next = _mm_shuffle_ps(_even_next, _even_next, _MM_SHUFFLE(0, 3, 2, 1));
+
+        _mm_storeu_ps(outptr, _mm_max_ps(_mm_max_ps(_even, _odd), _even_next));
+
+        r0 += 8;
+        r1 += 8;
+        r2 += 8;
+        outptr += 4;
+    }
+#endif // __SSE2__
+    for (; j<n; j++)
+    {
+        float max0 = std::max(std::max(r0[0], r0[1]), r0[2]);
+        float max1 = std::max(std::max(r1[0], r1[1]), r1[2]);
+        float max2 = std::max(std::max(r2[0], r2[1]), r2[2]);
+
+        *outptr = std::max(std::max(max0, max1), max2);
+
+        r0 += 2;
+        r1 += 2;
+        r2 += 2;
+        outptr++;
+    }
+}
+
+static void pooling3x3s2_avg_row_sse(const float* r0, const float* r1, const float* r2, float* outptr, int n)
+{
+    const float inv_maxk = 1.f / 9;
+
+    int j = 0;
+#if __AVX2__
+    const __m256i _rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+    __m256 _inv_maxk_avx = _mm256_set1_ps(inv_maxk);
+    for (; j+7<n; j+=8)
+    {
+        __m256 _sum0 = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(r0), _mm256_loadu_ps(r1)), _mm256_loadu_ps(r2));
+        __m256 _sum1 = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(r0 + 8), _mm256_loadu_ps(r1 + 8)), _mm256_loadu_ps(r2 + 8));
+        __m256 _sum2 = _mm256_set1_ps(r0[16] + r1[16] + r2[16]);
+
+        __m256 _even;
+        __m256 _odd;
+        deinterleave_ps256(_sum0, _sum1, _even, _odd);
+
+        // cols 2 4 6 .. 16
+        __m256 _even_next = _mm256_blend_ps(_mm256_permutevar8x32_ps(_even, _rotate), _sum2, 0x80);
+
+        __m256 _sum = _mm256_add_ps(_mm256_add_ps(_even, _odd), _even_next);
+        _mm256_storeu_ps(outptr, _mm256_mul_ps(_sum, _inv_maxk_avx));
+
+        r0 += 16;
+        r1 += 16;
+        r2 += 16;
+        outptr += 8;
+    }
+#endif // __AVX2__
+#if __SSE2__
+    __m128 _inv_maxk = _mm_set1_ps(inv_maxk);
+    for (; j+3<n; j+=4)
+    {
+        __m128 _sum0 = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(r0), _mm_loadu_ps(r1)), _mm_loadu_ps(r2));
+        __m128 _sum1 = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(r0 + 4), _mm_loadu_ps(r1 + 4)), _mm_loadu_ps(r2 + 4));
+        __m128 _sum2 = _mm_set_ss(r0[8] + r1[8] + r2[8]);
+
+        __m128 _even = _mm_shuffle_ps(_sum0, _sum1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 _odd = _mm_shuffle_ps(_sum0, _sum1, _MM_SHUFFLE(3, 1, 3, 1));
+
+        // cols 2 4 6 8
+        __m128 _even_next = _mm_move_ss(_even, _sum2);
+        _even_next = _mm_shuffle_ps(_even_next, _even_next, _MM_SHUFFLE(0, 3, 2, 1));
+
+        __m128 _sum = _mm_add_ps(_mm_add_ps(_even, _odd), _even_next);
+        _mm_storeu_ps(outptr, _mm_mul_ps(_sum, _inv_maxk));
+
+        r0 += 8;
+        r1 += 8;
+        r2 += 8;
+        outptr += 4;
+    }
+#endif // __SSE2__
+    for (; j<n; j++)
+    {
+        float sum0 = r0[0] + r0[1] + r0[2];
+        float sum1 = r1[0] + r1[1] + r1[2];
+        float sum2 = r2[0] + r2[1] + r2[2];
+
+        *outptr = (sum0 + sum1 + sum2) * inv_maxk;
+
+        r0 += 2;
+        r1 += 2;
+        r2 += 2;
+        outptr++;
+    }
+}
@@ -0,0 +1,588 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "pooling_x86.h"
+
+#include <float.h>
+#include <algorithm>
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+#if __AVX__
+#include <immintrin.h>
+#endif // __AVX__
+
+namespace ncnn {
+
+#include "pooling_2x2.h"
+#include "pooling_3x3.h"
+
+DEFINE_LAYER_CREATOR(Pooling_x86)
+
+Pooling_x86::Pooling_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+static float global_max_sse(const float* ptr, int size)
+{
+    float max = ptr[0];
+
+    int i = 0;
+#if __AVX__
+    if (size >= 8)
+    {
+        __m256 _max_avx = _mm256_loadu_ps(ptr);
+        for (; i+7<size; i+=8)
+        {
+            _max_avx = _mm256_max_ps(_max_avx, _mm256_loadu_ps(ptr + i));
+        }
+
+        __m128 _max = _mm_max_ps(_mm256_castps256_ps128(_max_avx), _mm256_extractf128_ps(_max_avx, 1));
+        _max = _mm_max_ps(_max, _mm_movehl_ps(_max, _max));
+        _max = _mm_max_ss(_max, _mm_shuffle_ps(_max, _max, _MM_SHUFFLE(1, 1, 1, 1)));
+        max = _mm_cvtss_f32(_max);
+    }
+#endif // __AVX__
+#if __SSE2__
+    if (size - i >= 4)
+    {
+        __m128 _max = _mm_loadu_ps(ptr + i);
+        for (; i+3<size; i+=4)
+        {
+            _max = _mm_max_ps(_max, _mm_loadu_ps(ptr + i));
+        }
+
+        _max = _mm_max_ps(_max, _mm_movehl_ps(_max, _max));
+        _max = _mm_max_ss(_max, _mm_shuffle_ps(_max, _max, _MM_SHUFFLE(1, 1, 1, 1)));
+        max = std::max(max, _mm_cvtss_f32(_max));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        max = std::max(max, ptr[i]);
+    }
+
+    return max;
+}
+
+static float global_sum_sse(const float* ptr, int size)
+{
+    float sum = 0.f;
+
+    int i = 0;
+#if __AVX__
+    __m256 _sum_avx = _mm256_setzero_ps();
+    for (; i+7<size; i+=8)
+    {
+        _sum_avx = _mm256_add_ps(_sum_avx, _mm256_loadu_ps(ptr + i));
+    }
+#endif // __AVX__
+#if __SSE2__
+    __m128 _sum = _mm_setzero_ps();
+    for (; i+3<size; i+=4)
+    {
+        _sum = _mm_add_ps(_sum, _mm_loadu_ps(ptr + i));
+    }
+#if __AVX__
+    _sum = _mm_add_ps(_sum, _mm_add_ps(_mm256_castps256_ps128(_sum_avx), _mm256_extractf128_ps(_sum_avx, 1)));
+#endif // __AVX__
+    _sum = _mm_add_ps(_sum, _mm_movehl_ps(_sum, _sum));
+    _sum = _mm_add_ss(_sum, _mm_shuffle_ps(_sum, _sum, _MM_SHUFFLE(1, 1, 1, 1)));
+    sum = _mm_cvtss_f32(_sum);
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        sum += ptr[i];
+    }
+
+    return sum;
+}
+
+// window starting at (y, x) clipped to the input, padding counts as -FLT_MAX or 0
+static float pooling_window_clipped(const Mat& m, int y, int x, int kernel_w, int kernel_h, int pooling_type, float inv_maxk)
+{
+    const int y0 = std::max(y, 0);
+    const int y1 = std::min(y + kernel_h, m.h);
+    const int x0 = std::max(x, 0);
+    const int x1 = std::min(x + kernel_w, m.w);
+
+    if (pooling_type == Pooling::PoolMethod_MAX)
+    {
+        float max = -FLT_MAX;
+        for (int yy = y0; yy < y1; yy++)
+        {
+            const float* sptr = m.row(yy);
+            for (int xx = x0; xx < x1; xx++)
+            {
+                max = std::max(max, sptr[xx]);
+            }
+        }
+
+        return max;
+    }
+
+    float sum = 0.f;
+    for (int yy = y0; yy < y1; yy++)
+    {
+        const float* sptr = m.row(yy);
+        for (int xx = x0; xx < x1; xx++)
+        {
+            sum += sptr[xx];
+        }
+    }
+
+    return sum * inv_maxk;
+}
+
+// max or avg over the lanes of size packed elements
+static void global_pooling_packn(const float* ptr, int size, int elempack, int pooling_type, float* outptr)
+{
+#if __AVX__
+    if (elempack == 8)
+    {
+        __m256 _r_avx = pooling_type == Pooling::PoolMethod_MAX ? _mm256_loadu_ps(ptr) : _mm256_setzero_ps();
+        for (int i=0; i<size; i++)
+        {
+            __m256 _p = _mm256_loadu_ps(ptr);
+            _r_avx = pooling_type == Pooling::PoolMethod_MAX ? _mm256_max_ps(_r_avx, _p) : _mm256_add_ps(_r_avx, _p);
+            ptr += 8;
+        }
+
+        if (pooling_type == Pooling::PoolMethod_AVE)
+            _r_avx = _mm256_div_ps(_r_avx, _mm256_set1_ps((float)size));
+
+        _mm256_storeu_ps(outptr, _r_avx);
+        return;
+    }
+#endif // __AVX__
+#if __SSE2__
+    if (elempack == 4)
+    {
+        __m128 _r = pooling_type == Pooling::PoolMethod_MAX ? _mm_loadu_ps(ptr) : _mm_setzero_ps();
+        for (int i=0; i<size; i++)
+        {
+            __m128 _p = _mm_loadu_ps(ptr);
+            _r = pooling_type == Pooling::PoolMethod_MAX ? _mm_max_ps(_r, _p) : _mm_add_ps(_r, _p);
+            ptr += 4;
+        }
+
+        if (pooling_type == Pooling::PoolMethod_AVE)
+            _r = _mm_div_ps(_r, _mm_set1_ps((float)size));
+
+        _mm_storeu_ps(outptr, _r);
+        return;
+    }
+#endif // __SSE2__
+    for (int k=0; k<elempack; k++)
+    {
+        outptr[k] = pooling_type == Pooling::PoolMethod_MAX ? ptr[k] : 0.f;
+    }
+    for (int i=0; i<size; i++)
+    {
+        for (int k=0; k<elempack; k++)
+        {
+            outptr[k] = pooling_type == Pooling::PoolMethod_MAX ? std::max(outptr[k], ptr[k]) : outptr[k] + ptr[k];
+        }
+        ptr += elempack;
+    }
+    if (pooling_type == Pooling::PoolMethod_AVE)
+    {
+        for (int k=0; k<elempack; k++)
+        {
+            outptr[k] /= size;
+        }
+    }
+}
+
+// packed window starting at (y, x) clipped to the input, padding counts as -FLT_MAX or 0
+static void pooling_window_clipped_packn(const Mat& m, int y, int x, int kernel_w, int kernel_h, int pooling_type, float inv_maxk, float* outptr)
+{
+    const int elempack = m.elempack;
+    const int y0 = std::max(y, 0);
+    const int y1 = std::min(y + kernel_h, m.h);
+    const int x0 = std::max(x, 0);
+    const int x1 = std::min(x + kernel_w, m.w);
+
+    const bool is_max = pooling_type == Pooling::PoolMethod_MAX;
+
+#if __AVX__
+    if (elempack == 8)
+    {
+        __m256 _r_avx = is_max ? _mm256_set1_ps(-FLT_MAX) : _mm256_setzero_ps();
+        for (int yy = y0; yy < y1; yy++)
+        {
+            const float* sptr = m.row(yy) + x0 * 8;
+            for (int xx = x0; xx < x1; xx++)
+            {
+                __m256 _p = _mm256_loadu_ps(sptr);
+                _r_avx = is_max ? _mm256_max_ps(_r_avx, _p) : _mm256_add_ps(_r_avx, _p);
+                sptr += 8;
+            }
+        }
+
+        if (!is_max)
+            _r_avx = _mm256_mul_ps(_r_avx, _mm256_set1_ps(inv_maxk));
+
+        _mm256_storeu_ps(outptr, _r_avx);
+        return;
+    }
+#endif // __AVX__
+#if __SSE2__
+    if (elempack == 4)
+    {
+        __m128 _r = is_max ? _mm_set1_ps(-FLT_MAX) : _mm_setzero_ps();
+        for (int yy = y0; yy < y1; yy++)
+        {
+            const float* sptr = m.row(yy) + x0 * 4;
+            for (int xx = x0; xx < x1; xx++)
+            {
+                __m128 _p = _mm_loadu_ps(sptr);
+                _r = is_max ? _mm_max_ps(_r, _p) : _mm_add_ps(_r, _p);
+                sptr += 4;
+            }
+        }
+
+        if (!is_max)
+            _r = _mm_mul_ps(_r, _mm_set1_ps(inv_maxk));
+
+        _mm_storeu_ps(outptr, _r);
+        return;
+    }
+#endif // __SSE2__
+    for (int k = 0; k < elempack; k++)
+    {
+        float r = is_max ? -FLT_MAX : 0.f;
+        for (int yy = y0; yy < y1; yy++)
+        {
+            const float* sptr = m.row(yy) + x0 * elempack + k;
+            for (int xx = x0; xx < x1; xx++)
+            {
+                r = is_max ? std::max(r, *sptr) : r + *sptr;
+                sptr += elempack;
+            }
+        }
+
+        outptr[k] = is_max ? r : r * inv_maxk;
+    }
+}
+
+int Pooling_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    // max value in NxN window
+    // avg value in NxN window
+
+    if (bottom_blob.elemsize == 1u)
+        return forward_int8(bottom_blob, top_blob, opt);
+
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int channels = bottom_blob.c;
+    size_t elemsize = bottom_blob.elemsize;
+    int elempack = bottom_blob.elempack;
+
+    if (global_pooling && elempack != 1)
+    {
+        top_blob.create(channels, elemsize, elempack, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        int size = w * h;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            const float* ptr = bottom_blob.channel(q);
+            float* outptr = (float*)top_blob + q * elempack;
+
+            global_pooling_packn(ptr, size, elempack, pooling_type, outptr);
+        }
+
+        return 0;
+    }
+
+    if (global_pooling)
+    {
+        top_blob.create(channels, elemsize, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        int size = w * h;
+
+        if (pooling_type == PoolMethod_MAX)
+        {
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int q=0; q<channels; q++)
+            {
+                const float* ptr = bottom_blob.channel(q);
+
+                top_blob[q] = global_max_sse(ptr, size);
+            }
+        }
+        else if (pooling_type == PoolMethod_AVE)
+        {
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int q=0; q<channels; q++)
+            {
+                const float* ptr = bottom_blob.channel(q);
+
+                top_blob[q] = global_sum_sse(ptr, size) / size;
+            }
+        }
+
+        return 0;
+    }
+
+    // resolve the padding without materializing the bordered blob
+    int pl = 0;
+    int pt = 0;
+    int wpadded = w;
+    int hpadded = h;
+
+    int wtailpad = 0;
+    int htailpad = 0;
+
+    if (pad_mode == 0) // full padding
+    {
+        int wtail = (w + pad_left + pad_right - kernel_w) % stride_w;
+        int htail = (h + pad_top + pad_bottom - kernel_h) % stride_h;
+
+        if (wtail != 0)
+            wtailpad = stride_w - wtail;
+        if (htail != 0)
+            htailpad = stride_h - htail;
+
+        pl = pad_left;
+        pt = pad_top;
+        wpadded = w + pad_left + pad_right + wtailpad;
+        hpadded = h + pad_top + pad_bottom + htailpad;
+    }
+    else if (pad_mode == 1) // valid padding
+    {
+        pl = pad_left;
+        pt = pad_top;
+        wpadded = w + pad_left + pad_right;
+        hpadded = h + pad_top + pad_bottom;
+    }
+    else if (pad_mode == 2 || pad_mode == 3) // SAME_UPPER or SAME_LOWER
+    {
+        // a negative total pad on one axis means no padding there, as in tensorflow
+        int wpad = std::max(kernel_w + (w - 1) / stride_w * stride_w - w, 0);
+        int hpad = std::max(kernel_h + (h - 1) / stride_h * stride_h - h, 0);
+
+        pl = pad_mode == 2 ? wpad / 2 : wpad - wpad / 2;
+        pt = pad_mode == 2 ? hpad / 2 : hpad - hpad / 2;
+        wpadded = w + wpad;
+        hpadded = h + hpad;
+    }
+
+    int outw = (wpadded - kernel_w) / stride_w + 1;
+    int outh = (hpadded - kernel_h) / stride_h + 1;
+
+    top_blob.create(outw, outh, channels, elemsize, elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    const int maxk = kernel_w * kernel_h;
+    const float inv_maxk = 1.f / maxk;
+
+    // outputs in [outh0, outh1) x [outw0, outw1) read no padding
+    int outw0 = std::min(std::max((pl + stride_w - 1) / stride_w, 0), outw);
+    int outh0 = std::min(std::max((pt + stride_h - 1) / stride_h, 0), outh);
+    int outw1 = w + pl - kernel_w < 0 ? 0 : std::min((w + pl - kernel_w) / stride_w + 1, outw);
+    int outh1 = h + pt - kernel_h < 0 ? 0 : std::min((h + pt - kernel_h) / stride_h + 1, outh);
+    outw1 = std::max(outw1, outw0);
+    outh1 = std::max(outh1, outh0);
+
+    const bool is_2x2s2 = kernel_w == 2 && kernel_h == 2 && stride_w == 2 && stride_h == 2;
+    const bool is_3x3s2 = kernel_w == 3 && kernel_h == 3 && stride_w == 2 && stride_h == 2;
+
+    // kernel offsets
+    std::vector<int> _space_ofs(maxk);
+    int* space_ofs = &_space_ofs[0];
+    {
+        int p1 = 0;
+        int p2 = 0;
+        int gap = w - kernel_w;
+        for (int i = 0; i < kernel_h; i++)
+        {
+            for (int j = 0; j < kernel_w; j++)
+            {
+                space_ofs[p1] = p2;
+                p1++;
+                p2++;
+            }
+            p2 += gap;
+        }
+    }
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<channels; q++)
+    {
+        const Mat m = bottom_blob.channel(q);
+        float* outptr = top_blob.channel(q);
+
+        if (elempack != 1)
+        {
+            for (int i = 0; i < outh; i++)
+            {
+                for (int j = 0; j < outw; j++)
+                {
+                    pooling_window_clipped_packn(m, i * stride_h - pt, j * stride_w - pl, kernel_w, kernel_h, pooling_type, inv_maxk, outptr + j * elempack);
+                }
+
+                outptr += outw * elempack;
+            }
+        }
+        else
+        {
+            for (int i = 0; i < outh; i++)
+            {
+                const int y = i * stride_h - pt;
+
+                if (i < outh0 || i >= outh1)
+                {
+                    for (int j = 0; j < outw; j++)
+                    {
+                        outptr[j] = pooling_window_clipped(m, y, j * stride_w - pl, kernel_w, kernel_h, pooling_type, inv_maxk);
+                    }
+
+                    outptr += outw;
+                    continue;
+                }
+
+                for (int j = 0; j < outw0; j++)
+                {
+                    outptr[j] = pooling_window_clipped(m, y, j * stride_w - pl, kernel_w, kernel_h, pooling_type, inv_maxk);
+                }
+
+                const float* sptr = m.row(y) + outw0 * stride_w - pl;
+                const int n = outw1 - outw0;
+
+                if (is_2x2s2)
+                {
+                    if (pooling_type == PoolMethod_MAX)
+                        pooling2x2s2_max_row_sse(sptr, sptr + w, outptr + outw0, n);
+                    else
+                        pooling2x2s2_avg_row_sse(sptr, sptr + w, outptr + outw0, n);
+                }
+                else if (is_3x3s2)
+                {
+                    if (pooling_type == PoolMethod_MAX)
+                        pooling3x3s2_max_row_sse(sptr, sptr + w, sptr + w * 2, outptr + outw0, n);
+                    else
+                        pooling3x3s2_avg_row_sse(sptr, sptr + w, sptr + w * 2, outptr + outw0, n);
+                }
+                else if (pooling_type == PoolMethod_MAX)
+                {
+                    for (int j = 0; j < n; j++)
+                    {
+                        const float* kptr = sptr + j * stride_w;
+
+                        float max = kptr[0];
+                        for (int k = 0; k < maxk; k++)
+                        {
+                            max = std::max(max, kptr[ space_ofs[k] ]);
+                        }
+
+                        outptr[outw0 + j] = max;
+                    }
+                }
+                else
+                {
+                    for (int j = 0; j < n; j++)
+                    {
+                        const float* kptr = sptr + j * stride_w;
+
+                        float sum = 0;
+                        for (int k = 0; k < maxk; k++)
+                        {
+                            sum += kptr[ space_ofs[k] ];
+                        }
+
+                        outptr[outw0 + j] = sum * inv_maxk;
+                    }
+                }
+
+                for (int j = outw1; j < outw; j++)
+                {
+                    outptr[j] = pooling_window_clipped(m, y, j * stride_w - pl, kernel_w, kernel_h, pooling_type, inv_maxk);
+                }
+
+                outptr += outw;
+            }
+        }
+
+        if (pooling_type == PoolMethod_AVE && avgpool_count_include_pad == 0)
+        {
+            // fix pad
+            if (pad_top != 0)
+            {
+                const float scale = (float)kernel_h / (kernel_h - pad_top);
+
+                outptr = top_blob.channel(q).row(0);
+                for (int i = 0; i < outw * elempack; i++)
+                {
+                    outptr[i] *= scale;
+                }
+            }
+            if (pad_bottom + htailpad != 0)
+            {
+                const float scale = (float)kernel_h / (kernel_h - pad_bottom - htailpad);
+
+                outptr = top_blob.channel(q).row(outh - 1);
+                for (int i = 0; i < outw * elempack; i++)
+                {
+                    outptr[i] *= scale;
+                }
+            }
+            if (pad_left != 0)
+            {
+                const float scale = (float)kernel_w / (kernel_w - pad_left);
+
+                outptr = top_blob.channel(q);
+                for (int i = 0; i < outh; i++)
+                {
+                    for (int k = 0; k < elempack; k++)
+                    {
+                        outptr[k] *= scale;
+                    }
+                    outptr += outw * elempack;
+                }
+            }
+            if (pad_right + wtailpad != 0)
+            {
+                const float scale = (float)kernel_w / (kernel_w - pad_right - wtailpad);
+
+                outptr = top_blob.channel(q);
+                outptr += (outw - 1) * elempack;
+                for (int i = 0; i < outh; i++)
+                {
+                    for (int k = 0; k < elempack; k++)
+                    {
+                        outptr[k] *= scale;
+                    }
+                    outptr += outw * elempack;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,171 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "relu_x86.h"
+
+#include <math.h>
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+#if __AVX__
+#include <immintrin.h>
+#endif // __AVX__
+
+namespace ncnn {
+
+DEFINE_LAYER_CREATOR(ReLU_x86)
+
+ReLU_x86::ReLU_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+int ReLU_x86::forward_inplace_int8(Mat& bottom_top_blob, const Option& opt) const
+{
+    if (slope != 0.f)
+        return ReLU::forward_inplace_int8(bottom_top_blob, opt);
+
+    int w = bottom_top_blob.w;
+    int h = bottom_top_blob.h;
+    int channels = bottom_top_blob.c;
+    int size = w * h;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q=0; q<channels; q++)
+    {
+        signed char* ptr = bottom_top_blob.channel(q);
+
+        int i = 0;
+#if __SSE2__
+        __m128i _zero = _mm_setzero_si128();
+        for (; i+15<size; i+=16)
+        {
+            __m128i _p = _mm_loadu_si128((const __m128i*)(ptr + i));
+            _p = _mm_and_si128(_p, _mm_cmpgt_epi8(_p, _zero));
+            _mm_storeu_si128((__m128i*)(ptr + i), _p);
+        }
+#endif // __SSE2__
+        for (; i<size; i++)
+        {
+            if (ptr[i] < 0)
+                ptr[i] = 0;
+        }
+    }
+
+    return 0;
+}
+
+int ReLU_x86::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
+{
+    if (bottom_top_blob.elemsize == 1u)
+        return forward_inplace_int8(bottom_top_blob, opt);
+
+    int w = bottom_top_blob.w;
+    int h = bottom_top_blob.h;
+    int channels = bottom_top_blob.c;
+    int elempack = bottom_top_blob.elempack;
+    int size = w * h * elempack;
+
+    if (slope == 0.f)
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            float* ptr = bottom_top_blob.channel(q);
+
+            int i = 0;
+#if __AVX__
+            __m256 _zero_avx = _mm256_setzero_ps();
+            for (; i+7<size; i+=8)
+            {
+                __m256 _p = _mm256_loadu_ps(ptr);
+                _p = _mm256_max_ps(_p, _zero_avx);
+                _mm256_storeu_ps(ptr, _p);
+
+                ptr += 8;
+            }
+#endif // __AVX__
+#if __SSE2__
+            __m128 _zero = _mm_setzero_ps();
+            for (; i+3<size; i+=4)
+            {
+                __m128 _p = _mm_loadu_ps(ptr);
+                _p = _mm_max_ps(_p, _zero);
+                _mm_storeu_ps(ptr, _p);
+
+                ptr += 4;
+            }
+#endif // __SSE2__
+            for (; i<size; i++)
+            {
+                if (*ptr < 0)
+                    *ptr = 0;
+
+                ptr++;
+            }
+        }
+    }
+    else
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            float* ptr = bottom_top_blob.channel(q);
+
+            int i = 0;
+#if __AVX__
+            __m256 _zero_avx = _mm256_setzero_ps();
+            __m256 _slope_avx = _mm256_set1_ps(slope);
+            for (; i+7<size; i+=8)
+            {
+                __m256 _p = _mm256_loadu_ps(ptr);
+                __m256 _pos = _mm256_max_ps(_p, _zero_avx);
+                __m256 _neg = _mm256_min_ps(_p, _zero_avx);
+                _p = _mm256_fmadd_ps(_slope_avx, _neg, _pos);
+                _mm256_storeu_ps(ptr, _p);
+
+                ptr += 8;
+            }
+#endif // __AVX__
+#if __SSE2__
+            __m128 _zero = _mm_setzero_ps();
+            __m128 _slope = _mm_set1_ps(slope);
+            for (; i+3<size; i+=4)
+            {
+                __m128 _p = _mm_loadu_ps(ptr);
+                __m128 _pos = _mm_max_ps(_p, _zero);
+                __m128 _neg = _mm_min_ps(_p, _zero);
+                _p = _mm_add_ps(_pos, _mm_mul_ps(_slope, _neg));
+                _mm_storeu_ps(ptr, _p);
+
+                ptr += 4;
+            }
+#endif // __SSE2__
+            for (; i<size; i++)
+            {
+                if (*ptr < 0)
+                    *ptr *= slope;
+
+                ptr++;
+            }
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,178 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "scale_x86.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+#if __AVX__
+#include <immintrin.h>
+#endif // __AVX__
+
+namespace ncnn {
+
+DEFINE_LAYER_CREATOR(Scale_x86)
+
+Scale_x86::Scale_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+// value = value * s + bias, s and bias hold one value per lane of the pack
+static void scale_lanes(float* ptr, const float* s, const float* bias, int size, int elempack)
+{
+    const float zeros[8] = {0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f};
+    if (!bias)
+        bias = zeros;
+
+#if __AVX__
+    if (elempack == 8)
+    {
+        __m256 _s = _mm256_loadu_ps(s);
+        __m256 _bias = _mm256_loadu_ps(bias);
+        for (int i=0; i<size; i++)
+        {
+            __m256 _p = _mm256_loadu_ps(ptr);
+            _mm256_storeu_ps(ptr, _mm256_fmadd_ps(_p, _s, _bias));
+            ptr += 8;
+        }
+        return;
+    }
+#endif // __AVX__
+#if __SSE2__
+    if (elempack == 4)
+    {
+        __m128 _s = _mm_loadu_ps(s);
+        __m128 _bias = _mm_loadu_ps(bias);
+        for (int i=0; i<size; i++)
+        {
+            __m128 _p = _mm_loadu_ps(ptr);
+            _mm_storeu_ps(ptr, _mm_add_ps(_mm_mul_ps(_p, _s), _bias));
+            ptr += 4;
+        }
+        return;
+    }
+#endif // __SSE2__
+
+    int i = 0;
+#if __AVX__
+    __m256 _s_avx = _mm256_set1_ps(s[0]);
+    __m256 _bias_avx = _mm256_set1_ps(bias[0]);
+    for (; i+7<size; i+=8)
+    {
+        __m256 _p = _mm256_loadu_ps(ptr);
+        _mm256_storeu_ps(ptr, _mm256_fmadd_ps(_p, _s_avx, _bias_avx));
+        ptr += 8;
+    }
+#endif // __AVX__
+#if __SSE2__
+    __m128 _s = _mm_set1_ps(s[0]);
+    __m128 _bias = _mm_set1_ps(bias[0]);
+    for (; i+3<size; i+=4)
+    {
+        __m128 _p = _mm_loadu_ps(ptr);
+        _mm_storeu_ps(ptr, _mm_add_ps(_mm_mul_ps(_p, _s), _bias));
+        ptr += 4;
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        *ptr = *ptr * s[0] + bias[0];
+        ptr++;
+    }
+}
+
+int Scale_x86::forward_inplace(std::vector<Mat>& bottom_top_blobs, const Option& opt) const
+{
+    Mat& bottom_top_blob = bottom_top_blobs[0];
+    const Mat& scale_blob = bottom_top_blobs[1];
+
+    int dims = bottom_top_blob.dims;
+    int elempack = bottom_top_blob.elempack;
+
+    const float* scale = scale_blob;
+    const float* bias = bias_term ? (const float*)bias_data : 0;
+
+    if (dims == 1)
+    {
+        int w = bottom_top_blob.w * elempack;
+
+        float* ptr = bottom_top_blob;
+
+        int i = 0;
+#if __AVX__
+        for (; i+7<w; i+=8)
+        {
+            __m256 _p = _mm256_loadu_ps(ptr + i);
+            __m256 _s = _mm256_loadu_ps(scale + i);
+            __m256 _bias = bias ? _mm256_loadu_ps(bias + i) : _mm256_setzero_ps();
+            _mm256_storeu_ps(ptr + i, _mm256_fmadd_ps(_p, _s, _bias));
+        }
+#endif // __AVX__
+#if __SSE2__
+        for (; i+3<w; i+=4)
+        {
+            __m128 _p = _mm_loadu_ps(ptr + i);
+            __m128 _s = _mm_loadu_ps(scale + i);
+            __m128 _bias = bias ? _mm_loadu_ps(bias + i) : _mm_setzero_ps();
+            _mm_storeu_ps(ptr + i, _mm_add_ps(_mm_mul_ps(_p, _s), _bias));
+        }
+#endif // __SSE2__
+        for (; i<w; i++)
+        {
+            ptr[i] = ptr[i] * scale[i] + (bias ? bias[i] : 0.f);
+        }
+
+        return 0;
+    }
+
+    if (dims == 2)
+    {
+        int w = bottom_top_blob.w;
+        int h = bottom_top_blob.h;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int i=0; i<h; i++)
+        {
+            float* ptr = bottom_top_blob.row(i);
+
+            scale_lanes(ptr, scale + i * elempack, bias ? bias + i * elempack : 0, w, elempack);
+        }
+
+        return 0;
+    }
+
+    if (dims == 3)
+    {
+        int size = bottom_top_blob.w * bottom_top_blob.h;
+        int channels = bottom_top_blob.c;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            float* ptr = bottom_top_blob.channel(q);
+
+            scale_lanes(ptr, scale + q * elempack, bias ? bias + q * elempack : 0, size, elempack);
+        }
+
+        return 0;
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,448 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "softmax_x86.h"
+
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+
+#if __SSE2__
+#include <emmintrin.h>
+#include "sse_mathfun.h"
+#endif // __SSE2__
+#if __AVX__
+#include <immintrin.h>
+#include "avx_mathfun.h"
+#endif // __AVX__
+
+namespace ncnn {
+
+DEFINE_LAYER_CREATOR(Softmax_x86)
+
+Softmax_x86::Softmax_x86()
+{
+}
+
+#if __AVX__
+static inline float reduce_max_ps256(__m256 x)
+{
+    __m128 x4 = _mm_max_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+    x4 = _mm_max_ps(x4, _mm_movehl_ps(x4, x4));
+    x4 = _mm_max_ss(x4, _mm_shuffle_ps(x4, x4, 1));
+    return _mm_cvtss_f32(x4);
+}
+
+static inline float reduce_add_ps256(__m256 x)
+{
+    __m128 x4 = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+    x4 = _mm_add_ps(x4, _mm_movehl_ps(x4, x4));
+    x4 = _mm_add_ss(x4, _mm_shuffle_ps(x4, x4, 1));
+    return _mm_cvtss_f32(x4);
+}
+#endif // __AVX__
+
+#if __SSE2__
+static inline float reduce_max_ps(__m128 x)
+{
+    x = _mm_max_ps(x, _mm_movehl_ps(x, x));
+    x = _mm_max_ss(x, _mm_shuffle_ps(x, x, 1));
+    return _mm_cvtss_f32(x);
+}
+
+static inline float reduce_add_ps(__m128 x)
+{
+    x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+    x = _mm_add_ss(x, _mm_shuffle_ps(x, x, 1));
+    return _mm_cvtss_f32(x);
+}
+#endif // __SSE2__
+
+static float softmax_max(const float* ptr, int size)
+{
+    float max = -FLT_MAX;
+
+    int i = 0;
+#if __AVX__
+    __m256 _max_avx = _mm256_set1_ps(-FLT_MAX);
+    for (; i+7<size; i+=8)
+    {
+        _max_avx = _mm256_max_ps(_max_avx, _mm256_loadu_ps(ptr + i));
+    }
+    max = std::max(max, reduce_max_ps256(_max_avx));
+#endif // __AVX__
+#if __SSE2__
+    __m128 _max = _mm_set1_ps(-FLT_MAX);
+    for (; i+3<size; i+=4)
+    {
+        _max = _mm_max_ps(_max, _mm_loadu_ps(ptr + i));
+    }
+    max = std::max(max, reduce_max_ps(_max));
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        max = std::max(max, ptr[i]);
+    }
+
+    return max;
+}
+
+// value = exp(value - max) and return the sum, in one pass
+static float softmax_exp_sum(float* ptr, int size, float max)
+{
+    float sum = 0.f;
+
+    int i = 0;
+#if __AVX__
+    __m256 _max_avx = _mm256_set1_ps(max);
+    __m256 _sum_avx = _mm256_setzero_ps();
+    for (; i+7<size; i+=8)
+    {
+        __m256 _p = exp256_ps(_mm256_sub_ps(_mm256_loadu_ps(ptr + i), _max_avx));
+        _mm256_storeu_ps(ptr + i, _p);
+        _sum_avx = _mm256_add_ps(_sum_avx, _p);
+    }
+    sum += reduce_add_ps256(_sum_avx);
+#endif // __AVX__
+#if __SSE2__
+    __m128 _max = _mm_set1_ps(max);
+    __m128 _sum = _mm_setzero_ps();
+    for (; i+3<size; i+=4)
+    {
+        __m128 _p = exp_ps(_mm_sub_ps(_mm_loadu_ps(ptr + i), _max));
+        _mm_storeu_ps(ptr + i, _p);
+        _sum = _mm_add_ps(_sum, _p);
+    }
+    sum += reduce_add_ps(_sum);
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        ptr[i] = exp(ptr[i] - max);
+        sum += ptr[i];
+    }
+
+    return sum;
+}
+
+static void softmax_mul(float* ptr, int size, float s)
+{
+    int i = 0;
+#if __AVX__
+    __m256 _s_avx = _mm256_set1_ps(s);
+    for (; i+7<size; i+=8)
+    {
+        _mm256_storeu_ps(ptr + i, _mm256_mul_ps(_mm256_loadu_ps(ptr + i), _s_avx));
+    }
+#endif // __AVX__
+#if __SSE2__
+    __m128 _s = _mm_set1_ps(s);
+    for (; i+3<size; i+=4)
+    {
+        _mm_storeu_ps(ptr + i, _mm_mul_ps(_mm_loadu_ps(ptr + i), _s));
+    }
+#endif // __SSE2__
+    for (; i<size; i++)
+    {
+        ptr[i] *= s;
+    }
+}
+
+// softmax over one contiguous row
+static void softmax_row(float* ptr, int size)
+{
+    float max = softmax_max(ptr, size);
+    float sum = softmax_exp_sum(ptr, size, max);
+    softmax_mul(ptr, size, 1.f / sum);
+}
+
+// softmax across n rows that are stride floats apart, for size independent lanes per row
+// maxptr and sumptr are size floats of scratch
+static void softmax_lanes(float* ptr, int size, int n, size_t stride, float* maxptr, float* sumptr)
+{
+    for (int i=0; i<size; i++)
+    {
+        maxptr[i] = -FLT_MAX;
+        sumptr[i] = 0.f;
+    }
+
+    for (int r=0; r<n; r++)
+    {
+        const float* p = ptr + r * stride;
+
+        int i = 0;
+#if __AVX__
+        for (; i+7<size; i+=8)
+        {
+            _mm256_storeu_ps(maxptr + i, _mm256_max_ps(_mm256_loadu_ps(maxptr + i), _mm256_loadu_ps(p + i)));
+        }
+#endif // __AVX__
+#if __SSE2__
+        for (; i+3<size; i+=4)
+        {
+            _mm_storeu_ps(maxptr + i, _mm_max_ps(_mm_loadu_ps(maxptr + i), _mm_loadu_ps(p + i)));
+        }
+#endif // __SSE2__
+        for (; i<size; i++)
+        {
+            maxptr[i] = std::max(maxptr[i], p[i]);
+        }
+    }
+
+    // fused subtract, exp, store and sum
+    for (int r=0; r<n; r++)
+    {
+        float* p = ptr + r * stride;
+
+        int i = 0;
+#if __AVX__
+        for (; i+7<size; i+=8)
+        {
+            __m256 _p = exp256_ps(_mm256_sub_ps(_mm256_loadu_ps(p + i), _mm256_loadu_ps(maxptr + i)));
+            _mm256_storeu_ps(p + i, _p);
+            _mm256_storeu_ps(sumptr + i, _mm256_add_ps(_mm256_loadu_ps(sumptr + i), _p));
+        }
+#endif // __AVX__
+#if __SSE2__
+        for (; i+3<size; i+=4)
+        {
+            __m128 _p = exp_ps(_mm_sub_ps(_mm_loadu_ps(p + i), _mm_loadu_ps(maxptr + i)));
+            _mm_storeu_ps(p + i, _p);
+            _mm_storeu_ps(sumptr + i, _mm_add_ps(_mm_loadu_ps(sumptr + i), _p));
+        }
+#endif // __SSE2__
+        for (; i<size; i++)
+        {
+            p[i] = exp(p[i] - maxptr[i]);
+            sumptr[i] += p[i];
+        }
+    }
+
+    for (int i=0; i<size; i++)
+    {
+        sumptr[i] = 1.f / sumptr[i];
+    }
+
+    for (int r=0; r<n; r++)
+    {
+        float* p = ptr + r * stride;
+
+        int i = 0;
+#if __AVX__
+        for (; i+7<size; i+=8)
+        {
+            _mm256_storeu_ps(p + i, _mm256_mul_ps(_mm256_loadu_ps(p + i), _mm256_loadu_ps(sumptr + i)));
+        }
+#endif // __AVX__
+#if __SSE2__
+        for (; i+3<size; i+=4)
+        {
+            _mm_storeu_ps(p + i, _mm_mul_ps(_mm_loadu_ps(p + i), _mm_loadu_ps(sumptr + i)));
+        }
+#endif // __SSE2__
+        for (; i<size; i++)
+        {
+            p[i] *= sumptr[i];
+        }
+    }
+}
+
+// softmax across n rows of a plane, split into column blocks that run in parallel
+static void softmax_lanes_parallel(float* ptr, int size, int n, size_t stride, float* maxptr, float* sumptr, const Option& opt)
+{
+    // 64 lanes per block keeps each strided pass within a few cache lines per row
+    const int block = 64;
+    int nn_block = (size + block - 1) / block;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int b=0; b<nn_block; b++)
+    {
+        int i = b * block;
+        int len = std::min(block, size - i);
+
+        softmax_lanes(ptr + i, len, n, stride, maxptr + i, sumptr + i);
+    }
+}
+
+int Softmax_x86::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
+{
+    int dims = bottom_top_blob.dims;
+    size_t elemsize = bottom_top_blob.elemsize;
+
+    if (dims == 1) // axis == 0
+    {
+        int w = bottom_top_blob.w;
+
+        float* ptr = bottom_top_blob;
+
+        // long vectors such as large class counts reduce in parallel chunks
+        int nn = std::min(opt.num_threads, w / 4096);
+        if (nn <= 1)
+        {
+            softmax_row(ptr, w);
+            return 0;
+        }
+
+        int chunk = ((w + nn - 1) / nn + 7) / 8 * 8;
+        nn = (w + chunk - 1) / chunk;
+
+        Mat partial;
+        partial.create(nn, 2, 4u, opt.workspace_allocator);
+        if (partial.empty())
+            return -100;
+
+        float* maxs = partial.row(0);
+        float* sums = partial.row(1);
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int t=0; t<nn; t++)
+        {
+            int i = t * chunk;
+            maxs[t] = softmax_max(ptr + i, std::min(chunk, w - i));
+        }
+
+        float max = -FLT_MAX;
+        for (int t=0; t<nn; t++)
+        {
+            max = std::max(max, maxs[t]);
+        }
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int t=0; t<nn; t++)
+        {
+            int i = t * chunk;
+            sums[t] = softmax_exp_sum(ptr + i, std::min(chunk, w - i), max);
+        }
+
+        float sum = 0.f;
+        for (int t=0; t<nn; t++)
+        {
+            sum += sums[t];
+        }
+
+        const float s = 1.f / sum;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int t=0; t<nn; t++)
+        {
+            int i = t * chunk;
+            softmax_mul(ptr + i, std::min(chunk, w - i), s);
+        }
+
+        return 0;
+    }
+
+    if (dims == 2 && axis == 0)
+    {
+        int w = bottom_top_blob.w;
+        int h = bottom_top_blob.h;
+
+        Mat max;
+        max.create(w, elemsize, opt.workspace_allocator);
+        if (max.empty())
+            return -100;
+
+        Mat sum;
+        sum.create(w, elemsize, opt.workspace_allocator);
+        if (sum.empty())
+            return -100;
+
+        softmax_lanes_parallel(bottom_top_blob, w, h, w, max, sum, opt);
+
+        return 0;
+    }
+
+    if (dims == 2 && axis == 1)
+    {
+        int w = bottom_top_blob.w;
+        int h = bottom_top_blob.h;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int i=0; i<h; i++)
+        {
+            softmax_row(bottom_top_blob.row(i), w);
+        }
+
+        return 0;
+    }
+
+    if (dims == 3 && axis == 0)
+    {
+        int w = bottom_top_blob.w;
+        int h = bottom_top_blob.h;
+        int channels = bottom_top_blob.c;
+        int size = w * h;
+
+        Mat max;
+        max.create(w, h, elemsize, opt.workspace_allocator);
+        if (max.empty())
+            return -100;
+
+        Mat sum;
+        sum.create(w, h, elemsize, opt.workspace_allocator);
+        if (sum.empty())
+            return -100;
+
+        softmax_lanes_parallel(bottom_top_blob, size, channels, bottom_top_blob.cstep, max, sum, opt);
+
+        return 0;
+    }
+
+    if (dims == 3 && axis == 1)
+    {
+        int w = bottom_top_blob.w;
+        int h = bottom_top_blob.h;
+        int channels = bottom_top_blob.c;
+
+        Mat max;
+        max.create(w, channels, elemsize, opt.workspace_allocator);
+        if (max.empty())
+            return -100;
+
+        Mat sum;
+        sum.create(w, channels, elemsize, opt.workspace_allocator);
+        if (sum.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q=0; q<channels; q++)
+        {
+            softmax_lanes(bottom_top_blob.channel(q), w, h, w, max.row(q), sum.row(q));
+        }
+
+        return 0;
+    }
+
+    if (dims == 3 && axis == 2)
+    {
+        int w = bottom_top_blob.w;
+        int h = bottom_top_blob.h;
+        int channels = bottom_top_blob.c;
+
+        // every row is independent, spread all of them over the threads
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int qi=0; qi<channels * h; qi++)
+        {
+            int q = qi / h;
+            int i = qi % h;
+
+            softmax_row(bottom_top_blob.channel(q).row(i), w);
+        }
+
+        return 0;
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -29,6 +29,13 @@
   (this is the zlib license)
 */
 
+#ifndef SSE_MATHFUN_H
+#define SSE_MATHFUN_H
+
+#if defined(__SSE2__) && !defined(USE_SSE2)
+#define USE_SSE2 1
+#endif
+
 #include <xmmintrin.h>
 
 /* yes I know, the top of this file is quite ugly */
@@ -109,7 +116,7 @@ typedef union xmm_mm_union {
 /* natural logarithm computed for 4 simultaneous float 
    return NaN for x <= 0
 */
-v4sf log_ps(v4sf x) {
+static inline v4sf log_ps(v4sf x) {
 #ifdef USE_SSE2
   v4si emm0;
 #else
@@ -211,7 +218,7 @@ _PS_CONST(cephes_exp_p3, 4.1665795894E-2);
 _PS_CONST(cephes_exp_p4, 1.6666665459E-1);
 _PS_CONST(cephes_exp_p5, 5.0000001201E-1);
 
-v4sf exp_ps(v4sf x) {
+static inline v4sf exp_ps(v4sf x) {
   v4sf tmp = _mm_setzero_ps(), fx;
 #ifdef USE_SSE2
   v4si emm0;
@@ -329,7 +336,7 @@ _PS_CONST(cephes_FOPI, 1.27323954473516); // 4 / M_PI
    Since it is based on SSE intrinsics, it has to be compiled at -O2 to
    deliver full speed.
 */
-v4sf sin_ps(v4sf x) { // any x
+static inline v4sf sin_ps(v4sf x) { // any x
   v4sf xmm1, xmm2 = _mm_setzero_ps(), xmm3, sign_bit, y;
 
 #ifdef USE_SSE2
@@ -446,7 +453,7 @@ v4sf sin_ps(v4sf x) { // any x
 }
 
 /* almost the same as sin_ps */
-v4sf cos_ps(v4sf x) { // any x
+static inline v4sf cos_ps(v4sf x) { // any x
   v4sf xmm1, xmm2 = _mm_setzero_ps(), xmm3, y;
 #ifdef USE_SSE2
   v4si emm0, emm2;
@@ -565,7 +572,7 @@ v4sf cos_ps(v4sf x) { // any x
 
 /* since sin_ps and cos_ps are almost identical, sincos_ps could replace both of them..
    it is almost as fast, and gives you a free cosine with your sine */
-void sincos_ps(v4sf x, v4sf *s, v4sf *c) {
+static inline void sincos_ps(v4sf x, v4sf *s, v4sf *c) {
   v4sf xmm1, xmm2, xmm3 = _mm_setzero_ps(), sign_bit_sin, y;
 #ifdef USE_SSE2
   v4si emm0, emm2, emm4;
@@ -709,3 +716,52 @@ void sincos_ps(v4sf x, v4sf *s, v4sf *c) {
   *c = _mm_xor_ps(xmm2, sign_bit_cos);
 }
 
+static inline v4sf pow_ps(v4sf a, v4sf b)
+{
+    // pow(x, m) = exp(m * log(x))
+    return exp_ps(_mm_mul_ps(b, log_ps(a)));
+}
+
+// tanh sse vector version
+// refer the scalar version from Cephes Math Library
+
+_PS_CONST(cephes_tanh_C1, 0.625f);
+
+_PS_CONST(cephes_tanh_p0, -5.70498872745E-3);
+_PS_CONST(cephes_tanh_p1, +2.06390887954E-2);
+_PS_CONST(cephes_tanh_p2, -5.37397155531E-2);
+_PS_CONST(cephes_tanh_p3, +1.33314422036E-1);
+_PS_CONST(cephes_tanh_p4, -3.33332819422E-1);
+
+/* Single precision hyperbolic tangent computed for 4 simultaneous float */
+static inline v4sf tanh_ps(v4sf x)
+{
+    v4sf x2 = _mm_and_ps(x, *(v4sf*)_ps_inv_sign_mask);
+
+    v4sf mask_l = _mm_cmpge_ps(x2, *(v4sf*)_ps_cephes_tanh_C1);
+
+    // abs(x) >= 0.625
+    // tanh(abs(x)) = (1 - exp(-2 abs(x))) / (1 + exp(-2 abs(x))), which never overflows
+    v4sf one = *(v4sf*)_ps_1;
+    v4sf exp_x_x = exp_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(x2, x2)));
+    v4sf y0 = _mm_div_ps(_mm_sub_ps(one, exp_x_x), _mm_add_ps(one, exp_x_x));
+    y0 = _mm_or_ps(y0, _mm_and_ps(x, *(v4sf*)_ps_sign_mask));
+
+    // abs(x) < 0.625
+    v4sf z = _mm_mul_ps(x, x);
+
+    v4sf y = *(v4sf*)_ps_cephes_tanh_p0;
+    y = _mm_add_ps(_mm_mul_ps(y, z), *(v4sf*)_ps_cephes_tanh_p1);
+    y = _mm_add_ps(_mm_mul_ps(y, z), *(v4sf*)_ps_cephes_tanh_p2);
+    y = _mm_add_ps(_mm_mul_ps(y, z), *(v4sf*)_ps_cephes_tanh_p3);
+    y = _mm_add_ps(_mm_mul_ps(y, z), *(v4sf*)_ps_cephes_tanh_p4);
+
+    y = _mm_mul_ps(y, z);
+    y = _mm_add_ps(_mm_mul_ps(y, x), x);
+
+    y = _mm_or_ps(_mm_and_ps(mask_l, y0), _mm_andnot_ps(mask_l, y));
+
+    return y;
+}
+
+#endif // SSE_MATHFUN_H
@@ -0,0 +1,117 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef X86_ACTIVATION_H
+#define X86_ACTIVATION_H
+
+#include <math.h>
+#include <algorithm>
+
+#if __SSE2__
+#include <emmintrin.h>
+#include "sse_mathfun.h"
+#endif // __SSE2__
+#if __AVX__
+#include <immintrin.h>
+#include "avx_mathfun.h"
+#endif // __AVX__
+
+// 0=none 1=relu 2=leakyrelu 3=clip 4=sigmoid
+static inline float activation_ss(float v, int activation_type, const ncnn::Mat& activation_params)
+{
+    if (activation_type == 1)
+    {
+        v = std::max(v, 0.f);
+    }
+    else if (activation_type == 2)
+    {
+        float slope = activation_params[0];
+        v = v > 0.f ? v : v * slope;
+    }
+    else if (activation_type == 3)
+    {
+        float min = activation_params[0];
+        float max = activation_params[1];
+        if (v < min)
+            v = min;
+        if (v > max)
+            v = max;
+    }
+    else if (activation_type == 4)
+    {
+        v = 1.f / (1.f + exp(-v));
+    }
+
+    return v;
+}
+
+#if __SSE2__
+static inline __m128 activation_sse(__m128 _v, int activation_type, const ncnn::Mat& activation_params)
+{
+    if (activation_type == 1)
+    {
+        _v = _mm_max_ps(_v, _mm_setzero_ps());
+    }
+    else if (activation_type == 2)
+    {
+        __m128 _slope = _mm_set1_ps(activation_params[0]);
+        __m128 _pos = _mm_max_ps(_v, _mm_setzero_ps());
+        __m128 _neg = _mm_min_ps(_v, _mm_setzero_ps());
+        _v = _mm_add_ps(_pos, _mm_mul_ps(_slope, _neg));
+    }
+    else if (activation_type == 3)
+    {
+        _v = _mm_max_ps(_v, _mm_set1_ps(activation_params[0]));
+        _v = _mm_min_ps(_v, _mm_set1_ps(activation_params[1]));
+    }
+    else if (activation_type == 4)
+    {
+        __m128 _one = _mm_set1_ps(1.f);
+        _v = _mm_div_ps(_one, _mm_add_ps(_one, exp_ps(_mm_sub_ps(_mm_setzero_ps(), _v))));
+    }
+
+    return _v;
+}
+#endif // __SSE2__
+
+#if __AVX__
+static inline __m256 activation_avx(__m256 _v, int activation_type, const ncnn::Mat& activation_params)
+{
+    if (activation_type == 1)
+    {
+        _v = _mm256_max_ps(_v, _mm256_setzero_ps());
+    }
+    else if (activation_type == 2)
+    {
+        __m256 _slope = _mm256_set1_ps(activation_params[0]);
+        __m256 _pos = _mm256_max_ps(_v, _mm256_setzero_ps());
+        __m256 _neg = _mm256_min_ps(_v, _mm256_setzero_ps());
+        _v = _mm256_fmadd_ps(_slope, _neg, _pos);
+    }
+    else if (activation_type == 3)
+    {
+        _v = _mm256_max_ps(_v, _mm256_set1_ps(activation_params[0]));
+        _v = _mm256_min_ps(_v, _mm256_set1_ps(activation_params[1]));
+    }
+    else if (activation_type == 4)
+    {
+        __m256 _one = _mm256_set1_ps(1.f);
+        _v = _mm256_div_ps(_one, _mm256_add_ps(_one, exp256_ps(_mm256_sub_ps(_mm256_setzero_ps(), _v))));
+    }
+
+    return _v;
+}
+#endif // __AVX__
+
+#endif // X86_ACTIVATION_H
@@ -0,0 +1,613 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef X86_GEMM_H
+#define X86_GEMM_H
+
+#include <string.h>
+#include <algorithm>
+
+#include "x86_activation.h"
+
+// shared sgemm engine, C = activation(A * B + bias + D)
+//
+// A and B are packed into panels of X86_GEMM_MR rows and X86_GEMM_NR columns,
+// each panel stored k-major and zero padded, so the micro kernel streams both
+// operands linearly. C is cache blocked into X86_GEMM_KC deep slices of
+// X86_GEMM_MC x X86_GEMM_NC tiles, and the tiles are spread over threads in 2d.
+//
+// the register tile depends on the isa this header is built for, so a packed
+// operand must be consumed by code compiled with the same isa as the packer.
+
+#if __AVX__
+#define X86_GEMM_MR 6
+#define X86_GEMM_NR 16
+#elif __SSE2__
+#define X86_GEMM_MR 4
+#define X86_GEMM_NR 8
+#else
+#define X86_GEMM_MR 4
+#define X86_GEMM_NR 4
+#endif
+
+// one kc slice of a b panel stays in l1, one mc x kc block of a stays in l2
+#define X86_GEMM_KC 256
+#define X86_GEMM_MC 96
+#define X86_GEMM_NC 256
+
+// packed a holds one row of X86_GEMM_MR * K floats per panel
+static inline void gemm_x86_packed_a_shape(int M, int K, int& w, int& h)
+{
+    w = X86_GEMM_MR * K;
+    h = (M + X86_GEMM_MR - 1) / X86_GEMM_MR;
+}
+
+// packed b holds one row of X86_GEMM_NR * K floats per panel
+static inline void gemm_x86_packed_b_shape(int K, int N, int& w, int& h)
+{
+    w = X86_GEMM_NR * K;
+    h = (N + X86_GEMM_NR - 1) / X86_GEMM_NR;
+}
+
+// A is M x K row-major
+static void gemm_x86_pack_a(const float* A, int lda, int M, int K, float* Ap, const ncnn::Option& opt)
+{
+    const int nn_panel = (M + X86_GEMM_MR - 1) / X86_GEMM_MR;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int pp=0; pp<nn_panel; pp++)
+    {
+        const int i0 = pp * X86_GEMM_MR;
+        const int mr = std::min(X86_GEMM_MR, M - i0);
+
+        float* ap = Ap + (size_t)pp * X86_GEMM_MR * K;
+
+        for (int k=0; k<K; k++)
+        {
+            int r = 0;
+            for (; r<mr; r++)
+            {
+                ap[r] = A[(size_t)(i0 + r) * lda + k];
+            }
+            for (; r<X86_GEMM_MR; r++)
+            {
+                ap[r] = 0.f;
+            }
+
+            ap += X86_GEMM_MR;
+        }
+    }
+}
+
+// B is K x N row-major
+static void gemm_x86_pack_b(const float* B, int ldb, int K, int N, float* Bp, const ncnn::Option& opt)
+{
+    const int nn_panel = (N + X86_GEMM_NR - 1) / X86_GEMM_NR;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int pp=0; pp<nn_panel; pp++)
+    {
+        const int j0 = pp * X86_GEMM_NR;
+        const int nr = std::min(X86_GEMM_NR, N - j0);
+
+        float* bp = Bp + (size_t)pp * X86_GEMM_NR * K;
+
+        for (int k=0; k<K; k++)
+        {
+            const float* b = B + (size_t)k * ldb + j0;
+
+            if (nr == X86_GEMM_NR)
+            {
+#if __AVX__
+                _mm256_storeu_ps(bp, _mm256_loadu_ps(b));
+                _mm256_storeu_ps(bp + 8, _mm256_loadu_ps(b + 8));
+#elif __SSE2__
+                _mm_storeu_ps(bp, _mm_loadu_ps(b));
+                _mm_storeu_ps(bp + 4, _mm_loadu_ps(b + 4));
+#else
+                memcpy(bp, b, X86_GEMM_NR * sizeof(float));
+#endif
+            }
+            else
+            {
+                int c = 0;
+                for (; c<nr; c++)
+                {
+                    bp[c] = b[c];
+                }
+                for (; c<X86_GEMM_NR; c++)
+                {
+                    bp[c] = 0.f;
+                }
+            }
+
+            bp += X86_GEMM_NR;
+        }
+    }
+}
+
+// B is given transposed, as N x K row-major
+static void gemm_x86_pack_b_transposed(const float* Bt, int ldb, int K, int N, float* Bp, const ncnn::Option& opt)
+{
+    const int nn_panel = (N + X86_GEMM_NR - 1) / X86_GEMM_NR;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int pp=0; pp<nn_panel; pp++)
+    {
+        const int j0 = pp * X86_GEMM_NR;
+        const int nr = std::min(X86_GEMM_NR, N - j0);
+
+        float* bp = Bp + (size_t)pp * X86_GEMM_NR * K;
+
+        for (int k=0; k<K; k++)
+        {
+            int c = 0;
+            for (; c<nr; c++)
+            {
+                bp[c] = Bt[(size_t)(j0 + c) * ldb + k];
+            }
+            for (; c<X86_GEMM_NR; c++)
+            {
+                bp[c] = 0.f;
+            }
+
+            bp += X86_GEMM_NR;
+        }
+    }
+}
+
+// full X86_GEMM_MR x X86_GEMM_NR tile
+// the first k slice starts from bias plus d, the last one applies the activation
+static void gemm_x86_kernel(const float* a, const float* b, int kc, float* c, int ldc, const float* d, int ldd, bool first, bool last, const float* bias_m, const float* bias_n, int activation_type, const ncnn::Mat& activation_params)
+{
+#if __AVX__
+    __m256 _c00, _c01, _c10, _c11, _c20, _c21, _c30, _c31, _c40, _c41, _c50, _c51;
+
+    if (first)
+    {
+        if (bias_m)
+        {
+            _c00 = _c01 = _mm256_set1_ps(bias_m[0]);
+            _c10 = _c11 = _mm256_set1_ps(bias_m[1]);
+            _c20 = _c21 = _mm256_set1_ps(bias_m[2]);
+            _c30 = _c31 = _mm256_set1_ps(bias_m[3]);
+            _c40 = _c41 = _mm256_set1_ps(bias_m[4]);
+            _c50 = _c51 = _mm256_set1_ps(bias_m[5]);
+        }
+        else if (bias_n)
+        {
+            _c00 = _c10 = _c20 = _c30 = _c40 = _c50 = _mm256_loadu_ps(bias_n);
+            _c01 = _c11 = _c21 = _c31 = _c41 = _c51 = _mm256_loadu_ps(bias_n + 8);
+        }
+        else
+        {
+            _c00 = _c10 = _c20 = _c30 = _c40 = _c50 = _mm256_setzero_ps();
+            _c01 = _c11 = _c21 = _c31 = _c41 = _c51 = _mm256_setzero_ps();
+        }
+
+        if (d)
+        {
+            _c00 = _mm256_add_ps(_c00, _mm256_loadu_ps(d));
+            _c01 = _mm256_add_ps(_c01, _mm256_loadu_ps(d + 8));
+            _c10 = _mm256_add_ps(_c10, _mm256_loadu_ps(d + ldd));
+            _c11 = _mm256_add_ps(_c11, _mm256_loadu_ps(d + ldd + 8));
+            _c20 = _mm256_add_ps(_c20, _mm256_loadu_ps(d + ldd * 2));
+            _c21 = _mm256_add_ps(_c21, _mm256_loadu_ps(d + ldd * 2 + 8));
+            _c30 = _mm256_add_ps(_c30, _mm256_loadu_ps(d + ldd * 3));
+            _c31 = _mm256_add_ps(_c31, _mm256_loadu_ps(d + ldd * 3 + 8));
+            _c40 = _mm256_add_ps(_c40, _mm256_loadu_ps(d + ldd * 4));
+            _c41 = _mm256_add_ps(_c41, _mm256_loadu_ps(d + ldd * 4 + 8));
+            _c50 = _mm256_add_ps(_c50, _mm256_loadu_ps(d + ldd * 5));
+            _c51 = _mm256_add_ps(_c51, _mm256_loadu_ps(d + ldd * 5 + 8));
+        }
+    }
+    else
+    {
+        _c00 = _mm256_loadu_ps(c);
+        _c01 = _mm256_loadu_ps(c + 8);
+        _c10 = _mm256_loadu_ps(c + ldc);
+        _c11 = _mm256_loadu_ps(c + ldc + 8);
+        _c20 = _mm256_loadu_ps(c + ldc * 2);
+        _c21 = _mm256_loadu_ps(c + ldc * 2 + 8);
+        _c30 = _mm256_loadu_ps(c + ldc * 3);
+        _c31 = _mm256_loadu_ps(c + ldc * 3 + 8);
+        _c40 = _mm256_loadu_ps(c + ldc * 4);
+        _c41 = _mm256_loadu_ps(c + ldc * 4 + 8);
+        _c50 = _mm256_loadu_ps(c + ldc * 5);
+        _c51 = _mm256_loadu_ps(c + ldc * 5 + 8);
+    }
+
+    for (int k=0; k<kc; k++)
+    {
+        __m256 _b0 = _mm256_loadu_ps(b);
+        __m256 _b1 = _mm256_loadu_ps(b + 8);
+
+        __m256 _a0 = _mm256_broadcast_ss(a);
+        __m256 _a1 = _mm256_broadcast_ss(a + 1);
+        _c00 = _mm256_fmadd_ps(_a0, _b0, _c00);
+        _c01 = _mm256_fmadd_ps(_a0, _b1, _c01);
+        _c10 = _mm256_fmadd_ps(_a1, _b0, _c10);
+        _c11 = _mm256_fmadd_ps(_a1, _b1, _c11);
+
+        __m256 _a2 = _mm256_broadcast_ss(a + 2);
+        __m256 _a3 = _mm256_broadcast_ss(a + 3);
+        _c20 = _mm256_fmadd_ps(_a2, _b0, _c20);
+        _c21 = _mm256_fmadd_ps(_a2, _b1, _c21);
+        _c30 = _mm256_fmadd_ps(_a3, _b0, _c30);
+        _c31 = _mm256_fmadd_ps(_a3, _b1, _c31);
+
+        __m256 _a4 = _mm256_broadcast_ss(a + 4);
+        __m256 _a5 = _mm256_broadcast_ss(a + 5);
+        _c40 = _mm256_fmadd_ps(_a4, _b0, _c40);
+        _c41 = _mm256_fmadd_ps(_a4, _b1, _c41);
+        _c50 = _mm256_fmadd_ps(_a5, _b0, _c50);
+        _c51 = _mm256_fmadd_ps(_a5, _b1, _c51);
+
+        a += 6;
+        b += 16;
+    }
+
+    if (last && activation_type)
+    {
+        _c00 = activation_avx(_c00, activation_type, activation_params);
+        _c01 = activation_avx(_c01, activation_type, activation_params);
+        _c10 = activation_avx(_c10, activation_type, activation_params);
+        _c11 = activation_avx(_c11, activation_type, activation_params);
+        _c20 = activation_avx(_c20, activation_type, activation_params);
+        _c21 = activation_avx(_c21, activation_type, activation_params);
+        _c30 = activation_avx(_c30, activation_type, activation_params);
+        _c31 = activation_avx(_c31, activation_type, activation_params);
+        _c40 = activation_avx(_c40, activation_type, activation_params);
+        _c41 = activation_avx(_c41, activation_type, activation_params);
+        _c50 = activation_avx(_c50, activation_type, activation_params);
+        _c51 = activation_avx(_c51, activation_type, activation_params);
+    }
+
+    _mm256_storeu_ps(c, _c00);
+    _mm256_storeu_ps(c + 8, _c01);
+    _mm256_storeu_ps(c + ldc, _c10);
+    _mm256_storeu_ps(c + ldc + 8, _c11);
+    _mm256_storeu_ps(c + ldc * 2, _c20);
+    _mm256_storeu_ps(c + ldc * 2 + 8, _c21);
+    _mm256_storeu_ps(c + ldc * 3, _c30);
+    _mm256_storeu_ps(c + ldc * 3 + 8, _c31);
+    _mm256_storeu_ps(c + ldc * 4, _c40);
+    _mm256_storeu_ps(c + ldc * 4 + 8, _c41);
+    _mm256_storeu_ps(c + ldc * 5, _c50);
+    _mm256_storeu_ps(c + ldc * 5 + 8, _c51);
+#elif __SSE2__
+    __m128 _c00, _c01, _c10, _c11, _c20, _c21, _c30, _c31;
+
+    if (first)
+    {
+        if (bias_m)
+        {
+            _c00 = _c01 = _mm_set1_ps(bias_m[0]);
+            _c10 = _c11 = _mm_set1_ps(bias_m[1]);
+            _c20 = _c21 = _mm_set1_ps(bias_m[2]);
+            _c30 = _c31 = _mm_set1_ps(bias_m[3]);
+        }
+        else if (bias_n)
+        {
+            _c00 = _c10 = _c20 = _c30 = _mm_loadu_ps(bias_n);
+            _c01 = _c11 = _c21 = _c31 = _mm_loadu_ps(bias_n + 4);
+        }
+        else
+        {
+            _c00 = _c10 = _c20 = _c30 = _mm_setzero_ps();
+            _c01 = _c11 = _c21 = _c31 = _mm_setzero_ps();
+        }
+
+        if (d)
+        {
+            _c00 = _mm_add_ps(_c00, _mm_loadu_ps(d));
+            _c01 = _mm_add_ps(_c01, _mm_loadu_ps(d + 4));
+            _c10 = _mm_add_ps(_c10, _mm_loadu_ps(d + ldd));
+            _c11 = _mm_add_ps(_c11, _mm_loadu_ps(d + ldd + 4));
+            _c20 = _mm_add_ps(_c20, _mm_loadu_ps(d + ldd * 2));
+            _c21 = _mm_add_ps(_c21, _mm_loadu_ps(d + ldd * 2 + 4));
+            _c30 = _mm_add_ps(_c30, _mm_loadu_ps(d + ldd * 3));
+            _c31 = _mm_add_ps(_c31, _mm_loadu_ps(d + ldd * 3 + 4));
+        }
+    }
+    else
+    {
+        _c00 = _mm_loadu_ps(c);
+        _c01 = _mm_loadu_ps(c + 4);
+        _c10 = _mm_loadu_ps(c + ldc);
+        _c11 = _mm_loadu_ps(c + ldc + 4);
+        _c20 = _mm_loadu_ps(c + ldc * 2);
+        _c21 = _mm_loadu_ps(c + ldc * 2 + 4);
+        _c30 = _mm_loadu_ps(c + ldc * 3);
+        _c31 = _mm_loadu_ps(c + ldc * 3 + 4);
+    }
+
+    for (int k=0; k<kc; k++)
+    {
+        __m128 _b0 = _mm_loadu_ps(b);
+        __m128 _b1 = _mm_loadu_ps(b + 4);
+
+        __m128 _a0 = _mm_load1_ps(a);
+        __m128 _a1 = _mm_load1_ps(a + 1);
+        _c00 = _mm_add_ps(_c00, _mm_mul_ps(_a0, _b0));
+        _c01 = _mm_add_ps(_c01, _mm_mul_ps(_a0, _b1));
+        _c10 = _mm_add_ps(_c10, _mm_mul_ps(_a1, _b0));
+        _c11 = _mm_add_ps(_c11, _mm_mul_ps(_a1, _b1));
+
+        __m128 _a2 = _mm_load1_ps(a + 2);
+        __m128 _a3 = _mm_load1_ps(a + 3);
+        _c20 = _mm_add_ps(_c20, _mm_mul_ps(_a2, _b0));
+        _c21 = _mm_add_ps(_c21, _mm_mul_ps(_a2, _b1));
+        _c30 = _mm_add_ps(_c30, _mm_mul_ps(_a3, _b0));
+        _c31 = _mm_add_ps(_c31, _mm_mul_ps(_a3, _b1));
+
+        a += 4;
+        b += 8;
+    }
+
+    if (last && activation_type)
+    {
+        _c00 = activation_sse(_c00, activation_type, activation_params);
+        _c01 = activation_sse(_c01, activation_type, activation_params);
+        _c10 = activation_sse(_c10, activation_type, activation_params);
+        _c11 = activation_sse(_c11, activation_type, activation_params);
+        _c20 = activation_sse(_c20, activation_type, activation_params);
+        _c21 = activation_sse(_c21, activation_type, activation_params);
+        _c30 = activation_sse(_c30, activation_type, activation_params);
+        _c31 = activation_sse(_c31, activation_type, activation_params);
+    }
+
+    _mm_storeu_ps(c, _c00);
+    _mm_storeu_ps(c + 4, _c01);
+    _mm_storeu_ps(c + ldc, _c10);
+    _mm_storeu_ps(c + ldc + 4, _c11);
+    _mm_storeu_ps(c + ldc * 2, _c20);
+    _mm_storeu_ps(c + ldc * 2 + 4, _c21);
+    _mm_storeu_ps(c + ldc * 3, _c30);
+    _mm_storeu_ps(c + ldc * 3 + 4, _c31);
+#else
+    float sum[X86_GEMM_MR][X86_GEMM_NR];
+
+    for (int r=0; r<X86_GEMM_MR; r++)
+    {
+        for (int j=0; j<X86_GEMM_NR; j++)
+        {
+            if (first)
+                sum[r][j] = (bias_m ? bias_m[r] : bias_n ? bias_n[j] : 0.f) + (d ? d[r * ldd + j] : 0.f);
+            else
+                sum[r][j] = c[r * ldc + j];
+        }
+    }
+
+    for (int k=0; k<kc; k++)
+    {
+        for (int r=0; r<X86_GEMM_MR; r++)
+        {
+            for (int j=0; j<X86_GEMM_NR; j++)
+            {
+                sum[r][j] += a[r] * b[j];
+            }
+        }
+
+        a += X86_GEMM_MR;
+        b += X86_GEMM_NR;
+    }
+
+    for (int r=0; r<X86_GEMM_MR; r++)
+    {
+        for (int j=0; j<X86_GEMM_NR; j++)
+        {
+            c[r * ldc + j] = last ? activation_ss(sum[r][j], activation_type, activation_params) : sum[r][j];
+        }
+    }
+#endif
+}
+
+// edge tile of mr x nr, computed through a full size scratch tile
+static void gemm_x86_kernel_edge(const float* a, const float* b, int kc, float* c, int ldc, const float* d, int ldd, int mr, int nr, bool first, bool last, const float* bias_m, const float* bias_n, int activation_type, const ncnn::Mat& activation_params)
+{
+    float tmp[X86_GEMM_MR * X86_GEMM_NR];
+    float tmp_bias[X86_GEMM_MR > X86_GEMM_NR ? X86_GEMM_MR : X86_GEMM_NR];
+    float tmp_d[X86_GEMM_MR * X86_GEMM_NR];
+
+    if (first)
+    {
+        if (d)
+        {
+            memset(tmp_d, 0, sizeof(tmp_d));
+            for (int r=0; r<mr; r++)
+            {
+                memcpy(tmp_d + r * X86_GEMM_NR, d + (size_t)r * ldd, nr * sizeof(float));
+            }
+            d = tmp_d;
+        }
+
+        if (bias_m)
+        {
+            for (int r=0; r<X86_GEMM_MR; r++)
+            {
+                tmp_bias[r] = r < mr ? bias_m[r] : 0.f;
+            }
+            bias_m = tmp_bias;
+        }
+        else if (bias_n)
+        {
+            for (int j=0; j<X86_GEMM_NR; j++)
+            {
+                tmp_bias[j] = j < nr ? bias_n[j] : 0.f;
+            }
+            bias_n = tmp_bias;
+        }
+    }
+    else
+    {
+        memset(tmp, 0, sizeof(tmp));
+        for (int r=0; r<mr; r++)
+        {
+            memcpy(tmp + r * X86_GEMM_NR, c + (size_t)r * ldc, nr * sizeof(float));
+        }
+    }
+
+    gemm_x86_kernel(a, b, kc, tmp, X86_GEMM_NR, d, X86_GEMM_NR, first, last, bias_m, bias_n, activation_type, activation_params);
+
+    for (int r=0; r<mr; r++)
+    {
+        memcpy(c + (size_t)r * ldc, tmp + r * X86_GEMM_NR, nr * sizeof(float));
+    }
+}
+
+// edge tile of a few columns, one column at a time with the rows in a vector
+static void gemm_x86_kernel_narrow(const float* a, const float* b, int kc, float* c, int ldc, const float* d, int ldd, int mr, int nr, bool first, bool last, const float* bias_m, const float* bias_n, int activation_type, const ncnn::Mat& activation_params)
+{
+    for (int j=0; j<nr; j++)
+    {
+        float sum[X86_GEMM_MR];
+        for (int r=0; r<X86_GEMM_MR; r++)
+        {
+            if (first)
+                sum[r] = r < mr ? (bias_m ? bias_m[r] : bias_n ? bias_n[j] : 0.f) + (d ? d[(size_t)r * ldd + j] : 0.f) : 0.f;
+            else
+                sum[r] = r < mr ? c[(size_t)r * ldc + j] : 0.f;
+        }
+
+        const float* ap = a;
+        const float* bp = b + j;
+
+#if __SSE2__
+        // two k chains to hide the add latency
+        __m128 _sum0 = _mm_loadu_ps(sum);
+        __m128 _sum1 = _mm_setzero_ps();
+#if X86_GEMM_MR == 6
+        __m128 _sum2 = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(sum + 4));
+        __m128 _sum3 = _mm_setzero_ps();
+#endif
+        int k = 0;
+        for (; k+1<kc; k+=2)
+        {
+            __m128 _b0 = _mm_set1_ps(bp[0]);
+            __m128 _b1 = _mm_set1_ps(bp[X86_GEMM_NR]);
+            _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_mm_loadu_ps(ap), _b0));
+            _sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_mm_loadu_ps(ap + X86_GEMM_MR), _b1));
+#if X86_GEMM_MR == 6
+            _sum2 = _mm_add_ps(_sum2, _mm_mul_ps(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(ap + 4)), _b0));
+            _sum3 = _mm_add_ps(_sum3, _mm_mul_ps(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(ap + 10)), _b1));
+#endif
+            ap += X86_GEMM_MR * 2;
+            bp += X86_GEMM_NR * 2;
+        }
+        for (; k<kc; k++)
+        {
+            __m128 _b0 = _mm_set1_ps(bp[0]);
+            _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_mm_loadu_ps(ap), _b0));
+#if X86_GEMM_MR == 6
+            _sum2 = _mm_add_ps(_sum2, _mm_mul_ps(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(ap + 4)), _b0));
+#endif
+            ap += X86_GEMM_MR;
+            bp += X86_GEMM_NR;
+        }
+        _mm_storeu_ps(sum, _mm_add_ps(_sum0, _sum1));
+#if X86_GEMM_MR == 6
+        _mm_storel_pi((__m64*)(sum + 4), _mm_add_ps(_sum2, _sum3));
+#endif
+#else
+        for (int k=0; k<kc; k++)
+        {
+            for (int r=0; r<X86_GEMM_MR; r++)
+            {
+                sum[r] += ap[r] * bp[0];
+            }
+
+            ap += X86_GEMM_MR;
+            bp += X86_GEMM_NR;
+        }
+#endif
+
+        for (int r=0; r<mr; r++)
+        {
+            c[(size_t)r * ldc + j] = last ? activation_ss(sum[r], activation_type, activation_params) : sum[r];
+        }
+    }
+}
+
+// C is M x N row-major, Ap and Bp come from the packers above
+// bias_m adds one value per row, bias_n one value per column, either may be null
+// D is an optional M x N addend summed before the activation, such as a residual
+static void gemm_x86(int M, int N, int K, const float* Ap, const float* Bp, float* C, int ldc, const float* D, int ldd, const float* bias_m, const float* bias_n, int activation_type, const ncnn::Mat& activation_params, const ncnn::Option& opt)
+{
+    int mc = std::min(X86_GEMM_MC, (M + X86_GEMM_MR - 1) / X86_GEMM_MR * X86_GEMM_MR);
+    int nc = std::min(X86_GEMM_NC, (N + X86_GEMM_NR - 1) / X86_GEMM_NR * X86_GEMM_NR);
+
+    int nn_m = (M + mc - 1) / mc;
+    int nn_n = (N + nc - 1) / nc;
+
+    // shrink the tiles until every thread has work, columns first
+    while (nn_m * nn_n < opt.num_threads)
+    {
+        if (nc > X86_GEMM_NR)
+            nc = (nc / 2 + X86_GEMM_NR - 1) / X86_GEMM_NR * X86_GEMM_NR;
+        else if (mc > X86_GEMM_MR)
+            mc = (mc / 2 + X86_GEMM_MR - 1) / X86_GEMM_MR * X86_GEMM_MR;
+        else
+            break;
+
+        nn_m = (M + mc - 1) / mc;
+        nn_n = (N + nc - 1) / nc;
+    }
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int t=0; t<nn_m * nn_n; t++)
+    {
+        const int i0 = t / nn_n * mc;
+        const int j0 = t % nn_n * nc;
+
+        const int mmax = std::min(mc, M - i0);
+        const int nmax = std::min(nc, N - j0);
+
+        for (int k0=0; k0<K; k0+=X86_GEMM_KC)
+        {
+            const int kc = std::min(X86_GEMM_KC, K - k0);
+
+            const bool first = k0 == 0;
+            const bool last = k0 + kc == K;
+
+            for (int j=0; j<nmax; j+=X86_GEMM_NR)
+            {
+                const int nr = std::min(X86_GEMM_NR, nmax - j);
+
+                const float* b = Bp + (size_t)(j0 + j) * K + k0 * X86_GEMM_NR;
+                const float* bn = bias_n ? bias_n + j0 + j : 0;
+
+                for (int i=0; i<mmax; i+=X86_GEMM_MR)
+                {
+                    const int mr = std::min(X86_GEMM_MR, mmax - i);
+
+                    const float* a = Ap + (size_t)(i0 + i) * K + k0 * X86_GEMM_MR;
+                    const float* bm = bias_m ? bias_m + i0 + i : 0;
+
+                    float* c = C + (size_t)(i0 + i) * ldc + j0 + j;
+                    const float* dd = D ? D + (size_t)(i0 + i) * ldd + j0 + j : 0;
+
+                    if (mr == X86_GEMM_MR && nr == X86_GEMM_NR)
+                        gemm_x86_kernel(a, b, kc, c, ldc, dd, ldd, first, last, bm, bn, activation_type, activation_params);
+                    else if (nr <= X86_GEMM_NR / 4)
+                        gemm_x86_kernel_narrow(a, b, kc, c, ldc, dd, ldd, mr, nr, first, last, bm, bn, activation_type, activation_params);
+                    else
+                        gemm_x86_kernel_edge(a, b, kc, c, ldc, dd, ldd, mr, nr, first, last, bm, bn, activation_type, activation_params);
+                }
+            }
+        }
+    }
+}
+
+#endif // X86_GEMM_H
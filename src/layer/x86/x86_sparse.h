@@ -0,0 +1,264 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef X86_SPARSE_H
+#define X86_SPARSE_H
+
+#include <algorithm>
+
+#include "x86_activation.h"
+
+// sparse times dense products for pruned weights
+//
+// the sparse operand is a M x K matrix in compressed sparse rows, values holds
+// the non-zero weights row by row and indices holds the M + 1 row offsets into
+// values followed by the column of each value. the spmm vectorizes over the
+// columns of the dense operand, the spmv gathers the dense vector.
+
+// the sparse kernels win over the dense ones below this fraction of non-zeros
+#define X86_SPARSE_DENSITY 0.3f
+
+// spmm columns per thread tile
+#if __AVX__
+#define X86_SPARSE_NT 32
+#elif __SSE2__
+#define X86_SPARSE_NT 16
+#else
+#define X86_SPARSE_NT 4
+#endif
+
+static int sparse_x86_count_nonzero(const float* A, int size)
+{
+    int nnz = 0;
+    for (int i=0; i<size; i++)
+    {
+        if (A[i] != 0.f)
+            nnz++;
+    }
+
+    return nnz;
+}
+
+static int sparse_x86_pack(const float* A, int M, int K, ncnn::Mat& values, ncnn::Mat& indices)
+{
+    const int nnz = sparse_x86_count_nonzero(A, M * K);
+
+    // keep one element so that an all zero matrix still marks the sparse path
+    values.create(std::max(nnz, 1));
+    indices.create(M + 1 + nnz, (size_t)4u);
+    if (values.empty() || indices.empty())
+        return -100;
+
+    values[0] = 0.f;
+
+    float* vptr = values;
+    int* offsets = indices;
+    int* cols = offsets + M + 1;
+
+    int n = 0;
+    for (int m=0; m<M; m++)
+    {
+        offsets[m] = n;
+
+        const float* aptr = A + m * K;
+        for (int k=0; k<K; k++)
+        {
+            if (aptr[k] == 0.f)
+                continue;
+
+            vptr[n] = aptr[k];
+            cols[n] = k;
+            n++;
+        }
+    }
+
+    offsets[M] = n;
+
+    return 0;
+}
+
+// C = activation(A * B + bias), B is K x N with row stride ldb
+static void sparse_x86_spmm(int M, int N, const ncnn::Mat& values, const ncnn::Mat& indices, const float* B, size_t ldb, float* C, size_t ldc, const float* bias, int activation_type, const ncnn::Mat& activation_params, const ncnn::Option& opt)
+{
+    const float* vptr = values;
+    const int* offsets = indices;
+    const int* cols = offsets + M + 1;
+
+    const int nn_tile = (N + X86_SPARSE_NT - 1) / X86_SPARSE_NT;
+
+    // every tile walks all rows, its column strip of B stays in cache
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int t=0; t<nn_tile; t++)
+    {
+        const int n0 = t * X86_SPARSE_NT;
+        const int nn = std::min(X86_SPARSE_NT, N - n0);
+
+        const float* bptr = B + n0;
+
+        for (int m=0; m<M; m++)
+        {
+            const int p0 = offsets[m];
+            const int p1 = offsets[m + 1];
+            const float bias0 = bias ? bias[m] : 0.f;
+
+            float* outptr = C + m * ldc + n0;
+
+            int j = 0;
+#if __AVX__
+            for (; j+31<nn; j+=32)
+            {
+                __m256 _sum0 = _mm256_set1_ps(bias0);
+                __m256 _sum1 = _sum0;
+                __m256 _sum2 = _sum0;
+                __m256 _sum3 = _sum0;
+
+                for (int p=p0; p<p1; p++)
+                {
+                    __m256 _w = _mm256_broadcast_ss(vptr + p);
+                    const float* x = bptr + cols[p] * ldb + j;
+
+                    _sum0 = _mm256_fmadd_ps(_w, _mm256_loadu_ps(x), _sum0);
+                    _sum1 = _mm256_fmadd_ps(_w, _mm256_loadu_ps(x + 8), _sum1);
+                    _sum2 = _mm256_fmadd_ps(_w, _mm256_loadu_ps(x + 16), _sum2);
+                    _sum3 = _mm256_fmadd_ps(_w, _mm256_loadu_ps(x + 24), _sum3);
+                }
+
+                _mm256_storeu_ps(outptr + j, activation_avx(_sum0, activation_type, activation_params));
+                _mm256_storeu_ps(outptr + j + 8, activation_avx(_sum1, activation_type, activation_params));
+                _mm256_storeu_ps(outptr + j + 16, activation_avx(_sum2, activation_type, activation_params));
+                _mm256_storeu_ps(outptr + j + 24, activation_avx(_sum3, activation_type, activation_params));
+            }
+            for (; j+7<nn; j+=8)
+            {
+                __m256 _sum = _mm256_set1_ps(bias0);
+
+                for (int p=p0; p<p1; p++)
+                {
+                    _sum = _mm256_fmadd_ps(_mm256_broadcast_ss(vptr + p), _mm256_loadu_ps(bptr + cols[p] * ldb + j), _sum);
+                }
+
+                _mm256_storeu_ps(outptr + j, activation_avx(_sum, activation_type, activation_params));
+            }
+#elif __SSE2__
+            for (; j+15<nn; j+=16)
+            {
+                __m128 _sum0 = _mm_set1_ps(bias0);
+                __m128 _sum1 = _sum0;
+                __m128 _sum2 = _sum0;
+                __m128 _sum3 = _sum0;
+
+                for (int p=p0; p<p1; p++)
+                {
+                    __m128 _w = _mm_load1_ps(vptr + p);
+                    const float* x = bptr + cols[p] * ldb + j;
+
+                    _sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_w, _mm_loadu_ps(x)));
+                    _sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_w, _mm_loadu_ps(x + 4)));
+                    _sum2 = _mm_add_ps(_sum2, _mm_mul_ps(_w, _mm_loadu_ps(x + 8)));
+                    _sum3 = _mm_add_ps(_sum3, _mm_mul_ps(_w, _mm_loadu_ps(x + 12)));
+                }
+
+                _mm_storeu_ps(outptr + j, activation_sse(_sum0, activation_type, activation_params));
+                _mm_storeu_ps(outptr + j + 4, activation_sse(_sum1, activation_type, activation_params));
+                _mm_storeu_ps(outptr + j + 8, activation_sse(_sum2, activation_type, activation_params));
+                _mm_storeu_ps(outptr + j + 12, activation_sse(_sum3, activation_type, activation_params));
+            }
+#endif
+#if __SSE2__
+            for (; j+3<nn; j+=4)
+            {
+                __m128 _sum = _mm_set1_ps(bias0);
+
+                for (int p=p0; p<p1; p++)
+                {
+                    _sum = _mm_add_ps(_sum, _mm_mul_ps(_mm_load1_ps(vptr + p), _mm_loadu_ps(bptr + cols[p] * ldb + j)));
+                }
+
+                _mm_storeu_ps(outptr + j, activation_sse(_sum, activation_type, activation_params));
+            }
+#endif // __SSE2__
+            for (; j<nn; j++)
+            {
+                float sum = bias0;
+
+                for (int p=p0; p<p1; p++)
+                {
+                    sum += vptr[p] * bptr[cols[p] * ldb + j];
+                }
+
+                outptr[j] = activation_ss(sum, activation_type, activation_params);
+            }
+        }
+    }
+}
+
+// y = activation(A * x + bias)
+static void sparse_x86_spmv(int M, const ncnn::Mat& values, const ncnn::Mat& indices, const float* x, float* y, const float* bias, int activation_type, const ncnn::Mat& activation_params, const ncnn::Option& opt)
+{
+    const float* vptr = values;
+    const int* offsets = indices;
+    const int* cols = offsets + M + 1;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int m=0; m<M; m++)
+    {
+        const int p1 = offsets[m + 1];
+
+        int p = offsets[m];
+        float sum = bias ? bias[m] : 0.f;
+
+#if __AVX2__
+        __m256 _sum0 = _mm256_setzero_ps();
+        __m256 _sum1 = _mm256_setzero_ps();
+        for (; p+15<p1; p+=16)
+        {
+            __m256 _x0 = _mm256_i32gather_ps(x, _mm256_loadu_si256((const __m256i*)(cols + p)), 4);
+            __m256 _x1 = _mm256_i32gather_ps(x, _mm256_loadu_si256((const __m256i*)(cols + p + 8)), 4);
+            _sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(vptr + p), _x0, _sum0);
+            _sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(vptr + p + 8), _x1, _sum1);
+        }
+        for (; p+7<p1; p+=8)
+        {
+            __m256 _x0 = _mm256_i32gather_ps(x, _mm256_loadu_si256((const __m256i*)(cols + p)), 4);
+            _sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(vptr + p), _x0, _sum0);
+        }
+
+        _sum0 = _mm256_add_ps(_sum0, _sum1);
+        __m128 _s = _mm_add_ps(_mm256_castps256_ps128(_sum0), _mm256_extractf128_ps(_sum0, 1));
+        _s = _mm_add_ps(_s, _mm_movehl_ps(_s, _s));
+        _s = _mm_add_ss(_s, _mm_shuffle_ps(_s, _s, 1));
+        sum += _mm_cvtss_f32(_s);
+#else
+        float sum1 = 0.f;
+        float sum2 = 0.f;
+        float sum3 = 0.f;
+        for (; p+3<p1; p+=4)
+        {
+            sum += vptr[p] * x[cols[p]];
+            sum1 += vptr[p + 1] * x[cols[p + 1]];
+            sum2 += vptr[p + 2] * x[cols[p + 2]];
+            sum3 += vptr[p + 3] * x[cols[p + 3]];
+        }
+        sum += sum1 + sum2 + sum3;
+#endif // __AVX2__
+        for (; p<p1; p++)
+        {
+            sum += vptr[p] * x[cols[p]];
+        }
+
+        y[m] = activation_ss(sum, activation_type, activation_params);
+    }
+}
+
+#endif // X86_SPARSE_H
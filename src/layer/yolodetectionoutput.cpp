@@ -16,6 +16,7 @@
 #include <algorithm>
 #include <math.h>
 #include "layer_type.h"
+#include "nms.h"
 
 namespace ncnn {
 
@@ -75,101 +76,6 @@ struct BBoxRect
     int label;
 };
 
-static inline float intersection_area(const BBoxRect& a, const BBoxRect& b)
-{
-    if (a.xmin > b.xmax || a.xmax < b.xmin || a.ymin > b.ymax || a.ymax < b.ymin)
-    {
-        // no intersection
-        return 0.f;
-    }
-
-    float inter_width = std::min(a.xmax, b.xmax) - std::max(a.xmin, b.xmin);
-    float inter_height = std::min(a.ymax, b.ymax) - std::max(a.ymin, b.ymin);
-
-    return inter_width * inter_height;
-}
-
-template <typename T>
-static void qsort_descent_inplace(std::vector<T>& datas, std::vector<float>& scores, int left, int right)
-{
-    int i = left;
-    int j = right;
-    float p = scores[(left + right) / 2];
-
-    while (i <= j)
-    {
-        while (scores[i] > p)
-            i++;
-
-        while (scores[j] < p)
-            j--;
-
-        if (i <= j)
-        {
-            // swap
-            std::swap(datas[i], datas[j]);
-            std::swap(scores[i], scores[j]);
-
-            i++;
-            j--;
-        }
-    }
-
-    if (left < j)
-        qsort_descent_inplace(datas, scores, left, j);
-
-    if (i < right)
-        qsort_descent_inplace(datas, scores, i, right);
-}
-
-template <typename T>
-static void qsort_descent_inplace(std::vector<T>& datas, std::vector<float>& scores)
-{
-    if (datas.empty() || scores.empty())
-        return;
-
-    qsort_descent_inplace(datas, scores, 0, scores.size() - 1);
-}
-
-static void nms_sorted_bboxes(const std::vector<BBoxRect>& bboxes, std::vector<int>& picked, float nms_threshold)
-{
-    picked.clear();
-
-    const int n = bboxes.size();
-
-    std::vector<float> areas(n);
-    for (int i = 0; i < n; i++)
-    {
-        const BBoxRect& r = bboxes[i];
-
-        float width = r.xmax - r.xmin;
-        float height = r.ymax - r.ymin;
-
-        areas[i] = width * height;
-    }
-
-    for (int i = 0; i < n; i++)
-    {
-        const BBoxRect& a = bboxes[i];
-
-        int keep = 1;
-        for (int j = 0; j < (int)picked.size(); j++)
-        {
-            const BBoxRect& b = bboxes[picked[j]];
-
-            // intersection over union
-            float inter_area = intersection_area(a, b);
-            float union_area = areas[i] + areas[picked[j]] - inter_area;
-//             float IoU = inter_area / union_area
-            if (inter_area / union_area > nms_threshold)
-                keep = 0;
-        }
-
-        if (keep)
-            picked.push_back(i);
-    }
-}
-
 static inline float sigmoid(float x)
 {
     return 1.f / (1.f + exp(-x));
@@ -280,12 +186,15 @@ int YoloDetectionOutput::forward_inplace(std::vector<Mat>& bottom_top_blobs, con
         }
     }
 
-    // global sort inplace
-    qsort_descent_inplace(all_bbox_rects, all_bbox_scores);
+    // global sort
+    std::vector<int> order;
+    if (!all_bbox_scores.empty())
+        topk_descent_indices(&all_bbox_scores[0], all_bbox_scores.size(), 0, order);
 
     // apply nms
     std::vector<int> picked;
-    nms_sorted_bboxes(all_bbox_rects, picked, nms_threshold);
+    if (!order.empty())
+        nms_sorted_bboxes((const float*)&all_bbox_rects[0], sizeof(BBoxRect) / sizeof(float), &order[0], order.size(), picked, nms_threshold);
 
     // select
     std::vector<BBoxRect> bbox_rects;
@@ -8,7 +8,7 @@
 #include <algorithm>
 #include <math.h>
 #include "layer_type.h"
-#include "object_detection.h"
+#include "nms.h"
 #include "yolov1detection.h"
 
 namespace ncnn
@@ -50,6 +50,15 @@ int Yolov1Detection::load_param(const ParamDict &pd)
     return 0;
 }
 
+struct BBoxRect
+{
+    float xmin;
+    float ymin;
+    float xmax;
+    float ymax;
+    int label;
+};
+
 int Yolov1Detection::forward_inplace(Mat &bottom_top_blob, const Option &opt) const
 {
     int size = side * side;
@@ -64,66 +73,79 @@ int Yolov1Detection::forward_inplace(Mat &bottom_top_blob, const Option &opt) co
         softmax->forward_inplace(classes_scores, opt);
     }
 
-    ObjectsManager objects(size * box_num / 20);
     const float *classes_ptr = bottom_top_blob;
     const float *scales_ptr = classes_ptr + size * classes;
     const float *boxes_ptr = scales_ptr + size * box_num;
 
+    // each cell collects its own candidates, no locking inside the parallel loop
+    std::vector< std::vector<BBoxRect> > all_cell_bbox_rects(size);
+    std::vector< std::vector<float> > all_cell_bbox_scores(size);
+
     #pragma omp parallel for num_threads(opt.num_threads)
     for (int i = 0; i < size; i++)
     {
         int x_offset = i % side;
         int y_offset = i / side;
 
+        const float *cell_classes_ptr = classes_ptr + i * classes;
+
         for (int n = 0; n < box_num; n++)
         {
+            const float *box_ptr = boxes_ptr + (i * box_num + n) * 4;
 
-            float w = (sqrt_enable == 0) * boxes_ptr[2] + (sqrt_enable != 0) * boxes_ptr[2] * boxes_ptr[2];
-            float h = (sqrt_enable == 0) * boxes_ptr[3] + (sqrt_enable != 0) * boxes_ptr[3] * boxes_ptr[3];
-            float xmin = (boxes_ptr[0] + x_offset) / side - w * 0.5f;
-            float ymin = (boxes_ptr[1] + y_offset) / side - h * 0.5f;
+            float w = (sqrt_enable == 0) * box_ptr[2] + (sqrt_enable != 0) * box_ptr[2] * box_ptr[2];
+            float h = (sqrt_enable == 0) * box_ptr[3] + (sqrt_enable != 0) * box_ptr[3] * box_ptr[3];
+            float xmin = (box_ptr[0] + x_offset) / side - w * 0.5f;
+            float ymin = (box_ptr[1] + y_offset) / side - h * 0.5f;
             float xmax = xmin + w;
             float ymax = ymin + h;
-            boxes_ptr += 4;
 
-            float scale = scales_ptr[0];
-            scales_ptr++;
+            float scale = scales_ptr[i * box_num + n];
 
             for (int j = 0; j < classes; j++)
             {
-                float prob = scale * classes_ptr[j];
+                float prob = scale * cell_classes_ptr[j];
                 if (prob > confidence_threshold)
                 {
-                    ObjectBox object = {
-                        .xmin = xmin,
-                        .ymin = ymin,
-                        .xmax = xmax,
-                        .ymax = ymax,
-                        .prob = prob,
-                        .classid = j,
-                    };
-                    objects.add_new_object_box(object);
+                    BBoxRect c = { xmin, ymin, xmax, ymax, j };
+                    all_cell_bbox_rects[i].push_back(c);
+                    all_cell_bbox_scores[i].push_back(prob);
                 }
             }
         }
+    }
+
+    // gather all cells
+    std::vector<BBoxRect> all_bbox_rects;
+    std::vector<float> all_bbox_scores;
 
-        classes_ptr += classes;
+    for (int i = 0; i < size; i++)
+    {
+        all_bbox_rects.insert(all_bbox_rects.end(), all_cell_bbox_rects[i].begin(), all_cell_bbox_rects[i].end());
+        all_bbox_scores.insert(all_bbox_scores.end(), all_cell_bbox_scores[i].begin(), all_cell_bbox_scores[i].end());
     }
 
-    std::vector<ObjectBox> detected_objects;
-    objects.do_objects_nms(detected_objects, nms_threshold, confidence_threshold);
+    // global sort and nms within each class
+    std::vector<int> picked;
+    if (!all_bbox_scores.empty())
+    {
+        std::vector<int> order;
+        topk_descent_indices(&all_bbox_scores[0], all_bbox_scores.size(), 0, order);
+
+        nms_sorted_bboxes((const float*)&all_bbox_rects[0], sizeof(BBoxRect) / sizeof(float), &order[0], order.size(), picked, nms_threshold, &all_bbox_rects[0].label);
+    }
 
-    bottom_top_blob.create(6, (int)detected_objects.size(), 4u, opt.blob_allocator);
+    bottom_top_blob.create(6, (int)picked.size(), 4u, opt.blob_allocator);
     if (bottom_top_blob.empty())
         return -100;
 
-    for (int i = 0; i < detected_objects.size(); i++)
+    for (int i = 0; i < (int)picked.size(); i++)
     {
-        const ObjectBox &r = detected_objects[i];
+        const BBoxRect &r = all_bbox_rects[picked[i]];
         float *outptr = bottom_top_blob.row(i);
 
-        outptr[0] = r.classid + 1; // 0 reserve for background
-        outptr[1] = r.prob;
+        outptr[0] = r.label + 1; // 0 reserve for background
+        outptr[1] = all_bbox_scores[picked[i]];
         outptr[2] = r.xmin;
         outptr[3] = r.ymin;
         outptr[4] = r.xmax;
@@ -7,7 +7,7 @@
 
 #include <math.h>
 #include "layer_type.h"
-#include "object_detection.h"
+#include "nms.h"
 #include "yolov3detection.h"
 
 namespace ncnn
@@ -53,18 +53,24 @@ int Yolov3Detection::load_param(const ParamDict &pd)
     return 0;
 }
 
+struct BBoxRect
+{
+    float xmin;
+    float ymin;
+    float xmax;
+    float ymax;
+    int label;
+};
+
 int Yolov3Detection::forward(const std::vector<Mat> &bottom_blobs, std::vector<Mat> &top_blobs, const Option &opt) const
 {
     int channels = bottom_blobs[0].c;
     std::vector<int> mat_steps_channels;
     mat_steps_channels.push_back(channels);
-    int prob_steps = bottom_blobs[0].w * bottom_blobs[0].h;
     for (int b = 1; b < bottom_blobs.size(); b++)
     {
         channels += bottom_blobs[b].c;
         mat_steps_channels.push_back(channels);
-        prob_steps += bottom_blobs[b].w * bottom_blobs[b].h;
-        prob_steps *= 0.5f;
     }
 
     const int channels_per_box = channels / box_num;
@@ -73,7 +79,9 @@ int Yolov3Detection::forward(const std::vector<Mat> &bottom_blobs, std::vector<M
     if (channels_per_box != 4 + 1 + classes)
         return -1;
         
-    ObjectsManager objects(prob_steps * box_num / 20);
+    // each box collects its own candidates, no locking inside the parallel loop
+    std::vector< std::vector<BBoxRect> > all_box_bbox_rects(box_num);
+    std::vector< std::vector<float> > all_box_bbox_scores(box_num);
 
     #pragma omp parallel for num_threads(opt.num_threads)
     for (int pp = 0; pp < box_num; pp++)
@@ -161,15 +169,9 @@ int Yolov3Detection::forward(const std::vector<Mat> &bottom_blobs, std::vector<M
                 float prob = box_score * class_score;
                 if (prob >= confidence_threshold)
                 {
-                    ObjectBox object = {
-                        .xmin = xmin,
-                        .ymin = ymin,
-                        .xmax = xmax,
-                        .ymax = ymax,
-                        .prob = prob,
-                        .classid = class_index,
-                    };
-                    objects.add_new_object_box(object);
+                    BBoxRect c = { xmin, ymin, xmax, ymax, class_index };
+                    all_box_bbox_rects[pp].push_back(c);
+                    all_box_bbox_scores[pp].push_back(prob);
                 }
 
                 xptr++;
@@ -182,22 +184,39 @@ int Yolov3Detection::forward(const std::vector<Mat> &bottom_blobs, std::vector<M
         }
     }
 
-    std::vector<ObjectBox> detected_objects;
-    objects.do_objects_nms(detected_objects, nms_threshold, confidence_threshold);
+    // gather all boxes
+    std::vector<BBoxRect> all_bbox_rects;
+    std::vector<float> all_bbox_scores;
+
+    for (int i = 0; i < box_num; i++)
+    {
+        all_bbox_rects.insert(all_bbox_rects.end(), all_box_bbox_rects[i].begin(), all_box_bbox_rects[i].end());
+        all_bbox_scores.insert(all_bbox_scores.end(), all_box_bbox_scores[i].begin(), all_box_bbox_scores[i].end());
+    }
+
+    // global sort and nms within each class
+    std::vector<int> picked;
+    if (!all_bbox_scores.empty())
+    {
+        std::vector<int> order;
+        topk_descent_indices(&all_bbox_scores[0], all_bbox_scores.size(), 0, order);
+
+        nms_sorted_bboxes((const float*)&all_bbox_rects[0], sizeof(BBoxRect) / sizeof(float), &order[0], order.size(), picked, nms_threshold, &all_bbox_rects[0].label);
+    }
 
     Mat &top_blob = top_blobs[0];
-    top_blob.create(6, (int)detected_objects.size(), 4u, opt.blob_allocator);
+    top_blob.create(6, (int)picked.size(), 4u, opt.blob_allocator);
 
     if (top_blob.empty())
         return -100;
 
-    for (int i = 0; i < detected_objects.size(); i++)
+    for (int i = 0; i < (int)picked.size(); i++)
     {
-        const ObjectBox &r = detected_objects[i];
+        const BBoxRect &r = all_bbox_rects[picked[i]];
         float *outptr = top_blob.row(i);
 
-        outptr[0] = r.classid + 1; // 0 reserve for background
-        outptr[1] = r.prob;
+        outptr[0] = r.label + 1; // 0 reserve for background
+        outptr[1] = all_bbox_scores[picked[i]];
         outptr[2] = r.xmin;
         outptr[3] = r.ymin;
         outptr[4] = r.xmax;
@@ -18,6 +18,7 @@
 #include <arm_neon.h>
 #endif // __ARM_NEON
 #include <math.h>
+#include <algorithm>
 
 #include "cpu.h"
 
@@ -255,7 +256,11 @@ void copy_cut_border(const Mat& src, Mat& dst, int top, int bottom, int left, in
 
     crop->load_param(pd);
 
-    crop->forward(src, dst, opt);
+    // dst must outlive src
+    Option opt_c = opt;
+    opt_c.use_blob_view = false;
+
+    crop->forward(src, dst, opt_c);
 
     delete crop;
 }
@@ -336,4 +341,119 @@ void cast_float16_to_float32(const Mat& src, Mat& dst, const Option& opt)
     delete cast;
 }
 
+void quantize_weight(const Mat& src, Mat& dst, Mat& scales, int rows, int type, int group_size)
+{
+    const int cols = src.w / rows;
+
+    if (type == 1)
+    {
+        dst.create(rows * cols, (size_t)1u);
+        scales.create(rows);
+        if (dst.empty() || scales.empty())
+            return;
+
+        for (int i=0; i<rows; i++)
+        {
+            const float* ptr = (const float*)src + i * cols;
+            signed char* outptr = (signed char*)dst.data + i * cols;
+
+            float absmax = 0.f;
+            for (int j=0; j<cols; j++)
+            {
+                absmax = std::max(absmax, (float)fabs(ptr[j]));
+            }
+
+            const float scale = absmax / 127.f;
+            const float scale_inv = absmax == 0.f ? 0.f : 127.f / absmax;
+
+            for (int j=0; j<cols; j++)
+            {
+                outptr[j] = (signed char)std::min(std::max((int)round(ptr[j] * scale_inv), -127), 127);
+            }
+
+            scales[i] = scale;
+        }
+    }
+    else if (type == 2)
+    {
+        const int row_bytes = (cols + 1) / 2;
+        const int groups = (cols + group_size - 1) / group_size;
+
+        dst.create(rows * row_bytes, (size_t)1u);
+        scales.create(rows * groups);
+        if (dst.empty() || scales.empty())
+            return;
+
+        memset(dst.data, 0, rows * row_bytes);
+
+        for (int i=0; i<rows; i++)
+        {
+            const float* ptr = (const float*)src + i * cols;
+            unsigned char* outptr = (unsigned char*)dst.data + i * row_bytes;
+
+            for (int g=0; g<groups; g++)
+            {
+                const int j0 = g * group_size;
+                const int j1 = std::min(j0 + group_size, cols);
+
+                float absmax = 0.f;
+                for (int j=j0; j<j1; j++)
+                {
+                    absmax = std::max(absmax, (float)fabs(ptr[j]));
+                }
+
+                const float scale = absmax / 7.f;
+                const float scale_inv = absmax == 0.f ? 0.f : 7.f / absmax;
+
+                for (int j=j0; j<j1; j++)
+                {
+                    int q = std::min(std::max((int)round(ptr[j] * scale_inv), -8), 7) + 8;
+                    outptr[j / 2] |= (unsigned char)(j % 2 == 0 ? q : q << 4);
+                }
+
+                scales[i * groups + g] = scale;
+            }
+        }
+    }
+}
+
+void dequantize_weight(const Mat& src, const Mat& scales, Mat& dst, int rows, int cols, int type, int group_size)
+{
+    dst.create(rows * cols);
+    if (dst.empty())
+        return;
+
+    if (type == 1)
+    {
+        for (int i=0; i<rows; i++)
+        {
+            const signed char* ptr = (const signed char*)src.data + i * cols;
+            float* outptr = (float*)dst + i * cols;
+
+            const float scale = scales[i];
+            for (int j=0; j<cols; j++)
+            {
+                outptr[j] = ptr[j] * scale;
+            }
+        }
+    }
+    else if (type == 2)
+    {
+        const int row_bytes = (cols + 1) / 2;
+        const int groups = (cols + group_size - 1) / group_size;
+
+        for (int i=0; i<rows; i++)
+        {
+            const unsigned char* ptr = (const unsigned char*)src.data + i * row_bytes;
+            float* outptr = (float*)dst + i * cols;
+
+            for (int j=0; j<cols; j++)
+            {
+                int q = j % 2 == 0 ? ptr[j / 2] & 15 : ptr[j / 2] >> 4;
+                outptr[j] = (q - 8) * scales[i * groups + j / group_size];
+            }
+        }
+    }
+}
+
 } // namespace ncnn
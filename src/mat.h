@@ -434,6 +434,13 @@ void convert_packing(const Mat& src, Mat& dst, int elempack, const Option& opt =
 void cast_float32_to_float16(const Mat& src, Mat& dst, const Option& opt = Option());
 void cast_float16_to_float32(const Mat& src, Mat& dst, const Option& opt = Option());
 
+// weight-only quantization of a row-major matrix, rows x cols
+// type 1 = int8 codes with one scale per row
+// type 2 = int4 codes with one scale per group_size columns, two codes per byte with the even column
+//          in the low nibble, each row starts on a byte boundary and a nibble stores code + 8
+void quantize_weight(const Mat& src, Mat& dst, Mat& scales, int rows, int type, int group_size);
+void dequantize_weight(const Mat& src, const Mat& scales, Mat& dst, int rows, int cols, int type, int group_size);
+
 inline Mat::Mat()
     : data(0), refcount(0), elemsize(0), elempack(0), allocator(0), dims(0), w(0), h(0), c(0), cstep(0)
 {
@@ -19,7 +19,14 @@
 #include "paramdict.h"
 #include "convolution.h"
 #include "convolutiondepthwise.h"
+#include "deconvolution.h"
+#include "deconvolutiondepthwise.h"
+#include "innerproduct.h"
+#include "concat.h"
+#include "eltwise.h"
 #include "relu.h"
+#include "benchmark.h"
+#include "cpu.h"
 
 #include <stdarg.h>
 #include <stdio.h>
@@ -30,16 +37,118 @@
 #include <omp.h>
 #endif // _OPENMP
 
-#if NCNN_BENCHMARK
-#include "benchmark.h"
-#endif // NCNN_BENCHMARK
-
 #if NCNN_VULKAN
 #include "command.h"
 #endif // NCNN_VULKAN
 
 namespace ncnn {
 
+// per machine constants of the adaptive thread count cost model
+struct thread_cost_model
+{
+    bool calibrated;
+    // single thread time of one float multiply-add
+    double ns_per_flop;
+    // single thread time of moving one byte through memory
+    double ns_per_byte;
+    // openmp wakeup and join time for each thread in a team
+    double ns_per_thread;
+};
+
+static thread_cost_model g_thread_cost_model = { false, 0.0, 0.0, 0.0 };
+static Mutex g_thread_cost_model_lock;
+
+// called with g_thread_cost_model_lock held
+static void calibrate_thread_cost_model(int max_threads)
+{
+    // compute, l1 resident fused multiply-add loop
+    {
+        const int size = 1024;
+        const int loop = 2048;
+        std::vector<float> a(size, 1.f);
+        std::vector<float> b(size, 0.5f);
+        std::vector<float> c(size, 0.f);
+
+        double start = get_current_time();
+        for (int r=0; r<loop; r++)
+        {
+            for (int i=0; i<size; i++)
+            {
+                c[i] += a[i] * b[i];
+            }
+            a[r % size] = c[r % size];
+        }
+        double end = get_current_time();
+
+        volatile float sink = c[0];
+        (void)sink;
+
+        g_thread_cost_model.ns_per_flop = (end - start) * 1000000.0 / (2.0 * size * loop);
+    }
+
+    // memory, copy a buffer larger than last level cache of typical hosts
+    {
+        const int size = 16 * 1024 * 1024;
+        const int loop = 4;
+        std::vector<unsigned char> a(size, 1);
+        std::vector<unsigned char> b(size, 0);
+
+        double start = get_current_time();
+        for (int r=0; r<loop; r++)
+        {
+            memcpy(&b[0], &a[0], size);
+            a[r] = b[size - 1 - r];
+        }
+        double end = get_current_time();
+
+        g_thread_cost_model.ns_per_byte = (end - start) * 1000000.0 / (2.0 * size * loop);
+    }
+
+    // openmp team wakeup, as the parallel for loops in layers do
+#ifdef _OPENMP
+    if (max_threads > 1)
+    {
+        const int loop = 256;
+        std::vector<int> sink(max_threads, 0);
+
+        // warm up the thread pool
+        #pragma omp parallel for num_threads(max_threads)
+        for (int i=0; i<max_threads; i++)
+        {
+            sink[i]++;
+        }
+
+        double start = get_current_time();
+        for (int r=0; r<loop; r++)
+        {
+            #pragma omp parallel for num_threads(max_threads)
+            for (int i=0; i<max_threads; i++)
+            {
+                sink[i]++;
+            }
+        }
+        double end = get_current_time();
+
+        g_thread_cost_model.ns_per_thread = (end - start) * 1000000.0 / loop / max_threads;
+    }
+#else
+    (void)max_threads;
+#endif // _OPENMP
+
+    g_thread_cost_model.calibrated = true;
+}
+
+// the calibrated constants, measured by whichever thread gets here first
+static thread_cost_model get_thread_cost_model(int max_threads)
+{
+    MutexLockGuard lock(g_thread_cost_model_lock);
+
+    if (!g_thread_cost_model.calibrated)
+        calibrate_thread_cost_model(max_threads);
+
+    return g_thread_cost_model;
+}
+
 Net::Net()
 {
 #if NCNN_VULKAN
@@ -456,6 +565,10 @@ int Net::load_model(const DataReader& dr)
 
     fuse_network();
 
+    // measure the cost model now rather than in the first extract
+    if (opt.use_adaptive_threads)
+        get_thread_cost_model(opt.num_threads);
+
     return ret;
 }
 
@@ -610,166 +723,344 @@ int Net::load_model(AAssetManager* mgr, const char* assetpath)
 }
 #endif // __ANDROID_API__ >= 9
 
-int Net::fuse_network()
+#if NCNN_REQUANT
+// blob scale states during the int8 fusion, positive values are int8 scales
+static const float INT8_SCALE_FP32 = 0.f;
+static const float INT8_SCALE_ANY = -1.f;
+static const float INT8_SCALE_UNSET = -2.f;
+
+// scale a quantized convolution expects its input in, 0 for fp32 input
+// the residual add of a convolution works in fp32 on both sides
+static float int8_bottom_scale(const Layer* layer)
 {
-    // set the int8 op fusion:requantize
-#if NCNN_STRING && NCNN_REQUANT    
-    // fprintf(stderr, "Test op fusion to int8 implement:\n");
-    // parse the network whether is a quantization model
-    bool net_quantized = false;
-    for (size_t i=0; i<layers.size(); i++)
+    if (layer->typeindex == LayerType::Convolution)
     {
-        Layer* layer = layers[i];
-        if (layer->type == "Convolution" || layer->type == "ConvolutionDepthWise")
+        const Convolution* convolution = (const Convolution*)layer;
+        if (!convolution->use_int8_inference || convolution->residual_term)
+            return INT8_SCALE_FP32;
+
+        return convolution->bottom_blob_int8_scale;
+    }
+
+    if (layer->typeindex == LayerType::ConvolutionDepthWise)
+    {
+        const ConvolutionDepthWise* convolutiondepthwise = (const ConvolutionDepthWise*)layer;
+        if (!convolutiondepthwise->use_int8_inference || convolutiondepthwise->bottom_blob_int8_scales.empty())
+            return INT8_SCALE_FP32;
+
+        // one int8 blob can only carry one scale
+        const float* scales = convolutiondepthwise->bottom_blob_int8_scales;
+        for (int g=1; g<convolutiondepthwise->bottom_blob_int8_scales.w; g++)
         {
-            if (layer->type == "Convolution" && (((Convolution*)layer)->use_int8_inference == false))
-                continue;
-            if (layer->type == "ConvolutionDepthWise" && (((ConvolutionDepthWise*)layer)->use_int8_inference == false))
-                continue;    
-            net_quantized = true;
+            if (scales[g] != scales[0])
+                return INT8_SCALE_FP32;
         }
+
+        return scales[0];
     }
 
-    if (net_quantized == false)
-        return 0;
+    return INT8_SCALE_FP32;
+}
+
+// layers that requantize their output to any scale
+static bool is_int8_producer(const Layer* layer)
+{
+    if (layer->typeindex == LayerType::Convolution)
+        return ((const Convolution*)layer)->use_int8_inference && !((const Convolution*)layer)->residual_term;
+
+    if (layer->typeindex == LayerType::ConvolutionDepthWise)
+        return ((const ConvolutionDepthWise*)layer)->use_int8_inference;
+
+    return layer->typeindex == LayerType::Eltwise;
+}
+
+// layers that take int8 and give int8 in the same scale
+static bool is_int8_passthrough(const Layer* layer)
+{
+    switch (layer->typeindex)
+    {
+    case LayerType::ReLU:
+    case LayerType::Pooling:
+    case LayerType::Split:
+    case LayerType::Concat:
+    case LayerType::ShuffleChannel:
+        return true;
+    case LayerType::Crop:
+        // the reference blob of the two input form only gives the shape
+        return layer->bottoms.size() == 1;
+    default:
+        return false;
+    }
+}
+
+static float merge_int8_scale(float a, float b)
+{
+    if (a == INT8_SCALE_UNSET)
+        return b;
+    if (a == INT8_SCALE_FP32 || b == INT8_SCALE_FP32)
+        return INT8_SCALE_FP32;
+    if (a == INT8_SCALE_ANY)
+        return b;
+    if (b == INT8_SCALE_ANY)
+        return a;
+
+    return a == b ? a : INT8_SCALE_FP32;
+}
 
+// a blob stays int8 when its producer can emit int8 and all consumers take it in one scale
+// convolutions fix the scale of their input, eltwise rescales any input
+// and the passthrough layers in between keep the scale of their input
+static void fuse_int8_requantize(std::vector<Layer*>& layers, std::vector<Blob>& blobs)
+{
+    bool net_quantized = false;
     for (size_t i=0; i<layers.size(); i++)
     {
-        Layer* layer = layers[i];
+        if (is_int8_producer(layers[i]) && layers[i]->typeindex != LayerType::Eltwise)
+            net_quantized = true;
+    }
 
-        if (layer->type == "Convolution" || layer->type == "ConvolutionDepthWise")
-        {
-            if (layer->type == "Convolution" && (((Convolution*)layer)->use_int8_inference == false))
-                continue;
-            if (layer->type == "ConvolutionDepthWise" && (((ConvolutionDepthWise*)layer)->use_int8_inference == false))
-                continue;
+    if (!net_quantized)
+        return;
 
-            for (size_t n=0; n<blobs[layer->tops[0]].consumers.size(); n++)
-            {
-                int layer_next_index = blobs[layer->tops[0]].consumers[n];
-                Layer* layer_next = layers[layer_next_index];
+    const int blob_count = blobs.size();
 
-                if (layer_next->type == "Convolution" || layer_next->type == "ConvolutionDepthWise")
-                {
-                    if (layer_next->type == "Convolution" && ((Convolution*)layer_next)->use_int8_inference == false)
-                        continue;
-                    if (layer_next->type == "ConvolutionDepthWise" && ((ConvolutionDepthWise*)layer_next)->use_int8_inference == false)
-                        continue;    
+    // the scale wanted by the consumers, layers are in topological order
+    std::vector<float> want(blob_count, INT8_SCALE_FP32);
+    std::vector<float> prefer(blob_count, INT8_SCALE_FP32);
 
-                    // fprintf(stderr, "%s, %s\n", layer->name.c_str(), layer_next->name.c_str());
-                    if (layer->type == "Convolution" && layer_next->type == "Convolution")
-                    {
-                        ((Convolution*)layer)->use_int8_requantize = true;
-                        ((Convolution*)layer)->top_blob_int8_scale = ((Convolution*)layer_next)->bottom_blob_int8_scale;
-                        ((Convolution*)layer)->create_requantize_op();
-                    }
-                    else if (layer->type == "ConvolutionDepthWise" && layer_next->type == "Convolution")
-                    {
-                        ((ConvolutionDepthWise*)layer)->use_int8_requantize = true;
-                        ((ConvolutionDepthWise*)layer)->top_blob_int8_scale = ((Convolution*)layer_next)->bottom_blob_int8_scale;
-                        ((ConvolutionDepthWise*)layer)->create_requantize_op();
-                    }
-                    else if (layer->type == "Convolution" && layer_next->type == "ConvolutionDepthWise")
-                    {
-                        ((Convolution*)layer)->use_int8_requantize = true;
-                        ((Convolution*)layer)->top_blob_int8_scale = ((ConvolutionDepthWise*)layer_next)->bottom_blob_int8_scales[0];
-                        ((Convolution*)layer)->create_requantize_op();
-                    }
-                    else
-                    {
-                        ((ConvolutionDepthWise*)layer)->use_int8_requantize = true;
-                        ((ConvolutionDepthWise*)layer)->top_blob_int8_scale = ((ConvolutionDepthWise*)layer_next)->bottom_blob_int8_scales[0];
-                        ((ConvolutionDepthWise*)layer)->create_requantize_op();
-                    }
-                }                  
-                else if (layer_next->type == "ReLU")
-                {
-                    int layer_next_2_index = blobs[layer_next->tops[0]].consumers[0];
-                    Layer* layer_next_2 = layers[layer_next_2_index];
+    for (int i=(int)layers.size()-1; i>=0; i--)
+    {
+        const Layer* layer = layers[i];
 
-                    if (layer_next_2->type == "Convolution" || layer_next_2->type == "ConvolutionDepthWise")
-                    {
-                        if (layer_next_2->type == "Convolution" && ((Convolution*)layer_next_2)->use_int8_inference == false)
-                            continue;
-                        if (layer_next_2->type == "ConvolutionDepthWise" && ((ConvolutionDepthWise*)layer_next_2)->use_int8_inference == false)
-                            continue;    
+        for (size_t j=0; j<layer->tops.size(); j++)
+        {
+            int blob_index = layer->tops[j];
+            const Blob& blob = blobs[blob_index];
 
-                        fprintf(stderr, "%s, %s, %s\n", layer->name.c_str(), layer_next->name.c_str(), layer_next_2->name.c_str());
-                        if (layer->type == "Convolution" && layer_next_2->type == "Convolution")
-                        {
-                            ((Convolution*)layer)->use_int8_requantize = true;
-                            ((Convolution*)layer)->top_blob_int8_scale = ((Convolution*)layer_next_2)->bottom_blob_int8_scale;
-                            ((Convolution*)layer)->create_requantize_op();
-                        }
-                        else if (layer->type == "ConvolutionDepthWise" && layer_next_2->type == "Convolution")
-                        {
-                            ((ConvolutionDepthWise*)layer)->use_int8_requantize = true;
-                            ((ConvolutionDepthWise*)layer)->top_blob_int8_scale = ((Convolution*)layer_next_2)->bottom_blob_int8_scale;
-                            ((ConvolutionDepthWise*)layer)->create_requantize_op();
-                        }
-                        else if (layer->type == "Convolution" && layer_next_2->type == "ConvolutionDepthWise")
-                        {
-                            ((Convolution*)layer)->use_int8_requantize = true;
-                            ((Convolution*)layer)->top_blob_int8_scale = ((ConvolutionDepthWise*)layer_next_2)->bottom_blob_int8_scales[0];
-                            ((Convolution*)layer)->create_requantize_op();
-                        }
-                        else
-                        {
-                            ((ConvolutionDepthWise*)layer)->use_int8_requantize = true;
-                            ((ConvolutionDepthWise*)layer)->top_blob_int8_scale = ((ConvolutionDepthWise*)layer_next_2)->bottom_blob_int8_scales[0];
-                            ((ConvolutionDepthWise*)layer)->create_requantize_op();
-                        }
-                    }
-                    else if (layer_next_2->type == "Split")
-                    {
-                        bool all_conv = true;
-                        for (size_t i=0; i<layer_next_2->tops.size(); i++)
-                        {
-                            int layer_next_3_index = blobs[layer_next_2->tops[i]].consumers[0];
-                            if (layers[layer_next_3_index]->type != "Convolution" && layers[layer_next_3_index]->type != "ConvolutionDepthWise" && layers[layer_next_3_index]->type != "PriorBox" )
-                            {
-                                // fprintf(stderr, "%s, %s, %s, %s\n", layer->name.c_str(), layer_next->name.c_str(), layer_next_2->name.c_str(), layers[layer_next_3_index]->name.c_str());
-                                all_conv = false;
-                            }
-                        }
+            float scale = blob.consumers.empty() ? INT8_SCALE_FP32 : INT8_SCALE_UNSET;
+            float preferred = INT8_SCALE_FP32;
 
-                        if (all_conv == true && layer_next_2->tops.size() >= size_t(2))
-                        {
-                            // fprintf(stderr, "%s, %s, %s, ", layer->name.c_str(), layer_next->name.c_str(), layer_next_2->name.c_str());
-                            for (size_t i=0; i<layer_next_2->tops.size(); i++)
-                            {
-                                int layer_next_3_index = blobs[layer_next_2->tops[i]].consumers[0];
-                                Layer* layer_next_3 = layers[layer_next_3_index];
-
-                                // fprintf(stderr, "%s, ", layer_next_3->name.c_str());
-                                if (layer_next_3->type == "Convolution")
-                                {
-                                    ((Convolution*)layer)->top_blob_int8_scale = ((Convolution*)layer_next_3)->bottom_blob_int8_scale; 
-                                }    
-                            }
+            for (size_t k=0; k<blob.consumers.size(); k++)
+            {
+                const Layer* consumer = layers[blob.consumers[k]];
 
-                            ((Convolution*)layer)->use_int8_requantize = true;
-                            ((Convolution*)layer)->create_requantize_op();    
-                            // fprintf(stderr, "\n");
-                        }
-                    }
-                    else
-                    {
-                        // fprintf(stderr, "%s, %s\n", layer->name.c_str(), layer_next->name.c_str());
-                    }
+                float consumer_scale = INT8_SCALE_FP32;
+                float consumer_preferred = INT8_SCALE_FP32;
+
+                if (consumer->typeindex == LayerType::Eltwise)
+                {
+                    consumer_scale = INT8_SCALE_ANY;
+                    consumer_preferred = want[consumer->tops[0]];
                 }
-                else if (layer_next->type == "Pooling")
+                else if (is_int8_passthrough(consumer))
                 {
-                    // ToDo
+                    consumer_scale = INT8_SCALE_UNSET;
+                    for (size_t t=0; t<consumer->tops.size(); t++)
+                    {
+                        consumer_scale = merge_int8_scale(consumer_scale, want[consumer->tops[t]]);
+                        if (consumer_preferred == INT8_SCALE_FP32)
+                            consumer_preferred = prefer[consumer->tops[t]];
+                    }
                 }
                 else
                 {
-                    // fprintf(stderr, "%s\n", layer->name.c_str());
-                }                  
+                    consumer_scale = int8_bottom_scale(consumer);
+                }
+
+                scale = merge_int8_scale(scale, consumer_scale);
+                if (preferred == INT8_SCALE_FP32)
+                    preferred = consumer_preferred;
+            }
+
+            if (scale == INT8_SCALE_UNSET)
+                scale = INT8_SCALE_FP32;
+
+            if (is_int8_producer(layer))
+            {
+                // only eltwise consumers, requantize to the scale they produce
+                if (scale == INT8_SCALE_ANY)
+                    scale = preferred;
+            }
+            else if (!is_int8_passthrough(layer))
+            {
+                scale = INT8_SCALE_FP32;
+            }
+
+            want[blob_index] = scale;
+            prefer[blob_index] = scale == INT8_SCALE_ANY ? preferred : INT8_SCALE_FP32;
+        }
+    }
+
+    // a passthrough layer must see int8 in one scale on all inputs and hand it to all outputs,
+    // otherwise its neighbourhood falls back to fp32, repeat until nothing changes
+    std::vector<float> scales = want;
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+
+        for (size_t i=0; i<layers.size(); i++)
+        {
+            const Layer* layer = layers[i];
+            if (!is_int8_passthrough(layer))
+                continue;
+
+            float scale = scales[layer->bottoms[0]];
+            bool int8 = scale > 0.f;
+
+            for (size_t j=1; j<layer->bottoms.size(); j++)
+            {
+                if (scales[layer->bottoms[j]] != scale)
+                    int8 = false;
+            }
+
+            for (size_t j=0; j<layer->tops.size(); j++)
+            {
+                float top_scale = scales[layer->tops[j]];
+                if (top_scale != scale && top_scale != INT8_SCALE_ANY)
+                    int8 = false;
+            }
+
+            if (int8)
+            {
+                for (size_t j=0; j<layer->tops.size(); j++)
+                    scales[layer->tops[j]] = scale;
+
+                continue;
+            }
+
+            for (size_t j=0; j<layer->bottoms.size(); j++)
+            {
+                if (scales[layer->bottoms[j]] != INT8_SCALE_FP32)
+                    changed = true;
+
+                scales[layer->bottoms[j]] = INT8_SCALE_FP32;
+            }
+
+            for (size_t j=0; j<layer->tops.size(); j++)
+            {
+                if (scales[layer->tops[j]] > 0.f)
+                    changed = true;
+
+                scales[layer->tops[j]] = INT8_SCALE_FP32;
+            }
+        }
+    }
+
+    for (int i=0; i<blob_count; i++)
+    {
+        if (scales[i] < 0.f)
+            scales[i] = INT8_SCALE_FP32;
+    }
+
+    for (size_t i=0; i<layers.size(); i++)
+    {
+        Layer* layer = layers[i];
+
+        if (layer->typeindex == LayerType::Eltwise)
+        {
+            Eltwise* eltwise = (Eltwise*)layer;
+
+            bool int8 = scales[layer->tops[0]] > 0.f;
+            eltwise->bottom_blob_int8_scales.resize(layer->bottoms.size());
+            for (size_t j=0; j<layer->bottoms.size(); j++)
+            {
+                eltwise->bottom_blob_int8_scales[j] = scales[layer->bottoms[j]];
+                if (scales[layer->bottoms[j]] > 0.f)
+                    int8 = true;
             }
+
+            eltwise->top_blob_int8_scale = scales[layer->tops[0]];
+            eltwise->use_int8_inference = int8;
+            continue;
+        }
+
+        if (!is_int8_producer(layer))
+            continue;
+
+        const float top_scale = scales[layer->tops[0]];
+        if (top_scale <= 0.f)
+            continue;
+
+        if (layer->typeindex == LayerType::Convolution)
+        {
+            Convolution* convolution = (Convolution*)layer;
+            convolution->use_int8_requantize = true;
+            convolution->top_blob_int8_scale = top_scale;
+            convolution->create_requantize_op();
+        }
+        else
+        {
+            ConvolutionDepthWise* convolutiondepthwise = (ConvolutionDepthWise*)layer;
+            convolutiondepthwise->use_int8_requantize = true;
+            convolutiondepthwise->top_blob_int8_scale = top_scale;
+            convolutiondepthwise->create_requantize_op();
+        }
+    }
+}
+#endif // NCNN_REQUANT
+
+int Net::fuse_network()
+{
+    fused_bottoms.assign(layers.size(), -1);
+    blob_reader_counts.resize(blobs.size());
+    for (size_t i=0; i<blobs.size(); i++)
+    {
+        blob_reader_counts[i] = (int)blobs[i].consumers.size();
+    }
+
+    // depthwise - 1x1 convolution, computed tile by tile in the convolution
+    if (!opt.use_vulkan_compute)
+    {
+        for (size_t i=0; i<layers.size(); i++)
+        {
+            Layer* layer = layers[i];
+
+            if (layer->typeindex != LayerType::ConvolutionDepthWise)
+                continue;
+
+            const ConvolutionDepthWise* convolutiondepthwise = (const ConvolutionDepthWise*)layer;
+            if (convolutiondepthwise->use_int8_inference || convolutiondepthwise->group != convolutiondepthwise->num_output)
+                continue;
+
+            const Blob& blob = blobs[layer->tops[0]];
+            if (blob.consumers.size() != 1)
+                continue;
+
+            int layer_next_index = blob.consumers[0];
+            Layer* layer_next = layers[layer_next_index];
+
+            if (layer_next->typeindex != LayerType::Convolution || layer_next->bottoms.size() != 1)
+                continue;
+
+            Convolution* convolution = (Convolution*)layer_next;
+            if (convolution->fuse_depthwise(layer, opt) != 0)
+                continue;
+
+            // the depthwise layer stays in place for anyone extracting its output
+            // its input now has two readers and is kept in light mode until the extractor goes away
+            int bottom_blob_index = layer->bottoms[0];
+            fused_bottoms[layer_next_index] = bottom_blob_index;
+            blob_reader_counts[bottom_blob_index]++;
+            blob_reader_counts[layer->tops[0]]--;
         }
     }
+
+    // keep activations in int8 between quantized layers
+#if NCNN_REQUANT
+    if (!opt.use_vulkan_compute)
+    {
+        fuse_int8_requantize(layers, blobs);
+    }
 #endif
+
+    {
+        MutexLockGuard guard(concat_shape_lock);
+        concat_bottom_shapes.clear();
+        concat_bottom_shapes.resize(blobs.size());
+    }
+
     return 0;
 }
 
@@ -780,6 +1071,12 @@ void Net::clear()
 #endif // NCNN_VULKAN
 
     blobs.clear();
+    fused_bottoms.clear();
+    blob_reader_counts.clear();
+    {
+        MutexLockGuard guard(concat_shape_lock);
+        concat_bottom_shapes.clear();
+    }
     for (size_t i=0; i<layers.size(); i++)
     {
         int dret = layers[i]->destroy_pipeline(opt);
@@ -807,6 +1104,11 @@ void Net::clear()
 #endif // NCNN_VULKAN
 }
 
+void Net::set_thread_affinity(const CpuSet& mask)
+{
+    thread_affinity_mask = mask;
+}
+
 Extractor Net::create_extractor() const
 {
     return Extractor(this, blobs.size());
@@ -1005,7 +1307,290 @@ Layer* Net::create_custom_layer(int index)
     return layer_creator();
 }
 
-int Net::forward_layer(int layer_index, std::vector<Mat>& blob_mats, Option& opt) const
+// rough flops and bytes of one layer forward from its input shapes
+static void estimate_layer_cost(const Layer* layer, const Mat* bottom_blobs, int bottom_count, double* flops, double* bytes)
+{
+    double in_size = 0;
+    double in_bytes = 0;
+    for (int i=0; i<bottom_count; i++)
+    {
+        const Mat& m = bottom_blobs[i];
+        in_size += (double)m.w * m.h * m.c * m.elempack;
+        in_bytes += (double)m.w * m.h * m.c * m.elemsize;
+    }
+
+    // read input and write output of similar size
+    *flops = in_size;
+    *bytes = in_bytes * 2;
+
+    if (bottom_count == 0)
+        return;
+
+    const Mat& bottom_blob = bottom_blobs[0];
+    const double in_spatial = (double)bottom_blob.w * bottom_blob.h;
+
+    // convolution flops are out_spatial * weight_data_size multiply-adds for any group
+    switch (layer->typeindex)
+    {
+    case LayerType::Convolution:
+    {
+        const Convolution* op = (const Convolution*)layer;
+        double out_spatial = in_spatial / (op->stride_w * op->stride_h);
+        *flops = 2.0 * out_spatial * op->weight_data_size;
+        break;
+    }
+    case LayerType::ConvolutionDepthWise:
+    {
+        const ConvolutionDepthWise* op = (const ConvolutionDepthWise*)layer;
+        double out_spatial = in_spatial / (op->stride_w * op->stride_h);
+        *flops = 2.0 * out_spatial * op->weight_data_size;
+        break;
+    }
+    case LayerType::Deconvolution:
+    {
+        const Deconvolution* op = (const Deconvolution*)layer;
+        *flops = 2.0 * in_spatial * op->weight_data_size;
+        *bytes = in_bytes * (1 + op->stride_w * op->stride_h);
+        break;
+    }
+    case LayerType::DeconvolutionDepthWise:
+    {
+        const DeconvolutionDepthWise* op = (const DeconvolutionDepthWise*)layer;
+        *flops = 2.0 * in_spatial * op->weight_data_size;
+        *bytes = in_bytes * (1 + op->stride_w * op->stride_h);
+        break;
+    }
+    case LayerType::InnerProduct:
+    {
+        const InnerProduct* op = (const InnerProduct*)layer;
+        *flops = 2.0 * op->weight_data_size;
+        *bytes = in_bytes + (double)op->weight_data_size * op->weight_data.elemsize;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// thread count minimizing single_thread_time / t + per_thread_overhead * t
+static int get_adaptive_num_threads(const Layer* layer, const Mat* bottom_blobs, int bottom_count, int max_threads)
+{
+    if (max_threads <= 1)
+        return 1;
+
+    const thread_cost_model model = get_thread_cost_model(max_threads);
+
+    double flops = 0;
+    double bytes = 0;
+    estimate_layer_cost(layer, bottom_blobs, bottom_count, &flops, &bytes);
+
+    const double single_thread_ns = flops * model.ns_per_flop + bytes * model.ns_per_byte;
+
+    int best_num_threads = 1;
+    double best_ns = single_thread_ns;
+    for (int t=2; t<=max_threads; t++)
+    {
+        double ns = single_thread_ns / t + model.ns_per_thread * t;
+        if (ns < best_ns)
+        {
+            best_ns = ns;
+            best_num_threads = t;
+        }
+    }
+
+    return best_num_threads;
+}
+
+// elempack a layer takes its input blob in when packing layout is enabled
+static int get_layer_elempack(const Layer* layer, const Mat& m)
+{
+    if (!layer->support_packing)
+        return 1;
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    // x86 layers pack fp32 data only, 8 lanes when the avx2 layer variants are in use
+    if (m.elemsize / m.elempack != 4u)
+        return 1;
+
+#if NCNN_AVX2
+    return 8;
+#else
+#if NCNN_RUNTIME_CPU_AVX512
+    if (cpu_support_x86_avx512())
+        return 8;
+#endif // NCNN_RUNTIME_CPU_AVX512
+#if NCNN_RUNTIME_CPU_AVX2
+    if (cpu_support_x86_avx2() && cpu_support_x86_fma())
+        return 8;
+#endif // NCNN_RUNTIME_CPU_AVX2
+    return 4;
+#endif // NCNN_AVX2
+#else
+    (void)m;
+    return 4;
+#endif
+}
+
+void Net::prepare_concat_views(const Layer* layer, const std::vector<Mat>& blob_mats, std::vector<Mat>& blob_views, Mat& concat_top, std::vector<Mat>& concat_views, const Option& opt) const
+{
+    const size_t bottom_count = layer->bottoms.size();
+
+    std::vector<Mat> shapes(bottom_count);
+    {
+        MutexLockGuard guard(concat_shape_lock);
+        if (concat_bottom_shapes.size() != blobs.size())
+            return;
+
+        for (size_t i=0; i<bottom_count; i++)
+        {
+            shapes[i] = concat_bottom_shapes[layer->bottoms[i]];
+        }
+    }
+
+    int channels = 0;
+    for (size_t i=0; i<bottom_count; i++)
+    {
+        if (shapes[i].dims != 3)
+            return;
+
+        channels += shapes[i].c;
+    }
+
+    // nested concat writes into the range of the outer one
+    const Mat& shape = shapes[0];
+    const Mat& top_view = blob_views[layer->tops[0]];
+    if (top_view.dims == 3 && top_view.w == shape.w && top_view.h == shape.h && top_view.c == channels && top_view.elemsize == shape.elemsize && top_view.elempack == shape.elempack)
+        concat_top = top_view;
+    else
+        concat_top.create(shape.w, shape.h, channels, shape.elemsize, shape.elempack, opt.blob_allocator);
+    if (concat_top.empty())
+        return;
+
+    concat_views.resize(bottom_count);
+
+    int q = 0;
+    for (size_t i=0; i<bottom_count; i++)
+    {
+        concat_views[i] = concat_top.channel_range(q, shapes[i].c);
+        q += shapes[i].c;
+
+        // hand the view to the producer, through any inplace layers in between
+        int blob_index = layer->bottoms[i];
+        while (blob_mats[blob_index].dims == 0 && blob_reader_counts[blob_index] == 1)
+        {
+            blob_views[blob_index] = concat_views[i];
+
+            const Layer* producer = layers[blobs[blob_index].producer];
+            if (!producer->one_blob_only || !producer->support_inplace || producer->bottoms.size() != 1)
+                break;
+
+            blob_index = producer->bottoms[0];
+        }
+    }
+}
+
+void Net::release_concat_views(const Layer* layer, std::vector<Mat>& blob_views) const
+{
+    for (size_t i=0; i<layer->bottoms.size(); i++)
+    {
+        int blob_index = layer->bottoms[i];
+        while (blob_views[blob_index].data)
+        {
+            blob_views[blob_index].release();
+
+            const Layer* producer = layers[blobs[blob_index].producer];
+            if (producer->bottoms.size() != 1)
+                break;
+
+            blob_index = producer->bottoms[0];
+        }
+    }
+}
+
+void Net::update_concat_shapes(const Layer* layer, const std::vector<Mat>& bottom_blobs, const Mat& top_blob) const
+{
+    // only inputs stacked as is, without repacking, can alias the output
+    bool stacked = top_blob.dims == 3;
+    for (size_t i=0; i<bottom_blobs.size(); i++)
+    {
+        const Mat& m = bottom_blobs[i];
+        if (m.dims != 3 || m.w != top_blob.w || m.h != top_blob.h || m.elemsize != top_blob.elemsize || m.elempack != top_blob.elempack)
+            stacked = false;
+    }
+
+    MutexLockGuard guard(concat_shape_lock);
+    if (concat_bottom_shapes.size() != blobs.size())
+        return;
+
+    for (size_t i=0; i<bottom_blobs.size(); i++)
+    {
+        const Mat& m = bottom_blobs[i];
+        Mat& shape = concat_bottom_shapes[layer->bottoms[i]];
+        if (stacked)
+            shape = Mat(m.w, m.h, m.c, (void*)0, m.elemsize, m.elempack, 0);
+        else
+            shape.release();
+    }
+}
+
+// copy the inputs that were not produced in place into the concat output
+static bool gather_concat_views(const std::vector<Mat>& bottom_blobs, const std::vector<Mat>& concat_views)
+{
+    for (size_t i=0; i<bottom_blobs.size(); i++)
+    {
+        const Mat& m = bottom_blobs[i];
+        const Mat& view = concat_views[i];
+        if (m.dims != 3 || m.w != view.w || m.h != view.h || m.c != view.c || m.elemsize != view.elemsize || m.elempack != view.elempack || m.cstep != view.cstep)
+            return false;
+    }
+
+    for (size_t i=0; i<bottom_blobs.size(); i++)
+    {
+        const Mat& m = bottom_blobs[i];
+        const Mat& view = concat_views[i];
+        if (m.data != view.data)
+        {
+            memcpy(view.data, m.data, m.cstep * m.c * m.elemsize);
+        }
+    }
+
+    return true;
+}
+
+// writing to m in place would be seen through another blob
+static bool is_shared_blob(const Mat& m, const Mat& owner, const Mat& concat_view)
+{
+    if (m.refcount)
+        return *m.refcount != 1;
+
+    // a concat output channel range is written in place on purpose
+    if (m.data == concat_view.data)
+        return false;
+
+    // a view into the output of another layer, or external memory
+    return owner.empty() || *owner.refcount != 1;
+}
+
+// a layer may return a range of its input instead of a copy, see Option::use_blob_view
+// find the allocation the view points into, which must be kept alive along with it
+static Mat get_view_owner(const Mat& view, const Mat& bottom_blob, const Mat& bottom_owner)
+{
+    if (view.refcount || !view.data)
+        return Mat();
+
+    const Mat& owner = bottom_blob.refcount ? bottom_blob : bottom_owner;
+    if (owner.empty())
+        return Mat();
+
+    const unsigned char* begin = (const unsigned char*)owner.data;
+    const unsigned char* end = begin + owner.total() * owner.elemsize;
+    if ((const unsigned char*)view.data < begin || (const unsigned char*)view.data >= end)
+        return Mat();
+
+    return owner;
+}
+
+int Net::forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<Mat>& blob_views, std::vector<Mat>& blob_owners, Option& opt) const
 {
     const Layer* layer = layers[layer_index];
 
@@ -1014,106 +1599,142 @@ int Net::forward_layer(int layer_index, std::vector<Mat>& blob_mats, Option& opt
     if (layer->one_blob_only)
     {
         // load bottom blob
-        int bottom_blob_index = layer->bottoms[0];
+        int bottom_blob_index = fused_bottoms[layer_index] != -1 ? fused_bottoms[layer_index] : layer->bottoms[0];
         int top_blob_index = layer->tops[0];
 
         if (blob_mats[bottom_blob_index].dims == 0)
         {
-            int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, opt);
+            int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, blob_views, blob_owners, opt);
             if (ret != 0)
                 return ret;
         }
 
         Mat bottom_blob = blob_mats[bottom_blob_index];
+        Mat bottom_owner = blob_owners[bottom_blob_index];
 
         if (opt.lightmode)
         {
-            // delete after taken in light mode
-            blob_mats[bottom_blob_index].release();
+            // delete after taken in light mode, unless another layer still reads it
+            if (blob_reader_counts[bottom_blob_index] == 1)
+            {
+                blob_mats[bottom_blob_index].release();
+                blob_owners[bottom_blob_index].release();
+            }
             // deep copy for inplace forward if data is shared
-            if (layer->support_inplace && *bottom_blob.refcount != 1)
+            if (layer->support_inplace && is_shared_blob(bottom_blob, bottom_owner, blob_views[bottom_blob_index]))
             {
                 bottom_blob = bottom_blob.clone();
+                bottom_owner.release();
             }
         }
 
         if (opt.use_packing_layout)
         {
-            int elempack = layer->support_packing ? 4 : 1;
+            int elempack = get_layer_elempack(layer, bottom_blob);
 
             Mat bottom_blob_packed;
             convert_packing(bottom_blob, bottom_blob_packed, elempack, opt);
             bottom_blob = bottom_blob_packed;
         }
 
+        Option opt_layer = opt;
+        opt_layer.use_blob_view = true;
+        if (opt.use_adaptive_threads)
+        {
+            opt_layer.num_threads = get_adaptive_num_threads(layer, &bottom_blob, 1, opt.num_threads);
+        }
+
         // forward
         if (opt.lightmode && layer->support_inplace)
         {
             Mat& bottom_top_blob = bottom_blob;
 #if NCNN_BENCHMARK
             double start = get_current_time();
-            int ret = layer->forward_inplace(bottom_top_blob, opt);
+            int ret = layer->forward_inplace(bottom_top_blob, opt_layer);
             double end = get_current_time();
-            benchmark(layer, bottom_top_blob, bottom_top_blob, start, end);
+            benchmark(layer, bottom_top_blob, bottom_top_blob, start, end, opt_layer.num_threads);
 #else
-            int ret = layer->forward_inplace(bottom_top_blob, opt);
+            int ret = layer->forward_inplace(bottom_top_blob, opt_layer);
 #endif // NCNN_BENCHMARK
             if (ret != 0)
                 return ret;
 
             // store top blob
             blob_mats[top_blob_index] = bottom_top_blob;
+            blob_owners[top_blob_index] = bottom_owner;
         }
         else
         {
-            Mat top_blob;
+            Mat top_blob = blob_views[top_blob_index];
 #if NCNN_BENCHMARK
             double start = get_current_time();
-            int ret = layer->forward(bottom_blob, top_blob, opt);
+            int ret = layer->forward(bottom_blob, top_blob, opt_layer);
             double end = get_current_time();
-            benchmark(layer, bottom_blob, top_blob, start, end);
+            benchmark(layer, bottom_blob, top_blob, start, end, opt_layer.num_threads);
 #else
-            int ret = layer->forward(bottom_blob, top_blob, opt);
+            int ret = layer->forward(bottom_blob, top_blob, opt_layer);
 #endif // NCNN_BENCHMARK
             if (ret != 0)
                 return ret;
 
             // store top blob
             blob_mats[top_blob_index] = top_blob;
+            blob_owners[top_blob_index] = get_view_owner(top_blob, bottom_blob, bottom_owner);
         }
 
     }
     else
     {
+        // allocate the channel concat output from the last seen input layout
+        // so that producers write into its channel ranges directly
+        Mat concat_top;
+        std::vector<Mat> concat_views;
+        bool channel_concat = opt.lightmode && layer->typeindex == LayerType::Concat && ((const Concat*)layer)->axis == 0;
+        if (channel_concat)
+        {
+            prepare_concat_views(layer, blob_mats, blob_views, concat_top, concat_views, opt);
+        }
+
         // load bottom blobs
         std::vector<Mat> bottom_blobs(layer->bottoms.size());
+        std::vector<Mat> bottom_owners(layer->bottoms.size());
         for (size_t i=0; i<layer->bottoms.size(); i++)
         {
             int bottom_blob_index = layer->bottoms[i];
 
             if (blob_mats[bottom_blob_index].dims == 0)
             {
-                int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, opt);
+                int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, blob_views, blob_owners, opt);
                 if (ret != 0)
+                {
+                    if (channel_concat)
+                        release_concat_views(layer, blob_views);
                     return ret;
+                }
             }
 
             bottom_blobs[i] = blob_mats[bottom_blob_index];
+            bottom_owners[i] = blob_owners[bottom_blob_index];
 
             if (opt.lightmode)
             {
-                // delete after taken in light mode
-                blob_mats[bottom_blob_index].release();
+                // delete after taken in light mode, unless another layer still reads it
+                if (blob_reader_counts[bottom_blob_index] == 1)
+                {
+                    blob_mats[bottom_blob_index].release();
+                    blob_owners[bottom_blob_index].release();
+                }
                 // deep copy for inplace forward if data is shared
-                if (layer->support_inplace && *bottom_blobs[i].refcount != 1)
+                if (layer->support_inplace && is_shared_blob(bottom_blobs[i], bottom_owners[i], blob_views[bottom_blob_index]))
                 {
                     bottom_blobs[i] = bottom_blobs[i].clone();
+                    bottom_owners[i].release();
                 }
             }
 
             if (opt.use_packing_layout)
             {
-                int elempack = layer->support_packing ? 4 : 1;
+                int elempack = get_layer_elempack(layer, bottom_blobs[i]);
 
                 Mat bottom_blob_packed;
                 convert_packing(bottom_blobs[i], bottom_blob_packed, elempack, opt);
@@ -1121,17 +1742,46 @@ int Net::forward_layer(int layer_index, std::vector<Mat>& blob_mats, Option& opt
             }
         }
 
+        if (channel_concat)
+        {
+            release_concat_views(layer, blob_views);
+        }
+
+        Option opt_layer = opt;
+        opt_layer.use_blob_view = true;
+        if (opt.use_adaptive_threads)
+        {
+            opt_layer.num_threads = get_adaptive_num_threads(layer, bottom_blobs.empty() ? 0 : &bottom_blobs[0], (int)bottom_blobs.size(), opt.num_threads);
+        }
+
         // forward
-        if (opt.lightmode && layer->support_inplace)
+        // inputs produced elsewhere are copied in, the rest are in place already
+#if NCNN_BENCHMARK
+        double gather_start = get_current_time();
+#endif // NCNN_BENCHMARK
+        bool concat_gathered = !concat_top.empty() && gather_concat_views(bottom_blobs, concat_views);
+#if NCNN_BENCHMARK
+        if (concat_gathered)
+        {
+            double gather_end = get_current_time();
+            benchmark(layer, gather_start, gather_end, opt_layer.num_threads);
+        }
+#endif // NCNN_BENCHMARK
+
+        if (concat_gathered)
+        {
+            blob_mats[layer->tops[0]] = concat_top;
+        }
+        else if (opt.lightmode && layer->support_inplace)
         {
             std::vector<Mat>& bottom_top_blobs = bottom_blobs;
 #if NCNN_BENCHMARK
             double start = get_current_time();
-            int ret = layer->forward_inplace(bottom_top_blobs, opt);
+            int ret = layer->forward_inplace(bottom_top_blobs, opt_layer);
             double end = get_current_time();
-            benchmark(layer, start, end);
+            benchmark(layer, start, end, opt_layer.num_threads);
 #else
-            int ret = layer->forward_inplace(bottom_top_blobs, opt);
+            int ret = layer->forward_inplace(bottom_top_blobs, opt_layer);
 #endif // NCNN_BENCHMARK
             if (ret != 0)
                 return ret;
@@ -1142,28 +1792,45 @@ int Net::forward_layer(int layer_index, std::vector<Mat>& blob_mats, Option& opt
                 int top_blob_index = layer->tops[i];
 
                 blob_mats[top_blob_index] = bottom_top_blobs[i];
+                blob_owners[top_blob_index] = bottom_owners[i];
             }
         }
         else
         {
             std::vector<Mat> top_blobs(layer->tops.size());
+            for (size_t i=0; i<layer->tops.size(); i++)
+            {
+                top_blobs[i] = blob_views[layer->tops[i]];
+            }
 #if NCNN_BENCHMARK
             double start = get_current_time();
-            int ret = layer->forward(bottom_blobs, top_blobs, opt);
+            int ret = layer->forward(bottom_blobs, top_blobs, opt_layer);
             double end = get_current_time();
-            benchmark(layer, start, end);
+            benchmark(layer, start, end, opt_layer.num_threads);
 #else
-            int ret = layer->forward(bottom_blobs, top_blobs, opt);
+            int ret = layer->forward(bottom_blobs, top_blobs, opt_layer);
 #endif // NCNN_BENCHMARK
             if (ret != 0)
                 return ret;
 
+            if (channel_concat)
+            {
+                update_concat_shapes(layer, bottom_blobs, top_blobs[0]);
+            }
+
             // store top blobs
             for (size_t i=0; i<layer->tops.size(); i++)
             {
                 int top_blob_index = layer->tops[i];
 
                 blob_mats[top_blob_index] = top_blobs[i];
+
+                Mat top_owner;
+                for (size_t j=0; j<bottom_blobs.size() && top_owner.empty(); j++)
+                {
+                    top_owner = get_view_owner(top_blobs[i], bottom_blobs[j], bottom_owners[j]);
+                }
+                blob_owners[top_blob_index] = top_owner;
             }
         }
     }
@@ -1553,7 +2220,7 @@ int Net::forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector
 
             if (opt.use_packing_layout)
             {
-                int elempack = layer->support_packing ? 4 : 1;
+                int elempack = get_layer_elempack(layer, bottom_blob);
 
                 Mat bottom_blob_packed;
                 convert_packing(bottom_blob, bottom_blob_packed, elempack, opt);
@@ -1733,7 +2400,7 @@ int Net::forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector
 
                 if (opt.use_packing_layout)
                 {
-                    int elempack = layer->support_packing ? 4 : 1;
+                    int elempack = get_layer_elempack(layer, bottom_blobs[i]);
 
                     Mat bottom_blob_packed;
                     convert_packing(bottom_blobs[i], bottom_blob_packed, elempack, opt);
@@ -1801,7 +2468,10 @@ int Net::forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector
 Extractor::Extractor(const Net* _net, int blob_count) : net(_net)
 {
     blob_mats.resize(blob_count);
+    blob_views.resize(blob_count);
+    blob_owners.resize(blob_count);
     opt = net->opt;
+    thread_affinity_mask = net->thread_affinity_mask;
 
 #if NCNN_VULKAN
     if (net->opt.use_vulkan_compute)
@@ -1821,6 +2491,11 @@ void Extractor::set_num_threads(int num_threads)
     opt.num_threads = num_threads;
 }
 
+void Extractor::set_thread_affinity(const CpuSet& mask)
+{
+    thread_affinity_mask = mask;
+}
+
 void Extractor::set_blob_allocator(Allocator* allocator)
 {
     opt.blob_allocator = allocator;
@@ -1901,6 +2576,11 @@ int Extractor::extract(int blob_index, Mat& feat)
     {
         int layer_index = net->blobs[blob_index].producer;
 
+        if (thread_affinity_mask.num_enabled() > 0)
+        {
+            set_cpu_thread_affinity(thread_affinity_mask, opt.num_threads);
+        }
+
 #if NCNN_VULKAN
         if (opt.use_vulkan_compute)
         {
@@ -2008,16 +2688,22 @@ int Extractor::extract(int blob_index, Mat& feat)
         }
         else
         {
-            ret = net->forward_layer(layer_index, blob_mats, opt);
+            ret = net->forward_layer(layer_index, blob_mats, blob_views, blob_owners, opt);
         }
 #else
-        ret = net->forward_layer(layer_index, blob_mats, opt);
+        ret = net->forward_layer(layer_index, blob_mats, blob_views, blob_owners, opt);
 #endif // NCNN_VULKAN
 
     }
 
     feat = blob_mats[blob_index];
 
+    // detach a view from the blob it points into
+    if (!feat.refcount && !blob_owners[blob_index].empty())
+    {
+        feat = feat.clone();
+    }
+
     if (opt.use_packing_layout)
     {
         Mat bottom_blob_unpacked;
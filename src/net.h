@@ -19,6 +19,7 @@
 #include <vector>
 #include "platform.h"
 #include "blob.h"
+#include "cpu.h"
 #include "layer.h"
 #include "mat.h"
 #include "option.h"
@@ -122,12 +123,18 @@ public:
     // unload network structure and weight data
     void clear();
 
+    // bind worker threads of extractors created from this net to cpus
+    // see set_cpu_thread_affinity() for the placement rules
+    // empty mask means no binding (default)
+    void set_thread_affinity(const CpuSet& mask);
+
     // construct an Extractor from network
     Extractor create_extractor() const;
 
 protected:
     // parse the structure of network
     // fuse int8 op dequantize and quantize by requantize
+    // fuse depthwise convolution into the following 1x1 convolution
     int fuse_network();
 
 #if NCNN_VULKAN
@@ -148,7 +155,12 @@ protected:
     Layer* create_custom_layer(const char* type);
 #endif // NCNN_STRING
     Layer* create_custom_layer(int index);
-    int forward_layer(int layer_index, std::vector<Mat>& blob_mats, Option& opt) const;
+    int forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<Mat>& blob_views, std::vector<Mat>& blob_owners, Option& opt) const;
+
+    // channel concat with the output allocated before its inputs are produced
+    void prepare_concat_views(const Layer* layer, const std::vector<Mat>& blob_mats, std::vector<Mat>& blob_views, Mat& concat_top, std::vector<Mat>& concat_views, const Option& opt) const;
+    void release_concat_views(const Layer* layer, std::vector<Mat>& blob_views) const;
+    void update_concat_shapes(const Layer* layer, const std::vector<Mat>& bottom_blobs, const Mat& top_blob) const;
 
 #if NCNN_VULKAN
     int forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<VkMat>& blob_mats_gpu, VkCompute& cmd, Option& opt) const;
@@ -160,6 +172,18 @@ protected:
 
     std::vector<layer_registry_entry> custom_layer_registry;
 
+    CpuSet thread_affinity_mask;
+
+    // depthwise - 1x1 convolution pairs are rewired for forward only, blobs and layers keep the saved graph
+    // the blob each layer reads instead of bottoms[0], -1 for none
+    std::vector<int> fused_bottoms;
+    // number of layers reading each blob in forward
+    std::vector<int> blob_reader_counts;
+
+    // input layout of each channel concat seen in the last forward
+    mutable Mutex concat_shape_lock;
+    mutable std::vector<Mat> concat_bottom_shapes;
+
 #if NCNN_VULKAN
     const VulkanDevice* vkdev;
 
@@ -186,6 +210,11 @@ public:
     // default count is system depended
     void set_num_threads(int num_threads);
 
+    // bind worker threads for this extractor to cpus
+    // this will overwrite the net setting
+    // applied before running layers on each extract
+    void set_thread_affinity(const CpuSet& mask);
+
     // set blob memory allocator
     void set_blob_allocator(Allocator* allocator);
 
@@ -247,7 +276,12 @@ protected:
 private:
     const Net* net;
     std::vector<Mat> blob_mats;
+    // channel ranges of a concat output for producers to write into
+    std::vector<Mat> blob_views;
+    // the blob memory that a view output of slice or crop points into
+    std::vector<Mat> blob_owners;
     Option opt;
+    CpuSet thread_affinity_mask;
 
 #if NCNN_VULKAN
     std::vector<VkMat> blob_mats_gpu;
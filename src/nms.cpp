@@ -0,0 +1,183 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#include "nms.h"
+
+#include <stdint.h>
+#include <algorithm>
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+#if __ARM_NEON
+#include <arm_neon.h>
+#endif // __ARM_NEON
+
+namespace ncnn {
+
+struct score_descent_compare
+{
+    score_descent_compare(const float* _scores) : scores(_scores) {}
+
+    bool operator()(int a, int b) const
+    {
+        return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+    }
+
+    const float* scores;
+};
+
+void topk_descent_indices(const float* scores, int n, int top_k, std::vector<int>& indices)
+{
+    indices.resize(n);
+    for (int i = 0; i < n; i++)
+    {
+        indices[i] = i;
+    }
+
+    score_descent_compare comp(scores);
+
+    if (top_k > 0 && top_k < n)
+    {
+        // linear selection of the top_k, the rest is never sorted
+        std::nth_element(indices.begin(), indices.begin() + top_k, indices.end(), comp);
+        indices.resize(top_k);
+    }
+
+    std::sort(indices.begin(), indices.end(), comp);
+}
+
+void nms_sorted_bboxes(const float* boxes, int stride, const int* order, int n, std::vector<int>& picked, float nms_threshold, const int* labels, int max_picked)
+{
+    picked.clear();
+
+    if (n <= 0)
+        return;
+
+    // gather in visiting order as planes, padded so every kept box tests 4 candidates at once
+    // the padding boxes are empty and never suppressed by anything that is visited
+    const int nn = (n + 3) / 4 * 4;
+
+    std::vector<float> planes(nn * 5, 0.f);
+    float* x1 = &planes[0];
+    float* y1 = x1 + nn;
+    float* x2 = y1 + nn;
+    float* y2 = x2 + nn;
+    float* areas = y2 + nn;
+
+    std::vector<int> plabels(labels ? nn : 0, 0);
+
+    for (int i = 0; i < n; i++)
+    {
+        const float* r = boxes + order[i] * stride;
+
+        x1[i] = r[0];
+        y1[i] = r[1];
+        x2[i] = r[2];
+        y2[i] = r[3];
+        areas[i] = (r[2] - r[0]) * (r[3] - r[1]);
+
+        if (labels)
+            plabels[i] = labels[order[i] * stride];
+    }
+
+    // one bit per candidate, set once a kept box overlaps it
+    std::vector<uint64_t> removed((nn + 63) / 64, 0);
+
+    for (int i = 0; i < n; i++)
+    {
+        if (removed[i >> 6] & ((uint64_t)1 << (i & 63)))
+            continue;
+
+        picked.push_back(order[i]);
+
+        if ((int)picked.size() == max_picked)
+            break;
+
+        const float ix1 = x1[i];
+        const float iy1 = y1[i];
+        const float ix2 = x2[i];
+        const float iy2 = y2[i];
+        const float iarea = areas[i];
+        const int ilabel = labels ? plabels[i] : 0;
+
+        // start from the aligned block holding i + 1, bits at or before i are never read again
+        int j = (i + 1) & ~3;
+#if __SSE2__
+        __m128 _x1 = _mm_set1_ps(ix1);
+        __m128 _y1 = _mm_set1_ps(iy1);
+        __m128 _x2 = _mm_set1_ps(ix2);
+        __m128 _y2 = _mm_set1_ps(iy2);
+        __m128 _area = _mm_set1_ps(iarea);
+        __m128 _thresh = _mm_set1_ps(nms_threshold);
+        __m128 _zero = _mm_setzero_ps();
+        __m128i _label = _mm_set1_epi32(ilabel);
+        for (; j < nn; j += 4)
+        {
+            __m128 _w = _mm_sub_ps(_mm_min_ps(_x2, _mm_loadu_ps(x2 + j)), _mm_max_ps(_x1, _mm_loadu_ps(x1 + j)));
+            __m128 _h = _mm_sub_ps(_mm_min_ps(_y2, _mm_loadu_ps(y2 + j)), _mm_max_ps(_y1, _mm_loadu_ps(y1 + j)));
+            __m128 _inter = _mm_mul_ps(_mm_max_ps(_w, _zero), _mm_max_ps(_h, _zero));
+            __m128 _union = _mm_sub_ps(_mm_add_ps(_mm_loadu_ps(areas + j), _area), _inter);
+            __m128 _overlap = _mm_cmpgt_ps(_mm_div_ps(_inter, _union), _thresh);
+
+            if (labels)
+            {
+                __m128i _same = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(&plabels[j])), _label);
+                _overlap = _mm_and_ps(_overlap, _mm_castsi128_ps(_same));
+            }
+
+            removed[j >> 6] |= (uint64_t)_mm_movemask_ps(_overlap) << (j & 63);
+        }
+#elif __ARM_NEON && __aarch64__
+        float32x4_t _x1 = vdupq_n_f32(ix1);
+        float32x4_t _y1 = vdupq_n_f32(iy1);
+        float32x4_t _x2 = vdupq_n_f32(ix2);
+        float32x4_t _y2 = vdupq_n_f32(iy2);
+        float32x4_t _area = vdupq_n_f32(iarea);
+        float32x4_t _thresh = vdupq_n_f32(nms_threshold);
+        float32x4_t _zero = vdupq_n_f32(0.f);
+        int32x4_t _label = vdupq_n_s32(ilabel);
+        const uint32_t bits[4] = { 1, 2, 4, 8 };
+        uint32x4_t _bits = vld1q_u32(bits);
+        for (; j < nn; j += 4)
+        {
+            float32x4_t _w = vsubq_f32(vminq_f32(_x2, vld1q_f32(x2 + j)), vmaxq_f32(_x1, vld1q_f32(x1 + j)));
+            float32x4_t _h = vsubq_f32(vminq_f32(_y2, vld1q_f32(y2 + j)), vmaxq_f32(_y1, vld1q_f32(y1 + j)));
+            float32x4_t _inter = vmulq_f32(vmaxq_f32(_w, _zero), vmaxq_f32(_h, _zero));
+            float32x4_t _union = vsubq_f32(vaddq_f32(vld1q_f32(areas + j), _area), _inter);
+            uint32x4_t _overlap = vcgtq_f32(vdivq_f32(_inter, _union), _thresh);
+
+            if (labels)
+            {
+                _overlap = vandq_u32(_overlap, vceqq_s32(vld1q_s32(&plabels[j]), _label));
+            }
+
+            removed[j >> 6] |= (uint64_t)vaddvq_u32(vandq_u32(_overlap, _bits)) << (j & 63);
+        }
+#endif // __SSE2__
+        for (; j < n; j++)
+        {
+            float w = std::max(std::min(ix2, x2[j]) - std::max(ix1, x1[j]), 0.f);
+            float h = std::max(std::min(iy2, y2[j]) - std::max(iy1, y1[j]), 0.f);
+            float inter = w * h;
+            float union_area = areas[j] + iarea - inter;
+
+            if (inter / union_area > nms_threshold && (!labels || plabels[j] == ilabel))
+                removed[j >> 6] |= (uint64_t)1 << (j & 63);
+        }
+    }
+}
+
+} // namespace ncnn
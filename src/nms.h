@@ -0,0 +1,35 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#ifndef NCNN_NMS_H
+#define NCNN_NMS_H
+
+#include <vector>
+
+namespace ncnn {
+
+// indices of the top_k highest scores, highest first, equal scores keep their input order
+// only the top_k are selected and sorted, every index is sorted when top_k <= 0
+void topk_descent_indices(const float* scores, int n, int top_k, std::vector<int>& indices);
+
+// greedy non maximum suppression, boxes are visited in the given order
+// box i is the floats x1 y1 x2 y2 at boxes + i * stride
+// with labels, box i has label labels[i * stride] and only boxes of the same label suppress each other
+// picked receives the indices of the kept boxes in visiting order, at most max_picked when > 0
+void nms_sorted_bboxes(const float* boxes, int stride, const int* order, int n, std::vector<int>& picked, float nms_threshold, const int* labels = 0, int max_picked = 0);
+
+} // namespace ncnn
+
+#endif // NCNN_NMS_H
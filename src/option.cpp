@@ -43,6 +43,12 @@ Option::Option()
 
     use_packing_layout = false;
 
+    use_adaptive_threads = false;
+
+    autotuner = 0;
+
+    use_blob_view = false;
+
     // sanitize
     if (num_threads <= 0)
         num_threads = 1;
@@ -24,6 +24,7 @@ class VkAllocator;
 #endif // NCNN_VULKAN
 
 class Allocator;
+class AutoTuner;
 class Option
 {
 public:
@@ -87,6 +88,24 @@ public:
 
     //
     bool use_packing_layout;
+
+    // pick the thread count of each layer from its estimated cost
+    // tiny layers run on fewer threads to avoid the openmp wakeup overhead
+    // num_threads is the upper bound
+    // disabled by default
+    bool use_adaptive_threads;
+
+    // pick the fastest implementation of each layer by timing the candidates
+    // on the first run of every input shape, see autotune.h
+    // the tuner must outlive the net
+    // null by default, which keeps the built-in heuristics
+    AutoTuner* autotuner;
+
+    // let slice and crop return a channel or row range of their input
+    // instead of a copy, the output refers to the input memory without holding it
+    // the net turns this on for the layers it runs and keeps the input alive
+    // disabled by default
+    bool use_blob_view;
 };
 
 } // namespace ncnn
@@ -0,0 +1,377 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "net.h"
+
+// depthwise followed by 1x1 convolution, fused by Net::fuse_network
+static const char dw_conv_param[] =
+    "7767517\n"
+    "4 4\n"
+    "Input data 0 1 data 0=12 1=12 2=16\n"
+    "ConvolutionDepthWise dw 1 1 data dw 0=16 1=3 4=1 5=1 6=144 7=16\n"
+    "Convolution conv 1 1 dw conv 0=32 1=1 5=1 6=512\n"
+    "ReLU relu 1 1 conv out\n";
+
+// the same network with a noop in between, which keeps the layers apart
+static const char dw_noop_conv_param[] =
+    "7767517\n"
+    "5 5\n"
+    "Input data 0 1 data 0=12 1=12 2=16\n"
+    "ConvolutionDepthWise dw 1 1 data dw 0=16 1=3 4=1 5=1 6=144 7=16\n"
+    "Noop noop 1 1 dw dw_noop\n"
+    "Convolution conv 1 1 dw_noop conv 0=32 1=1 5=1 6=512\n"
+    "ReLU relu 1 1 conv out\n";
+
+// exposes the graph, which fusion must leave as it was saved
+class GraphNet : public ncnn::Net
+{
+public:
+    const std::vector<ncnn::Blob>& graph_blobs() const
+    {
+        return blobs;
+    }
+    const std::vector<ncnn::Layer*>& graph_layers() const
+    {
+        return layers;
+    }
+};
+
+static void append_weight(std::vector<unsigned char>& model, int size, bool flag, float seed)
+{
+    if (flag)
+    {
+        unsigned int tag = 0;
+        model.insert(model.end(), (const unsigned char*)&tag, (const unsigned char*)&tag + 4);
+    }
+
+    for (int i = 0; i < size; i++)
+    {
+        float v = sinf(seed + i * 0.37f) * 0.5f;
+        model.insert(model.end(), (const unsigned char*)&v, (const unsigned char*)&v + 4);
+    }
+}
+
+static int load_dw_conv_net(ncnn::Net& net, std::vector<unsigned char>& model, const char* param = dw_conv_param)
+{
+    append_weight(model, 144, true, 0.1f);
+    append_weight(model, 16, false, 0.2f);
+    append_weight(model, 512, true, 0.3f);
+    append_weight(model, 32, false, 0.4f);
+
+    net.opt.use_packing_layout = false;
+
+    if (net.load_param_mem(param) != 0)
+        return -1;
+
+    if (net.load_model(&model[0]) != (int)model.size())
+        return -1;
+
+    return 0;
+}
+
+static ncnn::Mat make_input()
+{
+    ncnn::Mat in(12, 12, 16);
+    for (int q = 0; q < in.c; q++)
+    {
+        float* ptr = in.channel(q);
+        for (int i = 0; i < in.w * in.h; i++)
+        {
+            ptr[i] = cosf(q * 0.7f + i * 0.11f);
+        }
+    }
+
+    return in;
+}
+
+static int compare_mat(const ncnn::Mat& a, const ncnn::Mat& b, const char* what)
+{
+    if (a.w != b.w || a.h != b.h || a.c != b.c)
+    {
+        fprintf(stderr, "%s shape mismatch %d %d %d vs %d %d %d\n", what, a.w, a.h, a.c, b.w, b.h, b.c);
+        return -1;
+    }
+
+    for (int q = 0; q < a.c; q++)
+    {
+        const float* pa = a.channel(q);
+        const float* pb = b.channel(q);
+        for (int i = 0; i < a.w * a.h; i++)
+        {
+            if (fabsf(pa[i] - pb[i]) > 1e-4f * (1.f + fabsf(pb[i])))
+            {
+                fprintf(stderr, "%s value mismatch at %d %d %f vs %f\n", what, q, i, pa[i], pb[i]);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// extracting the fused depthwise output and the convolution output from one light mode extractor
+static int test_net_fused_depthwise_extract()
+{
+    ncnn::Net net;
+    std::vector<unsigned char> model;
+    if (load_dw_conv_net(net, model) != 0)
+    {
+        fprintf(stderr, "load_dw_conv_net failed\n");
+        return -1;
+    }
+
+    ncnn::Mat in = make_input();
+
+    // references from separate extractors
+    ncnn::Mat dw_ref;
+    ncnn::Mat out_ref;
+    {
+        ncnn::Extractor ex = net.create_extractor();
+        ex.set_light_mode(false);
+        ex.input("data", in);
+        if (ex.extract("dw", dw_ref) != 0 || ex.extract("out", out_ref) != 0)
+            return -1;
+    }
+
+    // depthwise first, then the convolution that reads the depthwise input directly
+    {
+        ncnn::Extractor ex = net.create_extractor();
+        ex.set_light_mode(true);
+        ex.input("data", in);
+
+        ncnn::Mat dw;
+        ncnn::Mat out;
+        if (ex.extract("dw", dw) != 0 || ex.extract("out", out) != 0)
+        {
+            fprintf(stderr, "extract dw then out failed\n");
+            return -1;
+        }
+
+        if (compare_mat(dw, dw_ref, "dw then out, dw") != 0 || compare_mat(out, out_ref, "dw then out, out") != 0)
+            return -1;
+    }
+
+    // and the other way around
+    {
+        ncnn::Extractor ex = net.create_extractor();
+        ex.set_light_mode(true);
+        ex.input("data", in);
+
+        ncnn::Mat out;
+        ncnn::Mat dw;
+        if (ex.extract("out", out) != 0 || ex.extract("dw", dw) != 0)
+        {
+            fprintf(stderr, "extract out then dw failed\n");
+            return -1;
+        }
+
+        if (compare_mat(dw, dw_ref, "out then dw, dw") != 0 || compare_mat(out, out_ref, "out then dw, out") != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+// the fused pair against the plain layers, and the graph written back by tools
+static int test_net_fused_depthwise_unfused()
+{
+    GraphNet net;
+    std::vector<unsigned char> model;
+    if (load_dw_conv_net(net, model) != 0)
+    {
+        fprintf(stderr, "load_dw_conv_net failed\n");
+        return -1;
+    }
+
+    ncnn::Net net_unfused;
+    std::vector<unsigned char> model_unfused;
+    if (load_dw_conv_net(net_unfused, model_unfused, dw_noop_conv_param) != 0)
+    {
+        fprintf(stderr, "load_dw_conv_net unfused failed\n");
+        return -1;
+    }
+
+    const std::vector<ncnn::Layer*>& layers = net.graph_layers();
+    const std::vector<ncnn::Blob>& blobs = net.graph_blobs();
+    const ncnn::Layer* conv = layers[2];
+    if (conv->bottoms.size() != 1 || blobs[conv->bottoms[0]].name != "dw" || blobs[conv->bottoms[0]].consumers.size() != 1)
+    {
+        fprintf(stderr, "fusion rewrote the graph\n");
+        return -1;
+    }
+
+    ncnn::Mat in = make_input();
+
+    ncnn::Mat out_ref;
+    {
+        ncnn::Extractor ex = net_unfused.create_extractor();
+        ex.set_light_mode(false);
+        ex.input("data", in);
+        if (ex.extract("out", out_ref) != 0)
+            return -1;
+    }
+
+    for (int light = 0; light < 2; light++)
+    {
+        ncnn::Extractor ex = net.create_extractor();
+        ex.set_light_mode(light);
+        ex.input("data", in);
+
+        ncnn::Mat out;
+        if (ex.extract("out", out) != 0)
+        {
+            fprintf(stderr, "extract out failed\n");
+            return -1;
+        }
+
+        if (compare_mat(out, out_ref, light ? "fused light, out" : "fused, out") != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+#if NCNN_REQUANT
+// int8 convolutions around a residual convolution, the residual add stays in fp32
+static const char residual_int8_param[] =
+    "7767517\n"
+    "6 7\n"
+    "Input data 0 1 data 0=8 1=8 2=8\n"
+    "Split split 1 2 data data0 data1\n"
+    "Convolution conv0 1 1 data0 a 0=8 1=3 4=1 5=1 6=576 8=1\n"
+    "Convolution convr 1 1 data1 r 0=8 1=1 5=1 6=64 8=1\n"
+    "Convolution conv1 2 1 a r b 0=8 1=1 5=1 6=64 8=1 19=1\n"
+    "Convolution conv2 1 1 b out 0=8 1=1 5=1 6=64 8=1\n";
+
+// the same network with noops that keep every blob in fp32
+static const char residual_fp32_param[] =
+    "7767517\n"
+    "9 10\n"
+    "Input data 0 1 data 0=8 1=8 2=8\n"
+    "Split split 1 2 data data0 data1\n"
+    "Convolution conv0 1 1 data0 a 0=8 1=3 4=1 5=1 6=576 8=1\n"
+    "Noop noopa 1 1 a a_noop\n"
+    "Convolution convr 1 1 data1 r 0=8 1=1 5=1 6=64 8=1\n"
+    "Noop noopr 1 1 r r_noop\n"
+    "Convolution conv1 2 1 a_noop r_noop b 0=8 1=1 5=1 6=64 8=1 19=1\n"
+    "Noop noopb 1 1 b b_noop\n"
+    "Convolution conv2 1 1 b_noop out 0=8 1=1 5=1 6=64 8=1\n";
+
+static void append_value(std::vector<unsigned char>& model, int size, float v)
+{
+    for (int i = 0; i < size; i++)
+    {
+        model.insert(model.end(), (const unsigned char*)&v, (const unsigned char*)&v + 4);
+    }
+}
+
+// fp32 weights, quantized at load time with the given input scale
+static void append_int8_conv(std::vector<unsigned char>& model, int weight_size, float seed, float bottom_scale)
+{
+    append_weight(model, weight_size, true, seed);
+    append_weight(model, 8, false, seed + 0.5f);
+    append_value(model, 8, 254.f);
+    append_value(model, 1, bottom_scale);
+}
+
+static int load_residual_int8_net(ncnn::Net& net, std::vector<unsigned char>& model, const char* param)
+{
+    append_int8_conv(model, 576, 0.1f, 127.f);
+    append_int8_conv(model, 64, 0.2f, 127.f);
+    append_int8_conv(model, 64, 0.3f, 6.f);
+    append_int8_conv(model, 64, 0.4f, 3.f);
+
+    net.opt.use_packing_layout = false;
+    net.opt.use_int8_inference = true;
+
+    if (net.load_param_mem(param) != 0)
+        return -1;
+
+    if (net.load_model(&model[0]) != (int)model.size())
+        return -1;
+
+    return 0;
+}
+
+// a residual convolution neither takes int8 residuals nor requantizes its output
+static int test_net_requantize_residual()
+{
+    ncnn::Net net;
+    std::vector<unsigned char> model;
+    if (load_residual_int8_net(net, model, residual_int8_param) != 0)
+    {
+        fprintf(stderr, "load_residual_int8_net failed\n");
+        return -1;
+    }
+
+    ncnn::Net net_fp32;
+    std::vector<unsigned char> model_fp32;
+    if (load_residual_int8_net(net_fp32, model_fp32, residual_fp32_param) != 0)
+    {
+        fprintf(stderr, "load_residual_int8_net fp32 failed\n");
+        return -1;
+    }
+
+    ncnn::Mat in(8, 8, 8);
+    for (int q = 0; q < in.c; q++)
+    {
+        float* ptr = in.channel(q);
+        for (int i = 0; i < in.w * in.h; i++)
+        {
+            ptr[i] = cosf(q * 0.7f + i * 0.11f);
+        }
+    }
+
+    ncnn::Mat out_ref;
+    {
+        ncnn::Extractor ex = net_fp32.create_extractor();
+        ex.input("data", in);
+        if (ex.extract("out", out_ref) != 0)
+        {
+            fprintf(stderr, "extract fp32 out failed\n");
+            return -1;
+        }
+    }
+
+    ncnn::Mat out;
+    {
+        ncnn::Extractor ex = net.create_extractor();
+        ex.input("data", in);
+        if (ex.extract("out", out) != 0)
+        {
+            fprintf(stderr, "extract requantized out failed\n");
+            return -1;
+        }
+    }
+
+    return compare_mat(out, out_ref, "requantized residual, out");
+}
+#endif // NCNN_REQUANT
+
+int main()
+{
+    return 0
+           || test_net_fused_depthwise_extract()
+           || test_net_fused_depthwise_unfused()
+#if NCNN_REQUANT
+           || test_net_requantize_residual()
+#endif // NCNN_REQUANT
+           ;
+}
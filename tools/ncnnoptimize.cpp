@@ -106,7 +106,7 @@ public:
 class NetOptimize : public ncnn::Net
 {
 public:
-    // 0=fp32 1=fp16
+    // 0=fp32 1=fp16 2=int8 weight-only 3=int4 weight-only
     int storage_type;
 
 public:
@@ -117,6 +117,7 @@ public:
     int fuse_deconvolutiondepthwise_batchnorm();
     int fuse_innerproduct_batchnorm();
     int fuse_innerproduct_dropout();
+    int fuse_convolution_eltwise();
     int fuse_convolution_activation();
     int fuse_convolutiondepthwise_activation();
     int fuse_deconvolution_activation();
@@ -141,6 +142,7 @@ public:
 
     int fwrite_weight_tag_data(int tag, const ncnn::Mat& data, FILE* bp);
     int fwrite_weight_data(const ncnn::Mat& data, FILE* bp);
+    int fwrite_weight_quantized_data(const ncnn::Mat& weight_data, const ncnn::Mat& bias_data, int rows, int weight_quant_type, int group_size, FILE* bp);
 
     int save(const char* parampath, const char* binpath);
 
@@ -866,6 +868,133 @@ int NetOptimize::fuse_innerproduct_dropout()
     return 0;
 }
 
+int NetOptimize::fuse_convolution_eltwise()
+{
+    const int layer_count = layers.size();
+    for (int i=0; i<layer_count; i++)
+    {
+        if (layers[i]->type != "Convolution")
+            continue;
+
+        ncnn::Convolution* convolution = (ncnn::Convolution*)layers[i];
+
+        // the convolution activation comes before the sum
+        if (convolution->activation_type != 0 || convolution->residual_term != 0)
+            continue;
+
+        // Convolution - Eltwise sum
+        int top_blob_index = layers[i]->tops[0];
+
+        int j = i + 1;
+        for (; j<layer_count; j++)
+        {
+            if (layers[j]->type != "Eltwise")
+                continue;
+
+            if (layers[j]->bottoms.size() != 2)
+                continue;
+
+            if (layers[j]->bottoms[0] == top_blob_index || layers[j]->bottoms[1] == top_blob_index)
+                break;
+        }
+
+        if (j == layer_count)
+            continue;
+
+        ncnn::Eltwise* eltwise = (ncnn::Eltwise*)layers[j];
+
+        if (eltwise->op_type != ncnn::Eltwise::Operation_SUM)
+            continue;
+
+        bool unit_coeffs = true;
+        for (int k=0; k<eltwise->coeffs.w; k++)
+        {
+            if (eltwise->coeffs[k] != 1.f)
+                unit_coeffs = false;
+        }
+
+        if (!unit_coeffs)
+            continue;
+
+        // fuse Convolution - Eltwise to Convolution with residual input
+        fprintf(stderr, "fuse_convolution_eltwise %s %s\n", convolution->name.c_str(), eltwise->name.c_str());
+
+        int residual_blob_index = eltwise->bottoms[0] == top_blob_index ? eltwise->bottoms[1] : eltwise->bottoms[0];
+
+        convolution->residual_term = 1;
+        convolution->bottoms.push_back(residual_blob_index);
+
+        // the residual blob may be produced after the convolution, take the eltwise position
+        layers[i] = eltwise;
+        layers[j] = convolution;
+
+        std::vector<int>& consumers = blobs[convolution->bottoms[0]].consumers;
+        std::replace(consumers.begin(), consumers.end(), i, j);
+
+        int top_blob_index_final = eltwise->tops[0];
+        convolution->tops[0] = top_blob_index_final;
+        blobs[top_blob_index_final].producer = j;
+        eltwise->type = "ncnnfused";
+
+        // Convolution - Activation after the sum
+        int k = j + 1;
+        for (; k<layer_count; k++)
+        {
+            if (layers[k]->type != "ReLU" && layers[k]->type != "Clip" && layers[k]->type != "Sigmoid")
+                continue;
+
+            if (layers[k]->bottoms.size() != 1)
+                continue;
+
+            if (layers[k]->bottoms[0] == top_blob_index_final)
+                break;
+        }
+
+        if (k == layer_count)
+            continue;
+
+        ncnn::Layer* activation = layers[k];
+
+        fprintf(stderr, "fuse_convolution_eltwise_activation %s %s\n", convolution->name.c_str(), activation->name.c_str());
+
+        if (activation->type == "ReLU")
+        {
+            ncnn::ReLU* relu = (ncnn::ReLU*)activation;
+
+            if (relu->slope == 0.f)
+            {
+                convolution->residual_activation_type = 1;
+            }
+            else
+            {
+                convolution->residual_activation_type = 2;
+                convolution->residual_activation_params = ncnn::Mat(1);
+                convolution->residual_activation_params[0] = relu->slope;
+            }
+        }
+        else if (activation->type == "Clip")
+        {
+            ncnn::Clip* clip = (ncnn::Clip*)activation;
+
+            convolution->residual_activation_type = 3;
+            convolution->residual_activation_params = ncnn::Mat(2);
+            convolution->residual_activation_params[0] = clip->min;
+            convolution->residual_activation_params[1] = clip->max;
+        }
+        else if (activation->type == "Sigmoid")
+        {
+            convolution->residual_activation_type = 4;
+        }
+
+        top_blob_index_final = activation->tops[0];
+        convolution->tops[0] = top_blob_index_final;
+        blobs[top_blob_index_final].producer = j;
+        activation->type = "ncnnfused";
+    }
+
+    return 0;
+}
+
 int NetOptimize::fuse_convolution_activation()
 {
     const int layer_count = layers.size();
@@ -874,6 +1003,10 @@ int NetOptimize::fuse_convolution_activation()
         if (layers[i]->type != "Convolution")
             continue;
 
+        // the sum activation is fused already
+        if (((ncnn::Convolution*)layers[i])->residual_term)
+            continue;
+
         // Convolution - Activation
         int top_blob_index = layers[i]->tops[0];
 
@@ -1814,6 +1947,20 @@ int NetOptimize::fwrite_weight_data(const ncnn::Mat& data, FILE* bp)
     return 0;
 }
 
+int NetOptimize::fwrite_weight_quantized_data(const ncnn::Mat& weight_data, const ncnn::Mat& bias_data, int rows, int weight_quant_type, int group_size, FILE* bp)
+{
+    ncnn::Mat weight_data_quantized;
+    ncnn::Mat weight_data_quantize_scales;
+    ncnn::quantize_weight(weight_data, weight_data_quantized, weight_data_quantize_scales, rows, weight_quant_type, group_size);
+
+    // the order load_model reads them in
+    fwrite_weight_tag_data(0x000D4B38, weight_data_quantized, bp);
+    fwrite_weight_data(bias_data, bp);
+    fwrite_weight_data(weight_data_quantize_scales, bp);
+
+    return 0;
+}
+
 int NetOptimize::save(const char* parampath, const char* binpath)
 {
     FILE* pp = fopen(parampath, "wb");
@@ -1951,9 +2098,27 @@ int NetOptimize::save(const char* parampath, const char* binpath)
             fprintf_param_value(" 9=%d", activation_type)
             { if (!op->activation_params.empty()) fprintf_param_float_array(10, op->activation_params, pp); }
             fprintf_param_value(" 17=%d", impl_type)
+            fprintf_param_value(" 19=%d", residual_term)
+            fprintf_param_value(" 20=%d", residual_activation_type)
+            { if (!op->residual_activation_params.empty()) fprintf_param_float_array(21, op->residual_activation_params, pp); }
 
-            fwrite_weight_tag_data(0, op->weight_data, bp);
-            fwrite_weight_data(op->bias_data, bp);
+            // weight-only quantization applies to 1x1 convolution
+            int weight_quant_type = op->weight_quant_type;
+            if (storage_type >= 2 && op->kernel_w == 1 && op->kernel_h == 1 && op->int8_scale_term == 0)
+                weight_quant_type = storage_type - 1;
+
+            { if (weight_quant_type != 0) fprintf(pp, " 22=%d", weight_quant_type); }
+            { if (weight_quant_type == 2) fprintf(pp, " 23=%d", op->weight_quant_group_size); }
+
+            if (weight_quant_type)
+            {
+                fwrite_weight_quantized_data(op->weight_data, op->bias_data, op->num_output, weight_quant_type, op->weight_quant_group_size, bp);
+            }
+            else
+            {
+                fwrite_weight_tag_data(0, op->weight_data, bp);
+                fwrite_weight_data(op->bias_data, bp);
+            }
         }
         else if (layer->type == "ConvolutionDepthWise")
         {
@@ -2141,8 +2306,22 @@ int NetOptimize::save(const char* parampath, const char* binpath)
             fprintf_param_value(" 9=%d", activation_type)
             { if (!op->activation_params.empty()) fprintf_param_float_array(10, op->activation_params, pp); }
 
-            fwrite_weight_tag_data(0, op->weight_data, bp);
-            fwrite_weight_data(op->bias_data, bp);
+            int weight_quant_type = op->weight_quant_type;
+            if (storage_type >= 2 && op->int8_scale_term == 0)
+                weight_quant_type = storage_type - 1;
+
+            { if (weight_quant_type != 0) fprintf(pp, " 11=%d", weight_quant_type); }
+            { if (weight_quant_type == 2) fprintf(pp, " 12=%d", op->weight_quant_group_size); }
+
+            if (weight_quant_type)
+            {
+                fwrite_weight_quantized_data(op->weight_data, op->bias_data, op->num_output, weight_quant_type, op->weight_quant_group_size, bp);
+            }
+            else
+            {
+                fwrite_weight_tag_data(0, op->weight_data, bp);
+                fwrite_weight_data(op->bias_data, bp);
+            }
         }
         else if (layer->type == "Input")
         {
@@ -2545,6 +2724,7 @@ int main(int argc, char** argv)
     if (argc != 10)
     {
         fprintf(stderr, "usage: %s [inparam] [inbin] [outparam] [outbin] [flag] [dataname] [w] [h] [c]\n", argv[0]);
+        fprintf(stderr, "  flag: 0=fp32 1=fp16 2=int8 weight-only 3=int4 weight-only\n");
         return -1;
     }
     const char* dataname = argv[6];
@@ -2555,6 +2735,7 @@ int main(int argc, char** argv)
     if (argc != 6)
     {
         fprintf(stderr, "usage: %s [inparam] [inbin] [outparam] [outbin] [flag]\n", argv[0]);
+        fprintf(stderr, "  flag: 0=fp32 1=fp16 2=int8 weight-only 3=int4 weight-only\n");
         return -1;
     }
 #endif // defined(__aarch64__) && defined(LINUX)
@@ -2567,15 +2748,18 @@ int main(int argc, char** argv)
 
     NetOptimize optimizer;
 
-    if (flag == 1)
+    if (flag == 1 || flag == 2 || flag == 3)
     {
-        optimizer.storage_type = 1;
+        optimizer.storage_type = flag;
     }
     else
     {
         optimizer.storage_type = 0;
     }
 
+    // the layers must keep their fp32 weights around for rewriting
+    optimizer.opt.lightmode = false;
+
     optimizer.load_param(inparam);
     if (strcmp(inbin, "null") == 0)
     {
@@ -2595,6 +2779,7 @@ int main(int argc, char** argv)
     optimizer.fuse_deconvolutiondepthwise_batchnorm();
     optimizer.fuse_innerproduct_batchnorm();
     optimizer.fuse_innerproduct_dropout();
+    optimizer.fuse_convolution_eltwise();
     optimizer.fuse_convolution_activation();
     optimizer.fuse_convolutiondepthwise_activation();
     optimizer.fuse_deconvolution_activation();
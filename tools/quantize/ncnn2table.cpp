@@ -26,6 +26,9 @@
 #include <stdlib.h>
 #include <algorithm>
 #include <map>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
@@ -44,6 +47,15 @@ static ncnn::Option g_default_option;
 static ncnn::UnlockedPoolAllocator g_blob_pool_allocator;
 static ncnn::PoolAllocator g_workspace_pool_allocator;
 
+static int get_thread_num()
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
 // Get the filenames from direct path
 int parse_images_dir(const char *base_path, std::vector<std::string>& file_path)
 {
@@ -227,6 +239,14 @@ int QuantNet::get_conv_weight_blob_scales()
     return 0;
 }
 
+// threshold search method
+enum
+{
+    METHOD_KL = 0,
+    METHOD_PERCENTILE = 1,
+    METHOD_MSE = 2
+};
+
 class QuantizeData
 {
 public:
@@ -239,13 +259,21 @@ public:
     int normalize_histogram(); 
     int update_histogram(ncnn::Mat data);
 
+    // fold the max value and histogram collected by another worker into this one
+    int merge(const QuantizeData& other);
+
     float compute_kl_divergence(const std::vector<float> &dist_a, const std::vector<float> &dist_b);
     int threshold_distribution(const std::vector<float> &distribution, const int target_bin=128);
+    int threshold_percentile(const std::vector<float> &distribution, const float percentile);
+    int threshold_mse(const std::vector<float> &distribution, const int target_bin=128);
     float get_data_blob_scale();
 
 public:
     std::string name;
 
+    int method;
+    float percentile;
+
     float max_value;
     int num_bins;
     float histogram_interval;
@@ -259,6 +287,8 @@ public:
 QuantizeData::QuantizeData(std::string layer_name, int num)
 {
     name = layer_name;
+    method = METHOD_KL;
+    percentile = 0.9999f;
     max_value = 0.0;
     num_bins = num;
     histogram_interval = 0.0;
@@ -327,7 +357,7 @@ int QuantizeData::update_histogram(ncnn::Mat data)
             if (data_n[i] == 0)
                 continue;
 
-            int index = std::min(static_cast<int>(std::abs(data_n[i]) / histogram_interval), 2047);
+            int index = std::min(static_cast<int>(std::abs(data_n[i]) / histogram_interval), num_bins - 1);
 
             histogram[index]++;
         }
@@ -336,6 +366,16 @@ int QuantizeData::update_histogram(ncnn::Mat data)
     return 0;
 }
 
+int QuantizeData::merge(const QuantizeData& other)
+{
+    max_value = std::max(max_value, other.max_value);
+
+    for (int i=0; i<num_bins; i++)
+        histogram[i] += other.histogram[i];
+
+    return 0;
+}
+
 float QuantizeData::compute_kl_divergence(const std::vector<float> &dist_a, const std::vector<float> &dist_b) 
 {
     const int length = dist_a.size();
@@ -493,10 +533,71 @@ int QuantizeData::threshold_distribution(const std::vector<float> &distribution,
     return target_threshold;
 }
 
+// smallest threshold that keeps the given fraction of the values unclipped
+int QuantizeData::threshold_percentile(const std::vector<float> &distribution, const float percentile)
+{
+    const int length = distribution.size();
+
+    float sum = 0;
+    for (int i=0; i<length; i++)
+    {
+        sum += distribution[i];
+        if (sum >= percentile)
+            return i + 1;
+    }
+
+    return length;
+}
+
+// threshold that minimizes the expected squared error of clipping plus rounding
+int QuantizeData::threshold_mse(const std::vector<float> &distribution, const int target_bin)
+{
+    const int length = distribution.size();
+
+    // prefix sums of p, p*x and p*x*x over the bin centers in bin units
+    std::vector<double> sum0(length + 1, 0.0);
+    std::vector<double> sum1(length + 1, 0.0);
+    std::vector<double> sum2(length + 1, 0.0);
+    for (int i=0; i<length; i++)
+    {
+        const double x = i + 0.5;
+        sum0[i + 1] = sum0[i] + distribution[i];
+        sum1[i + 1] = sum1[i] + distribution[i] * x;
+        sum2[i + 1] = sum2[i] + distribution[i] * x * x;
+    }
+
+    int target_threshold = length;
+    double min_error = -1;
+
+    for (int threshold=target_bin; threshold<=length; threshold++)
+    {
+        // values below the threshold get uniform rounding noise of step^2/12
+        const double step = threshold / 127.0;
+        double error = sum0[threshold] * step * step / 12;
+
+        // values above it are clipped to the threshold
+        const double t = threshold;
+        error += (sum2[length] - sum2[threshold]) - 2 * t * (sum1[length] - sum1[threshold]) + t * t * (sum0[length] - sum0[threshold]);
+
+        if (min_error < 0 || error < min_error)
+        {
+            min_error = error;
+            target_threshold = threshold;
+        }
+    }
+
+    return target_threshold;
+}
+
 float QuantizeData::get_data_blob_scale()
 {   
     normalize_histogram();
-    threshold_bin = threshold_distribution(histogram);
+    if (method == METHOD_PERCENTILE)
+        threshold_bin = threshold_percentile(histogram, percentile);
+    else if (method == METHOD_MSE)
+        threshold_bin = threshold_mse(histogram);
+    else
+        threshold_bin = threshold_distribution(histogram);
     threshold = (threshold_bin + 0.5) * histogram_interval;
     scale = 127 / threshold;
     return scale;
@@ -511,29 +612,100 @@ struct PreParam
     bool swapRB;
 };
 
-static int post_training_quantize(const std::vector<std::string> filenames, const char* param_path, const char* bin_path, const char* table_path, struct PreParam per_param)
+struct CalibrationParam
 {
-    int size = filenames.size();
+    int method;
+    float percentile;
+    std::map<std::string,int> layer_methods;
+};
+
+// run the calibration images through one extractor per worker thread,
+// each image is decoded by the worker that consumes it
+// step 1 collects the max value, otherwise the histogram
+static int collect_activation(QuantNet& net, const std::vector<std::string>& filenames, const struct PreParam& per_param, int step, std::vector<std::vector<QuantizeData> >& worker_datas)
+{
+    const int size = filenames.size();
+    const int num_workers = worker_datas.size();
+
+    std::vector<ncnn::UnlockedPoolAllocator> blob_pool_allocators(num_workers);
+
+    // each worker records its own failure, merged once the loop is done
+    std::vector<int> worker_rets(num_workers, 0);
+    int processed = 0;
+
+    #pragma omp parallel for num_threads(num_workers) schedule(dynamic)
+    for (int i=0; i<size; i++)
+    {
+        const int tid = get_thread_num();
+        if (worker_rets[tid] != 0)
+            continue;
+
+        std::vector<QuantizeData>& quantize_datas = worker_datas[tid];
+
+        const std::string& img_name = filenames[i];
+
+#if OpenCV_VERSION_MAJOR > 2
+        cv::Mat bgr = cv::imread(img_name, cv::IMREAD_COLOR);
+#else
+        cv::Mat bgr = cv::imread(img_name, CV_LOAD_IMAGE_COLOR);
+#endif
+        if (bgr.empty())
+        {
+            fprintf(stderr, "cv::imread %s failed\n", img_name.c_str());
+            worker_rets[tid] = -1;
+            continue;
+        }
+
+        ncnn::Mat in = ncnn::Mat::from_pixels_resize(bgr.data, per_param.swapRB ? ncnn::Mat::PIXEL_BGR2RGB : ncnn::Mat::PIXEL_BGR, bgr.cols, bgr.rows, per_param.weith, per_param.height);
+        in.substract_mean_normalize(per_param.mean, per_param.norm);
+
+        ncnn::Extractor ex = net.create_extractor();
+        ex.set_blob_allocator(&blob_pool_allocators[tid]);
+        if (num_workers > 1)
+            ex.set_num_threads(1);
 
+        ex.input(net.input_names[0].c_str(), in);
+
+        for (size_t j=0; j<net.conv_names.size(); j++)
+        {
+            std::string layer_name = net.conv_names[j];
+            std::string blob_name = net.conv_bottom_blob_names[layer_name];
+
+            ncnn::Mat out;
+            ex.extract(blob_name.c_str(), out);
+
+            // quantize_datas follows the order of conv_names
+            if (step == 1)
+                quantize_datas[j].initial_blob_max(out);
+            else
+                quantize_datas[j].update_histogram(out);
+        }
+
+        int count;
+        #pragma omp atomic capture
+        count = ++processed;
+
+        if (count % 100 == 0)
+            fprintf(stderr, "          %d/%d\n", count, size);
+    }
+
+    for (int t=0; t<num_workers; t++)
+    {
+        if (worker_rets[t] != 0)
+            return worker_rets[t];
+    }
+
+    return 0;
+}
+
+static int post_training_quantize(const std::vector<std::string> filenames, const char* param_path, const char* bin_path, const char* table_path, struct PreParam per_param, const struct CalibrationParam& calib_param)
+{
     QuantNet net;
     net.opt = g_default_option;
 
     net.load_param(param_path);
     net.load_model(bin_path);
 
-    float mean_vals[3], norm_vals[3];
-    int weith = per_param.weith;
-    int height = per_param.height;
-    bool swapRB = per_param.swapRB;
-
-    mean_vals[0] = per_param.mean[0];
-    mean_vals[1] = per_param.mean[1];
-    mean_vals[2] = per_param.mean[2];
-
-    norm_vals[0] = per_param.norm[0];
-    norm_vals[1] = per_param.norm[1];
-    norm_vals[2] = per_param.norm[2];
-
     g_blob_pool_allocator.clear();
     g_workspace_pool_allocator.clear();
 
@@ -572,142 +744,99 @@ static int post_training_quantize(const std::vector<std::string> filenames, cons
         std::string layer_name = net.conv_names[i];
 
         QuantizeData quantize_data(layer_name, 2048);
-        quantize_datas.push_back(quantize_data);
-    }    
 
-    // step 1 count the max value
-    printf("====> Quantize the activation.\n"); 
-    printf("    ====> step 1 : find the max value.\n");
+        quantize_data.method = calib_param.method;
+        quantize_data.percentile = calib_param.percentile;
 
-    for (size_t i=0; i<filenames.size(); i++)
-    {
-        std::string img_name = filenames[i];
+        std::map<std::string,int>::const_iterator it = calib_param.layer_methods.find(layer_name);
+        if (it != calib_param.layer_methods.end())
+            quantize_data.method = it->second;
 
-        if ((i+1)%100 == 0)
-            fprintf(stderr, "          %d/%d\n", (int)(i+1), (int)size);
+        quantize_datas.push_back(quantize_data);
+    }    
 
-#if OpenCV_VERSION_MAJOR > 2
-        cv::Mat bgr = cv::imread(img_name, cv::IMREAD_COLOR);
-#else
-        cv::Mat bgr = cv::imread(img_name, CV_LOAD_IMAGE_COLOR);
-#endif
-        if (bgr.empty())
-        {
-            fprintf(stderr, "cv::imread %s failed\n", img_name.c_str());
-            return -1;
-        }
+    // every worker accumulates into its own copy, merged after each pass
+    const int num_workers = std::max(g_default_option.num_threads, 1);
 
-        ncnn::Mat in = ncnn::Mat::from_pixels_resize(bgr.data, swapRB ? ncnn::Mat::PIXEL_BGR2RGB : ncnn::Mat::PIXEL_BGR, bgr.cols, bgr.rows, weith, height);
-        in.substract_mean_normalize(mean_vals, norm_vals);
+    std::vector<QuantizeData> worker_init = quantize_datas;
+    for (size_t i=0; i<worker_init.size(); i++)
+    {
+        std::fill(worker_init[i].histogram.begin(), worker_init[i].histogram.end(), 0.f);
+    }
 
-        ncnn::Extractor ex = net.create_extractor();
-        ex.input(net.input_names[0].c_str(), in);
+    // step 1 count the max value
+    printf("====> Quantize the activation.\n"); 
+    printf("    ====> step 1 : find the max value.\n");
 
-        for (size_t i=0; i<net.conv_names.size(); i++)
-        {
-            std::string layer_name = net.conv_names[i];
-            std::string blob_name = net.conv_bottom_blob_names[layer_name];
+    std::vector<std::vector<QuantizeData> > worker_datas(num_workers, worker_init);
 
-            ncnn::Mat out;
-            ex.extract(blob_name.c_str(), out);  
+    int ret = collect_activation(net, filenames, per_param, 1, worker_datas);
+    if (ret != 0)
+    {
+        fclose(fp);
+        return ret;
+    }
 
-            for (size_t j=0; j<quantize_datas.size(); j++)
-            {
-                if (quantize_datas[j].name == layer_name)
-                {
-                    quantize_datas[j].initial_blob_max(out);
-                    break;
-                }
-            }
-        }         
+    for (int t=0; t<num_workers; t++)
+    {
+        for (size_t i=0; i<quantize_datas.size(); i++)
+            quantize_datas[i].merge(worker_datas[t][i]);
     }
 
     // step 2 histogram_interval
     printf("    ====> step 2 : generate the histogram_interval.\n");
-    for (size_t i=0; i<net.conv_names.size(); i++)
+    for (size_t i=0; i<quantize_datas.size(); i++)
     {
-        std::string layer_name = net.conv_names[i];
+        quantize_datas[i].initial_histogram_interval();
+        worker_init[i].histogram_interval = quantize_datas[i].histogram_interval;
 
-        for (size_t j=0; j<quantize_datas.size(); j++)
-        {
-            if (quantize_datas[j].name == layer_name)
-            {
-                quantize_datas[j].initial_histogram_interval();
-
-                fprintf(stderr, "%-20s : max = %-15f interval = %-10f\n", quantize_datas[j].name.c_str(), quantize_datas[j].max_value, quantize_datas[j].histogram_interval);
-                break;
-            }
-        }
+        fprintf(stderr, "%-20s : max = %-15f interval = %-10f\n", quantize_datas[i].name.c_str(), quantize_datas[i].max_value, quantize_datas[i].histogram_interval);
     }    
 
     // step 3 histogram
     printf("    ====> step 3 : generate the histogram.\n");
-    for (size_t i=0; i<filenames.size(); i++)
-    {
-        std::string img_name = filenames[i];
 
-        if ((i+1)%100 == 0)
-            fprintf(stderr, "          %d/%d\n", (int)(i+1), (int)size);
-#if OpenCV_VERSION_MAJOR > 2
-        cv::Mat bgr = cv::imread(img_name, cv::IMREAD_COLOR);
-#else
-        cv::Mat bgr = cv::imread(img_name, CV_LOAD_IMAGE_COLOR);
-#endif
-        if (bgr.empty())
-        {
-            fprintf(stderr, "cv::imread %s failed\n", img_name.c_str());
-            return -1;
-        }  
+    worker_datas.assign(num_workers, worker_init);
 
-        ncnn::Mat in = ncnn::Mat::from_pixels_resize(bgr.data, swapRB ? ncnn::Mat::PIXEL_BGR2RGB : ncnn::Mat::PIXEL_BGR, bgr.cols, bgr.rows, weith, height);
-        in.substract_mean_normalize(mean_vals, norm_vals);
-      
-        ncnn::Extractor ex = net.create_extractor();
-        ex.input(net.input_names[0].c_str(), in);
+    ret = collect_activation(net, filenames, per_param, 3, worker_datas);
+    if (ret != 0)
+    {
+        fclose(fp);
+        return ret;
+    }
 
-        for (size_t i=0; i<net.conv_names.size(); i++)
-        {
-            std::string layer_name = net.conv_names[i];
-            std::string blob_name = net.conv_bottom_blob_names[layer_name];
+    for (int t=0; t<num_workers; t++)
+    {
+        for (size_t i=0; i<quantize_datas.size(); i++)
+            quantize_datas[i].merge(worker_datas[t][i]);
+    }
 
-            ncnn::Mat out;
-            ex.extract(blob_name.c_str(), out);  
+    worker_datas.clear();
 
-            for (size_t j=0; j<quantize_datas.size(); j++)
-            {
-                if (quantize_datas[j].name == layer_name)
-                {
-                    quantize_datas[j].update_histogram(out);
-                    break;
-                }
-            }
-        }     
-    }
+    // step4 threshold search, one layer per thread
+    printf("    ====> step 4 : search the best threshold value.\n");
 
-    // step4 kld
-    printf("    ====> step 4 : using kld to find the best threshold value.\n");
-    for (size_t i=0; i<net.conv_names.size(); i++)
-    {
-        std::string layer_name = net.conv_names[i];
-        std::string blob_name = net.conv_bottom_blob_names[layer_name];
-        fprintf(stderr, "%-20s ", layer_name.c_str());
+    const int layer_count = quantize_datas.size();
 
-        for (size_t j=0; j<quantize_datas.size(); j++)
-        {
-            if (quantize_datas[j].name == layer_name)
-            {
-                quantize_datas[j].get_data_blob_scale();
-                fprintf(stderr, "bin : %-8d threshold : %-15f interval : %-10f scale : %-10f\n", \
-                                                                quantize_datas[j].threshold_bin, \
-                                                                quantize_datas[j].threshold, \
-                                                                quantize_datas[j].histogram_interval, \
-                                                                quantize_datas[j].scale);
+    #pragma omp parallel for num_threads(num_workers) schedule(dynamic)
+    for (int i=0; i<layer_count; i++)
+    {
+        quantize_datas[i].get_data_blob_scale();
+    }
 
-                fprintf(fp, "%s %f\n", layer_name.c_str(), quantize_datas[j].scale);
+    static const char* method_names[] = { "kl", "percentile", "mse" };
 
-                break;
-            }
-        }
+    for (size_t i=0; i<quantize_datas.size(); i++)
+    {
+        fprintf(stderr, "%-20s %-10s bin : %-8d threshold : %-15f interval : %-10f scale : %-10f\n", \
+                                                        quantize_datas[i].name.c_str(), \
+                                                        method_names[quantize_datas[i].method], \
+                                                        quantize_datas[i].threshold_bin, \
+                                                        quantize_datas[i].threshold, \
+                                                        quantize_datas[i].histogram_interval, \
+                                                        quantize_datas[i].scale);
+
+        fprintf(fp, "%s %f\n", quantize_datas[i].name.c_str(), quantize_datas[i].scale);
     }
 
     fclose(fp);
@@ -730,9 +859,24 @@ void showUsage()
     std::cout << " -s, --size       the size of input image(using the resize the original image,default is w=416,h=416)" << std::endl;
     std::cout << " -c  --swapRB     flag which indicates that swap first and last channels in 3-channel image is necessary" << std::endl;
     std::cout << " -t, --thread     number of threads(defalut is 1)" << std::endl;    
+    std::cout << " -a, --method     threshold search method, kl, percentile or mse(default is kl)" << std::endl;
+    std::cout << " -l, --layer      per layer method, overrides --method(e.g. conv1=mse,fc7=percentile)" << std::endl;
+    std::cout << " -e, --percentile kept percentage of values for the percentile method(default is 99.99)" << std::endl;
     std::cout << "example: ./ncnn2table --param squeezenet-fp32.param --bin squeezenet-fp32.bin --images images/ --output squeezenet.table --mean 104,117,123 --norm 1,1,1 --size 227,227 --swapRB --thread 2" << std::endl;
 }
 
+static int parse_method(const char* name)
+{
+    if (strcmp(name, "kl") == 0)
+        return METHOD_KL;
+    if (strcmp(name, "percentile") == 0)
+        return METHOD_PERCENTILE;
+    if (strcmp(name, "mse") == 0)
+        return METHOD_MSE;
+
+    return -1;
+}
+
 // string.split('x')
 std::vector<std::string> split(const std::string &str,const std::string &pattern)
 {
@@ -770,6 +914,10 @@ int main(int argc, char** argv)
         .swapRB = false
     };
 
+    struct CalibrationParam calib_param;
+    calib_param.method = METHOD_KL;
+    calib_param.percentile = 0.9999f;
+
     int c;
 
     while (1) 
@@ -786,11 +934,14 @@ int main(int argc, char** argv)
             {"size",    required_argument, 0,  's' },
             {"swapRB",  no_argument,       0,  'c' },
             {"thread",  required_argument, 0,  't' },
+            {"method",  required_argument, 0,  'a' },
+            {"layer",   required_argument, 0,  'l' },
+            {"percentile", required_argument, 0, 'e' },
             {"help",    no_argument,       0,  'h' },
             {0,         0,                 0,  0 }
         };
 
-        c = getopt_long(argc, argv, "p:b:i:o:m:n:s:ct:h", long_options, &option_index);
+        c = getopt_long(argc, argv, "p:b:i:o:m:n:s:ct:a:l:e:h", long_options, &option_index);
         if (c == -1)
             break;
 
@@ -859,6 +1010,39 @@ int main(int argc, char** argv)
             num_threads = atoi(optarg);
             break;            
 
+        case 'a':
+            calib_param.method = parse_method(optarg);
+            if (calib_param.method == -1)
+            {
+                fprintf(stderr, "unknown method %s\n", optarg);
+                return -1;
+            }
+            break;
+
+        case 'l':
+        {
+            printf("layer = '%s'\n", optarg);
+            std::string temp(optarg);
+            std::vector<std::string> array = split(temp, ",");
+            for (size_t i=0; i<array.size(); i++)
+            {
+                std::vector<std::string> pair = split(array[i], "=");
+                int method = pair.size() == 2 ? parse_method(pair[1].c_str()) : -1;
+                if (method == -1)
+                {
+                    fprintf(stderr, "invalid layer method %s\n", array[i].c_str());
+                    return -1;
+                }
+                calib_param.layer_methods[pair[0]] = method;
+            }
+        }
+            break;
+
+        case 'e':
+            printf("percentile = '%s'\n", optarg);
+            calib_param.percentile = atof(optarg) / 100.f;
+            break;
+
         case 'h':
         case '?':
             showUsage();
@@ -904,7 +1088,7 @@ int main(int argc, char** argv)
     parse_images_dir(imagepath, filenames);
 
     // get the calibration table file, and save it.
-    int ret = post_training_quantize(filenames, parampath, binpath, tablepath, pre_param);
+    int ret = post_training_quantize(filenames, parampath, binpath, tablepath, pre_param, calib_param);
     if (!ret)
         fprintf(stderr, "\nNCNN Int8 Calibration table create success.\n");
 